@@ -0,0 +1,171 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/binary_indices.hpp"
+#include "gesel/write_database.hpp"
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Synthetic database with 10000 sets over 20000 genes, written in both the text and binary formats.
+ */
+struct MockBinaryDatabase {
+    MockBinaryDatabase() {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_binary_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory);
+        prefix = directory + "/9606_";
+
+        std::mt19937_64 rng(42);
+        std::lognormal_distribution<double> sizes(4, 1);
+        std::vector<gesel::CollectionDetails> collections(10);
+        for (size_t c = 0; c < collections.size(); ++c) {
+            auto& coll = collections[c];
+            coll.title = "collection " + std::to_string(c);
+            coll.species = 9606;
+            coll.sets.resize(1000);
+            for (auto& set : coll.sets) {
+                set.name = "set " + std::to_string(rng() % 100000);
+                set.description = "pathway " + std::to_string(rng() % 1000) + " in tissue " + std::to_string(rng() % 100);
+                size_t n = std::min(static_cast<size_t>(sizes(rng)) + 1, num_genes);
+                for (size_t g = 0; g < n; ++g) {
+                    set.genes.push_back(rng() % num_genes);
+                }
+                std::sort(set.genes.begin(), set.genes.end());
+                set.genes.erase(std::unique(set.genes.begin(), set.genes.end()), set.genes.end());
+            }
+        }
+        gesel::write_database(prefix, collections, num_genes, gesel::WriteDatabaseOptions());
+        gesel::convert_database_to_binary(prefix, num_genes, gesel::WriteDatabaseOptions());
+    }
+
+    ~MockBinaryDatabase() {
+        std::filesystem::remove_all(directory);
+    }
+
+    static constexpr size_t num_genes = 20000;
+    std::string directory, prefix;
+};
+
+static const MockBinaryDatabase& mock_binary_database() {
+    static MockBinaryDatabase mock;
+    return mock;
+}
+
+static std::vector<char> read_file(const std::string& path) {
+    gesel::internal::PositionalFile file(path);
+    std::vector<char> output(file.size());
+    file.read(0, output.size(), output.data());
+    return output;
+}
+
+static void BM_DecodeText(benchmark::State& state) {
+    const auto& mock = mock_binary_database();
+    auto path = mock.prefix + (state.range(0) ? "gene2set.tsv" : "set2gene.tsv");
+    auto contents = read_file(path);
+    auto starts = gesel::internal::line_starts(gesel::internal::load_ranges(path + ".ranges.gz"));
+    std::vector<uint64_t> output;
+    for (auto _ : state) {
+        for (size_t l = 0, end = starts.size() - 1; l < end; ++l) {
+            gesel::internal::decode_delta_line(contents.data() + starts[l], starts[l + 1] - starts[l] - 1, output, path, l);
+            benchmark::DoNotOptimize(output.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * contents.size());
+    state.counters["file_bytes"] = contents.size();
+}
+
+BENCHMARK(BM_DecodeText)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+static void BM_DecodeBinary(benchmark::State& state) {
+    const auto& mock = mock_binary_database();
+    auto path = mock.prefix + (state.range(0) ? "gene2set.bin" : "set2gene.bin");
+    auto contents = read_file(path);
+    auto starts = gesel::internal::run_starts(gesel::internal::load_ranges(path + ".ranges.gz"));
+    auto ptr = reinterpret_cast<const unsigned char*>(contents.data());
+    std::vector<uint64_t> output;
+    for (auto _ : state) {
+        for (size_t l = 0, end = starts.size() - 1; l < end; ++l) {
+            gesel::internal::decode_binary_line(ptr + starts[l], starts[l + 1] - starts[l], output, path, l);
+            benchmark::DoNotOptimize(output.data());
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * contents.size());
+    state.counters["file_bytes"] = contents.size();
+}
+
+BENCHMARK(BM_DecodeBinary)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Isolating the vectorized decoder from the dispatch, using the longest line in 'gene2set.bin'.
+static void BM_DecodeStreamVByte(benchmark::State& state) {
+    const auto& mock = mock_binary_database();
+    auto path = mock.prefix + "gene2set.bin";
+    auto contents = read_file(path);
+    auto ranges = gesel::internal::load_ranges(path + ".ranges.gz");
+    auto starts = gesel::internal::run_starts(ranges);
+    size_t longest = std::max_element(ranges.begin(), ranges.end()) - ranges.begin();
+
+    auto ptr = reinterpret_cast<const unsigned char*>(contents.data()) + starts[longest];
+    auto end = ptr + ranges[longest];
+    uint64_t n;
+    auto control = gesel::internal::read_varint(ptr, end, n);
+    auto data = control + (n + 3) / 4;
+    std::vector<uint64_t> output(n);
+
+    bool simd = state.range(0);
+#ifdef GESEL_X86_SIMD
+    if (simd && !gesel::internal::simd_support().sse41) {
+        state.SkipWithError("SSE4.1 is not supported");
+        return;
+    }
+#else
+    if (simd) {
+        state.SkipWithError("vectorized kernels are not available");
+        return;
+    }
+#endif
+
+    for (auto _ : state) {
+#ifdef GESEL_X86_SIMD
+        if (simd) {
+            benchmark::DoNotOptimize(gesel::internal::decode_streamvbyte_sse41(control, data, end, n, 0, output.data()));
+            continue;
+        }
+#endif
+        benchmark::DoNotOptimize(gesel::internal::decode_streamvbyte_scalar(control, data, end, n, 0, output.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_DecodeStreamVByte)->Arg(0)->Arg(1);
+
+static void BM_ValidateText(benchmark::State& state) {
+    const auto& mock = mock_binary_database();
+    auto ranges = gesel::internal::load_ranges(mock.prefix + "gene2set.tsv.ranges.gz");
+    for (auto _ : state) {
+        gesel::internal::check_indices<false>(
+            mock.prefix + "gene2set.tsv",
+            10000,
+            ranges,
+            [](uint64_t, const std::vector<uint64_t>&) -> void {}
+        );
+    }
+}
+
+BENCHMARK(BM_ValidateText)->Unit(benchmark::kMillisecond);
+
+static void BM_ValidateBinary(benchmark::State& state) {
+    const auto& mock = mock_binary_database();
+    auto ranges = gesel::internal::load_ranges(mock.prefix + "gene2set.bin.ranges.gz");
+    for (auto _ : state) {
+        gesel::internal::check_binary_indices(
+            mock.prefix + "gene2set.bin",
+            10000,
+            ranges,
+            [](uint64_t, const std::vector<uint64_t>&) -> void {}
+        );
+    }
+}
+
+BENCHMARK(BM_ValidateBinary)->Unit(benchmark::kMillisecond);
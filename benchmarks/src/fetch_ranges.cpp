@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/fetch_ranges.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Simulates a remote server by adding a fixed latency to each request and a transfer time that is proportional to the number of bytes.
+ * This allows us to tune FetchLinesOptions::max_gap, which trades off the number of requests against the number of unused bytes.
+ */
+class LatencyFetcher final : public gesel::RangeFetcher {
+public:
+    LatencyFetcher(std::string prefix, std::chrono::microseconds latency, double bytes_per_microsecond) :
+        my_inner(std::move(prefix)), my_latency(latency), my_rate(bytes_per_microsecond) {}
+
+    void fetch(const std::string& name, uint64_t start, uint64_t length, char* buffer) const {
+        std::this_thread::sleep_for(my_latency + std::chrono::microseconds(static_cast<int64_t>(length / my_rate)));
+        my_inner.fetch(name, start, length, buffer);
+        ++requests;
+        bytes += length;
+    }
+
+    std::string fetch_all(const std::string& name) const {
+        return my_inner.fetch_all(name);
+    }
+
+    mutable std::atomic<uint64_t> requests = 0, bytes = 0;
+
+private:
+    gesel::FileFetcher my_inner;
+    std::chrono::microseconds my_latency;
+    double my_rate;
+};
+
+struct MockIndexFile {
+    MockIndexFile() {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_fetch_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory);
+
+        // Mimicking a gene2set.tsv file with a skewed number of sets per gene.
+        std::mt19937_64 rng(42);
+        std::ofstream out(directory + "/gene2set.tsv", std::ios::binary);
+        constexpr size_t num_genes = 50000;
+        for (size_t g = 0; g < num_genes; ++g) {
+            size_t nsets = rng() % 20 + (rng() % 10 == 0 ? rng() % 500 : 0);
+            std::string line;
+            for (size_t s = 0; s < nsets; ++s) {
+                if (s) {
+                    line += '\t';
+                }
+                line += std::to_string(rng() % 1000);
+            }
+            out << line << '\n';
+            bytes.push_back(line.size());
+        }
+    }
+
+    ~MockIndexFile() {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string directory;
+    std::vector<uint64_t> bytes;
+};
+
+static const MockIndexFile& mock_file() {
+    static MockIndexFile file;
+    return file;
+}
+
+// Arguments are the maximum gap, the number of threads and the number of requested lines.
+static void BM_FetchLines(benchmark::State& state) {
+    const auto& mock = mock_file();
+    auto fetcher = std::make_shared<LatencyFetcher>(mock.directory + "/", std::chrono::microseconds(2000), 10.0); // 2 ms per request, 10 MB/s.
+    gesel::LineFetcher lines(fetcher, "gene2set.tsv", mock.bytes);
+
+    gesel::FetchLinesOptions opt;
+    opt.max_gap = state.range(0);
+    opt.num_threads = state.range(1);
+
+    std::mt19937_64 rng(state.range(2));
+    std::vector<size_t> requested(state.range(2));
+    for (auto& r : requested) {
+        r = rng() % mock.bytes.size();
+    }
+
+    for (auto _ : state) {
+        auto output = lines.fetch_indices(requested, opt);
+        benchmark::DoNotOptimize(output.data());
+    }
+
+    state.counters["requests"] = benchmark::Counter(fetcher->requests, benchmark::Counter::kAvgIterations);
+    state.counters["bytes"] = benchmark::Counter(fetcher->bytes, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_FetchLines)
+    ->ArgNames({ "max_gap", "threads", "lines" })
+    ->ArgsProduct({ { 0, 1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20 }, { 1, 6 }, { 20, 200 } })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
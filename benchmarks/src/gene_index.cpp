@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/gene_index.hpp"
+#include "byteme/byteme.hpp"
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Synthetic gene mapping files resembling a human database, with 60000 genes that each have an Ensembl identifier and (mostly) a symbol.
+ */
+struct MockGeneFiles {
+    MockGeneFiles() {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_genes_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory);
+
+        std::mt19937_64 rng(42);
+        std::string ensembl, symbol;
+        for (size_t g = 0; g < num_genes; ++g) {
+            auto id = std::to_string(g);
+            names.push_back("ENSG" + std::string(11 - id.size(), '0') + id);
+            ensembl += names.back() + "\n";
+            if (rng() % 10) {
+                std::string sym;
+                for (size_t i = 0, n = 3 + rng() % 4; i < n; ++i) {
+                    sym += static_cast<char>('A' + rng() % 26);
+                }
+                sym += std::to_string(rng() % 20);
+                names.push_back(sym);
+                symbol += sym;
+            }
+            symbol += "\n";
+        }
+        write(directory + "/9606_ensembl.tsv.gz", ensembl);
+        write(directory + "/9606_symbol.tsv.gz", symbol);
+
+        // Queries are a mix of known names and some unknown identifiers.
+        for (size_t q = 0; q < 10000; ++q) {
+            queries.push_back(q % 10 ? names[rng() % names.size()] : "UNKNOWN" + std::to_string(q));
+        }
+    }
+
+    static void write(const std::string& path, const std::string& contents) {
+        byteme::GzipFileWriter writer(path.c_str(), {});
+        writer.write(reinterpret_cast<const unsigned char*>(contents.data()), contents.size());
+    }
+
+    ~MockGeneFiles() {
+        std::filesystem::remove_all(directory);
+    }
+
+    static constexpr size_t num_genes = 60000;
+    std::string directory;
+    std::vector<std::string> names;
+    std::vector<std::string> queries;
+};
+
+static const MockGeneFiles& mock_genes() {
+    static MockGeneFiles files;
+    return files;
+}
+
+static void BM_GeneIndexBuild(benchmark::State& state) {
+    gesel::GeneIndexOptions opt;
+    opt.case_insensitive = state.range(0);
+    for (auto _ : state) {
+        gesel::GeneIndex index(mock_genes().directory + "/9606_", opt);
+        benchmark::DoNotOptimize(index.num_genes());
+    }
+}
+
+BENCHMARK(BM_GeneIndexBuild)->ArgNames({ "case_insensitive" })->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// Resolving 10000 names, where the arguments are whether to ignore case and whether to resolve in a batch (or one at a time).
+static void BM_GeneIndexResolve(benchmark::State& state) {
+    gesel::GeneIndex index(mock_genes().directory + "/9606_");
+    const auto& queries = mock_genes().queries;
+    gesel::GeneLookupOptions opt;
+    opt.case_insensitive = state.range(0);
+    for (auto _ : state) {
+        size_t total = 0;
+        if (state.range(1)) {
+            total = index.resolve(queries, opt).genes.size();
+        } else {
+            for (const auto& q : queries) {
+                total += index.find(q, opt).size();
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+BENCHMARK(BM_GeneIndexResolve)->ArgNames({ "case_insensitive", "batch" })->ArgsProduct({ { 0, 1 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+// Baseline of what clients would otherwise build themselves.
+static void BM_UnorderedMapResolve(benchmark::State& state) {
+    std::unordered_map<std::string, std::vector<uint64_t> > mapping;
+    gesel::GeneIndex index(mock_genes().directory + "/9606_");
+    for (const auto& n : mock_genes().names) {
+        auto genes = index.find(n);
+        mapping[n].assign(genes.begin(), genes.end());
+    }
+    const auto& queries = mock_genes().queries;
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& q : queries) {
+            auto it = mapping.find(q);
+            if (it != mapping.end()) {
+                total += it->second.size();
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+BENCHMARK(BM_UnorderedMapResolve)->Unit(benchmark::kMicrosecond);
+
+static void BM_GeneIndexComplete(benchmark::State& state) {
+    gesel::GeneIndex index(mock_genes().directory + "/9606_");
+    gesel::GeneLookupOptions opt;
+    opt.case_insensitive = state.range(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.complete("ab", 20, opt));
+    }
+}
+
+BENCHMARK(BM_GeneIndexComplete)->ArgNames({ "case_insensitive" })->Arg(0)->Arg(1);
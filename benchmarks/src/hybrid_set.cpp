@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/hybrid_set.hpp"
+#include "gesel/intersect.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+ * Pairs of sets drawn from a universe of 20000 genes, where the first argument is the density of each set in parts per thousand.
+ * This mimics the overlap between large gene sets or between the sets containing two frequently-used genes.
+ */
+static std::vector<uint32_t> random_dense(std::mt19937_64& rng, double density) {
+    std::vector<uint32_t> output;
+    std::uniform_real_distribution<double> unif;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        if (unif(rng) < density) {
+            output.push_back(i);
+        }
+    }
+    return output;
+}
+
+struct DensePair {
+    DensePair(int64_t permille) {
+        std::mt19937_64 rng(permille);
+        left = random_dense(rng, permille / 1000.0);
+        right = random_dense(rng, permille / 1000.0);
+        hleft = gesel::HybridSet(left);
+        hright = gesel::HybridSet(right);
+    }
+    std::vector<uint32_t> left, right;
+    gesel::HybridSet hleft, hright;
+};
+
+static void BM_DenseIntersectVector(benchmark::State& state) {
+    DensePair pair(state.range(0));
+    std::vector<uint32_t> output;
+    for (auto _ : state) {
+        gesel::internal::intersect_pair(pair.left.data(), pair.left.size(), pair.right.data(), pair.right.size(), output);
+        benchmark::DoNotOptimize(output.data());
+    }
+}
+
+BENCHMARK(BM_DenseIntersectVector)->Arg(10)->Arg(100)->Arg(300)->Arg(800);
+
+static void BM_DenseIntersectHybrid(benchmark::State& state) {
+    DensePair pair(state.range(0));
+    for (auto _ : state) {
+        auto output = gesel::hybrid_intersect(pair.hleft, pair.hright);
+        benchmark::DoNotOptimize(output);
+    }
+}
+
+BENCHMARK(BM_DenseIntersectHybrid)->Arg(10)->Arg(100)->Arg(300)->Arg(800);
+
+static void BM_DenseCountVector(benchmark::State& state) {
+    DensePair pair(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gesel::internal::intersect_count(pair.left.data(), pair.left.size(), pair.right.data(), pair.right.size()));
+    }
+}
+
+BENCHMARK(BM_DenseCountVector)->Arg(10)->Arg(100)->Arg(300)->Arg(800);
+
+static void BM_DenseCountHybrid(benchmark::State& state) {
+    DensePair pair(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gesel::hybrid_intersection_size(pair.hleft, pair.hright));
+    }
+}
+
+BENCHMARK(BM_DenseCountHybrid)->Arg(10)->Arg(100)->Arg(300)->Arg(800);
+
+static void BM_DenseUnionVector(benchmark::State& state) {
+    DensePair pair(state.range(0));
+    std::vector<uint32_t> output;
+    for (auto _ : state) {
+        gesel::internal::union_pair(pair.left.data(), pair.left.size(), pair.right.data(), pair.right.size(), output);
+        benchmark::DoNotOptimize(output.data());
+    }
+}
+
+BENCHMARK(BM_DenseUnionVector)->Arg(10)->Arg(100)->Arg(300)->Arg(800);
+
+static void BM_DenseUnionHybrid(benchmark::State& state) {
+    DensePair pair(state.range(0));
+    for (auto _ : state) {
+        auto output = gesel::hybrid_union(pair.hleft, pair.hright);
+        benchmark::DoNotOptimize(output);
+    }
+}
+
+BENCHMARK(BM_DenseUnionHybrid)->Arg(10)->Arg(100)->Arg(300)->Arg(800);
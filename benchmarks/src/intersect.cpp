@@ -0,0 +1,176 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/intersect.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <vector>
+
+/*
+ * Methods to compare, indexed by the first benchmark argument.
+ */
+enum Method { STD = 0, SCALAR = 1, KERNEL = 2, GALLOPING = 3, DISPATCH = 4 };
+
+template<typename Value_>
+static std::vector<Value_> random_subset(std::mt19937_64& rng, size_t n, size_t universe) {
+    // Floyd's algorithm, so that the sizes are exact.
+    std::vector<Value_> output;
+    output.reserve(n);
+    std::vector<char> used(universe);
+    for (size_t j = universe - n; j < universe; ++j) {
+        size_t t = rng() % (j + 1);
+        if (used[t]) {
+            t = j;
+        }
+        used[t] = 1;
+        output.push_back(t);
+    }
+    std::sort(output.begin(), output.end());
+    return output;
+}
+
+template<typename Value_>
+static size_t run_intersect(int method, const std::vector<Value_>& left, const std::vector<Value_>& right, std::vector<Value_>& buffer) {
+    switch (method) {
+        case STD:
+            buffer.clear();
+            std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(buffer));
+            break;
+        case SCALAR:
+            buffer.resize(gesel::internal::intersect_capacity(left.size(), right.size()));
+            buffer.resize(gesel::internal::intersect_scalar<true>(left.data(), left.size(), right.data(), right.size(), buffer.data()));
+            break;
+        case KERNEL:
+            buffer.resize(gesel::internal::intersect_capacity(left.size(), right.size()));
+            buffer.resize(gesel::internal::intersect_kernel<true>(left.data(), left.size(), right.data(), right.size(), buffer.data()));
+            break;
+        case GALLOPING:
+            gesel::internal::intersect_galloping(left.data(), left.size(), right.data(), right.size(), buffer);
+            break;
+        default:
+            gesel::internal::intersect_pair(left.data(), left.size(), right.data(), right.size(), buffer);
+    }
+    return buffer.size();
+}
+
+// Arguments are the method and the lengths of the two arrays, drawn from a universe of 20000 genes (32-bit) or 50000 sets (64-bit).
+template<typename Value_>
+static void BM_IntersectSizes(benchmark::State& state) {
+    std::mt19937_64 rng(42);
+    const size_t universe = sizeof(Value_) == 4 ? 20000 : 50000;
+    auto left = random_subset<Value_>(rng, state.range(1), universe);
+    auto right = random_subset<Value_>(rng, state.range(2), universe);
+    std::vector<Value_> buffer;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(run_intersect(state.range(0), left, right, buffer));
+    }
+}
+
+BENCHMARK(BM_IntersectSizes<uint32_t>)
+    ->ArgNames({ "method", "left", "right" })
+    ->ArgsProduct({ { STD, SCALAR, KERNEL, GALLOPING, DISPATCH }, { 16, 128, 1024 }, { 1024, 8192 } });
+
+BENCHMARK(BM_IntersectSizes<uint64_t>)
+    ->ArgNames({ "method", "left", "right" })
+    ->ArgsProduct({ { STD, SCALAR, KERNEL, GALLOPING, DISPATCH }, { 16, 128, 1024 }, { 1024, 8192, 32768 } });
+
+/*
+ * Pairs of arrays with lengths drawn from realistic distributions:
+ * - Gene sets: log-normal sizes with a median of 30 genes, clamped to [5, 5000], from 20000 genes.
+ * - Token postings: Zipf-distributed numbers of sets per token, up to 50000 sets.
+ */
+template<typename Value_>
+static std::vector<std::pair<std::vector<Value_>, std::vector<Value_> > > realistic_pairs(bool postings) {
+    std::mt19937_64 rng(postings ? 100 : 200);
+    std::lognormal_distribution<double> set_sizes(std::log(30.0), 1.3);
+    const size_t universe = postings ? 50000 : 20000;
+    auto draw = [&]() -> size_t {
+        if (postings) {
+            // Rank r is used by about 50000/r sets.
+            double rank = std::exp(std::uniform_real_distribution<double>(0, std::log(20000.0))(rng));
+            return std::max<size_t>(1, universe / rank);
+        }
+        return std::min<size_t>(5000, std::max<size_t>(5, set_sizes(rng)));
+    };
+
+    std::vector<std::pair<std::vector<Value_>, std::vector<Value_> > > output;
+    for (size_t p = 0; p < 1000; ++p) {
+        output.emplace_back(random_subset<Value_>(rng, draw(), universe), random_subset<Value_>(rng, draw(), universe));
+    }
+    return output;
+}
+
+// Arguments are the method and whether to use the token postings or gene sets.
+template<typename Value_>
+static void BM_IntersectRealistic(benchmark::State& state) {
+    auto pairs = realistic_pairs<Value_>(state.range(1));
+    std::vector<Value_> buffer;
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& p : pairs) {
+            total += run_intersect(state.range(0), p.first, p.second, buffer);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+BENCHMARK(BM_IntersectRealistic<uint32_t>)
+    ->ArgNames({ "method", "postings" })
+    ->ArgsProduct({ { STD, SCALAR, KERNEL, GALLOPING, DISPATCH }, { 0, 1 } })
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_IntersectRealistic<uint64_t>)
+    ->ArgNames({ "method", "postings" })
+    ->ArgsProduct({ { STD, SCALAR, KERNEL, GALLOPING, DISPATCH }, { 0, 1 } })
+    ->Unit(benchmark::kMicrosecond);
+
+// Counting without storing, where the first argument is 0 for a scalar count and 1 for the dispatched count.
+static void BM_IntersectCount(benchmark::State& state) {
+    auto pairs = realistic_pairs<uint32_t>(false);
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& p : pairs) {
+            const auto& l = p.first;
+            const auto& r = p.second;
+            if (state.range(0)) {
+                total += gesel::internal::intersect_count(l.data(), l.size(), r.data(), r.size());
+            } else {
+                total += gesel::internal::intersect_scalar<false>(l.data(), l.size(), r.data(), r.size(), static_cast<uint32_t*>(NULL));
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+BENCHMARK(BM_IntersectCount)->ArgNames({ "dispatch" })->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// Unions of gene sets, where the first argument is 0 for std::set_union, 1 for the scalar kernel and 2 for the dispatched kernel.
+static void BM_Union(benchmark::State& state) {
+    auto pairs = realistic_pairs<uint32_t>(false);
+    std::vector<uint32_t> buffer;
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& p : pairs) {
+            const auto& l = p.first;
+            const auto& r = p.second;
+            if (state.range(0) == 0) {
+                buffer.clear();
+                std::set_union(l.begin(), l.end(), r.begin(), r.end(), std::back_inserter(buffer));
+            } else {
+                buffer.resize(gesel::internal::union_capacity(l.size(), r.size()));
+                auto fun = (state.range(0) == 1 ? gesel::internal::union_scalar<uint32_t> : gesel::internal::union_kernel<uint32_t>);
+                buffer.resize(fun(l.data(), l.size(), r.data(), r.size(), buffer.data()));
+            }
+            total += buffer.size();
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+BENCHMARK(BM_Union)->ArgNames({ "method" })->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
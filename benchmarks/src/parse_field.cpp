@@ -0,0 +1,328 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/parse_field.hpp"
+#include "gesel/chunked_reader.hpp"
+#include "gesel/load_ranges.hpp"
+#include "gesel/check_indices.hpp"
+#include "gesel/token_dictionary.hpp"
+#include "gesel/validate_database.hpp"
+#include "byteme/byteme.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Microbenchmarks for the parsing primitives on in-memory buffers, so that changes can be compared in ns/byte without any filesystem noise.
+ * Where a primitive accepts any byte source, the last argument chooses between byteme's SerialBufferedReader (0),
+ * which only supports the byte-by-byte path, and our ChunkedReader (1), which also supports the multi-byte fast paths.
+ */
+
+static constexpr size_t buffer_size = 65536;
+
+template<class Function_>
+static void with_source(int source, const std::string& buffer, Function_ fun) {
+    auto ptr = reinterpret_cast<const unsigned char*>(buffer.data());
+    if (source == 0) {
+        byteme::RawBufferReader reader(ptr, buffer.size());
+        byteme::SerialBufferedReader<char, byteme::RawBufferReader*> pb(&reader, buffer_size);
+        fun(pb);
+    } else {
+        gesel::internal::ChunkedReader pb(std::unique_ptr<byteme::Reader>(new byteme::RawBufferReader(ptr, buffer.size())), buffer_size, false, 1);
+        fun(pb);
+    }
+}
+
+static void report_bytes(benchmark::State& state, size_t bytes) {
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["time_per_byte"] = benchmark::Counter(bytes, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// Random integer with exactly 'digits' decimal digits.
+static uint64_t random_integer(std::mt19937_64& rng, int digits) {
+    if (digits == 1) {
+        return rng() % 10;
+    }
+    uint64_t lower = 1;
+    for (int d = 1; d < digits; ++d) {
+        lower *= 10;
+    }
+    return lower + rng() % (lower * 9);
+}
+
+/*
+ * Integer fields, where the first argument is the number of digits: 1-3 digits for deltas and set sizes,
+ * 5 digits for gene indices and byte ranges, and 9-12 digits for large byte offsets.
+ * Each line contains 8 fields, so all fields except the last are MIDDLE fields;
+ * for the LAST benchmark, each field is on its own line, and for UNKNOWN, the fields are parsed without knowing which one ends the line.
+ */
+static std::string integer_buffer(int digits, bool one_per_line) {
+    std::mt19937_64 rng(digits);
+    std::string output;
+    for (size_t line = 0; line < 20000; ++line) {
+        for (size_t f = 0; f < 8; ++f) {
+            output += std::to_string(random_integer(rng, digits));
+            output += (one_per_line || f == 7 ? '\n' : '\t');
+        }
+    }
+    return output;
+}
+
+static void BM_ParseIntegerFieldLast(benchmark::State& state) {
+    auto buffer = integer_buffer(state.range(0), true);
+    for (auto _ : state) {
+        with_source(state.range(1), buffer, [&](auto& pb) -> void {
+            bool valid = pb.valid();
+            uint64_t line = 0, sum = 0;
+            while (valid) {
+                sum += gesel::internal::parse_integer_field<gesel::internal::FieldType::LAST>(pb, valid, "", line);
+                ++line;
+            }
+            benchmark::DoNotOptimize(sum);
+        });
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_ParseIntegerFieldLast)->ArgsProduct({ { 1, 3, 5, 9, 12 }, { 0, 1 } });
+
+static void BM_ParseIntegerFieldMiddle(benchmark::State& state) {
+    auto buffer = integer_buffer(state.range(0), false);
+    for (auto _ : state) {
+        with_source(state.range(1), buffer, [&](auto& pb) -> void {
+            bool valid = pb.valid();
+            uint64_t line = 0, sum = 0;
+            while (valid) {
+                for (size_t f = 0; f < 7; ++f) {
+                    sum += gesel::internal::parse_integer_field<gesel::internal::FieldType::MIDDLE>(pb, valid, "", line);
+                }
+                sum += gesel::internal::parse_integer_field<gesel::internal::FieldType::LAST>(pb, valid, "", line);
+                ++line;
+            }
+            benchmark::DoNotOptimize(sum);
+        });
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_ParseIntegerFieldMiddle)->ArgsProduct({ { 1, 3, 5, 9, 12 }, { 0, 1 } });
+
+static void BM_ParseIntegerFieldUnknown(benchmark::State& state) {
+    auto buffer = integer_buffer(state.range(0), false);
+    for (auto _ : state) {
+        with_source(state.range(1), buffer, [&](auto& pb) -> void {
+            bool valid = pb.valid();
+            uint64_t line = 0, sum = 0;
+            while (valid) {
+                auto status = gesel::internal::parse_integer_field<gesel::internal::FieldType::UNKNOWN>(pb, valid, "", line);
+                sum += status.first;
+                line += status.second;
+            }
+            benchmark::DoNotOptimize(sum);
+        });
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_ParseIntegerFieldUnknown)->ArgsProduct({ { 1, 3, 5, 9, 12 }, { 0, 1 } });
+
+/*
+ * String fields, where the first argument is the field length: ~16 characters for set names, ~64-256 for descriptions.
+ * Each line contains a MIDDLE field followed by a LAST field of the same length.
+ */
+static std::string random_words(std::mt19937_64& rng, size_t length) {
+    std::string output;
+    while (output.size() < length) {
+        if (!output.empty()) {
+            output += ' ';
+        }
+        for (size_t i = 0, n = 3 + rng() % 8; i < n; ++i) {
+            output += static_cast<char>('a' + rng() % 26);
+        }
+    }
+    output.resize(length);
+    if (output.back() == ' ') {
+        output.back() = 'x';
+    }
+    return output;
+}
+
+static void BM_ParseStringField(benchmark::State& state) {
+    std::mt19937_64 rng(state.range(0));
+    std::string buffer;
+    while (buffer.size() < 2000000) {
+        buffer += random_words(rng, state.range(0)) + '\t' + random_words(rng, state.range(0)) + '\n';
+    }
+
+    for (auto _ : state) {
+        with_source(state.range(1), buffer, [&](auto& pb) -> void {
+            bool valid = pb.valid();
+            uint64_t line = 0, total = 0;
+            while (valid) {
+                total += gesel::internal::parse_string_field<gesel::internal::FieldType::MIDDLE>(pb, valid, "", line).size();
+                total += gesel::internal::parse_string_field<gesel::internal::FieldType::LAST>(pb, valid, "", line).size();
+                ++line;
+            }
+            benchmark::DoNotOptimize(total);
+        });
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_ParseStringField)->ArgsProduct({ { 8, 16, 64, 256 }, { 0, 1 } });
+
+/*
+ * Contents of the '*.ranges.gz' files, after decompression, where the first argument is the number of digits in each byte count.
+ * Named ranges are preceded by a name of the specified length (e.g., tokens and gene names), which is the second argument.
+ */
+static void BM_LoadRanges(benchmark::State& state) {
+    std::mt19937_64 rng(state.range(0));
+    std::string buffer;
+    for (size_t line = 0; line < 200000; ++line) {
+        buffer += std::to_string(random_integer(rng, state.range(0))) + '\n';
+    }
+
+    auto ptr = reinterpret_cast<const unsigned char*>(buffer.data());
+    for (auto _ : state) {
+        byteme::RawBufferReader reader(ptr, buffer.size());
+        benchmark::DoNotOptimize(gesel::internal::load_ranges(reader, ""));
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_LoadRanges)->Arg(1)->Arg(3)->Arg(5);
+
+static void BM_LoadNamedRanges(benchmark::State& state) {
+    std::mt19937_64 rng(state.range(0));
+    std::vector<std::string> names;
+    for (size_t line = 0; line < 100000; ++line) {
+        names.push_back(random_words(rng, state.range(1)));
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    std::string buffer;
+    for (const auto& name : names) {
+        buffer += name + '\t' + std::to_string(random_integer(rng, state.range(0))) + '\n';
+    }
+
+    auto ptr = reinterpret_cast<const unsigned char*>(buffer.data());
+    for (auto _ : state) {
+        byteme::RawBufferReader reader(ptr, buffer.size());
+        benchmark::DoNotOptimize(gesel::internal::load_named_ranges(reader, ""));
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_LoadNamedRanges)->ArgsProduct({ { 1, 3, 5 }, { 6, 12, 24 } });
+
+/*
+ * Tokenization of set names and descriptions, where the first argument is the length of each text.
+ * Tokens are drawn from a fixed vocabulary so that the map of tokens to sets grows realistically.
+ * The legacy tokenize() into a map of strings is kept as a baseline for the TokenCollector that is used by write_database().
+ */
+static std::vector<std::string> tokenize_texts(size_t length, size_t& total) {
+    std::mt19937_64 rng(length);
+    std::vector<std::string> vocabulary;
+    for (size_t w = 0; w < 5000; ++w) {
+        vocabulary.push_back(random_words(rng, 3 + rng() % 8));
+    }
+
+    std::vector<std::string> texts;
+    total = 0;
+    for (size_t t = 0; t < 10000; ++t) {
+        std::string text;
+        while (text.size() < length) {
+            text += (text.empty() ? "" : (rng() % 4 ? " " : "-")) + vocabulary[rng() % vocabulary.size()];
+            if (rng() % 3 == 0) {
+                text.back() = static_cast<char>('A' + rng() % 26); // mixed case, to exercise lower-casing.
+            }
+        }
+        total += text.size();
+        texts.push_back(std::move(text));
+    }
+    return texts;
+}
+
+static void BM_Tokenize(benchmark::State& state) {
+    size_t total;
+    auto texts = tokenize_texts(state.range(0), total);
+    for (auto _ : state) {
+        std::unordered_map<std::string, std::vector<uint64_t> > tokens_to_sets;
+        for (size_t t = 0; t < texts.size(); ++t) {
+            gesel::internal::tokenize(t, texts[t], tokens_to_sets);
+        }
+        benchmark::DoNotOptimize(tokens_to_sets.size());
+    }
+    report_bytes(state, total);
+}
+
+BENCHMARK(BM_Tokenize)->Arg(16)->Arg(64)->Arg(256);
+
+static void BM_TokenCollector(benchmark::State& state) {
+    size_t total;
+    auto texts = tokenize_texts(state.range(0), total);
+    for (auto _ : state) {
+        gesel::internal::TokenCollector<uint32_t> collector;
+        for (size_t t = 0; t < texts.size(); ++t) {
+            collector.add(t, texts[t]);
+        }
+        auto dictionary = collector.finish();
+        benchmark::DoNotOptimize(dictionary.tokens.size());
+    }
+    report_bytes(state, total);
+}
+
+BENCHMARK(BM_TokenCollector)->Arg(16)->Arg(64)->Arg(256);
+
+/*
+ * Parsing and checking of delta-encoded index lines as done by check_indices(), without the Gzip comparison.
+ * The first argument is the number of indices per line and the second argument is the size of the index space,
+ * e.g., 20000 genes for 'set2gene.tsv' or 1000000 sets for 'gene2set.tsv' of a large database.
+ */
+static void BM_CheckIndicesLines(benchmark::State& state) {
+    const size_t per_line = state.range(0);
+    const uint64_t limit = state.range(1);
+    std::mt19937_64 rng(per_line);
+
+    std::string buffer;
+    std::vector<uint64_t> ranges;
+    std::vector<uint64_t> indices;
+    std::string line;
+    while (buffer.size() < 4000000) {
+        indices.clear();
+        for (size_t i = 0; i < per_line; ++i) {
+            indices.push_back(rng() % limit);
+        }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+        line.clear();
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (i) {
+                line += '\t';
+            }
+            line += std::to_string(i ? indices[i] - indices[i - 1] : indices[i]);
+        }
+        ranges.push_back(line.size());
+        buffer += line;
+        buffer += '\n';
+    }
+
+    const std::string path = "";
+    for (auto _ : state) {
+        gesel::internal::ChunkedReader pb(std::unique_ptr<byteme::Reader>(new byteme::RawBufferReader(reinterpret_cast<const unsigned char*>(buffer.data()), buffer.size())), buffer_size, false, 1);
+        bool placeholder = false;
+        uint64_t total = 0;
+        auto extra = [&](uint64_t, const std::vector<uint64_t>& x) -> void { total += x.size(); };
+        gesel::internal::check_indices_lines<false>(pb, placeholder, path, path, limit, ranges, 0, extra);
+        benchmark::DoNotOptimize(total);
+    }
+    report_bytes(state, buffer.size());
+}
+
+BENCHMARK(BM_CheckIndicesLines)->ArgsProduct({ { 5, 50, 500 }, { 20000, 1000000 } });
@@ -0,0 +1,118 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/revalidate.hpp"
+#include "gesel/write_database.hpp"
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Synthetic database with 10000 sets over 20000 genes, written once and then revalidated after small edits.
+ */
+struct MockRevalidation {
+    MockRevalidation() {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_revalidate_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory);
+        prefix = directory + "/9606_";
+
+        std::mt19937_64 rng(42);
+        std::lognormal_distribution<double> sizes(4, 1);
+        collections.resize(10);
+        for (size_t c = 0; c < collections.size(); ++c) {
+            auto& coll = collections[c];
+            coll.title = "collection " + std::to_string(c);
+            coll.species = 9606;
+            coll.sets.resize(1000);
+            for (size_t s = 0; s < coll.sets.size(); ++s) {
+                auto& set = coll.sets[s];
+                set.name = "set " + std::to_string(rng() % 100000);
+                set.description = "pathway " + std::to_string(rng() % 1000) + " in tissue " + std::to_string(rng() % 100);
+                size_t n = std::min(static_cast<size_t>(sizes(rng)) + 1, num_genes);
+                for (size_t g = 0; g < n; ++g) {
+                    set.genes.push_back(rng() % num_genes);
+                }
+                std::sort(set.genes.begin(), set.genes.end());
+                set.genes.erase(std::unique(set.genes.begin(), set.genes.end()), set.genes.end());
+            }
+        }
+        gesel::write_database(prefix, collections, num_genes, gesel::WriteDatabaseOptions());
+    }
+
+    ~MockRevalidation() {
+        std::filesystem::remove_all(directory);
+    }
+
+    static constexpr size_t num_genes = 20000;
+    std::string directory, prefix;
+    std::vector<gesel::CollectionDetails> collections;
+};
+
+static MockRevalidation& mock_revalidation() {
+    static MockRevalidation mock;
+    return mock;
+}
+
+static void BM_ValidateFull(benchmark::State& state) {
+    auto& mock = mock_revalidation();
+    for (auto _ : state) {
+        gesel::validate_database(mock.prefix, MockRevalidation::num_genes);
+    }
+}
+
+BENCHMARK(BM_ValidateFull)->Unit(benchmark::kMillisecond);
+
+static void BM_RevalidateUnchanged(benchmark::State& state) {
+    auto& mock = mock_revalidation();
+    gesel::ValidationManifest manifest;
+    gesel::revalidate_database(mock.prefix, MockRevalidation::num_genes, manifest, gesel::ValidateDatabaseOptions());
+    for (auto _ : state) {
+        gesel::revalidate_database(mock.prefix, MockRevalidation::num_genes, manifest, gesel::ValidateDatabaseOptions());
+    }
+}
+
+BENCHMARK(BM_RevalidateUnchanged)->Unit(benchmark::kMillisecond);
+
+// Editing a collection's title requires only the collection details to be validated again.
+static void BM_RevalidateCollectionEdit(benchmark::State& state) {
+    auto& mock = mock_revalidation();
+    gesel::ValidationManifest manifest;
+    gesel::revalidate_database(mock.prefix, MockRevalidation::num_genes, manifest, gesel::ValidateDatabaseOptions());
+
+    // Alternating between two versions of the collection details, so that every iteration sees a change.
+    auto edited = mock.collections;
+    edited[0].title = "edited collection";
+    std::vector<std::string> versions{ mock.directory + "/original", mock.directory + "/edited" };
+    for (size_t v = 0; v < versions.size(); ++v) {
+        std::filesystem::create_directories(versions[v]);
+        gesel::write_database(versions[v] + "/9606_", (v ? edited : mock.collections), MockRevalidation::num_genes, gesel::WriteDatabaseOptions());
+    }
+    size_t counter = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        ++counter;
+        for (const auto& suffix : { "", ".gz", ".ranges.gz" }) {
+            std::filesystem::copy_file(versions[counter % 2] + "/9606_collections.tsv" + suffix, mock.prefix + "collections.tsv" + suffix, std::filesystem::copy_options::overwrite_existing);
+        }
+        state.ResumeTiming();
+
+        gesel::revalidate_database(mock.prefix, MockRevalidation::num_genes, manifest, gesel::ValidateDatabaseOptions());
+    }
+}
+
+BENCHMARK(BM_RevalidateCollectionEdit)->Unit(benchmark::kMillisecond);
+
+static void BM_RevalidateVerifyContents(benchmark::State& state) {
+    auto& mock = mock_revalidation();
+    gesel::ValidationManifest manifest;
+    gesel::revalidate_database(mock.prefix, MockRevalidation::num_genes, manifest, gesel::ValidateDatabaseOptions());
+    gesel::RevalidateOptions ropt;
+    ropt.verify_contents = true;
+    for (auto _ : state) {
+        gesel::revalidate_database(mock.prefix, MockRevalidation::num_genes, manifest, gesel::ValidateDatabaseOptions(), ropt);
+    }
+}
+
+BENCHMARK(BM_RevalidateVerifyContents)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/search_sets.hpp"
+#include "byteme/byteme.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Synthetic token files with a Zipf-like vocabulary, so that queries can mix very common tokens (long posting lists) with rare ones.
+ */
+struct MockTokenFiles {
+    MockTokenFiles() {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_search_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory);
+
+        std::mt19937_64 rng(42);
+        constexpr size_t vocab_size = 20000;
+        for (size_t v = 0; v < vocab_size; ++v) {
+            std::string word;
+            size_t len = 3 + rng() % 8;
+            for (size_t i = 0; i < len; ++i) {
+                word += static_cast<char>('a' + rng() % 26);
+            }
+            vocabulary.push_back(word);
+        }
+
+        // Sampling word ranks from a discretized power law.
+        std::vector<double> weights(vocab_size);
+        for (size_t v = 0; v < vocab_size; ++v) {
+            weights[v] = 1.0 / (v + 1);
+        }
+        std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+
+        constexpr size_t num_sets = 50000;
+        gesel::internal::TokenCollector<uint32_t> names, descriptions;
+        for (size_t s = 0; s < num_sets; ++s) {
+            std::string name, description;
+            for (size_t w = 0, nw = 2 + rng() % 4; w < nw; ++w) {
+                name += vocabulary[zipf(rng)] + " ";
+            }
+            for (size_t w = 0, nw = 10 + rng() % 20; w < nw; ++w) {
+                description += vocabulary[zipf(rng)] + " ";
+            }
+            names.add(s, name);
+            descriptions.add(s, description);
+        }
+
+        save(directory + "/tokens-names.tsv", names.finish());
+        save(directory + "/tokens-descriptions.tsv", descriptions.finish());
+    }
+
+    static void save(const std::string& path, const gesel::internal::TokenDictionary<uint32_t>& dict) {
+        byteme::RawFileWriter rwriter(path.c_str(), {});
+        auto rpath = path + ".ranges.gz";
+        byteme::GzipFileWriter gwriter(rpath.c_str(), {});
+        for (size_t t = 0, end = dict.tokens.size(); t < end; ++t) {
+            std::string line;
+            uint64_t last = 0;
+            for (auto o = dict.sets.offsets[t], oend = dict.sets.offsets[t + 1]; o < oend; ++o) {
+                if (o != dict.sets.offsets[t]) {
+                    line += '\t';
+                }
+                line += std::to_string(dict.sets.values[o] - last);
+                last = dict.sets.values[o];
+            }
+            std::string range = std::string(dict.tokens[t]) + "\t" + std::to_string(line.size()) + "\n";
+            line += '\n';
+            rwriter.write(reinterpret_cast<const unsigned char*>(line.data()), line.size());
+            gwriter.write(reinterpret_cast<const unsigned char*>(range.data()), range.size());
+        }
+    }
+
+    ~MockTokenFiles() {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::string directory;
+    std::vector<std::string> vocabulary;
+};
+
+static const MockTokenFiles& mock_tokens() {
+    static MockTokenFiles files;
+    return files;
+}
+
+// The query consists of one token at each of the specified vocabulary ranks, where lower ranks are more common.
+static std::string make_query(const std::vector<size_t>& ranks, bool wildcard) {
+    const auto& vocab = mock_tokens().vocabulary;
+    std::string query;
+    for (auto r : ranks) {
+        query += (wildcard ? vocab[r].substr(0, 2) + "*" : vocab[r]) + " ";
+    }
+    return query;
+}
+
+// Arguments are whether the postings are in memory, the number of query tokens, the rarest rank and whether wildcards are used.
+static void BM_TokenSearch(benchmark::State& state) {
+    gesel::TokenSearchOptions sopt;
+    sopt.in_memory = state.range(0);
+    gesel::TokenSearch searcher(mock_tokens().directory + "/", sopt);
+
+    std::vector<size_t> ranks;
+    for (int64_t t = 0; t < state.range(1); ++t) {
+        ranks.push_back(t == 0 ? state.range(2) : t); // one rare token and some common tokens.
+    }
+    auto query = make_query(ranks, state.range(3));
+
+    gesel::SearchOptions opt;
+    opt.match_all = true;
+    size_t found = 0;
+    for (auto _ : state) {
+        auto res = searcher.search(query, opt);
+        found = res.size();
+        benchmark::DoNotOptimize(res.data());
+    }
+    state.counters["results"] = found;
+}
+
+BENCHMARK(BM_TokenSearch)
+    ->ArgNames({ "in_memory", "tokens", "rank", "wildcard" })
+    ->ArgsProduct({ { 0, 1 }, { 1, 2, 4 }, { 1, 1000 }, { 0, 1 } })
+    ->Unit(benchmark::kMicrosecond);
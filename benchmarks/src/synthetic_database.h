@@ -0,0 +1,227 @@
+#ifndef GESEL_BENCHMARKS_SYNTHETIC_DATABASE_H
+#define GESEL_BENCHMARKS_SYNTHETIC_DATABASE_H
+
+#include "gesel/write_database.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#if __has_include(<sys/resource.h>)
+#include <sys/resource.h>
+#define GESEL_BENCHMARKS_HAS_RUSAGE 1
+#endif
+
+/*
+ * Parameters for a synthetic Gesel database.
+ * The same parameters (including the seed) always generate the same files.
+ */
+struct SyntheticDatabaseOptions {
+    uint64_t seed = 42;
+
+    size_t num_genes = 20000;
+
+    size_t num_collections = 10;
+
+    size_t sets_per_collection = 1000;
+
+    // Set sizes follow a log-normal distribution, as in MSigDB-like collections, capped at half of all genes.
+    double set_size_meanlog = 4;
+
+    double set_size_sdlog = 1;
+
+    // Gene popularity follows a power law, where the gene with popularity rank 'r' (starting from 1) is chosen with probability proportional to 'r^(-exponent)'.
+    // This mimics the small number of well-studied genes that appear in many sets.
+    double popularity_exponent = 1;
+
+    // Words in the names and descriptions are drawn from a vocabulary of this size, also with power-law frequencies.
+    size_t vocabulary_size = 5000;
+
+    size_t words_per_description = 12;
+
+    int num_threads = 1;
+};
+
+/*
+ * Synthetic database written to a new temporary directory, which is removed on destruction.
+ * Gene mapping files are written to 'genes_prefix' and the database files are written to 'prefix'.
+ */
+class SyntheticDatabase {
+public:
+    SyntheticDatabase(const SyntheticDatabaseOptions& options) : my_options(options) {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_synthetic_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory + "/genes");
+        std::filesystem::create_directories(directory + "/db");
+        genes_prefix = directory + "/genes/9606_";
+        prefix = directory + "/db/9606_";
+
+        std::mt19937_64 rng(options.seed);
+        gesel::WriteDatabaseOptions wopt;
+        wopt.num_threads = options.num_threads;
+        num_genes = gesel::write_genes(genes_prefix, generate_genes(rng), wopt);
+        gesel::write_database(prefix, generate_collections(rng), num_genes, wopt);
+    }
+
+    ~SyntheticDatabase() {
+        std::filesystem::remove_all(directory);
+    }
+
+    SyntheticDatabase(const SyntheticDatabase&) = delete;
+    SyntheticDatabase& operator=(const SyntheticDatabase&) = delete;
+
+public:
+    std::string directory, genes_prefix, prefix;
+    uint64_t num_genes = 0;
+
+    // Total size of the database files whose names start with any of the 'stems', e.g., "sets", "tokens".
+    // An empty 'stems' counts all database files.
+    uint64_t file_bytes(const std::vector<std::string>& stems) const {
+        uint64_t total = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(directory + "/db")) {
+            auto name = entry.path().filename().string().substr(5); // skipping the '9606_' prefix.
+            bool keep = stems.empty();
+            for (const auto& stem : stems) {
+                keep = keep || name.compare(0, stem.size(), stem) == 0;
+            }
+            if (keep) {
+                total += entry.file_size();
+            }
+        }
+        return total;
+    }
+
+    uint64_t gene_file_bytes() const {
+        uint64_t total = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(directory + "/genes")) {
+            total += entry.file_size();
+        }
+        return total;
+    }
+
+private:
+    SyntheticDatabaseOptions my_options;
+
+    static std::discrete_distribution<size_t> power_law(size_t n, double exponent) {
+        std::vector<double> weights(n);
+        for (size_t i = 0; i < n; ++i) {
+            weights[i] = std::pow(static_cast<double>(i + 1), -exponent);
+        }
+        return std::discrete_distribution<size_t>(weights.begin(), weights.end());
+    }
+
+    std::vector<gesel::GeneNames> generate_genes(std::mt19937_64& rng) const {
+        std::vector<gesel::GeneNames> output(3);
+        output[0].type = "symbol";
+        output[1].type = "entrez";
+        output[2].type = "ensembl";
+        for (auto& entry : output) {
+            entry.names.resize(my_options.num_genes);
+        }
+
+        for (size_t g = 0; g < my_options.num_genes; ++g) {
+            output[0].names[g].push_back("GENE" + std::to_string(g));
+            if (rng() % 10 == 0) { // some genes have an alias, while others are missing from some types.
+                output[0].names[g].push_back("ALIAS" + std::to_string(g));
+            }
+            if (rng() % 20) {
+                output[1].names[g].push_back(std::to_string(100000 + g));
+            }
+            if (rng() % 20) {
+                auto id = std::to_string(g);
+                output[2].names[g].push_back("ENSG" + std::string(11 - std::min<size_t>(id.size(), 11), '0') + id);
+            }
+        }
+        return output;
+    }
+
+    std::vector<gesel::CollectionDetails> generate_collections(std::mt19937_64& rng) const {
+        std::vector<std::string> vocabulary;
+        vocabulary.reserve(my_options.vocabulary_size);
+        for (size_t w = 0; w < my_options.vocabulary_size; ++w) {
+            std::string word;
+            for (size_t i = 0, n = 3 + rng() % 8; i < n; ++i) {
+                word += static_cast<char>('a' + rng() % 26);
+            }
+            vocabulary.push_back(word);
+        }
+        auto choose_word = power_law(vocabulary.size(), 1);
+        auto random_text = [&](size_t nwords) -> std::string {
+            std::string text;
+            for (size_t w = 0; w < nwords; ++w) {
+                text += (w ? " " : "") + vocabulary[choose_word(rng)];
+            }
+            return text;
+        };
+
+        // Popularity ranks are randomly assigned so that popular genes are scattered across the index space.
+        std::vector<uint64_t> by_rank(my_options.num_genes);
+        for (size_t g = 0; g < by_rank.size(); ++g) {
+            by_rank[g] = g;
+        }
+        std::shuffle(by_rank.begin(), by_rank.end(), rng);
+        auto choose_gene = power_law(by_rank.size(), my_options.popularity_exponent);
+
+        std::lognormal_distribution<double> sizes(my_options.set_size_meanlog, my_options.set_size_sdlog);
+        const size_t max_size = std::max<size_t>(my_options.num_genes / 2, 1);
+        std::vector<char> used(my_options.num_genes);
+
+        std::vector<gesel::CollectionDetails> output(my_options.num_collections);
+        for (size_t c = 0; c < output.size(); ++c) {
+            auto& coll = output[c];
+            coll.title = "collection " + std::to_string(c) + " " + random_text(3);
+            coll.description = random_text(my_options.words_per_description * 2);
+            coll.species = 9606;
+            coll.maintainer = "synthetic";
+            coll.source = "https://example.com/" + std::to_string(c);
+
+            coll.sets.resize(my_options.sets_per_collection);
+            for (auto& set : coll.sets) {
+                set.name = random_text(1 + rng() % 4);
+                set.description = random_text(my_options.words_per_description);
+
+                // Drawing from the power law until we get enough unique genes, topping up uniformly if the popular genes are exhausted.
+                size_t n = std::min(static_cast<size_t>(sizes(rng)) + 1, max_size);
+                for (size_t attempt = 0, limit = n * 10; set.genes.size() < n && attempt < limit; ++attempt) {
+                    auto gene = by_rank[choose_gene(rng)];
+                    if (!used[gene]) {
+                        used[gene] = 1;
+                        set.genes.push_back(gene);
+                    }
+                }
+                while (set.genes.size() < n) {
+                    auto gene = rng() % my_options.num_genes;
+                    if (!used[gene]) {
+                        used[gene] = 1;
+                        set.genes.push_back(gene);
+                    }
+                }
+                for (auto gene : set.genes) {
+                    used[gene] = 0;
+                }
+                std::sort(set.genes.begin(), set.genes.end());
+            }
+        }
+        return output;
+    }
+};
+
+// Peak resident set size of the process in megabytes, or zero if this is not available.
+inline double peak_rss_mb() {
+#ifdef GESEL_BENCHMARKS_HAS_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1048576.0; // bytes on macOS.
+#else
+        return usage.ru_maxrss / 1024.0; // kilobytes on Linux.
+#endif
+    }
+#endif
+    return 0;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/validate_database.hpp"
+#include "gesel/validate_genes.hpp"
+#include "synthetic_database.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * End-to-end validation of synthetic databases at increasing scales, where the first argument is the number of sets in thousands.
+ * Each scale is generated once on first use and reused by all benchmarks.
+ * Throughput is reported relative to the total size of the files read by each benchmark, including the Gzip-compressed copies.
+ * Peak RSS is reported for the whole process, so it is most informative when a single benchmark is selected with --benchmark_filter.
+ */
+static const SyntheticDatabase& synthetic_database(int64_t thousands) {
+    static std::map<int64_t, std::unique_ptr<SyntheticDatabase> > cache;
+    auto& found = cache[thousands];
+    if (!found) {
+        SyntheticDatabaseOptions opt;
+        opt.num_genes = 20000 + thousands * 200;
+        opt.num_collections = 10;
+        opt.sets_per_collection = thousands * 100;
+        found.reset(new SyntheticDatabase(opt));
+    }
+    return *found;
+}
+
+static void report(benchmark::State& state, uint64_t bytes) {
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["file_mb"] = bytes / 1048576.0;
+    state.counters["peak_rss_mb"] = peak_rss_mb();
+}
+
+static void BM_SyntheticValidateGenes(benchmark::State& state) {
+    const auto& db = synthetic_database(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gesel::validate_genes(db.genes_prefix));
+    }
+    report(state, db.gene_file_bytes());
+}
+
+BENCHMARK(BM_SyntheticValidateGenes)->Arg(10)->Arg(50)->Arg(200)->Unit(benchmark::kMillisecond);
+
+static void BM_SyntheticValidateDatabase(benchmark::State& state) {
+    const auto& db = synthetic_database(state.range(0));
+    gesel::ValidateDatabaseOptions opt;
+    opt.num_threads = state.range(1);
+    for (auto _ : state) {
+        gesel::validate_database(db.prefix, db.num_genes, opt);
+    }
+    report(state, db.file_bytes({}));
+}
+
+BENCHMARK(BM_SyntheticValidateDatabase)->ArgsProduct({ { 10, 50, 200 }, { 1, 3 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * Each stage of validate_database() in isolation, where the second argument is the stage:
+ * 0 for the collection details, 1 for the set details and tokens, and 2 for the mappings between sets and genes.
+ */
+static void BM_SyntheticValidateStage(benchmark::State& state) {
+    const auto& db = synthetic_database(state.range(0));
+    auto stage = state.range(1);
+    auto read_opt = gesel::internal::reader_options(gesel::ValidateDatabaseOptions());
+
+    for (auto _ : state) {
+        auto shared = gesel::internal::load_shared_ranges(db.prefix);
+        if (stage == 0) {
+            gesel::internal::check_collection_details(db.prefix + "collections.tsv", shared.collection_bytes, shared.collection_numbers, read_opt);
+        } else if (stage == 1) {
+            gesel::internal::validate_sets_and_tokens(db.prefix, shared.total_sets, shared.set_bytes, shared.set_sizes, read_opt);
+        } else {
+            gesel::internal::validate_mappings(db.prefix, db.num_genes, shared.total_sets, shared.set_sizes, read_opt);
+        }
+    }
+
+    if (stage == 0) {
+        report(state, db.file_bytes({ "collections" }));
+    } else if (stage == 1) {
+        report(state, db.file_bytes({ "sets", "tokens" }));
+    } else {
+        report(state, db.file_bytes({ "set2gene", "gene2set" }));
+    }
+}
+
+BENCHMARK(BM_SyntheticValidateStage)->ArgsProduct({ { 10, 50, 200 }, { 0, 1, 2 } })->Unit(benchmark::kMillisecond);
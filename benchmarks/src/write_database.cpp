@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include "gesel/write_database.hpp"
+#include "byteme/byteme.hpp"
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Synthetic collections with a few thousand sets, with log-normal set sizes as in MSigDB-like databases.
+ */
+struct MockCollections {
+    MockCollections() {
+        directory = std::filesystem::temp_directory_path() / ("gesel_bench_writer_" + std::to_string(std::random_device()()));
+        std::filesystem::create_directories(directory);
+
+        std::mt19937_64 rng(42);
+        std::lognormal_distribution<double> sizes(4, 1);
+        std::vector<std::string> words;
+        for (size_t w = 0; w < 5000; ++w) {
+            std::string word;
+            for (size_t i = 0, n = 3 + rng() % 8; i < n; ++i) {
+                word += static_cast<char>('a' + rng() % 26);
+            }
+            words.push_back(word);
+        }
+        auto random_text = [&](size_t nwords) -> std::string {
+            std::string output;
+            for (size_t w = 0; w < nwords; ++w) {
+                output += (w ? " " : "") + words[rng() % words.size()];
+            }
+            return output;
+        };
+
+        collections.resize(20);
+        for (auto& coll : collections) {
+            coll.title = random_text(5);
+            coll.description = random_text(20);
+            coll.species = 9606;
+            coll.maintainer = "Aaron Lun";
+            coll.source = "https://example.com";
+            coll.sets.resize(500);
+            for (auto& set : coll.sets) {
+                set.name = random_text(4);
+                set.description = random_text(15);
+                size_t n = std::min(static_cast<size_t>(sizes(rng)) + 1, num_genes);
+                for (size_t g = 0; g < n; ++g) {
+                    set.genes.push_back(rng() % num_genes);
+                }
+                std::sort(set.genes.begin(), set.genes.end());
+                set.genes.erase(std::unique(set.genes.begin(), set.genes.end()), set.genes.end());
+            }
+        }
+
+        for (size_t i = 0; i < 8; ++i) {
+            text += random_text(100000) + "\n";
+        }
+    }
+
+    ~MockCollections() {
+        std::filesystem::remove_all(directory);
+    }
+
+    static constexpr size_t num_genes = 60000;
+    std::string directory;
+    std::vector<gesel::CollectionDetails> collections;
+    std::string text;
+};
+
+static const MockCollections& mock_collections() {
+    static MockCollections mock;
+    return mock;
+}
+
+static void BM_WriteDatabase(benchmark::State& state) {
+    const auto& mock = mock_collections();
+    gesel::WriteDatabaseOptions opt;
+    opt.num_threads = state.range(0);
+    for (auto _ : state) {
+        gesel::write_database(mock.directory + "/9606_", mock.collections, MockCollections::num_genes, opt);
+    }
+}
+
+BENCHMARK(BM_WriteDatabase)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Baseline of a single Gzip stream, as would be produced by a typical writer.
+static void BM_GzipSerial(benchmark::State& state) {
+    const auto& mock = mock_collections();
+    auto path = mock.directory + "/serial.gz";
+    for (auto _ : state) {
+        byteme::GzipFileWriter writer(path.c_str(), {});
+        writer.write(reinterpret_cast<const unsigned char*>(mock.text.data()), mock.text.size());
+        writer.finish();
+    }
+    state.SetBytesProcessed(state.iterations() * mock.text.size());
+}
+
+BENCHMARK(BM_GzipSerial)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_GzipParallel(benchmark::State& state) {
+    const auto& mock = mock_collections();
+    auto path = mock.directory + "/parallel.gz";
+    gesel::WriteDatabaseOptions opt;
+    opt.num_threads = state.range(0);
+    for (auto _ : state) {
+        gesel::internal::ParallelGzipWriter writer(path, opt);
+        writer.write(mock.text);
+        writer.finish();
+    }
+    state.SetBytesProcessed(state.iterations() * mock.text.size());
+}
+
+BENCHMARK(BM_GzipParallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
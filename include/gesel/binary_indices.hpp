@@ -0,0 +1,756 @@
+#ifndef GESEL_BINARY_INDICES_HPP
+#define GESEL_BINARY_INDICES_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <charconv>
+
+#include "check_indices.hpp"
+#include "chunked_reader.hpp"
+#include "load_ranges.hpp"
+#include "validate_database.hpp"
+#include "ranged_file.hpp"
+#include "fetch_ranges.hpp"
+#include "intersect_kernels.hpp"
+#include "write_database.hpp"
+#include "parallelize.hpp"
+
+/**
+ * @file binary_indices.hpp
+ * @brief Compact binary versions of the index files.
+ *
+ * Each of `set2gene.tsv`, `gene2set.tsv`, `tokens-names.tsv` and `tokens-descriptions.tsv` can have a binary sibling with the `.bin` extension, e.g., `set2gene.bin`.
+ * Each line of the text file corresponds to a run of bytes in the binary file, in the same order and with no separators between runs.
+ * A run is empty if the corresponding line is empty; otherwise, it contains:
+ *
+ * - The number of indices \f$n\f$, as a LEB128 varint.
+ * - \f$\lceil n/4 \rceil\f$ control bytes, where each pair of bits (starting from the least significant pair of the first byte) contains the number of data bytes for one delta, minus 1.
+ *   Any unused bits in the last control byte should be zero.
+ * - The data bytes for each delta in little-endian order, using the smallest number of bytes (at least 1) that can represent the delta.
+ *
+ * This is the StreamVByte layout for 32-bit integers, where the deltas are defined as in the text files, i.e., the first value is the index itself.
+ * All indices must be less than \f$2^{32}\f$.
+ * The number of bytes in each run is stored in a `<NAME>.bin.ranges.gz` file with the same format as the `<NAME>.tsv.ranges.gz` file,
+ * so byte range requests can be planned in the same manner as for the text files.
+ */
+
+namespace gesel {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline void append_varint(std::string& output, uint64_t value) {
+    while (value >= 128) {
+        output += static_cast<char>((value & 127) | 128);
+        value >>= 7;
+    }
+    output += static_cast<char>(value);
+}
+
+/*
+ * Returns a pointer to the byte after the varint, or NULL if the varint is truncated or overflows 64 bits.
+ */
+inline const unsigned char* read_varint(const unsigned char* ptr, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (ptr == end) {
+            return NULL;
+        }
+        uint64_t current = *ptr;
+        ++ptr;
+        if (shift == 63 && current > 1) {
+            return NULL;
+        }
+        value |= (current & 127) << shift;
+        if (current < 128) {
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+inline int streamvbyte_length(uint32_t value) {
+    return 1 + (value >= (1u << 8)) + (value >= (1u << 16)) + (value >= (1u << 24));
+}
+
+/*
+ * Appends the binary encoding of a line to 'output'.
+ * 'values' should be sorted and unique, and all values should be less than 2^32.
+ */
+template<typename Index_>
+void encode_binary_line(const Index_* values, size_t n, std::string& output) {
+    if (n == 0) {
+        return;
+    }
+    append_varint(output, n);
+
+    size_t control_start = output.size();
+    output.append((n + 3) / 4, '\0');
+    uint32_t previous = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t delta = static_cast<uint32_t>(values[i]) - previous;
+        previous = values[i];
+        int len = streamvbyte_length(delta);
+        output[control_start + i / 4] |= static_cast<char>((len - 1) << ((i % 4) * 2));
+        for (int b = 0; b < len; ++b) {
+            output += static_cast<char>(delta & 255);
+            delta >>= 8;
+        }
+    }
+}
+
+/*
+ * All decoders store the cumulative sums of the deltas (modulo 2^32) in 'output', starting from 'base'.
+ * 'control' should point to the first control byte for these values, and 'n' is the number of values.
+ * They return a pointer to the byte after the data bytes, or NULL if the data bytes would extend past 'end'.
+ */
+inline const unsigned char* decode_streamvbyte_scalar(const unsigned char* control, const unsigned char* data, const unsigned char* end, size_t n, uint32_t base, uint64_t* output) {
+    for (size_t i = 0; i < n; ++i) {
+        int len = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+        if (end - data < len) {
+            return NULL;
+        }
+        uint32_t delta = 0;
+        for (int b = 0; b < len; ++b) {
+            delta |= static_cast<uint32_t>(data[b]) << (8 * b);
+        }
+        data += len;
+        base += delta;
+        output[i] = base;
+    }
+    return data;
+}
+
+#ifdef GESEL_X86_SIMD
+
+/*
+ * Shuffle masks that expand the data bytes for each group of 4 values into 32-bit lanes, along with the total number of data bytes, for each of the 256 possible control bytes.
+ */
+struct StreamVByteTable {
+    StreamVByteTable() {
+        for (int control = 0; control < 256; ++control) {
+            int pos = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                int len = ((control >> (lane * 2)) & 3) + 1;
+                for (int b = 0; b < 4; ++b) {
+                    shuffle[control][lane * 4 + b] = (b < len ? pos + b : 0x80); // zeroes the unused high bytes.
+                }
+                pos += len;
+            }
+            lengths[control] = pos;
+        }
+    }
+    alignas(16) uint8_t shuffle[256][16];
+    uint8_t lengths[256];
+};
+
+inline const StreamVByteTable& streamvbyte_table() {
+    static const StreamVByteTable table;
+    return table;
+}
+
+/*
+ * Decodes each group of 4 values with a single shuffle, followed by an in-register prefix sum.
+ * The 16-byte load may read past the data bytes for the current group, so we only use the vectorized loop while at least 16 bytes remain before 'end'.
+ */
+__attribute__((target("sse4.1")))
+inline const unsigned char* decode_streamvbyte_sse41(const unsigned char* control, const unsigned char* data, const unsigned char* end, size_t n, uint32_t base, uint64_t* output) {
+    const auto& table = streamvbyte_table();
+    __m128i running = _mm_set1_epi32(static_cast<int>(base));
+    size_t i = 0;
+    for (; i + 4 <= n && end - data >= 16; i += 4) {
+        auto c = control[i / 4];
+        __m128i values = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(table.shuffle[c]))
+        );
+        values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+        values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+        values = _mm_add_epi32(values, running);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_cvtepu32_epi64(values));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 2), _mm_cvtepu32_epi64(_mm_srli_si128(values, 8)));
+        running = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+        data += table.lengths[c];
+    }
+    base = static_cast<uint32_t>(_mm_cvtsi128_si32(running));
+    return decode_streamvbyte_scalar(control + i / 4, data, end, n - i, base, output + i);
+}
+
+#endif
+
+inline const unsigned char* decode_streamvbyte(const unsigned char* control, const unsigned char* data, const unsigned char* end, size_t n, uint64_t* output) {
+#ifdef GESEL_X86_SIMD
+    if (simd_support().sse41) {
+        return decode_streamvbyte_sse41(control, data, end, n, 0, output);
+    }
+#endif
+    return decode_streamvbyte_scalar(control, data, end, n, 0, output);
+}
+
+/*
+ * Decodes the run of bytes for a single line into 'output'.
+ * This only checks that the run can be decoded and has no trailing bytes; see check_binary_line() for the other checks.
+ */
+inline void decode_binary_line(const unsigned char* ptr, size_t length, std::vector<uint64_t>& output, const std::string& path, uint64_t line) {
+    output.clear();
+    if (length == 0) {
+        return;
+    }
+
+    const unsigned char* end = ptr + length;
+    uint64_t n;
+    ptr = read_varint(ptr, end, n);
+    if (ptr == NULL) {
+        throw std::runtime_error("invalid number of indices in '" + path + "'" + append_line_number(line));
+    }
+
+    // Each value needs at least 1 data byte, so this also protects us from excessive allocations.
+    uint64_t available = end - ptr;
+    if (n > available || (n + 3) / 4 > available - n) {
+        throw std::runtime_error("number of bytes in '" + path + "' is too small for the number of indices" + append_line_number(line));
+    }
+
+    output.resize(n);
+    const unsigned char* control = ptr;
+    auto last = decode_streamvbyte(control, control + (n + 3) / 4, end, n, output.data());
+    if (last == NULL) {
+        throw std::runtime_error("number of bytes in '" + path + "' is too small for the number of indices" + append_line_number(line));
+    }
+    if (last != end) {
+        throw std::runtime_error("number of bytes in '" + path + "' is greater than that required for the number of indices" + append_line_number(line));
+    }
+}
+
+/*
+ * Unlike line_starts(), there are no newlines between the runs of the binary files.
+ */
+inline std::vector<uint64_t> run_starts(const std::vector<uint64_t>& bytes) {
+    std::vector<uint64_t> starts;
+    starts.reserve(bytes.size() + 1);
+    uint64_t total = 0;
+    starts.push_back(total);
+    for (auto b : bytes) {
+        if (b > std::numeric_limits<uint64_t>::max() - total) {
+            throw std::runtime_error("cumulative sum of bytes should fit in a 64-bit integer");
+        }
+        total += b;
+        starts.push_back(total);
+    }
+    return starts;
+}
+
+/*
+ * Checks a single line in the same manner as check_indices_lines(), plus a check that the encoding is canonical.
+ * With a canonical encoding, there is only one valid run of bytes for each line, which allows byte-for-byte comparisons between files.
+ * As the decoder has already checked that the data bytes are consumed exactly, we only need to check the varint and the control bytes;
+ * the latter is done in the same pass as the range checks, rather than encoding the line again.
+ */
+template<class Extra_>
+void check_binary_line(const unsigned char* ptr, size_t length, uint64_t index_limit, std::vector<uint64_t>& indices, const std::string& path, uint64_t line, Extra_& extra) {
+    decode_binary_line(ptr, length, indices, path, line);
+
+    const size_t n = indices.size();
+    if (n) {
+        size_t header = 1;
+        for (auto x = n; x >= 128; x >>= 7) {
+            ++header;
+        }
+        bool canonical = !(ptr[header - 1] & 128); // otherwise, the varint is longer than necessary.
+        const unsigned char* control = ptr + header;
+
+        uint64_t previous = indices.front();
+        if (previous >= index_limit) {
+            throw std::runtime_error("out-of-range index in '" + path + "'" + append_line_number(line));
+        }
+        unsigned char expected = streamvbyte_length(previous) - 1;
+
+        for (size_t i = 1; i < n; ++i) {
+            auto current = indices[i];
+            if (current <= previous) {
+                if (current == previous) {
+                    throw std::runtime_error("duplicate index in '" + path + "'" + append_line_number(line));
+                }
+                throw std::runtime_error("out-of-range index in '" + path + "'" + append_line_number(line)); // as the cumulative sum overflowed 32 bits.
+            }
+            if (current >= index_limit) {
+                throw std::runtime_error("out-of-range index in '" + path + "'" + append_line_number(line));
+            }
+
+            size_t lane = i % 4;
+            if (lane == 0) {
+                canonical &= (control[i / 4 - 1] == expected);
+                expected = 0;
+            }
+            expected |= (streamvbyte_length(current - previous) - 1) << (lane * 2);
+            previous = current;
+        }
+
+        canonical &= (control[(n - 1) / 4] == expected);
+        if (!canonical) {
+            throw std::runtime_error("non-canonical encoding of indices in '" + path + "'" + append_line_number(line));
+        }
+    }
+
+    extra(line, indices);
+}
+
+/*
+ * Validates the runs for lines 'first' to 'last - 1' from 'reader', which should contain exactly the bytes for those runs.
+ */
+template<class Extra_>
+void check_binary_lines(ChunkedReader& reader, const std::string& path, uint64_t index_limit, const std::vector<uint64_t>& ranges, size_t first, size_t last, Extra_& extra) {
+    std::vector<uint64_t> indices;
+    std::vector<unsigned char> buffer;
+
+    bool valid = reader.valid();
+    for (size_t line = first; line < last; ++line) {
+        size_t length = ranges[line];
+
+        // Avoiding a copy if the run lies entirely within the current chunk, which is always the case for memory-mapped files.
+        const unsigned char* ptr;
+        if (valid && reader.chunk_remaining() >= length) {
+            ptr = reinterpret_cast<const unsigned char*>(reader.chunk_pointer());
+        } else {
+            buffer.resize(length);
+            size_t copied = 0;
+            while (copied < length) {
+                if (!valid) {
+                    throw std::runtime_error("size of '" + path + "' is less than that expected from its '*.ranges.gz' file" + append_line_number(line));
+                }
+                size_t available = std::min(reader.chunk_remaining(), length - copied);
+                std::memcpy(buffer.data() + copied, reader.chunk_pointer(), available);
+                copied += available;
+                valid = reader.skip(available);
+            }
+            ptr = buffer.data();
+            length = 0; // so that the skip() below is a no-op.
+        }
+
+        check_binary_line(ptr, ranges[line], index_limit, indices, path, line, extra);
+        if (length) {
+            valid = reader.skip(length);
+        }
+    }
+
+    if (valid) {
+        throw std::runtime_error("size of '" + path + "' is greater than that expected from its '*.ranges.gz' file");
+    }
+}
+
+/*
+ * Equivalent to check_indices() for the binary files, where 'ranges' contains the number of bytes in each run.
+ * If 'options.num_threads > 1' and the file can be memory-mapped, the runs are split into shards that are validated in parallel,
+ * in which case 'extra' may be called concurrently and the validation is repeated in serial upon failure to report the first error.
+ */
+template<class Extra_>
+void check_binary_indices(const std::string& path, uint64_t index_limit, const std::vector<uint64_t>& ranges, Extra_ extra, const ReaderOptions& options = ReaderOptions()) {
+    std::exception_ptr parallel_error;
+    if (options.num_threads > 1 && options.memory_map_raw) {
+        try {
+            auto mapped = MappedFile::open(path);
+            if (mapped) {
+                const size_t num_ranges = ranges.size();
+                auto starts = run_starts(ranges);
+                uint64_t total = starts.back();
+                if (total != static_cast<uint64_t>(mapped->size())) {
+                    throw std::runtime_error("size of '" + path + "' is not consistent with its '*.ranges.gz' file");
+                }
+
+                size_t num_shards = std::max(std::min(static_cast<size_t>(options.num_threads) * 4, num_ranges), static_cast<size_t>(1));
+                parallelize(options.num_threads, num_shards, [&](size_t shard) -> void {
+                    size_t first = num_ranges / num_shards * shard + std::min(shard, num_ranges % num_shards);
+                    size_t last = num_ranges / num_shards * (shard + 1) + std::min(shard + 1, num_ranges % num_shards);
+                    ChunkedReader reader(mapped, starts[first], starts[last] - starts[first]);
+                    check_binary_lines(reader, path, index_limit, ranges, first, last, extra);
+                });
+                return;
+            }
+        } catch (...) {
+            parallel_error = std::current_exception();
+        }
+    }
+
+    auto reader = open_raw_reader(path, options);
+    check_binary_lines(reader, path, index_limit, ranges, 0, ranges.size(), extra);
+
+    // This should only happen if the parallel failure was not reproducible, e.g., due to a failure to allocate memory.
+    if (parallel_error) {
+        std::rethrow_exception(parallel_error);
+    }
+}
+
+/*
+ * Converts a single text file into its binary sibling, validating the text file along the way.
+ * The text file is always read in serial so that the binary runs are written in order.
+ */
+inline void convert_index_file(const std::string& prefix, const std::string& name, uint64_t index_limit, const std::vector<uint64_t>& ranges, const std::vector<std::string>& names, const WriteDatabaseOptions& options) {
+    if (index_limit > static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()) + 1) {
+        throw std::runtime_error("indices in '" + name + ".tsv' should fit in a 32-bit unsigned integer for conversion to the binary format");
+    }
+
+    auto bin_path = prefix + name + ".bin";
+    TextFileWriter output(bin_path);
+    ParallelGzipWriter ranges_output(bin_path + ".ranges.gz", options);
+    std::string encoded;
+    char buffer[32];
+
+    check_indices<false>(
+        prefix + name + ".tsv",
+        index_limit,
+        ranges,
+        [&](uint64_t line, const std::vector<uint64_t>& indices) {
+            encoded.clear();
+            encode_binary_line(indices.data(), indices.size(), encoded);
+            output.write(encoded);
+            if (!names.empty()) {
+                ranges_output.write(names[line]);
+                ranges_output.write("\t");
+            }
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<uint64_t>(encoded.size()));
+            ranges_output.write(std::string_view(buffer, res.ptr - buffer));
+            ranges_output.write("\n");
+        }
+    );
+
+    output.finish();
+    ranges_output.finish();
+}
+
+/*
+ * Describes each of the index files that have a binary sibling.
+ */
+struct BinaryIndexFile {
+    std::string name;
+    bool named;
+    bool sets; // whether the indices refer to sets rather than genes.
+};
+
+inline std::vector<BinaryIndexFile> binary_index_files() {
+    return std::vector<BinaryIndexFile>{
+        { "set2gene", false, false },
+        { "gene2set", false, true },
+        { "tokens-names", true, true },
+        { "tokens-descriptions", true, true }
+    };
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Convert the index files of a Gesel database into their binary siblings, i.e., `set2gene.bin`, `gene2set.bin`, `tokens-names.bin` and `tokens-descriptions.bin`,
+ * along with their `*.bin.ranges.gz` files.
+ * The text files are validated in the same manner as `validate_database()` during conversion, though they are not checked for consistency with each other or with the set details.
+ * An error is thrown if any index does not fit into a 32-bit unsigned integer.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param num_genes Total number of genes for this species.
+ * @param options Further options, used to compress the `*.bin.ranges.gz` files.
+ * Each text file is read on the calling thread.
+ */
+inline void convert_database_to_binary(const std::string& prefix, uint64_t num_genes, const WriteDatabaseOptions& options) {
+    auto total_sets = internal::count_total_sets(internal::load_ranges_with_sizes(prefix + "collections.tsv.ranges.gz").second);
+    for (const auto& file : internal::binary_index_files()) {
+        auto ranges_path = prefix + file.name + ".tsv.ranges.gz";
+        std::vector<uint64_t> ranges;
+        std::vector<std::string> names;
+        if (file.named) {
+            auto loaded = internal::load_named_ranges(ranges_path);
+            names = std::move(loaded.first);
+            ranges = std::move(loaded.second);
+        } else {
+            ranges = internal::load_ranges(ranges_path);
+        }
+        internal::convert_index_file(prefix, file.name, (file.sets ? total_sets : num_genes), ranges, names, options);
+    }
+}
+
+/**
+ * @brief Options for `validate_binary_database()`.
+ */
+struct ValidateBinaryOptions {
+    /**
+     * Number of threads to use.
+     * If greater than 1, the binary files are validated concurrently.
+     */
+    int num_threads = 1;
+
+    /**
+     * Number of threads used to validate each binary file.
+     * If greater than 1, each memory-mapped file is split into shards that are validated concurrently.
+     * This is applied separately for each file, so the total number of threads may be up to the product of `num_threads` and this value.
+     */
+    int num_index_threads = 1;
+
+    /**
+     * Whether to check that each binary file contains the same indices as its text counterpart.
+     * If true, the token names in each `*.bin.ranges.gz` file are also compared to those in the corresponding `*.tsv.ranges.gz` file.
+     */
+    bool compare_text = true;
+
+    /**
+     * Whether to memory-map each file rather than reading it in chunks.
+     * Only supported on POSIX systems, and enabled by default on Linux.
+     */
+    bool memory_map_raw = internal::memory_map_by_default;
+
+    /**
+     * Size of each buffer used for reading, in bytes.
+     */
+    size_t buffer_size = 65536;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Contents of an entire binary file, for random access to the runs of each line.
+ */
+class BinaryContents {
+public:
+    BinaryContents(const std::string& path, bool memory_map) {
+        if (memory_map) {
+            my_mapped = MappedFile::open(path);
+        }
+        if (my_mapped) {
+            my_data = reinterpret_cast<const unsigned char*>(my_mapped->data());
+            my_size = my_mapped->size();
+        } else {
+            PositionalFile file(path);
+            my_buffer.resize(file.size());
+            file.read(0, my_buffer.size(), reinterpret_cast<char*>(my_buffer.data()));
+            my_data = my_buffer.data();
+            my_size = my_buffer.size();
+        }
+    }
+
+    const unsigned char* data() const {
+        return my_data;
+    }
+
+    size_t size() const {
+        return my_size;
+    }
+
+private:
+    std::shared_ptr<const MappedFile> my_mapped;
+    std::vector<unsigned char> my_buffer;
+    const unsigned char* my_data = NULL;
+    size_t my_size = 0;
+};
+
+inline void validate_binary_file(const std::string& prefix, const BinaryIndexFile& file, uint64_t expected_lines, uint64_t index_limit, const ValidateBinaryOptions& options) {
+    ReaderOptions read_opt;
+    read_opt.buffer_size = options.buffer_size;
+    read_opt.memory_map_raw = options.memory_map_raw;
+    read_opt.num_threads = options.num_index_threads;
+
+    auto bin_name = file.name + ".bin";
+    auto bin_ranges_name = bin_name + ".ranges.gz";
+    std::vector<uint64_t> bin_ranges;
+    std::vector<std::string> bin_names;
+    if (file.named) {
+        auto loaded = load_named_ranges(prefix + bin_ranges_name);
+        bin_names = std::move(loaded.first);
+        bin_ranges = std::move(loaded.second);
+    } else {
+        bin_ranges = load_ranges(prefix + bin_ranges_name);
+        if (bin_ranges.size() != expected_lines) {
+            throw std::runtime_error("number of lines in '" + bin_ranges_name + "' does not match the total number of " + (file.sets ? "genes" : "sets"));
+        }
+    }
+
+    check_binary_indices(prefix + bin_name, index_limit, bin_ranges, [](uint64_t, const std::vector<uint64_t>&) -> void {}, read_opt);
+    if (!options.compare_text) {
+        return;
+    }
+
+    auto text_name = file.name + ".tsv";
+    auto text_ranges_name = text_name + ".ranges.gz";
+    std::vector<uint64_t> text_ranges;
+    if (file.named) {
+        auto loaded = load_named_ranges(prefix + text_ranges_name);
+        if (loaded.first != bin_names) {
+            throw std::runtime_error("names in '" + bin_ranges_name + "' are not the same as those in '" + text_ranges_name + "'");
+        }
+        text_ranges = std::move(loaded.second);
+    } else {
+        text_ranges = load_ranges(prefix + text_ranges_name);
+    }
+    if (text_ranges.size() != bin_ranges.size()) {
+        throw std::runtime_error("number of lines in '" + bin_ranges_name + "' does not match that in '" + text_ranges_name + "'");
+    }
+
+    // All runs have already been validated, so we can decode them directly.
+    BinaryContents contents(prefix + bin_name, options.memory_map_raw);
+    auto starts = run_starts(bin_ranges);
+    if (starts.back() != static_cast<uint64_t>(contents.size())) {
+        throw std::runtime_error("size of '" + bin_name + "' is not consistent with its '*.ranges.gz' file");
+    }
+    std::vector<uint64_t> indices;
+    read_opt.num_threads = 1; // as 'indices' is shared across calls.
+    check_indices<false>(
+        prefix + text_name,
+        index_limit,
+        text_ranges,
+        [&](uint64_t line, const std::vector<uint64_t>& expected) -> void {
+            decode_binary_line(contents.data() + starts[line], bin_ranges[line], indices, bin_name, line);
+            if (indices != expected) {
+                throw std::runtime_error("different indices between '" + bin_name + "' and '" + text_name + "'" + append_line_number(line));
+            }
+        },
+        read_opt
+    );
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Validate the binary siblings of the index files, as created by `convert_database_to_binary()`.
+ * Each binary file is checked for correct encoding and consistency with its `*.bin.ranges.gz` file, and all indices are checked to be in range, sorted and unique.
+ * If `ValidateBinaryOptions::compare_text = true`, the indices in each binary file are also compared to those in its text counterpart.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param num_genes Total number of genes for this species.
+ * @param options Further options.
+ */
+inline void validate_binary_database(const std::string& prefix, uint64_t num_genes, const ValidateBinaryOptions& options) {
+    auto total_sets = internal::count_total_sets(internal::load_ranges_with_sizes(prefix + "collections.tsv.ranges.gz").second);
+    auto files = internal::binary_index_files();
+    internal::parallelize(options.num_threads, files.size(), [&](size_t f) -> void {
+        const auto& file = files[f];
+        internal::validate_binary_file(prefix, file, (file.sets ? num_genes : total_sets), (file.sets ? total_sets : num_genes), options);
+    });
+}
+
+/**
+ * @brief Fetch indices from the binary index files with coalesced byte range requests.
+ *
+ * This is the counterpart to `LineFetcher::fetch_indices()` for the binary siblings of the index files.
+ * Requests are planned in the same manner, but each request transfers fewer bytes and the indices are decoded without any parsing of decimal digits.
+ */
+class BinaryIndexFetcher {
+public:
+    /**
+     * @param fetcher Source of the database files.
+     * @param name Name of the binary file, e.g., `9606_set2gene.bin`.
+     * The number of bytes for each line is fetched from `<name>.ranges.gz`.
+     * @param format Format of the `*.ranges.gz` file.
+     * This should be `RangesFormat::NAME_AND_BYTES` for the token files.
+     */
+    BinaryIndexFetcher(std::shared_ptr<const RangeFetcher> fetcher, std::string name, RangesFormat format = RangesFormat::BYTES) :
+        my_fetcher(std::move(fetcher)), my_name(std::move(name))
+    {
+        auto ranges_name = my_name + ".ranges.gz";
+        auto contents = internal::inflate_gzip_buffer(my_fetcher->fetch_all(ranges_name), ranges_name);
+        byteme::RawBufferReader reader(contents.data(), contents.size());
+        auto loaded = internal::load_line_ranges(reader, ranges_name, format);
+        my_names = std::move(loaded.names);
+        my_starts = internal::run_starts(loaded.bytes);
+    }
+
+public:
+    /**
+     * @return Number of lines in the file.
+     */
+    size_t num_lines() const {
+        return my_starts.size() - 1;
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @return Number of bytes used to encode the line.
+     */
+    uint64_t line_length(size_t line) const {
+        internal::check_line_index(line, num_lines());
+        return my_starts[line + 1] - my_starts[line];
+    }
+
+    /**
+     * @return The first field of each line in the `*.ranges.gz` file, if `RangesFormat::NAME_AND_BYTES` was used; otherwise empty.
+     */
+    const std::vector<std::string>& names() const {
+        return my_names;
+    }
+
+    /**
+     * @param name Name of interest, e.g., a token.
+     * @return Index of the line with this name, or `num_lines()` if no such line exists.
+     */
+    size_t find_name(std::string_view name) const {
+        auto found = internal::find_sorted_name(my_names, name);
+        return (found == my_names.size() ? num_lines() : found);
+    }
+
+    /**
+     * @param lines Indices of the lines to fetch.
+     * These need not be sorted or unique.
+     * @param options Further options.
+     * @return Number of byte range requests that would be issued by `fetch_indices()`.
+     */
+    size_t num_requests(const std::vector<size_t>& lines, const FetchLinesOptions& options) const {
+        return internal::plan_line_requests(my_starts, lines, options.max_gap).requests.size();
+    }
+
+    /**
+     * @param lines Indices of the lines to fetch.
+     * These need not be sorted or unique.
+     * @param options Further options.
+     * @return The decoded indices for each line in `lines`.
+     */
+    std::vector<std::vector<uint64_t> > fetch_indices(const std::vector<size_t>& lines, const FetchLinesOptions& options) const {
+        auto plan = internal::plan_line_requests(my_starts, lines, options.max_gap);
+        const auto& requests = plan.requests;
+        std::vector<std::vector<char> > buffers(requests.size());
+        internal::parallelize(options.num_threads, requests.size(), [&](size_t r) -> void {
+            const auto& req = requests[r];
+            auto& buffer = buffers[r];
+            buffer.resize(req.end - req.start);
+            my_fetcher->fetch(my_name, req.start, buffer.size(), buffer.data());
+        });
+
+        std::vector<std::vector<uint64_t> > output(lines.size());
+        for (size_t r = 0, end = requests.size(); r < end; ++r) {
+            const auto& req = requests[r];
+            auto buffer = reinterpret_cast<const unsigned char*>(buffers[r].data());
+            for (size_t i = req.first; i < req.last; ++i) {
+                auto o = plan.order[i];
+                size_t line = lines[o];
+                internal::decode_binary_line(buffer + (my_starts[line] - req.start), line_length(line), output[o], my_name, line);
+            }
+            std::vector<char>().swap(buffers[r]);
+        }
+        return output;
+    }
+
+private:
+    std::shared_ptr<const RangeFetcher> my_fetcher;
+    std::string my_name;
+    std::vector<uint64_t> my_starts;
+    std::vector<std::string> my_names;
+};
+
+}
+
+#endif
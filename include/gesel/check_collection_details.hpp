@@ -4,77 +4,99 @@
 #include <string>
 #include <cstdint>
 #include <vector>
-
-#include "byteme/byteme.hpp"
+#include <string_view>
 
 #include "parse_field.hpp"
+#include "chunked_reader.hpp"
 
 namespace gesel {
 
 namespace internal {
 
-inline void check_collection_details(const std::string& path, const std::vector<uint64_t>& ranges, const std::vector<uint64_t>& numbers) {
-    byteme::RawFileReader raw_r(path.c_str(), {});
+/*
+ * 'extra' is called with the line number and the fields of each line; the views are only valid for the duration of the call.
+ * If 'has_gzip_ = false', only the uncompressed file is parsed, e.g., when loading a database without validation.
+ */
+template<bool has_gzip_ = true, class Extra_>
+void check_collection_details(const std::string& path, const std::vector<uint64_t>& ranges, const std::vector<uint64_t>& numbers, Extra_ extra, const ReaderOptions& options) {
+    auto raw_p = open_raw_reader(path, options);
     auto gzpath = path + ".gz";
-    byteme::GzipFileReader gzip_r(gzpath.c_str(), {});
-
-    byteme::SerialBufferedReader<char, decltype(&raw_r)> raw_p(&raw_r, 65536);
-    byteme::SerialBufferedReader<char, decltype(&gzip_r)> gzip_p(&gzip_r, 65536);
+    auto gzip_p = [&]{
+        if constexpr(has_gzip_) {
+            return open_gzip_reader(gzpath, options);
+        } else {
+            return false;
+        }
+    }();
 
     bool raw_valid = raw_p.valid();
-    bool gzip_valid = gzip_p.valid();
+    bool gzip_valid = [&]{
+        if constexpr(has_gzip_) {
+            return gzip_p.valid();
+        } else {
+            return false;
+        }
+    }();
     uint64_t line = 0;
     const uint64_t num_ranges = ranges.size();
+    std::string raw_scratch, gzip_scratch;
 
     while (raw_valid) {
-        auto raw_pos = raw_p.position();
-        auto title = parse_string_field<FieldType::MIDDLE>(raw_p, raw_valid, path, line);
-        auto description = parse_string_field<FieldType::MIDDLE>(raw_p, raw_valid, path, line);
-        auto species = parse_integer_field<FieldType::MIDDLE>(raw_p, raw_valid, path, line);
-        auto maintainer = parse_string_field<FieldType::MIDDLE>(raw_p, raw_valid, path, line);
-        auto source = parse_string_field<FieldType::LAST>(raw_p, raw_valid, path, line);
+        auto raw_line = read_line(raw_p, raw_scratch);
+        bool line_valid = true;
+        auto title = parse_string_view_field<FieldType::MIDDLE>(raw_line, line_valid, path, line);
+        auto description = parse_string_view_field<FieldType::MIDDLE>(raw_line, line_valid, path, line);
+        auto species = parse_integer_field<FieldType::MIDDLE>(raw_line, line_valid, path, line);
+        auto maintainer = parse_string_view_field<FieldType::MIDDLE>(raw_line, line_valid, path, line);
+        auto source = parse_string_view_field<FieldType::LAST>(raw_line, line_valid, path, line);
 
         if (line >= num_ranges) {
             throw std::runtime_error("number of lines in '" + path + "' exceeds that expected from its '*.ranges.gz' file " + append_line_number(line));
         }
-        if (raw_p.position() - raw_pos - 1 != static_cast<size_t>(ranges[line])) {
+        if (raw_line.length() != static_cast<size_t>(ranges[line])) {
             throw std::runtime_error("number of bytes per line in '" + path + "' is not the same as that expected from the '*.ranges.gz' file " + append_line_number(line));
         }
 
-        if (!gzip_valid) {
-            throw std::runtime_error("early termination of the Gzipped version of '" + path + "'");
-        }
-
-        auto gz_title = parse_string_field<FieldType::MIDDLE>(gzip_p, gzip_valid, path, line);
-        if (gz_title != title) {
-            throw std::runtime_error("different title in '" + path + "' compared to its Gzipped version " + append_line_number(line));
-        }
-
-        auto gz_description = parse_string_field<FieldType::MIDDLE>(gzip_p, gzip_valid, path, line);
-        if (gz_description != description) {
-            throw std::runtime_error("different description in '" + path + "' compared to its Gzipped version " + append_line_number(line));
-        }
-
-        auto gz_species = parse_integer_field<FieldType::MIDDLE>(gzip_p, gzip_valid, path, line);
-        if (gz_species != species) {
-            throw std::runtime_error("different species in '" + path + "' compared to its Gzipped version " + append_line_number(line));
-        }
-
-        auto gz_maintainer = parse_string_field<FieldType::MIDDLE>(gzip_p, gzip_valid, path, line);
-        if (gz_maintainer != maintainer) {
-            throw std::runtime_error("different maintainer in '" + path + "' compared to its Gzipped version " + append_line_number(line));
-        }
-
-        auto gz_source = parse_string_field<FieldType::MIDDLE>(gzip_p, gzip_valid, path, line);
-        if (gz_source != source) {
-            throw std::runtime_error("different source in '" + path + "' compared to its Gzipped version " + append_line_number(line));
-        }
-
-        auto gz_number = parse_integer_field<FieldType::LAST>(gzip_p, gzip_valid, path, line);
-        if (gz_number != numbers[line]) {
-            throw std::runtime_error("different number in '" + path + ".gz' compared to its '*.ranges.gz' file " + append_line_number(line));
+        if constexpr(has_gzip_) {
+            if (!gzip_valid) {
+                throw std::runtime_error("early termination of the Gzipped version of '" + path + "'");
+            }
+
+            auto gzip_line = read_line(gzip_p, gzip_scratch);
+            auto gz_title = parse_string_view_field<FieldType::MIDDLE>(gzip_line, line_valid, path, line);
+            if (gz_title != title) {
+                throw std::runtime_error("different title in '" + path + "' compared to its Gzipped version " + append_line_number(line));
+            }
+
+            auto gz_description = parse_string_view_field<FieldType::MIDDLE>(gzip_line, line_valid, path, line);
+            if (gz_description != description) {
+                throw std::runtime_error("different description in '" + path + "' compared to its Gzipped version " + append_line_number(line));
+            }
+
+            auto gz_species = parse_integer_field<FieldType::MIDDLE>(gzip_line, line_valid, path, line);
+            if (gz_species != species) {
+                throw std::runtime_error("different species in '" + path + "' compared to its Gzipped version " + append_line_number(line));
+            }
+
+            auto gz_maintainer = parse_string_view_field<FieldType::MIDDLE>(gzip_line, line_valid, path, line);
+            if (gz_maintainer != maintainer) {
+                throw std::runtime_error("different maintainer in '" + path + "' compared to its Gzipped version " + append_line_number(line));
+            }
+
+            auto gz_source = parse_string_view_field<FieldType::MIDDLE>(gzip_line, line_valid, path, line);
+            if (gz_source != source) {
+                throw std::runtime_error("different source in '" + path + "' compared to its Gzipped version " + append_line_number(line));
+            }
+
+            auto gz_number = parse_integer_field<FieldType::LAST>(gzip_line, line_valid, path, line);
+            if (gz_number != numbers[line]) {
+                throw std::runtime_error("different number in '" + path + ".gz' compared to its '*.ranges.gz' file " + append_line_number(line));
+            }
+            gzip_valid = finish_line(gzip_p, gzip_line);
         }
 
+        extra(line, title, description, species, maintainer, source);
+        raw_valid = finish_line(raw_p, raw_line);
         ++line;
     }
 
@@ -83,6 +105,16 @@ inline void check_collection_details(const std::string& path, const std::vector<
     }
 }
 
+inline void check_collection_details(const std::string& path, const std::vector<uint64_t>& ranges, const std::vector<uint64_t>& numbers, const ReaderOptions& options = ReaderOptions()) {
+    check_collection_details<true>(
+        path,
+        ranges,
+        numbers,
+        [](uint64_t, std::string_view, std::string_view, uint64_t, std::string_view, std::string_view) -> void {},
+        options
+    );
+}
+
 }
 
 }
@@ -3,6 +3,7 @@
 
 #include <limits>
 #include <cstdint>
+#include <cstddef>
 #include <vector>
 #include <string>
 #include <stdexcept>
@@ -17,8 +18,36 @@ namespace gesel {
 
 namespace internal {
 
-inline uint64_t check_genes(const std::string& path) {
-    byteme::GzipFileReader reader(path.c_str(), {});
+/*
+ * Counts the bytes returned by another reader, e.g., the number of decompressed bytes from a GzipFileReader.
+ */
+class CountingReader final : public byteme::Reader {
+public:
+    CountingReader(byteme::Reader& reader) : my_reader(reader) {}
+
+    std::size_t read(unsigned char* buffer, std::size_t n) {
+        auto output = my_reader.read(buffer, n);
+        my_total += output;
+        return output;
+    }
+
+    uint64_t total() const {
+        return my_total;
+    }
+
+private:
+    byteme::Reader& my_reader;
+    uint64_t my_total = 0;
+};
+
+/*
+ * Calls 'on_name(line, name)' for each name in the file, so that callers can collect the names in the same pass as the validation.
+ * If 'inflated' is not NULL, it is set to the number of decompressed bytes.
+ */
+template<class OnName_>
+uint64_t check_genes(const std::string& path, OnName_ on_name, uint64_t* inflated = NULL) {
+    byteme::GzipFileReader gz(path.c_str(), {});
+    CountingReader reader(gz);
     byteme::SerialBufferedReader<char, decltype(&reader)> pb(&reader, 65536);
     std::vector<uint64_t> output;
 
@@ -40,6 +69,7 @@ inline uint64_t check_genes(const std::string& path) {
                 if (current_names.find(parsed.first) != current_names.end()) {
                     throw std::runtime_error("duplicated names detected in '" + path + "' " + append_line_number(line)); 
                 }
+                on_name(line, parsed.first);
                 if (parsed.second) {
                     break;
                 }
@@ -53,9 +83,16 @@ inline uint64_t check_genes(const std::string& path) {
         ++line;
     }
 
+    if (inflated) {
+        *inflated = reader.total();
+    }
     return line;
 }
 
+inline uint64_t check_genes(const std::string& path) {
+    return check_genes(path, [](uint64_t, const std::string&) -> void {});
+}
+
 }
 
 }
@@ -4,36 +4,36 @@
 #include <string>
 #include <cstdint>
 #include <vector>
-
-#include "byteme/byteme.hpp"
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
 
 #include "parse_field.hpp"
+#include "chunked_reader.hpp"
+#include "gzip_index.hpp"
+#include "parallelize.hpp"
 
 namespace gesel {
 
 namespace internal {
 
-template<bool has_gzip_, class Extra_>
-void check_indices(const std::string& path, uint64_t index_limit, const std::vector<uint64_t>& ranges, Extra_ extra) {
-    byteme::RawFileReader raw_r(path.c_str(), {});
-    auto gzpath = path + ".gz";
-    auto gzip_r = [&]{
-        if constexpr(has_gzip_) {
-            return byteme::GzipFileReader(gzpath.c_str(), {});
-        } else {
-            return false;
-        }
-    }();
-
-    byteme::SerialBufferedReader<char, decltype(&raw_r)> raw_p(&raw_r, 65536);
-    auto gzip_p = [&]{
-        if constexpr(has_gzip_) {
-            return byteme::SerialBufferedReader<char, decltype(&gzip_r)>(&gzip_r, 65536);
-        } else {
-            return false;
-        }
-    }();
-
+/*
+ * Validates each line from 'raw_p' (and its counterpart in 'gzip_p'), starting from the specified line number.
+ * Returns the number of the line after the last line that was read.
+ */
+template<bool has_gzip_, class RawSource_, class GzipSource_, class Extra_>
+uint64_t check_indices_lines(
+    RawSource_& raw_p,
+    GzipSource_& gzip_p,
+    const std::string& path,
+    const std::string& gzpath,
+    uint64_t index_limit,
+    const std::vector<uint64_t>& ranges,
+    uint64_t line,
+    Extra_& extra)
+{
     bool raw_valid = raw_p.valid();
     bool gzip_valid = [&]{
         if constexpr(has_gzip_) {
@@ -45,7 +45,6 @@ void check_indices(const std::string& path, uint64_t index_limit, const std::vec
 
     std::vector<uint64_t> raw_indices;
     typename std::conditional<has_gzip_, std::vector<uint64_t>, bool>::type gzip_indices;
-    uint64_t line = 0;
     const uint64_t num_ranges = ranges.size();
 
     while (raw_valid) {
@@ -124,9 +123,258 @@ void check_indices(const std::string& path, uint64_t index_limit, const std::vec
         ++line;
     }
 
+    return line;
+}
+
+/*
+ * Byte-for-byte comparison of the Gzip-compressed twin with the uncompressed file.
+ * For valid files, this is equivalent to comparing the parsed indices in each line,
+ * as there is only one valid way to write each delta-encoded line.
+ * Any trailing bytes in the Gzip-compressed file are ignored, consistent with check_indices_lines().
+ */
+inline void compare_gzip_bytes(const std::string& gzpath, const MappedFile& raw, const ReaderOptions& options) {
+    auto gzip_p = open_gzip_reader(gzpath, options);
+    const char* expected = raw.data();
+    size_t remaining = raw.size();
+
+    bool valid = gzip_p.valid();
+    while (remaining) {
+        if (!valid) {
+            throw std::runtime_error("early termination of the Gzipped version");
+        }
+        size_t available = std::min(gzip_p.chunk_remaining(), remaining);
+        if (std::memcmp(gzip_p.chunk_pointer(), expected, available) != 0) {
+            throw std::runtime_error("different bytes in the Gzipped version");
+        }
+        expected += available;
+        remaining -= available;
+        valid = gzip_p.skip(available);
+    }
+}
+
+inline std::string gzip_index_path(const std::string& gzpath) {
+    return gzpath + ".zran";
+}
+
+/*
+ * Same as compare_gzip_bytes(), but also builds a checkpoint index for the Gzip-compressed file and saves it if requested.
+ * The index is only saved if the entire file could be decompressed; it does not depend on whether the comparison succeeds.
+ */
+inline void compare_gzip_bytes_and_index(const std::string& gzpath, const MappedFile& gz, const MappedFile& raw, const ReaderOptions& options) {
+    const char* expected = raw.data();
+    const size_t total = raw.size();
+    size_t compared = 0;
+
+    bool mismatch = false, built = false;
+    GzipIndex index;
+    try {
+        index = build_gzip_index(gz, options.gzip_index_spacing, [&](const unsigned char* ptr, size_t n) -> void {
+            if (compared < total) {
+                size_t available = std::min(n, total - compared);
+                if (std::memcmp(ptr, expected + compared, available) != 0) {
+                    mismatch = true;
+                    throw std::runtime_error("different bytes in the Gzipped version");
+                }
+                compared += available;
+            }
+        });
+        built = true;
+    } catch (...) {
+        // Decompression errors after the comparison is complete are ignored, consistent with check_indices_lines().
+        if (mismatch || compared < total) {
+            throw;
+        }
+    }
+
+    if (compared < total) {
+        throw std::runtime_error("early termination of the Gzipped version");
+    }
+
+    if (built && options.save_gzip_index) {
+        try {
+            save_gzip_index(index, gzip_index_path(gzpath));
+        } catch (...) {
+            // Failing to save the index is not a validation failure, e.g., the directory might be read-only.
+        }
+    }
+}
+
+/*
+ * Compares the uncompressed bytes between a checkpoint and the next checkpoint (or the end of the uncompressed file).
+ */
+inline void compare_gzip_span(const MappedFile& gz, const GzipIndex& index, size_t span, const MappedFile& raw) {
+    const auto& points = index.checkpoints;
+    uint64_t start = points[span].uncompressed;
+    uint64_t end = (span + 1 < points.size() ? points[span + 1].uncompressed : index.uncompressed_size);
+    end = std::min(end, static_cast<uint64_t>(raw.size()));
+    if (start >= end) {
+        return;
+    }
+
+    const char* expected = raw.data() + start;
+    uint64_t length = end - start;
+    auto produced = inflate_from_checkpoint(gz, points[span], length, [&](const unsigned char* ptr, size_t n) -> void {
+        if (std::memcmp(ptr, expected, n) != 0) {
+            throw std::runtime_error("different bytes in the Gzipped version");
+        }
+        expected += n;
+    });
+    if (produced != length) {
+        throw std::runtime_error("early termination of the Gzipped version");
+    }
+}
+
+/*
+ * Loads the sidecar index for the Gzip-compressed file, if it exists and matches the current file.
+ */
+inline bool load_matching_gzip_index(const std::string& gzpath, const MappedFile& gz, GzipIndex& index) {
+    GzipIndex candidate;
+    try {
+        candidate = load_gzip_index(gzip_index_path(gzpath));
+    } catch (...) {
+        return false;
+    }
+    if (!gzip_index_matches(candidate, gz)) {
+        return false;
+    }
+    if (candidate.checkpoints.empty() && candidate.uncompressed_size) {
+        return false;
+    }
+    index = std::move(candidate);
+    return true;
+}
+
+/*
+ * Validates the uncompressed file in line-aligned shards on separate threads, using the byte ranges to find the start of each shard.
+ * Returns false if the file could not be memory-mapped, in which case nothing was done.
+ * Otherwise, any failure results in an error that does not necessarily match the first error from a serial pass.
+ */
+template<bool has_gzip_, class Extra_>
+bool check_indices_sharded(const std::string& path, const std::string& gzpath, uint64_t index_limit, const std::vector<uint64_t>& ranges, Extra_& extra, const ReaderOptions& options) {
+    auto mapped = MappedFile::open(path);
+    if (!mapped) {
+        return false;
+    }
+
+    const size_t num_ranges = ranges.size();
+    std::vector<uint64_t> starts;
+    starts.reserve(num_ranges + 1);
+    uint64_t total = 0;
+    starts.push_back(total);
+    for (auto r : ranges) {
+        if (r >= std::numeric_limits<uint64_t>::max() - total) {
+            throw std::runtime_error("cumulative sum of bytes should fit in a 64-bit integer");
+        }
+        total += r + 1;
+        starts.push_back(total);
+    }
+    if (total != static_cast<uint64_t>(mapped->size())) {
+        throw std::runtime_error("size of '" + path + "' is not consistent with its '*.ranges.gz' file");
+    }
+
+    // Splitting the lines so that each shard has roughly the same number of bytes.
+    size_t num_shards = std::min(static_cast<size_t>(options.num_threads) * 4, num_ranges);
+    std::vector<size_t> boundaries(1);
+    for (size_t s = 1; s < num_shards; ++s) {
+        uint64_t target = total / num_shards * s;
+        size_t candidate = std::upper_bound(starts.begin(), starts.end(), target) - starts.begin() - 1;
+        if (candidate > boundaries.back()) {
+            boundaries.push_back(candidate);
+        }
+    }
+    boundaries.push_back(num_ranges);
+    num_shards = boundaries.size() - 1;
+
+    // If we have a checkpoint index, the Gzip-compressed file can be split into spans that are decompressed in parallel.
+    // Otherwise, the Gzip comparison is the long pole, so we start it first.
+    std::shared_ptr<const MappedFile> gzmapped;
+    GzipIndex gzindex;
+    bool use_index = false;
+    size_t num_spans = 0;
+    if constexpr(has_gzip_) {
+        if (options.gzip_index) {
+            gzmapped = MappedFile::open(gzpath);
+        }
+        use_index = gzmapped && load_matching_gzip_index(gzpath, *gzmapped, gzindex);
+        if (use_index) {
+            if (gzindex.uncompressed_size < total) {
+                throw std::runtime_error("early termination of the Gzipped version");
+            }
+            num_spans = gzindex.checkpoints.size();
+        } else {
+            num_spans = 1;
+        }
+    }
+
+    size_t num_tasks = num_shards + num_spans;
+    parallelize(options.num_threads, num_tasks, [&](size_t task) -> void {
+        if constexpr(has_gzip_) {
+            if (task < num_spans) {
+                if (use_index) {
+                    compare_gzip_span(*gzmapped, gzindex, task, *mapped);
+                } else if (gzmapped) {
+                    compare_gzip_bytes_and_index(gzpath, *gzmapped, *mapped, options);
+                } else {
+                    compare_gzip_bytes(gzpath, *mapped, options);
+                }
+                return;
+            }
+            task -= num_spans;
+        }
+
+        size_t first = boundaries[task], last = boundaries[task + 1];
+        ChunkedReader raw_p(mapped, starts[first], starts[last] - starts[first]);
+        bool placeholder = false;
+        auto next = check_indices_lines<false>(raw_p, placeholder, path, gzpath, index_limit, ranges, first, extra);
+        if (next != last) {
+            throw std::runtime_error("lines in '" + path + "' are not consistent with its '*.ranges.gz' file");
+        }
+    });
+
+    return true;
+}
+
+/*
+ * If 'options.num_threads > 1' and memory mapping is enabled, the file is split into shards that are validated in parallel where possible,
+ * in which case 'extra' may be called concurrently (though lines within each shard are still processed in order).
+ * If the parallel validation fails, we repeat the validation in serial to report the first error,
+ * so 'extra' may be called more than once for some lines.
+ * If 'options.gzip_index = true', the Gzip-compressed file is also decompressed in parallel from the checkpoints in its sidecar index, if available.
+ */
+template<bool has_gzip_, class Extra_>
+void check_indices(const std::string& path, uint64_t index_limit, const std::vector<uint64_t>& ranges, Extra_ extra, const ReaderOptions& options = ReaderOptions()) {
+    auto gzpath = path + ".gz";
+
+    std::exception_ptr parallel_error;
+    if (options.num_threads > 1 && options.memory_map_raw) {
+        try {
+            if (check_indices_sharded<has_gzip_>(path, gzpath, index_limit, ranges, extra, options)) {
+                return;
+            }
+        } catch (...) {
+            parallel_error = std::current_exception();
+        }
+    }
+
+    auto raw_p = open_raw_reader(path, options);
+    auto gzip_p = [&]{
+        if constexpr(has_gzip_) {
+            return open_gzip_reader(gzpath, options);
+        } else {
+            return false;
+        }
+    }();
+
+    auto line = check_indices_lines<has_gzip_>(raw_p, gzip_p, path, gzpath, index_limit, ranges, 0, extra);
+    const uint64_t num_ranges = ranges.size();
     if (line != num_ranges) {
         throw std::runtime_error("number of lines in '" + path + "' is less than that expected from its '*.ranges.gz' file (line " + std::to_string(line + 1) + ")");
     }
+
+    // This should only happen if the parallel failure was not reproducible, e.g., due to a failure to allocate memory.
+    if (parallel_error) {
+        std::rethrow_exception(parallel_error);
+    }
 }
 
 }
@@ -0,0 +1,350 @@
+#ifndef GESEL_CHUNKED_READER_HPP
+#define GESEL_CHUNKED_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+
+#include "byteme/byteme.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define GESEL_HAS_MMAP
+#endif
+
+namespace gesel {
+
+namespace internal {
+
+#ifdef __linux__
+constexpr bool memory_map_by_default = true;
+#else
+constexpr bool memory_map_by_default = false;
+#endif
+
+struct ReaderOptions {
+    size_t buffer_size = 65536;
+    bool background_gzip = false;
+    bool background_raw = false;
+    size_t num_buffers = 4;
+    bool memory_map_raw = memory_map_by_default;
+    int num_threads = 1;
+    bool gzip_index = false;
+    bool save_gzip_index = false;
+    uint64_t gzip_index_spacing = 1048576;
+};
+
+/*
+ * Read-only memory mapping of an entire file.
+ * open() returns a null pointer if the file cannot be mapped (e.g., it is not a regular file, or mmap is not supported on this platform),
+ * in which case the caller should fall back to reading it as a stream.
+ */
+class MappedFile {
+private:
+    MappedFile() = default;
+
+public:
+    ~MappedFile() {
+#ifdef GESEL_HAS_MMAP
+        if (my_size) {
+            munmap(const_cast<char*>(my_data), my_size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    static std::shared_ptr<const MappedFile> open(const std::string& path) {
+#ifdef GESEL_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("failed to open file at '" + path + "'");
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            ::close(fd);
+            return NULL;
+        }
+
+        std::shared_ptr<MappedFile> output(new MappedFile);
+        output->my_size = info.st_size;
+        if (output->my_size) {
+            void* ptr = mmap(NULL, output->my_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (ptr == MAP_FAILED) {
+                return NULL;
+            }
+            output->my_data = static_cast<const char*>(ptr);
+            madvise(ptr, output->my_size, MADV_SEQUENTIAL); // purely a hint, so we don't care if it fails.
+        } else {
+            ::close(fd);
+        }
+        return output;
+#else
+        (void)path;
+        return NULL;
+#endif
+    }
+
+public:
+    const char* data() const {
+        return my_data;
+    }
+
+    size_t size() const {
+        return my_size;
+    }
+
+private:
+    const char* my_data = NULL;
+    size_t my_size = 0;
+};
+
+/*
+ * Byte source that satisfies the same get()/advance()/position() contract as byteme::SerialBufferedReader.
+ * In background mode, a producer thread reads (and decompresses) chunks into a ring of buffers while the caller parses the current chunk.
+ * Otherwise, each chunk is read on the calling thread when the previous chunk is exhausted.
+ * Alternatively, the reader can be constructed from (a region of) a memory-mapped file, in which case the entire region is treated as a single chunk.
+ */
+class ChunkedReader {
+public:
+    ChunkedReader(std::unique_ptr<byteme::Reader> reader, size_t buffer_size, bool background, size_t num_buffers) :
+        my_reader(std::move(reader)),
+        my_buffer_size(buffer_size < 1 ? 1 : buffer_size),
+        my_background(background)
+    {
+        size_t nbuffers = (my_background ? (num_buffers < 2 ? 2 : num_buffers) : 1);
+        my_buffers.resize(nbuffers);
+        my_filled.resize(nbuffers);
+        for (auto& buf : my_buffers) {
+            buf.resize(my_buffer_size);
+        }
+
+        if (my_background) {
+            my_thread = std::thread([this]() -> void { produce(); });
+        }
+
+        try {
+            acquire();
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ChunkedReader(std::shared_ptr<const MappedFile> file, size_t start, size_t length) : my_file(std::move(file)) {
+        my_chunk = my_file->data() + start;
+        my_available = length;
+        my_exhausted = true;
+    }
+
+    ChunkedReader(std::shared_ptr<const MappedFile> file) : ChunkedReader(file, 0, file->size()) {}
+
+    ~ChunkedReader() {
+        stop();
+    }
+
+    ChunkedReader(const ChunkedReader&) = delete;
+    ChunkedReader& operator=(const ChunkedReader&) = delete;
+
+public:
+    bool valid() const {
+        return my_current < my_available;
+    }
+
+    char get() const {
+        return my_chunk[my_current];
+    }
+
+    bool advance() {
+        ++my_current;
+        if (my_current < my_available) {
+            return true;
+        }
+        return refill();
+    }
+
+    unsigned long long position() const {
+        return my_offset + my_current;
+    }
+
+public:
+    // Contiguous access to the remainder of the current chunk, for parsers that can process multiple bytes at once.
+    const char* chunk_pointer() const {
+        return my_chunk + my_current;
+    }
+
+    size_t chunk_remaining() const {
+        return my_available - my_current;
+    }
+
+    // 'n' should be positive and no greater than chunk_remaining().
+    bool skip(size_t n) {
+        my_current += n;
+        if (my_current < my_available) {
+            return true;
+        }
+        return refill();
+    }
+
+private:
+    std::unique_ptr<byteme::Reader> my_reader;
+    size_t my_buffer_size = 0;
+    bool my_background = false;
+    std::shared_ptr<const MappedFile> my_file;
+
+    std::vector<std::vector<char> > my_buffers;
+    std::vector<size_t> my_filled;
+
+    const char* my_chunk = NULL;
+    size_t my_current = 0;
+    size_t my_available = 0;
+    unsigned long long my_offset = 0;
+    bool my_exhausted = false;
+
+    // Only used in background mode; the ring is indexed by the number of chunks produced/consumed so far.
+    std::thread my_thread;
+    std::mutex my_mutex;
+    std::condition_variable my_cv;
+    size_t my_produced = 0;
+    size_t my_consumed = 0;
+    bool my_finished = false;
+    bool my_stop = false;
+    std::exception_ptr my_error;
+
+private:
+    void stop() {
+        if (my_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lck(my_mutex);
+                my_stop = true;
+            }
+            my_cv.notify_all();
+            my_thread.join();
+        }
+    }
+
+    size_t read_into(std::vector<char>& buffer) {
+        return my_reader->read(reinterpret_cast<unsigned char*>(buffer.data()), my_buffer_size);
+    }
+
+    void produce() {
+        size_t nbuffers = my_buffers.size();
+        try {
+            while (true) {
+                size_t slot;
+                {
+                    std::unique_lock<std::mutex> lck(my_mutex);
+                    // The slot for the chunk that the consumer is currently parsing cannot be overwritten.
+                    my_cv.wait(lck, [&]() -> bool { return my_stop || my_produced < my_consumed + nbuffers; });
+                    if (my_stop) {
+                        return;
+                    }
+                    slot = my_produced % nbuffers;
+                }
+
+                size_t nread = read_into(my_buffers[slot]);
+
+                {
+                    std::lock_guard<std::mutex> lck(my_mutex);
+                    if (nread == 0) {
+                        my_finished = true;
+                    } else {
+                        my_filled[slot] = nread;
+                        ++my_produced;
+                    }
+                }
+                my_cv.notify_all();
+                if (nread == 0) {
+                    return;
+                }
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lck(my_mutex);
+                my_error = std::current_exception();
+                my_finished = true;
+            }
+            my_cv.notify_all();
+        }
+    }
+
+    void acquire() {
+        my_current = 0;
+
+        if (!my_background) {
+            my_chunk = my_buffers.front().data();
+            my_available = read_into(my_buffers.front());
+            my_exhausted = (my_available == 0);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lck(my_mutex);
+        my_cv.wait(lck, [&]() -> bool { return my_finished || my_produced > my_consumed; });
+        if (my_produced > my_consumed) {
+            size_t slot = my_consumed % my_buffers.size();
+            my_chunk = my_buffers[slot].data();
+            my_available = my_filled[slot];
+        } else {
+            my_available = 0;
+            my_exhausted = true;
+            if (my_error) {
+                std::rethrow_exception(my_error);
+            }
+        }
+    }
+
+    bool refill() {
+        my_offset += my_available;
+        my_current = 0;
+        my_available = 0;
+        if (my_exhausted) {
+            return false;
+        }
+
+        if (my_background) {
+            {
+                std::lock_guard<std::mutex> lck(my_mutex);
+                ++my_consumed;
+            }
+            my_cv.notify_all();
+        }
+
+        acquire();
+        return my_available > 0;
+    }
+};
+
+inline ChunkedReader open_raw_reader(const std::string& path, const ReaderOptions& options) {
+    if (options.memory_map_raw) {
+        auto mapped = MappedFile::open(path);
+        if (mapped) {
+            return ChunkedReader(std::move(mapped));
+        }
+    }
+    std::unique_ptr<byteme::Reader> ptr(new byteme::RawFileReader(path.c_str(), {}));
+    return ChunkedReader(std::move(ptr), options.buffer_size, options.background_raw, options.num_buffers);
+}
+
+inline ChunkedReader open_gzip_reader(const std::string& path, const ReaderOptions& options) {
+    std::unique_ptr<byteme::Reader> ptr(new byteme::GzipFileReader(path.c_str(), {}));
+    return ChunkedReader(std::move(ptr), options.buffer_size, options.background_gzip, options.num_buffers);
+}
+
+}
+
+}
+
+#endif
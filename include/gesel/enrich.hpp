@@ -0,0 +1,401 @@
+#ifndef GESEL_ENRICH_HPP
+#define GESEL_ENRICH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+
+#include "load_database.hpp"
+#include "hybrid_set.hpp"
+#include "ranged_file.hpp"
+#include "load_ranges.hpp"
+#include "parallelize.hpp"
+
+/**
+ * @file enrich.hpp
+ * @brief Test a list of genes for enrichment in each set.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Options for `enrich()`.
+ */
+struct EnrichOptions {
+    /**
+     * Number of sets to report, i.e., those with the lowest p-values.
+     * If zero, all sets with a non-zero overlap are reported.
+     */
+    size_t top_k = 0;
+
+    /**
+     * Number of threads to use.
+     * The query genes (or the sets, when intersecting hybrid mappings) are split across threads to count the overlaps, and then the touched sets are split across threads to compute the p-values.
+     */
+    int num_threads = 1;
+};
+
+/**
+ * @brief Enrichment result for a single set.
+ */
+struct EnrichResult {
+    /**
+     * Index of the set.
+     */
+    uint64_t set;
+
+    /**
+     * Number of query genes in the set.
+     */
+    uint64_t overlap;
+
+    /**
+     * Size of the set.
+     */
+    uint64_t size;
+
+    /**
+     * Probability of observing an overlap of at least `overlap` under the hypergeometric null, i.e., the one-sided p-value from Fisher's exact test.
+     */
+    double p_value;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Natural logarithms of the factorials from 0 to n, so that the log-binomial coefficients are just sums of table entries.
+ */
+inline std::vector<double> log_factorials(uint64_t n) {
+    std::vector<double> output(n + 1);
+    for (uint64_t i = 2; i <= n; ++i) {
+        output[i] = output[i - 1] + std::log(static_cast<double>(i));
+    }
+    return output;
+}
+
+/*
+ * Upper tail of the hypergeometric distribution, i.e., P(X >= overlap) when drawing 'num_drawn' genes from a universe of 'universe' genes of which 'set_size' are in the set.
+ * We compute the log-probability of an anchor term from the table, and the other terms from the ratio of successive probabilities, which avoids calling exp() for every term.
+ * The anchor is the larger of 'overlap' and the mode, so that the terms decrease monotonically as we move away from it in either direction;
+ * every term is then no greater than the anchor, so the sum cannot overflow even when the anchor's probability itself underflows.
+ */
+inline double hypergeometric_upper_tail(uint64_t overlap, uint64_t set_size, uint64_t num_drawn, uint64_t universe, const std::vector<double>& lfact) {
+    if (overlap == 0) {
+        return 1;
+    }
+    auto log_choose = [&](uint64_t n, uint64_t k) -> double { return lfact[n] - lfact[k] - lfact[n - k]; };
+    const uint64_t others = universe - set_size;
+    if (num_drawn - overlap > others) {
+        throw std::runtime_error("overlap is not consistent with the set size and the universe size");
+    }
+
+    const uint64_t upper = std::min(set_size, num_drawn);
+    uint64_t mode = std::floor((static_cast<double>(num_drawn) + 1) * (static_cast<double>(set_size) + 1) / (static_cast<double>(universe) + 2));
+    uint64_t anchor = std::min(std::max(overlap, mode), upper);
+    double log_anchor = log_choose(set_size, anchor) + log_choose(others, num_drawn - anchor) - log_choose(universe, num_drawn);
+
+    double term = 1, sum = 1;
+    for (uint64_t x = anchor; x < upper; ++x) {
+        term *= static_cast<double>(set_size - x) * static_cast<double>(num_drawn - x) / (static_cast<double>(x + 1) * static_cast<double>(others + x + 1 - num_drawn));
+        sum += term;
+        if (term < sum * 1e-16) {
+            break;
+        }
+    }
+
+    term = 1;
+    for (uint64_t x = anchor; x > overlap; --x) {
+        term *= static_cast<double>(x) * static_cast<double>(others + x - num_drawn) / (static_cast<double>(set_size - x + 1) * static_cast<double>(num_drawn - x + 1));
+        sum += term;
+        if (term < sum * 1e-16) {
+            break;
+        }
+    }
+
+    return std::min(1.0, std::exp(log_anchor) * sum);
+}
+
+/*
+ * Counts the number of query genes in each set, using a dense array if a large fraction of the sets are expected to be touched and a hash map otherwise.
+ * 'expected_hits' is the total number of (gene, set) pairs, which is an upper bound on the number of touched sets.
+ */
+class OverlapCounter {
+public:
+    OverlapCounter(size_t num_sets, uint64_t expected_hits) : my_dense(expected_hits * 8 >= num_sets) {
+        if (my_dense) {
+            my_counts.resize(num_sets);
+        } else {
+            my_sparse.reserve(expected_hits);
+        }
+    }
+
+    void add(uint64_t set, uint32_t count = 1) {
+        if (my_dense) {
+            my_counts[set] += count;
+        } else {
+            my_sparse[set] += count;
+        }
+    }
+
+    template<class Function_>
+    void for_each(Function_ fun) const {
+        if (my_dense) {
+            for (size_t s = 0, end = my_counts.size(); s < end; ++s) {
+                if (my_counts[s]) {
+                    fun(s, my_counts[s]);
+                }
+            }
+        } else {
+            for (const auto& entry : my_sparse) {
+                fun(entry.first, entry.second);
+            }
+        }
+    }
+
+private:
+    bool my_dense;
+    std::vector<uint32_t> my_counts;
+    std::unordered_map<uint64_t, uint32_t> my_sparse;
+};
+
+/*
+ * Computes the p-value for each touched set in 'results', and then sorts and truncates the results according to 'options'.
+ */
+inline std::vector<EnrichResult> compute_p_values(std::vector<EnrichResult> results, size_t num_query, uint64_t universe, const EnrichOptions& options) {
+    for (const auto& res : results) {
+        if (res.size > universe) {
+            throw std::runtime_error("set size should not be greater than the universe size");
+        }
+        if (res.overlap > res.size) {
+            throw std::runtime_error("overlap should not be greater than the set size");
+        }
+    }
+
+    auto lfact = log_factorials(universe);
+    const size_t num_results = results.size();
+    size_t num_blocks = std::min(static_cast<size_t>(std::max(options.num_threads, 1)), num_results);
+    size_t per_block = (num_blocks ? (num_results + num_blocks - 1) / num_blocks : 0);
+    parallelize(options.num_threads, num_blocks, [&](size_t b) -> void {
+        size_t start = b * per_block, end = std::min(num_results, start + per_block);
+        for (size_t r = start; r < end; ++r) {
+            auto& res = results[r];
+            res.p_value = hypergeometric_upper_tail(res.overlap, res.size, num_query, universe, lfact);
+        }
+    });
+
+    auto cmp = [](const EnrichResult& left, const EnrichResult& right) -> bool {
+        if (left.p_value == right.p_value) {
+            return left.set < right.set;
+        }
+        return left.p_value < right.p_value;
+    };
+    if (options.top_k && options.top_k < num_results) {
+        std::partial_sort(results.begin(), results.begin() + options.top_k, results.end(), cmp);
+        results.resize(options.top_k);
+    } else {
+        std::sort(results.begin(), results.end(), cmp);
+    }
+    return results;
+}
+
+/*
+ * 'sets_for_gene(g)' should return a range of set indices for query gene 'g', which is called from multiple threads if 'options.num_threads > 1'.
+ * 'expected_hits' should be the total length of all ranges.
+ */
+template<class SetsForGene_>
+std::vector<EnrichResult> enrich(size_t num_query, SetsForGene_ sets_for_gene, uint64_t expected_hits, const std::vector<uint64_t>& set_sizes, uint64_t universe, const EnrichOptions& options) {
+    const size_t num_sets = set_sizes.size();
+    if (num_query > universe) {
+        throw std::runtime_error("number of query genes should not be greater than the universe size");
+    }
+
+    // Counting overlaps, with each worker handling a contiguous block of query genes.
+    size_t num_workers = std::max<size_t>(1, std::min<size_t>(std::max(options.num_threads, 1), num_query));
+    size_t per_worker = (num_query + num_workers - 1) / num_workers;
+    std::vector<OverlapCounter> counters;
+    counters.reserve(num_workers);
+    for (size_t w = 0; w < num_workers; ++w) {
+        counters.emplace_back(num_sets, expected_hits / num_workers + 1);
+    }
+
+    parallelize(options.num_threads, num_workers, [&](size_t w) -> void {
+        auto& counter = counters[w];
+        size_t start = w * per_worker, end = std::min(num_query, start + per_worker);
+        for (size_t q = start; q < end; ++q) {
+            for (auto s : sets_for_gene(q)) {
+                if (static_cast<uint64_t>(s) >= num_sets) {
+                    throw std::runtime_error("set index out of range in the gene-to-set mapping");
+                }
+                counter.add(s);
+            }
+        }
+    });
+
+    std::vector<EnrichResult> results;
+    if (num_workers == 1) {
+        counters[0].for_each([&](uint64_t set, uint32_t count) -> void {
+            results.push_back(EnrichResult{ set, count, set_sizes[set], 0 });
+        });
+    } else {
+        OverlapCounter combined(num_sets, expected_hits);
+        for (const auto& counter : counters) {
+            counter.for_each([&](uint64_t set, uint32_t count) -> void {
+                combined.add(set, count);
+            });
+        }
+        combined.for_each([&](uint64_t set, uint32_t count) -> void {
+            results.push_back(EnrichResult{ set, count, set_sizes[set], 0 });
+        });
+    }
+    counters.clear();
+
+    return compute_p_values(std::move(results), num_query, universe, options);
+}
+
+/*
+ * Counts the overlaps by intersecting the query with the hybrid representation of each set, with each worker handling a contiguous block of sets.
+ * This is cheaper than counting from the gene-to-set mapping when the query is large enough to touch most sets,
+ * as pairs of bitmap chunks are intersected with population counts and no per-set counters are needed.
+ */
+template<typename Index_>
+std::vector<EnrichResult> enrich_hybrid(const Database<Index_>& database, const std::vector<Index_>& query, uint64_t universe, const EnrichOptions& options) {
+    if (query.size() > universe) {
+        throw std::runtime_error("number of query genes should not be greater than the universe size");
+    }
+
+    HybridSet hquery(query);
+    const size_t num_sets = database.num_sets();
+    std::vector<uint64_t> overlaps(num_sets);
+    size_t num_blocks = std::min(static_cast<size_t>(std::max(options.num_threads, 1)), num_sets);
+    size_t per_block = (num_blocks ? (num_sets + num_blocks - 1) / num_blocks : 0);
+    parallelize(options.num_threads, num_blocks, [&](size_t b) -> void {
+        size_t start = b * per_block, end = std::min(num_sets, start + per_block);
+        for (size_t s = start; s < end; ++s) {
+            overlaps[s] = hybrid_intersection_size(hquery, database.hybrid_genes_in_set(s));
+        }
+    });
+
+    std::vector<EnrichResult> results;
+    for (size_t s = 0; s < num_sets; ++s) {
+        if (overlaps[s]) {
+            results.push_back(EnrichResult{ s, overlaps[s], database.set_size(s), 0 });
+        }
+    }
+    return compute_p_values(std::move(results), query.size(), universe, options);
+}
+
+template<typename Index_>
+std::vector<Index_> unique_genes(std::vector<Index_> genes, uint64_t universe) {
+    std::sort(genes.begin(), genes.end());
+    genes.erase(std::unique(genes.begin(), genes.end()), genes.end());
+    if (!genes.empty() && static_cast<uint64_t>(genes.back()) >= universe) {
+        throw std::runtime_error("query gene index should be less than the universe size");
+    }
+    return genes;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Test a list of genes for enrichment in each set of an in-memory database.
+ * For each set that contains at least one query gene, we compute the probability of observing at least that many query genes in the set,
+ * given the set size and the universe size, using the hypergeometric distribution (equivalent to a one-sided Fisher's exact test).
+ * Sets without any query genes are not reported as their p-values are always 1.
+ *
+ * If the database has hybrid mappings (see `Database::has_hybrid_mappings()`) and the query genes are expected to touch most sets,
+ * the overlaps are computed by intersecting the query with each set's `Database::hybrid_genes_in_set()` instead of counting through `Database::sets_for_gene()`.
+ * The results are the same in either case.
+ *
+ * @tparam Index_ Integer type of the set and gene indices.
+ * @param database The database, usually created with `load_database()`.
+ * @param genes Indices of the query genes.
+ * Duplicates are ignored.
+ * @param universe Number of genes in the universe, i.e., all genes that could have been in the query list.
+ * This is usually the total number of genes in the database, and should be no less than the size of any set.
+ * @param options Further options.
+ *
+ * @return Results for each set with non-zero overlap, sorted by increasing p-value (ties are broken by the set index).
+ */
+template<typename Index_>
+std::vector<EnrichResult> enrich(const Database<Index_>& database, const std::vector<Index_>& genes, uint64_t universe, const EnrichOptions& options = EnrichOptions()) {
+    auto query = internal::unique_genes(genes, universe);
+    uint64_t hits = 0;
+    for (auto g : query) {
+        if (static_cast<size_t>(g) >= database.num_genes()) {
+            throw std::runtime_error("query gene index is out of range for the database");
+        }
+        hits += database.sets_for_gene(g).size();
+    }
+
+    if (database.has_hybrid_mappings() && hits >= database.num_sets()) {
+        return internal::enrich_hybrid(database, query, universe, options);
+    }
+
+    std::vector<uint64_t> set_sizes(database.num_sets());
+    for (size_t s = 0, end = set_sizes.size(); s < end; ++s) {
+        set_sizes[s] = database.set_size(s);
+    }
+
+    return internal::enrich(
+        query.size(),
+        [&](size_t q) -> Span<Index_> { return database.sets_for_gene(query[q]); },
+        hits,
+        set_sizes,
+        universe,
+        options
+    );
+}
+
+/**
+ * Test a list of genes for enrichment in each set, reading the relevant lines of the database files on demand.
+ * This only reads the `gene2set.tsv` lines for the query genes and the set sizes in `sets.tsv.ranges.gz`, so is suitable for one-off queries.
+ * See the other `enrich()` overload for details on the test.
+ *
+ * @param prefix Prefix for the Gesel database files, see `validate_database()`.
+ * @param genes Indices of the query genes.
+ * Duplicates are ignored.
+ * @param universe Number of genes in the universe.
+ * @param options Further options.
+ *
+ * @return Results for each set with non-zero overlap, sorted by increasing p-value.
+ */
+inline std::vector<EnrichResult> enrich(const std::string& prefix, const std::vector<uint64_t>& genes, uint64_t universe, const EnrichOptions& options = EnrichOptions()) {
+    auto query = internal::unique_genes(genes, universe);
+    RangedFile gene2set(prefix + "gene2set.tsv");
+    std::vector<size_t> lines;
+    lines.reserve(query.size());
+    uint64_t hits = 0;
+    for (auto g : query) {
+        if (g >= gene2set.num_lines()) {
+            throw std::runtime_error("query gene index is out of range for '" + prefix + "gene2set.tsv'");
+        }
+        lines.push_back(g);
+        hits += gene2set.line_length(g) / 2 + 1;
+    }
+
+    auto sets = gene2set.read_indices(lines);
+    auto set_sizes = internal::load_ranges_with_sizes(prefix + "sets.tsv.ranges.gz").second;
+    return internal::enrich(
+        query.size(),
+        [&](size_t q) -> const std::vector<uint64_t>& { return sets[q]; },
+        hits,
+        set_sizes,
+        universe,
+        options
+    );
+}
+
+}
+
+#endif
@@ -0,0 +1,768 @@
+#ifndef GESEL_FETCH_RANGES_HPP
+#define GESEL_FETCH_RANGES_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cctype>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <limits>
+#include <algorithm>
+
+#include "byteme/byteme.hpp"
+
+#include "ranged_file.hpp"
+#include "gzip_index.hpp"
+#include "parallelize.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#define GESEL_HAS_SOCKETS
+#endif
+
+/**
+ * @file fetch_ranges.hpp
+ * @brief Fetch lines of the database files with byte range requests.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Interface for fetching byte ranges of the database files.
+ *
+ * This abstracts over the location of the database files, e.g., on the local filesystem or on a static web server.
+ * Implementations should be safe to call from multiple threads.
+ */
+class RangeFetcher {
+public:
+    /**
+     * @cond
+     */
+    virtual ~RangeFetcher() = default;
+    /**
+     * @endcond
+     */
+
+    /**
+     * @param name Name of the file, e.g., `9606_set2gene.tsv`.
+     * @param start Byte offset of the start of the range.
+     * @param length Number of bytes in the range.
+     * @param[out] buffer Pointer to an array of length no less than `length`, in which to store the contents of the range.
+     * An error should be thrown if the file does not contain the entire range.
+     */
+    virtual void fetch(const std::string& name, uint64_t start, uint64_t length, char* buffer) const = 0;
+
+    /**
+     * @param name Name of the file.
+     * @return Contents of the entire file.
+     */
+    virtual std::string fetch_all(const std::string& name) const = 0;
+};
+
+/**
+ * @brief Fetch byte ranges from files on the local filesystem.
+ */
+class FileFetcher final : public RangeFetcher {
+public:
+    /**
+     * @param prefix Prefix for the path to each file.
+     * The path is defined as the concatenation of `prefix` and the file name, e.g., `prefix` could be a directory with a trailing slash.
+     */
+    FileFetcher(std::string prefix) : my_prefix(std::move(prefix)) {}
+
+public:
+    /**
+     * @cond
+     */
+    void fetch(const std::string& name, uint64_t start, uint64_t length, char* buffer) const {
+        auto file = open(name);
+        if (start > file->size() || length > file->size() - start) {
+            throw std::runtime_error("requested range lies outside of '" + my_prefix + name + "'");
+        }
+        file->read(start, length, buffer);
+    }
+
+    std::string fetch_all(const std::string& name) const {
+        auto file = open(name);
+        std::string output(file->size(), '\0');
+        file->read(0, output.size(), output.data());
+        return output;
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    // Handles are cached so that each file is only opened once, regardless of the number of requests.
+    std::shared_ptr<const internal::PositionalFile> open(const std::string& name) const {
+        std::lock_guard<std::mutex> lock(my_lock);
+        auto it = my_files.find(name);
+        if (it != my_files.end()) {
+            return it->second;
+        }
+        auto file = std::make_shared<const internal::PositionalFile>(my_prefix + name);
+        my_files.emplace(name, file);
+        return file;
+    }
+
+private:
+    std::string my_prefix;
+    mutable std::mutex my_lock;
+    mutable std::unordered_map<std::string, std::shared_ptr<const internal::PositionalFile> > my_files;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+struct HttpResponse {
+    int status = 0;
+    std::string body;
+
+    // First and last bytes from the 'Content-Range' header, if present.
+    bool has_range = false;
+    uint64_t range_first = 0, range_last = 0;
+};
+
+inline std::string lower_case(std::string_view x) {
+    std::string output(x);
+    for (auto& c : output) {
+        c = std::tolower(c);
+    }
+    return output;
+}
+
+inline uint64_t parse_http_number(std::string_view x, int base, const std::string& url) {
+    if (x.empty()) {
+        throw std::runtime_error("invalid number in the HTTP response for '" + url + "'");
+    }
+    uint64_t value = 0;
+    for (auto c : x) {
+        uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            throw std::runtime_error("invalid number in the HTTP response for '" + url + "'");
+        }
+        if (value > (std::numeric_limits<uint64_t>::max() - digit) / base) {
+            throw std::runtime_error("invalid number in the HTTP response for '" + url + "'");
+        }
+        value = value * base + digit;
+    }
+    return value;
+}
+
+inline std::string decode_chunked(std::string_view body, const std::string& url) {
+    std::string output;
+    size_t pos = 0;
+    while (true) {
+        auto eol = body.find("\r\n", pos);
+        if (eol == std::string_view::npos) {
+            throw std::runtime_error("truncated chunk in the HTTP response for '" + url + "'");
+        }
+        auto size_field = body.substr(pos, eol - pos);
+        size_field = size_field.substr(0, size_field.find(';')); // ignoring chunk extensions.
+        auto size = parse_http_number(size_field, 16, url);
+        pos = eol + 2;
+        if (size == 0) {
+            break;
+        }
+        if (size > body.size() - pos) {
+            throw std::runtime_error("truncated chunk in the HTTP response for '" + url + "'");
+        }
+        output.append(body.substr(pos, size));
+        pos += size + 2;
+    }
+    return output;
+}
+
+/*
+ * Parses a complete HTTP/1.1 response, i.e., everything that was received before the server closed the connection.
+ */
+inline HttpResponse parse_http_response(const std::string& raw, const std::string& url) {
+    auto header_end = raw.find("\r\n\r\n");
+    if (raw.compare(0, 5, "HTTP/") != 0 || header_end == std::string::npos) {
+        throw std::runtime_error("malformed HTTP response for '" + url + "'");
+    }
+
+    HttpResponse output;
+    std::string_view header(raw.data(), header_end);
+    auto status_end = header.find("\r\n");
+    auto status_line = header.substr(0, status_end);
+    auto space = status_line.find(' ');
+    if (space == std::string_view::npos || status_line.size() < space + 4) {
+        throw std::runtime_error("malformed HTTP response for '" + url + "'");
+    }
+    output.status = parse_http_number(status_line.substr(space + 1, 3), 10, url);
+
+    bool chunked = false, has_length = false;
+    uint64_t content_length = 0;
+    size_t pos = (status_end == std::string_view::npos ? header.size() : status_end + 2);
+    while (pos < header.size()) {
+        auto eol = std::min(header.find("\r\n", pos), header.size());
+        auto field = header.substr(pos, eol - pos);
+        pos = eol + 2;
+
+        auto colon = field.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        auto key = lower_case(field.substr(0, colon));
+        auto value = field.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+
+        if (key == "content-length") {
+            has_length = true;
+            content_length = parse_http_number(value, 10, url);
+        } else if (key == "transfer-encoding") {
+            chunked = (lower_case(value).find("chunked") != std::string::npos);
+        } else if (key == "content-range") {
+            // Only 'bytes <FIRST>-<LAST>/<TOTAL>' is used, as 'bytes */<TOTAL>' is only sent with a 416 status.
+            if (lower_case(value.substr(0, 6)) == "bytes ") {
+                auto spec = value.substr(6);
+                auto dash = spec.find('-');
+                auto slash = spec.find('/');
+                if (dash != std::string_view::npos && slash != std::string_view::npos && dash < slash) {
+                    output.range_first = parse_http_number(spec.substr(0, dash), 10, url);
+                    output.range_last = parse_http_number(spec.substr(dash + 1, slash - dash - 1), 10, url);
+                    output.has_range = true;
+                }
+            }
+        }
+    }
+
+    std::string_view body(raw.data() + header_end + 4, raw.size() - header_end - 4);
+    if (chunked) {
+        output.body = decode_chunked(body, url);
+    } else if (has_length) {
+        if (body.size() < content_length) {
+            throw std::runtime_error("truncated HTTP response for '" + url + "'");
+        }
+        output.body = body.substr(0, content_length);
+    } else {
+        output.body = body;
+    }
+    return output;
+}
+
+#ifdef GESEL_HAS_SOCKETS
+class Socket {
+public:
+    Socket(int fd) : my_fd(fd) {}
+
+    ~Socket() {
+        if (my_fd >= 0) {
+            ::close(my_fd);
+        }
+    }
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    int get() const {
+        return my_fd;
+    }
+
+private:
+    int my_fd;
+};
+
+inline bool would_block() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS;
+}
+
+/*
+ * Connects without blocking so that we can give up after 'timeout' seconds, trying each address in turn.
+ * The socket is then switched back to blocking mode with the same timeout on each send and receive.
+ */
+inline int connect_to(const std::string& host, const std::string& port, double timeout, const std::string& url) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* found = NULL;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) {
+        throw std::runtime_error("failed to resolve the host '" + host + "'");
+    }
+
+    const int timeout_ms = static_cast<int>(std::min(timeout * 1000, static_cast<double>(std::numeric_limits<int>::max())));
+    int fd = -1;
+    bool timed_out = false;
+    for (auto current = found; current; current = current->ai_next) {
+        fd = ::socket(current->ai_family, current->ai_socktype, current->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        int flags = ::fcntl(fd, F_GETFL, 0);
+        if (flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0) {
+            bool connected = (::connect(fd, current->ai_addr, current->ai_addrlen) == 0);
+            if (!connected && would_block()) {
+                pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                int ready;
+                do {
+                    ready = ::poll(&pfd, 1, timeout_ms);
+                } while (ready < 0 && errno == EINTR);
+                if (ready == 0) {
+                    timed_out = true;
+                } else if (ready > 0) {
+                    int error = 0;
+                    socklen_t len = sizeof(error);
+                    connected = (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0);
+                }
+            }
+            if (connected && ::fcntl(fd, F_SETFL, flags) == 0) {
+                break;
+            }
+        }
+
+        ::close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(found);
+
+    if (fd < 0) {
+        if (timed_out) {
+            throw std::runtime_error("timed out fetching '" + url + "'");
+        }
+        throw std::runtime_error("failed to connect to '" + host + ":" + port + "'");
+    }
+
+    timeval tv;
+    tv.tv_sec = static_cast<decltype(tv.tv_sec)>(timeout);
+    tv.tv_usec = static_cast<decltype(tv.tv_usec)>((timeout - static_cast<double>(tv.tv_sec)) * 1000000);
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+inline void send_all(int fd, const std::string& message, const std::string& url) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < message.size()) {
+        auto n = ::send(fd, message.data() + sent, message.size() - sent, flags);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n < 0 && would_block()) {
+                throw std::runtime_error("timed out fetching '" + url + "'");
+            }
+            throw std::runtime_error("failed to send the HTTP request for '" + url + "'");
+        }
+        sent += n;
+    }
+}
+
+inline std::string receive_all(int fd, const std::string& url) {
+    std::string output;
+    char buffer[65536];
+    while (true) {
+        auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            if (would_block()) {
+                throw std::runtime_error("timed out fetching '" + url + "'");
+            }
+            throw std::runtime_error("failed to receive the HTTP response for '" + url + "'");
+        }
+        if (n == 0) {
+            break;
+        }
+        output.append(buffer, n);
+    }
+    return output;
+}
+#endif
+
+}
+/**
+ * @endcond
+ */
+
+#ifdef GESEL_HAS_SOCKETS
+/**
+ * @brief Options for `HttpFetcher`.
+ */
+struct HttpFetcherOptions {
+    /**
+     * Maximum time to wait for a connection to be established, or for each send or receive on that connection to make progress, in seconds.
+     * If this is exceeded, an error is thrown.
+     * This should be positive.
+     * Note that the time to resolve the host name is not included.
+     */
+    double timeout = 30;
+};
+
+/**
+ * @brief Fetch byte ranges from a static web server.
+ *
+ * Each range is fetched with a separate HTTP/1.1 GET request containing a `Range` header.
+ * If the server does not support range requests, the entire file is returned and the range is extracted from it, which is correct but slow.
+ * Only plain HTTP is supported, i.e., TLS-encrypted servers should be accessed through a local proxy.
+ * This class is only available on POSIX systems.
+ */
+class HttpFetcher final : public RangeFetcher {
+public:
+    /**
+     * @param url Prefix for the URL of each file, of the form `http://<HOST>[:<PORT>]/<PATH>`.
+     * The URL for each file is defined as the concatenation of `url` and the file name.
+     * @param options Further options.
+     */
+    HttpFetcher(const std::string& url, const HttpFetcherOptions& options = HttpFetcherOptions()) : my_url(url), my_timeout(options.timeout) {
+        constexpr std::string_view scheme = "http://";
+        if (url.compare(0, scheme.size(), scheme) != 0) {
+            throw std::runtime_error("URL should start with 'http://'");
+        }
+
+        auto remainder = std::string_view(url).substr(scheme.size());
+        auto slash = remainder.find('/');
+        auto authority = remainder.substr(0, slash);
+        my_path = (slash == std::string_view::npos ? std::string("/") : std::string(remainder.substr(slash)));
+
+        auto colon = authority.rfind(':');
+        if (colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+            my_host = authority.substr(0, colon);
+            my_port = authority.substr(colon + 1);
+        } else {
+            my_host = authority;
+            my_port = "80";
+        }
+        my_host_header = std::string(authority);
+
+        if (my_host.size() > 2 && my_host.front() == '[' && my_host.back() == ']') { // IPv6 literals.
+            my_host = my_host.substr(1, my_host.size() - 2);
+        }
+        if (my_host.empty() || my_port.empty()) {
+            throw std::runtime_error("failed to parse the host and port from '" + url + "'");
+        }
+    }
+
+public:
+    /**
+     * @cond
+     */
+    void fetch(const std::string& name, uint64_t start, uint64_t length, char* buffer) const {
+        if (length == 0) {
+            return;
+        }
+
+        auto res = request(name, "Range: bytes=" + std::to_string(start) + "-" + std::to_string(start + length - 1) + "\r\n");
+        if (res.status == 206) {
+            if (res.body.size() != length) {
+                throw std::runtime_error("requested range lies outside of '" + my_url + name + "'");
+            }
+            if (!res.has_range || res.range_first != start || res.range_last != start + length - 1) {
+                throw std::runtime_error("returned range does not match the requested range for '" + my_url + name + "'");
+            }
+            std::copy(res.body.begin(), res.body.end(), buffer);
+        } else if (res.status == 200) {
+            if (start > res.body.size() || length > res.body.size() - start) {
+                throw std::runtime_error("requested range lies outside of '" + my_url + name + "'");
+            }
+            std::copy_n(res.body.begin() + start, length, buffer);
+        } else if (res.status == 416) {
+            throw std::runtime_error("requested range lies outside of '" + my_url + name + "'");
+        } else {
+            throw std::runtime_error("HTTP request for '" + my_url + name + "' failed with status " + std::to_string(res.status));
+        }
+    }
+
+    std::string fetch_all(const std::string& name) const {
+        auto res = request(name, "");
+        if (res.status != 200) {
+            throw std::runtime_error("HTTP request for '" + my_url + name + "' failed with status " + std::to_string(res.status));
+        }
+        return std::move(res.body);
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    // A new connection is used for each request, so there is no state to share between threads.
+    internal::HttpResponse request(const std::string& name, const std::string& extra_headers) const {
+        auto url = my_url + name;
+        internal::Socket sock(internal::connect_to(my_host, my_port, my_timeout, url));
+        std::string message = "GET " + my_path + name + " HTTP/1.1\r\nHost: " + my_host_header + "\r\n" + extra_headers + "Connection: close\r\n\r\n";
+        internal::send_all(sock.get(), message, url);
+        return internal::parse_http_response(internal::receive_all(sock.get(), url), url);
+    }
+
+private:
+    std::string my_url, my_host, my_port, my_host_header, my_path;
+    double my_timeout;
+};
+#endif
+
+/**
+ * @brief Options for `LineFetcher`.
+ */
+struct FetchLinesOptions {
+    /**
+     * Maximum number of unrequested bytes between two lines for them to be coalesced into a single request.
+     * Larger values reduce the number of requests at the cost of transferring more unused bytes,
+     * so this should be increased when the per-request latency is high relative to the transfer rate.
+     */
+    uint64_t max_gap = 65536;
+
+    /**
+     * Number of threads to use, i.e., the maximum number of requests in flight at any given time.
+     */
+    int num_threads = 4;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Decompresses Gzip-compressed data in memory, allowing for multiple members as in build_gzip_index().
+ */
+inline std::vector<unsigned char> inflate_gzip_buffer(const std::string& compressed, const std::string& path) {
+    InflateStream stream(47);
+    auto& strm = stream.get();
+    strm.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(compressed.data()));
+    strm.avail_in = compressed.size();
+
+    std::vector<unsigned char> output;
+    unsigned char buffer[65536];
+    bool between_members = false;
+    while (true) {
+        strm.next_out = buffer;
+        strm.avail_out = sizeof(buffer);
+        int ret = inflate(&strm, Z_NO_FLUSH);
+        output.insert(output.end(), buffer, strm.next_out);
+
+        if (ret == Z_STREAM_END) {
+            if (strm.avail_in == 0) {
+                break;
+            }
+            between_members = true;
+            inflateReset(&strm);
+            continue;
+        }
+        if (ret == Z_DATA_ERROR && between_members) {
+            break;
+        }
+        if (ret == Z_BUF_ERROR && strm.avail_in == 0) {
+            throw std::runtime_error("unexpected end of the Gzip-compressed file at '" + path + "'");
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw std::runtime_error("failed to decompress the Gzip-compressed file at '" + path + "'");
+        }
+        between_members = false;
+    }
+
+    return output;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Fetch lines of a database file with coalesced byte range requests.
+ *
+ * Given a batch of line indices, the byte offsets from the accompanying `*.ranges.gz` file are used to plan the smallest number of byte range requests.
+ * Neighbouring lines are merged into a single request if the gap between them is small enough, see `FetchLinesOptions::max_gap`.
+ * The requests are then issued concurrently and the responses are split back into the individual lines.
+ */
+class LineFetcher {
+public:
+    /**
+     * @param fetcher Source of the database files.
+     * @param name Name of the uncompressed database file, e.g., `9606_set2gene.tsv`.
+     * The byte ranges are fetched from `<name>.ranges.gz`.
+     * @param format Format of the `*.ranges.gz` file.
+     */
+    LineFetcher(std::shared_ptr<const RangeFetcher> fetcher, std::string name, RangesFormat format = RangesFormat::BYTES) :
+        my_fetcher(std::move(fetcher)), my_name(std::move(name))
+    {
+        auto ranges_name = my_name + ".ranges.gz";
+        auto contents = internal::inflate_gzip_buffer(my_fetcher->fetch_all(ranges_name), ranges_name);
+        byteme::RawBufferReader reader(contents.data(), contents.size());
+        auto loaded = internal::load_line_ranges(reader, ranges_name, format);
+        my_numbers = std::move(loaded.numbers);
+        my_names = std::move(loaded.names);
+        my_starts = internal::line_starts(loaded.bytes);
+    }
+
+    /**
+     * @param fetcher Source of the database files.
+     * @param name Name of the uncompressed database file.
+     * @param bytes Number of bytes in each line of the file, excluding the newline.
+     */
+    LineFetcher(std::shared_ptr<const RangeFetcher> fetcher, std::string name, const std::vector<uint64_t>& bytes) :
+        my_fetcher(std::move(fetcher)), my_name(std::move(name))
+    {
+        internal::check_bytes(bytes);
+        my_starts = internal::line_starts(bytes);
+    }
+
+public:
+    /**
+     * @return Number of lines in the file.
+     */
+    size_t num_lines() const {
+        return my_starts.size() - 1;
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @return Number of bytes in the line, excluding the newline.
+     */
+    uint64_t line_length(size_t line) const {
+        internal::check_line_index(line, num_lines());
+        return my_starts[line + 1] - my_starts[line] - 1;
+    }
+
+    /**
+     * @return The second field of each line in the `*.ranges.gz` file, if `RangesFormat::BYTES_AND_NUMBER` was used; otherwise empty.
+     */
+    const std::vector<uint64_t>& numbers() const {
+        return my_numbers;
+    }
+
+    /**
+     * @return The first field of each line in the `*.ranges.gz` file, if `RangesFormat::NAME_AND_BYTES` was used; otherwise empty.
+     */
+    const std::vector<std::string>& names() const {
+        return my_names;
+    }
+
+    /**
+     * @param name Name of interest, e.g., a token.
+     * This assumes that the names are lexicographically sorted, as is the case for tokens.
+     * @return Index of the line with this name, or `num_lines()` if no such line exists.
+     */
+    size_t find_name(std::string_view name) const {
+        auto found = internal::find_sorted_name(my_names, name);
+        return (found == my_names.size() ? num_lines() : found);
+    }
+
+    /**
+     * @param lines Indices of the lines to fetch.
+     * These need not be sorted or unique.
+     * @param options Further options.
+     * @return Number of byte range requests that would be issued by `fetch_lines()`.
+     */
+    size_t num_requests(const std::vector<size_t>& lines, const FetchLinesOptions& options) const {
+        return internal::plan_line_requests(my_starts, lines, options.max_gap).requests.size();
+    }
+
+public:
+    /**
+     * @tparam Function_ Function to be applied to each line.
+     * @param lines Indices of the lines to fetch.
+     * These need not be sorted or unique.
+     * @param fun Function that accepts `(i, contents)`, where `i` is the position of the line in `lines` and `contents` is a `std::string_view` of that line (excluding the newline).
+     * `contents` is only valid for the duration of the call.
+     * This is only called on the current thread after all requests have completed, in an unspecified order.
+     * @param options Further options.
+     */
+    template<class Function_>
+    void fetch_lines(const std::vector<size_t>& lines, Function_ fun, const FetchLinesOptions& options) const {
+        auto plan = internal::plan_line_requests(my_starts, lines, options.max_gap);
+        const auto& requests = plan.requests;
+        std::vector<std::vector<char> > buffers(requests.size());
+        internal::parallelize(options.num_threads, requests.size(), [&](size_t r) -> void {
+            const auto& req = requests[r];
+            auto& buffer = buffers[r];
+            buffer.resize(req.end - req.start);
+            my_fetcher->fetch(my_name, req.start, buffer.size(), buffer.data());
+        });
+
+        for (size_t r = 0, end = requests.size(); r < end; ++r) {
+            const auto& req = requests[r];
+            const char* buffer = buffers[r].data();
+            for (size_t i = req.first; i < req.last; ++i) {
+                auto o = plan.order[i];
+                size_t line = lines[o];
+                const char* ptr = buffer + (my_starts[line] - req.start);
+                auto len = line_length(line);
+                if (ptr[len] != '\n') {
+                    throw std::runtime_error("line in '" + my_name + "' is not consistent with its '*.ranges.gz' file" + internal::append_line_number(line));
+                }
+                fun(o, std::string_view(ptr, len));
+            }
+            std::vector<char>().swap(buffers[r]);
+        }
+    }
+
+    /**
+     * @param lines Indices of the lines to fetch.
+     * These need not be sorted or unique.
+     * @param options Further options.
+     * @return Contents of each line in `lines`, excluding the newline.
+     */
+    std::vector<std::string> fetch_lines(const std::vector<size_t>& lines, const FetchLinesOptions& options) const {
+        std::vector<std::string> output(lines.size());
+        fetch_lines(lines, [&](size_t i, std::string_view contents) -> void {
+            output[i] = contents;
+        }, options);
+        return output;
+    }
+
+    /**
+     * @param lines Indices of the lines to fetch.
+     * These need not be sorted or unique.
+     * @param options Further options.
+     * @return The decoded indices for each line in `lines`, i.e., after reversing the delta encoding.
+     */
+    std::vector<std::vector<uint64_t> > fetch_indices(const std::vector<size_t>& lines, const FetchLinesOptions& options) const {
+        std::vector<std::vector<uint64_t> > output(lines.size());
+        fetch_lines(lines, [&](size_t i, std::string_view contents) -> void {
+            internal::decode_delta_line(contents.data(), contents.size(), output[i], my_name, lines[i]);
+        }, options);
+        return output;
+    }
+
+private:
+    std::shared_ptr<const RangeFetcher> my_fetcher;
+    std::string my_name;
+    std::vector<uint64_t> my_starts;
+    std::vector<uint64_t> my_numbers;
+    std::vector<std::string> my_names;
+};
+
+}
+
+#endif
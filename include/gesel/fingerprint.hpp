@@ -0,0 +1,78 @@
+#ifndef GESEL_FINGERPRINT_HPP
+#define GESEL_FINGERPRINT_HPP
+
+#include <cstdint>
+#include <vector>
+#include <atomic>
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * Order-independent fingerprint of a set of indices, formed from the sums of two differently-seeded 64-bit mixes of each index.
+ * As addition is commutative, the same fingerprint is obtained regardless of the order in which the indices are added.
+ * Identical sets always yield identical fingerprints, so any mismatch is conclusive evidence of an inconsistency;
+ * different sets will only collide with a probability on the order of 2^-128.
+ */
+struct IndexFingerprint {
+    uint64_t count = 0;
+    uint64_t first = 0;
+    uint64_t second = 0;
+};
+
+// The finalizer from SplitMix64.
+inline uint64_t mix_index(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+inline void add_to_fingerprint(IndexFingerprint& fp, uint64_t index) {
+    ++fp.count;
+    fp.first += mix_index(index);
+    fp.second += mix_index(index ^ 0x5851f42d4c957f2dULL);
+}
+
+/*
+ * Variant of IndexFingerprint that can be updated from multiple threads.
+ * Addition is commutative so relaxed ordering is sufficient, as long as the values are only retrieved after all threads are joined.
+ */
+struct AtomicFingerprint {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> first{0};
+    std::atomic<uint64_t> second{0};
+};
+
+inline void add_to_fingerprint(AtomicFingerprint& fp, uint64_t index) {
+    fp.count.fetch_add(1, std::memory_order_relaxed);
+    fp.first.fetch_add(mix_index(index), std::memory_order_relaxed);
+    fp.second.fetch_add(mix_index(index ^ 0x5851f42d4c957f2dULL), std::memory_order_relaxed);
+}
+
+inline IndexFingerprint load_fingerprint(const AtomicFingerprint& fp) {
+    IndexFingerprint output;
+    output.count = fp.count.load(std::memory_order_relaxed);
+    output.first = fp.first.load(std::memory_order_relaxed);
+    output.second = fp.second.load(std::memory_order_relaxed);
+    return output;
+}
+
+inline IndexFingerprint compute_fingerprint(const std::vector<uint64_t>& indices) {
+    IndexFingerprint fp;
+    for (auto i : indices) {
+        add_to_fingerprint(fp, i);
+    }
+    return fp;
+}
+
+inline bool same_fingerprints(const IndexFingerprint& left, const IndexFingerprint& right) {
+    return left.count == right.count && left.first == right.first && left.second == right.second;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef GESEL_FLAT_INDICES_HPP
+#define GESEL_FLAT_INDICES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * Compressed sparse row representation of a mapping between two sets of indices (e.g., sets to genes).
+ * The indices for line 'i' are stored in 'values' from 'offsets[i]' to 'offsets[i + 1]'.
+ * This avoids a separate heap allocation for each line, and we can use 32-bit indices when the number of targets is small enough.
+ */
+template<typename Index_>
+struct FlatIndices {
+    std::vector<uint64_t> offsets;
+    std::vector<Index_> values;
+};
+
+/*
+ * Two-pass transposition where we count the number of occurrences of each target and then scatter the line indices.
+ * As the lines are traversed in order, the indices in each row of the output are sorted.
+ */
+template<typename Index_>
+FlatIndices<Index_> transpose_indices(const FlatIndices<Index_>& forward, uint64_t num_targets) {
+    FlatIndices<Index_> output;
+    auto& offsets = output.offsets;
+    offsets.resize(static_cast<size_t>(num_targets) + 1);
+    for (auto v : forward.values) {
+        ++offsets[static_cast<size_t>(v) + 1];
+    }
+    for (size_t t = 1, end = offsets.size(); t < end; ++t) {
+        offsets[t] += offsets[t - 1];
+    }
+
+    // Using the start of each row as the insertion cursor, so each 'offsets[t]' ends up at the end of row 't'.
+    output.values.resize(forward.values.size());
+    const size_t num_lines = forward.offsets.size() - 1;
+    for (size_t l = 0; l < num_lines; ++l) {
+        for (uint64_t j = forward.offsets[l], end = forward.offsets[l + 1]; j < end; ++j) {
+            auto& cursor = offsets[forward.values[j]];
+            output.values[cursor] = l;
+            ++cursor;
+        }
+    }
+
+    for (size_t t = offsets.size() - 1; t > 0; --t) {
+        offsets[t] = offsets[t - 1];
+    }
+    offsets[0] = 0;
+
+    return output;
+}
+
+template<typename Index_>
+bool same_flat_indices(const FlatIndices<Index_>& flat, size_t line, const std::vector<uint64_t>& right) {
+    uint64_t start = flat.offsets[line], end = flat.offsets[line + 1];
+    if (end - start != static_cast<uint64_t>(right.size())) {
+        return false;
+    }
+    for (auto r : right) {
+        if (static_cast<uint64_t>(flat.values[start]) != r) {
+            return false;
+        }
+        ++start;
+    }
+    return true;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,555 @@
+#ifndef GESEL_GENE_INDEX_HPP
+#define GESEL_GENE_INDEX_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+#include "validate_genes.hpp"
+#include "fingerprint.hpp"
+#include "span.hpp"
+
+/**
+ * @file gene_index.hpp
+ * @brief Look up genes by their names.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Options for the `GeneIndex` constructor.
+ */
+struct GeneIndexOptions {
+    /**
+     * Whether to build an additional index for case-insensitive lookups.
+     * This is required for any lookup where `GeneLookupOptions::case_insensitive = true`.
+     */
+    bool case_insensitive = true;
+};
+
+/**
+ * @brief Options for gene lookups in a `GeneIndex`.
+ */
+struct GeneLookupOptions {
+    /**
+     * Type of gene name to search, e.g., `"symbol"`.
+     * If empty, names of all types are searched.
+     */
+    std::string type;
+
+    /**
+     * Whether to ignore differences in (ASCII) case between the query and the gene names.
+     */
+    bool case_insensitive = false;
+};
+
+/**
+ * @brief Genes for each name in a batch.
+ */
+struct ResolvedGenes {
+    /**
+     * Offsets into `genes` for each name, of length equal to the number of names plus 1.
+     * The genes for name `i` are stored from `offsets[i]` to `offsets[i + 1]`.
+     */
+    std::vector<uint64_t> offsets;
+
+    /**
+     * Sorted gene indices for each name, concatenated across names.
+     */
+    std::vector<uint64_t> genes;
+
+    /**
+     * @return Number of names.
+     */
+    size_t size() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    /**
+     * @param i Index of the name.
+     * @return Sorted indices of the genes matching the name.
+     * This is empty if the name could not be resolved.
+     */
+    Span<uint64_t> operator[](size_t i) const {
+        return Span<uint64_t>(genes.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline uint64_t hash_gene_name(std::string_view name) {
+    uint64_t h = mix_index(name.size());
+    const char* ptr = name.data();
+    size_t remaining = name.size();
+    while (remaining >= 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, ptr, 8);
+        h = mix_index(h ^ chunk);
+        ptr += 8;
+        remaining -= 8;
+    }
+    if (remaining) {
+        uint64_t chunk = 0;
+        std::memcpy(&chunk, ptr, remaining);
+        h = mix_index(h ^ chunk);
+    }
+    return h;
+}
+
+/*
+ * Interned names in an arena, with an open-addressing hash table for lookups.
+ * Each slot holds the upper bits of the hash as a tag, so that most mismatches are rejected without touching the arena.
+ * Linear probing with a load factor of at most 0.5 keeps the expected probe length close to 1.
+ */
+class GeneNameTable {
+public:
+    GeneNameTable() : my_starts(1), my_slots(16), my_mask(15) {}
+
+private:
+    struct Slot {
+        uint32_t tag = 0;
+        uint32_t entry = 0; // entry index plus 1, so that zero indicates an empty slot.
+    };
+
+    static uint32_t tag_of(uint64_t hash) {
+        return hash >> 32;
+    }
+
+public:
+    size_t size() const {
+        return my_hashes.size();
+    }
+
+    std::string_view name(size_t entry) const {
+        return std::string_view(my_arena.data() + my_starts[entry], my_starts[entry + 1] - my_starts[entry]);
+    }
+
+    void prefetch(uint64_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(my_slots.data() + (hash & my_mask));
+#else
+        (void)hash;
+#endif
+    }
+
+    // Returns 'size()' if the name is absent.
+    size_t find(std::string_view name, uint64_t hash) const {
+        auto tag = tag_of(hash);
+        for (size_t pos = hash & my_mask; ; pos = (pos + 1) & my_mask) {
+            const auto& slot = my_slots[pos];
+            if (slot.entry == 0) {
+                return size();
+            }
+            size_t candidate = slot.entry - 1;
+            if (slot.tag == tag && this->name(candidate) == name) {
+                return candidate;
+            }
+        }
+    }
+
+    size_t intern(std::string_view name) {
+        auto hash = hash_gene_name(name);
+        auto found = find(name, hash);
+        if (found < size()) {
+            return found;
+        }
+        if (found >= std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("number of unique gene names should fit in a 32-bit integer");
+        }
+
+        size_t entry = size();
+        my_arena.insert(my_arena.end(), name.begin(), name.end());
+        my_starts.push_back(my_arena.size());
+        my_hashes.push_back(hash);
+        if (my_hashes.size() * 2 > my_slots.size()) {
+            std::vector<Slot> replacement(my_slots.size() * 2);
+            my_slots.swap(replacement);
+            my_mask = my_slots.size() - 1;
+            for (size_t e = 0, end = my_hashes.size(); e < end; ++e) {
+                insert_slot(e);
+            }
+        } else {
+            insert_slot(entry);
+        }
+        return entry;
+    }
+
+private:
+    void insert_slot(size_t entry) {
+        auto hash = my_hashes[entry];
+        size_t pos = hash & my_mask;
+        while (my_slots[pos].entry) {
+            pos = (pos + 1) & my_mask;
+        }
+        my_slots[pos].tag = tag_of(hash);
+        my_slots[pos].entry = entry + 1;
+    }
+
+private:
+    std::string my_arena;
+    std::vector<uint64_t> my_starts;
+    std::vector<uint64_t> my_hashes;
+    std::vector<Slot> my_slots;
+    size_t my_mask;
+};
+
+inline void fold_case(std::string_view name, std::string& output) {
+    output.assign(name.begin(), name.end());
+    for (auto& x : output) {
+        x = std::tolower(static_cast<unsigned char>(x));
+    }
+}
+
+/*
+ * Values for each bucket in a compressed sparse row layout, built by a counting sort of (bucket, value) pairs.
+ * As the sort is stable, the values in each bucket retain their input order unless 'deduplicate = true', in which case they are also sorted and made unique.
+ */
+struct GenePostings {
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> values;
+
+    void build(size_t num_buckets, const std::vector<uint64_t>& buckets, const std::vector<uint64_t>& input, bool deduplicate) {
+        offsets.clear();
+        offsets.resize(num_buckets + 1);
+        for (auto b : buckets) {
+            ++offsets[b + 1];
+        }
+        for (size_t b = 1; b <= num_buckets; ++b) {
+            offsets[b] += offsets[b - 1];
+        }
+
+        values.resize(input.size());
+        std::vector<uint64_t> cursors(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0, end = buckets.size(); i < end; ++i) {
+            values[cursors[buckets[i]]++] = input[i];
+        }
+
+        if (deduplicate) {
+            uint64_t kept = 0;
+            for (size_t b = 0; b < num_buckets; ++b) {
+                auto start = values.begin() + offsets[b];
+                auto end = values.begin() + offsets[b + 1];
+                std::sort(start, end);
+                auto last = std::unique(start, end);
+                offsets[b] = kept;
+                kept = std::copy(start, last, values.begin() + kept) - values.begin();
+            }
+            offsets[num_buckets] = kept;
+            values.resize(kept);
+        }
+    }
+
+    Span<uint64_t> get(size_t bucket) const {
+        auto start = offsets[bucket];
+        return Span<uint64_t>(values.data() + start, offsets[bucket + 1] - start);
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Look up genes by any of their names.
+ *
+ * This maps each name of each type (e.g., Ensembl identifiers, symbols) in the gene mapping files to the indices of the genes with that name.
+ * A name may map to multiple genes, e.g., symbols that are shared by different Ensembl genes.
+ * The names are interned in a single arena and located with an open-addressing hash table,
+ * and the genes for each name are precomputed for each type and for all types, so each lookup requires a single probe and no allocations.
+ * Names can also be searched without regard to case, which is convenient for symbols;
+ * or by prefix, e.g., for autocompletion.
+ *
+ * The gene mapping files are validated while the index is constructed, so there is no need to call `validate_genes()` separately.
+ * All methods are safe to call from multiple threads.
+ */
+class GeneIndex {
+public:
+    /**
+     * @param prefix Prefix for the Gesel gene mapping files, see `validate_genes()`.
+     * @param types Vector of gene name types, e.g., `"ensembl"`, `"symbol"`.
+     * This should contain at least one value.
+     * @param options Further options.
+     */
+    GeneIndex(const std::string& prefix, const std::vector<std::string>& types, const GeneIndexOptions& options = GeneIndexOptions()) : my_types(types) {
+        std::vector<uint64_t> entries, by_type, genes;
+        const size_t num_types = types.size();
+        my_num_genes = internal::validate_genes(prefix, types, [&](size_t type, uint64_t gene, const std::string& name) -> void {
+            auto e = my_exact.intern(name);
+            entries.push_back(e);
+            by_type.push_back(e * num_types + type);
+            genes.push_back(gene);
+        });
+
+        // Genes are visited in order for each type, and names are unique within each gene, so the genes for each type do not need deduplication.
+        const size_t num_exact = my_exact.size();
+        my_exact_by_type.build(num_exact * num_types, by_type, genes, false);
+        my_exact_any.build(num_exact, entries, genes, true);
+
+        my_sorted.resize(num_exact);
+        for (size_t e = 0; e < num_exact; ++e) {
+            my_sorted[e] = e;
+        }
+        std::sort(my_sorted.begin(), my_sorted.end(), [&](uint32_t left, uint32_t right) -> bool {
+            return my_exact.name(left) < my_exact.name(right);
+        });
+
+        if (!options.case_insensitive) {
+            return;
+        }
+        my_has_folded = true;
+
+        // Different names with the same lower-cased form may share genes, so deduplication is required here.
+        std::vector<uint64_t> folded_of(num_exact);
+        std::string buffer;
+        for (size_t e = 0; e < num_exact; ++e) {
+            internal::fold_case(my_exact.name(e), buffer);
+            folded_of[e] = my_folded.intern(buffer);
+        }
+        for (auto& b : by_type) {
+            auto e = b / num_types;
+            b = folded_of[e] * num_types + (b - e * num_types);
+        }
+        for (auto& e : entries) {
+            e = folded_of[e];
+        }
+        const size_t num_folded = my_folded.size();
+        my_folded_by_type.build(num_folded * num_types, by_type, genes, true);
+        my_folded_any.build(num_folded, entries, genes, true);
+
+        // Names for each lower-cased form in sorted order, for case-insensitive autocompletion.
+        std::vector<uint64_t> member_folded(num_exact), member_names(num_exact);
+        for (size_t i = 0; i < num_exact; ++i) {
+            member_folded[i] = folded_of[my_sorted[i]];
+            member_names[i] = my_sorted[i];
+        }
+        my_folded_members.build(num_folded, member_folded, member_names, false);
+
+        my_folded_sorted.resize(num_folded);
+        for (size_t f = 0; f < num_folded; ++f) {
+            my_folded_sorted[f] = f;
+        }
+        std::sort(my_folded_sorted.begin(), my_folded_sorted.end(), [&](uint32_t left, uint32_t right) -> bool {
+            return my_folded.name(left) < my_folded.name(right);
+        });
+    }
+
+    /**
+     * Overload of the `GeneIndex` constructor that uses all gene name types in the directory.
+     * This scans the directory for all files starting with `prefix` and ending with `".tsv.gz"`, as described in `validate_genes()`.
+     *
+     * @param prefix Prefix for the Gesel gene mapping files.
+     * @param options Further options.
+     */
+    GeneIndex(const std::string& prefix, const GeneIndexOptions& options = GeneIndexOptions()) :
+        GeneIndex(prefix, internal::list_gene_types(prefix), options) {}
+
+public:
+    /**
+     * @return Number of genes.
+     */
+    uint64_t num_genes() const {
+        return my_num_genes;
+    }
+
+    /**
+     * @return Types of gene names in the index.
+     */
+    const std::vector<std::string>& types() const {
+        return my_types;
+    }
+
+    /**
+     * @param type Type of gene name.
+     * @return Index of `type` in `types()`.
+     * An error is raised if `type` is not present.
+     */
+    size_t type_index(std::string_view type) const {
+        for (size_t t = 0, end = my_types.size(); t < end; ++t) {
+            if (my_types[t] == type) {
+                return t;
+            }
+        }
+        throw std::runtime_error("unknown gene name type '" + std::string(type) + "'");
+    }
+
+    /**
+     * @param name Name of a gene.
+     * @param options Further options.
+     * @return Sorted indices of the genes with this name.
+     * This is a view into the index and is empty if no gene has this name.
+     */
+    Span<uint64_t> find(std::string_view name, const GeneLookupOptions& options = GeneLookupOptions()) const {
+        auto type = chosen_type(options);
+        if (!options.case_insensitive) {
+            return genes_for(false, my_exact.find(name, internal::hash_gene_name(name)), type);
+        }
+        check_folded();
+        std::string buffer;
+        internal::fold_case(name, buffer);
+        return genes_for(true, my_folded.find(buffer, internal::hash_gene_name(buffer)), type);
+    }
+
+    /**
+     * Resolve many names at once, e.g., a user-supplied list of gene identifiers.
+     * This hashes a block of names and prefetches their slots in the hash table before probing, to hide the latency of the random memory accesses.
+     *
+     * @tparam String_ String type that can be converted to a `std::string_view`.
+     * @param names Names of genes.
+     * @param options Further options.
+     * @return Sorted indices of the genes for each name in `names`.
+     */
+    template<typename String_>
+    ResolvedGenes resolve(const std::vector<String_>& names, const GeneLookupOptions& options = GeneLookupOptions()) const {
+        auto type = chosen_type(options);
+        const internal::GeneNameTable* table = &my_exact;
+        if (options.case_insensitive) {
+            check_folded();
+            table = &my_folded;
+        }
+
+        ResolvedGenes output;
+        const size_t num_names = names.size();
+        output.offsets.reserve(num_names + 1);
+        output.offsets.push_back(0);
+
+        constexpr size_t block_size = 16;
+        std::string_view block_names[block_size];
+        uint64_t hashes[block_size];
+        std::vector<std::string> folded(options.case_insensitive ? block_size : 0);
+
+        for (size_t start = 0; start < num_names; start += block_size) {
+            const size_t current = std::min(block_size, num_names - start);
+            for (size_t i = 0; i < current; ++i) {
+                std::string_view name(names[start + i]);
+                if (options.case_insensitive) {
+                    internal::fold_case(name, folded[i]);
+                    name = folded[i];
+                }
+                block_names[i] = name;
+                hashes[i] = internal::hash_gene_name(name);
+                table->prefetch(hashes[i]);
+            }
+
+            for (size_t i = 0; i < current; ++i) {
+                auto entry = table->find(block_names[i], hashes[i]);
+                auto genes = genes_for(options.case_insensitive, entry, type);
+                output.genes.insert(output.genes.end(), genes.begin(), genes.end());
+                output.offsets.push_back(output.genes.size());
+            }
+        }
+
+        return output;
+    }
+
+    /**
+     * Find gene names that start with a prefix, e.g., for autocompletion.
+     *
+     * @param prefix Prefix of the gene names.
+     * @param max_results Maximum number of names to report.
+     * @param options Further options.
+     * @return Sorted and unique gene names that start with `prefix`.
+     * If `GeneLookupOptions::case_insensitive = true`, names are sorted by their lower-cased forms, with ties broken by the original names.
+     */
+    std::vector<std::string> complete(std::string_view prefix, size_t max_results, const GeneLookupOptions& options = GeneLookupOptions()) const {
+        auto type = chosen_type(options);
+        std::vector<std::string> output;
+        auto has_type = [&](size_t entry) -> bool {
+            return type == my_types.size() || !my_exact_by_type.get(entry * my_types.size() + type).empty();
+        };
+
+        if (!options.case_insensitive) {
+            auto it = lower_bound_prefix(my_exact, my_sorted, prefix);
+            for (; it != my_sorted.end() && output.size() < max_results; ++it) {
+                auto name = my_exact.name(*it);
+                if (name.compare(0, prefix.size(), prefix) != 0) {
+                    break;
+                }
+                if (has_type(*it)) {
+                    output.emplace_back(name);
+                }
+            }
+            return output;
+        }
+
+        check_folded();
+        std::string folded_prefix;
+        internal::fold_case(prefix, folded_prefix);
+        auto it = lower_bound_prefix(my_folded, my_folded_sorted, folded_prefix);
+        for (; it != my_folded_sorted.end() && output.size() < max_results; ++it) {
+            if (my_folded.name(*it).compare(0, folded_prefix.size(), folded_prefix) != 0) {
+                break;
+            }
+            for (auto m : my_folded_members.get(*it)) {
+                if (output.size() == max_results) {
+                    break;
+                }
+                if (has_type(m)) {
+                    output.emplace_back(my_exact.name(m));
+                }
+            }
+        }
+        return output;
+    }
+
+private:
+    static std::vector<uint32_t>::const_iterator lower_bound_prefix(const internal::GeneNameTable& table, const std::vector<uint32_t>& sorted, std::string_view prefix) {
+        return std::lower_bound(sorted.begin(), sorted.end(), prefix, [&](uint32_t entry, std::string_view target) -> bool {
+            return table.name(entry) < target;
+        });
+    }
+
+    // Returns the number of types if all types are to be searched.
+    size_t chosen_type(const GeneLookupOptions& options) const {
+        if (options.type.empty()) {
+            return my_types.size();
+        }
+        return type_index(options.type);
+    }
+
+    void check_folded() const {
+        if (!my_has_folded) {
+            throw std::runtime_error("case-insensitive lookups require 'GeneIndexOptions::case_insensitive = true'");
+        }
+    }
+
+    Span<uint64_t> genes_for(bool folded, size_t entry, size_t type) const {
+        const auto& table = (folded ? my_folded : my_exact);
+        if (entry >= table.size()) {
+            return Span<uint64_t>();
+        }
+        const size_t num_types = my_types.size();
+        if (type == num_types) {
+            return (folded ? my_folded_any : my_exact_any).get(entry);
+        } else {
+            return (folded ? my_folded_by_type : my_exact_by_type).get(entry * num_types + type);
+        }
+    }
+
+private:
+    std::vector<std::string> my_types;
+    uint64_t my_num_genes = 0;
+
+    internal::GeneNameTable my_exact;
+    internal::GenePostings my_exact_by_type, my_exact_any;
+    std::vector<uint32_t> my_sorted;
+
+    bool my_has_folded = false;
+    internal::GeneNameTable my_folded;
+    internal::GenePostings my_folded_by_type, my_folded_any, my_folded_members;
+    std::vector<uint32_t> my_folded_sorted;
+};
+
+}
+
+#endif
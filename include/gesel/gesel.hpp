@@ -1,8 +1,20 @@
 #ifndef GESEL_GESEL_HPP
 #define GESEL_GESEL_HPP
 
+#include "validation_report.hpp"
 #include "validate_database.hpp"
 #include "validate_genes.hpp"
+#include "revalidate.hpp"
+#include "gene_index.hpp"
+#include "hybrid_set.hpp"
+#include "load_database.hpp"
+#include "ranged_file.hpp"
+#include "fetch_ranges.hpp"
+#include "line_cache.hpp"
+#include "enrich.hpp"
+#include "search_sets.hpp"
+#include "write_database.hpp"
+#include "binary_indices.hpp"
 
 /**
  * @file gesel.hpp
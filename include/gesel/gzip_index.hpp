@@ -0,0 +1,390 @@
+#ifndef GESEL_GZIP_INDEX_HPP
+#define GESEL_GZIP_INDEX_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+#include "zlib.h"
+
+#include "chunked_reader.hpp"
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * Access points for random access into a Gzip-compressed file, following the approach in zlib's examples/zran.c.
+ * Each checkpoint lies on a deflate block boundary and stores the bit offset into the compressed stream,
+ * the corresponding offset into the uncompressed stream, and the preceding 32 kB of uncompressed data for use as the inflation dictionary.
+ * Inflation can then be started at any checkpoint without decompressing all of the preceding data.
+ *
+ * Files with multiple Gzip members (e.g., from pigz or concatenation) are supported,
+ * and any trailing bytes that do not form a valid Gzip member are ignored, consistent with gzread().
+ */
+constexpr size_t gzip_window_size = 32768;
+
+struct GzipCheckpoint {
+    uint64_t compressed = 0;
+    uint64_t uncompressed = 0;
+    int bits = 0;
+    std::vector<unsigned char> window;
+};
+
+struct GzipIndex {
+    // Size and the last 8 bytes (usually the CRC-32 and length of the last member) of the compressed file, to detect stale indices.
+    uint64_t compressed_size = 0;
+    std::array<unsigned char, 8> trailer{};
+
+    uint64_t uncompressed_size = 0;
+    std::vector<GzipCheckpoint> checkpoints;
+};
+
+class InflateStream {
+public:
+    InflateStream(int window_bits) {
+        std::memset(&my_strm, 0, sizeof(z_stream));
+        if (inflateInit2(&my_strm, window_bits) != Z_OK) {
+            throw std::runtime_error("failed to initialize the Gzip decompression stream");
+        }
+    }
+
+    ~InflateStream() {
+        inflateEnd(&my_strm);
+    }
+
+    InflateStream(const InflateStream&) = delete;
+    InflateStream& operator=(const InflateStream&) = delete;
+
+public:
+    z_stream& get() {
+        return my_strm;
+    }
+
+private:
+    z_stream my_strm;
+};
+
+inline const unsigned char* mapped_bytes(const MappedFile& file) {
+    return reinterpret_cast<const unsigned char*>(file.data());
+}
+
+// Input is contiguous in the mapping, but 'avail_in' is only 32 bits, so we feed it in pieces.
+inline void refill_input(z_stream& strm, uint64_t& remaining) {
+    constexpr uint64_t max_chunk = 1u << 30;
+    auto chunk = std::min(remaining, max_chunk);
+    strm.avail_in = chunk;
+    remaining -= chunk;
+}
+
+inline void fill_trailer(const MappedFile& gz, GzipIndex& index) {
+    index.compressed_size = gz.size();
+    index.trailer.fill(0);
+    size_t ntrail = std::min(gz.size(), index.trailer.size());
+    if (ntrail) {
+        std::copy_n(mapped_bytes(gz) + gz.size() - ntrail, ntrail, index.trailer.begin() + (index.trailer.size() - ntrail));
+    }
+}
+
+/*
+ * Decompresses the entire file, passing each chunk of uncompressed bytes to 'consume(ptr, n)',
+ * and records a checkpoint at the first block boundary after every 'spacing' bytes of uncompressed data.
+ */
+template<class Consumer_>
+GzipIndex build_gzip_index(const MappedFile& gz, uint64_t spacing, Consumer_ consume) {
+    GzipIndex index;
+    fill_trailer(gz, index);
+
+    InflateStream stream(47); // automatic detection of the Gzip/Zlib header.
+    auto& strm = stream.get();
+    strm.next_in = const_cast<unsigned char*>(mapped_bytes(gz));
+    uint64_t remaining = gz.size();
+
+    // Output is written into a circular buffer that also serves as the dictionary for each checkpoint.
+    std::vector<unsigned char> window(gzip_window_size);
+    strm.avail_out = 0;
+
+    uint64_t totin = 0, totout = 0, last = 0;
+    bool between_members = false;
+
+    while (true) {
+        if (strm.avail_in == 0) {
+            if (remaining == 0) {
+                if (!between_members) {
+                    throw std::runtime_error("unexpected end of the Gzip-compressed file");
+                }
+                break;
+            }
+            refill_input(strm, remaining);
+        }
+
+        if (strm.avail_out == 0) {
+            strm.next_out = window.data();
+            strm.avail_out = window.size();
+        }
+
+        auto out_start = strm.next_out;
+        auto before_in = strm.avail_in, before_out = strm.avail_out;
+        int ret = inflate(&strm, Z_BLOCK);
+        totin += before_in - strm.avail_in;
+        size_t produced = before_out - strm.avail_out;
+        totout += produced;
+        if (produced) {
+            consume(static_cast<const unsigned char*>(out_start), produced);
+        }
+
+        if (ret == Z_STREAM_END) {
+            between_members = true;
+            inflateReset(&strm);
+            continue;
+        }
+        if (ret == Z_DATA_ERROR && between_members) {
+            break; // ignoring trailing garbage.
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw std::runtime_error("failed to decompress the Gzip-compressed file");
+        }
+
+        if (strm.data_type & 128) {
+            between_members = false; // a block boundary means that we're definitely in a valid member.
+            if (!(strm.data_type & 64) && (index.checkpoints.empty() || totout - last >= spacing)) {
+                index.checkpoints.emplace_back();
+                auto& point = index.checkpoints.back();
+                point.compressed = totin;
+                point.uncompressed = totout;
+                point.bits = strm.data_type & 7;
+
+                // The window is a ring buffer where 'pos' is the next byte to be written,
+                // so the history is [pos, end) followed by [0, pos), of which we keep the last 'keep' bytes.
+                size_t pos = window.size() - std::min<size_t>(strm.avail_out, window.size());
+                size_t keep = std::min(static_cast<uint64_t>(window.size()), totout);
+                point.window.resize(keep);
+                if (keep <= pos) {
+                    std::copy(window.begin() + (pos - keep), window.begin() + pos, point.window.begin());
+                } else {
+                    size_t wrapped = keep - pos;
+                    auto next = std::copy(window.end() - wrapped, window.end(), point.window.begin());
+                    std::copy(window.begin(), window.begin() + pos, next);
+                }
+
+                last = totout;
+            }
+        }
+    }
+
+    index.uncompressed_size = totout;
+    return index;
+}
+
+/*
+ * Decompresses up to 'length' bytes starting from the specified checkpoint, passing each chunk to 'consume(ptr, n)'.
+ * Returns the number of bytes that were decompressed, which may be less than 'length' if the end of the file is reached.
+ */
+template<class Consumer_>
+uint64_t inflate_from_checkpoint(const MappedFile& gz, const GzipCheckpoint& point, uint64_t length, Consumer_ consume) {
+    if (point.compressed > gz.size() || (point.bits && point.compressed == 0)) {
+        throw std::runtime_error("checkpoint lies outside of the Gzip-compressed file");
+    }
+
+    InflateStream stream(-15); // raw deflate, as we're starting in the middle of a member.
+    auto& strm = stream.get();
+    auto input = mapped_bytes(gz);
+    uint64_t pos = point.compressed;
+    if (point.bits) {
+        --pos;
+        if (inflatePrime(&strm, point.bits, input[pos] >> (8 - point.bits)) != Z_OK) {
+            throw std::runtime_error("failed to prime the Gzip decompression stream");
+        }
+        ++pos;
+    }
+    if (!point.window.empty()) {
+        if (inflateSetDictionary(&strm, point.window.data(), point.window.size()) != Z_OK) {
+            throw std::runtime_error("failed to set the Gzip decompression dictionary");
+        }
+    }
+
+    strm.next_in = const_cast<unsigned char*>(input + pos);
+    uint64_t remaining = gz.size() - pos;
+    strm.avail_in = 0;
+
+    std::vector<unsigned char> buffer(std::min(length, static_cast<uint64_t>(65536)));
+    uint64_t total = 0;
+    bool raw_deflate = true, between_members = false;
+
+    while (total < length) {
+        if (strm.avail_in == 0) {
+            if (remaining == 0) {
+                break;
+            }
+            refill_input(strm, remaining);
+        }
+
+        strm.next_out = buffer.data();
+        strm.avail_out = std::min(static_cast<uint64_t>(buffer.size()), length - total);
+        auto before_out = strm.avail_out;
+        int ret = inflate(&strm, Z_NO_FLUSH);
+        size_t produced = before_out - strm.avail_out;
+        if (produced) {
+            consume(static_cast<const unsigned char*>(buffer.data()), produced);
+            total += produced;
+            between_members = false;
+        }
+
+        if (ret == Z_STREAM_END) {
+            if (raw_deflate) {
+                // Skipping the CRC-32 and length of the current member, so that we can switch to parsing Gzip headers.
+                uint64_t left = static_cast<uint64_t>(strm.avail_in) + remaining;
+                if (left < 8) {
+                    break;
+                }
+                strm.next_in += 8;
+                remaining = left - 8;
+                strm.avail_in = 0;
+                inflateReset2(&strm, 31);
+                raw_deflate = false;
+            } else {
+                inflateReset(&strm);
+            }
+            between_members = true;
+            continue;
+        }
+        if (ret == Z_DATA_ERROR && between_members) {
+            break;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            throw std::runtime_error("failed to decompress the Gzip-compressed file");
+        }
+    }
+
+    return total;
+}
+
+inline bool gzip_index_matches(const GzipIndex& index, const MappedFile& gz) {
+    GzipIndex current;
+    fill_trailer(gz, current);
+    return index.compressed_size == current.compressed_size && index.trailer == current.trailer;
+}
+
+/*
+ * Sidecar format: the magic string, then the fields of the GzipIndex in order, followed by each checkpoint.
+ * All integers are stored as little-endian 64-bit values.
+ */
+constexpr char gzip_index_magic[8] = { 'G', 'E', 'S', 'E', 'L', 'Z', 'I', '1' };
+
+inline void write_u64(std::ostream& out, uint64_t value) {
+    unsigned char buffer[8];
+    for (int b = 0; b < 8; ++b) {
+        buffer[b] = (value >> (8 * b)) & 0xff;
+    }
+    out.write(reinterpret_cast<const char*>(buffer), 8);
+}
+
+inline uint64_t read_u64(std::istream& in) {
+    unsigned char buffer[8];
+    if (!in.read(reinterpret_cast<char*>(buffer), 8)) {
+        throw std::runtime_error("unexpected end of the Gzip index file");
+    }
+    uint64_t value = 0;
+    for (int b = 0; b < 8; ++b) {
+        value |= static_cast<uint64_t>(buffer[b]) << (8 * b);
+    }
+    return value;
+}
+
+/*
+ * The index is written to a temporary file and then renamed, so that concurrent readers never observe a partially written index.
+ */
+inline void save_gzip_index(const GzipIndex& index, const std::string& path) {
+    auto tmppath = path + ".tmp";
+    {
+        std::ofstream out(tmppath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("failed to open Gzip index file at '" + tmppath + "'");
+        }
+        out.write(gzip_index_magic, sizeof(gzip_index_magic));
+        write_u64(out, index.compressed_size);
+        out.write(reinterpret_cast<const char*>(index.trailer.data()), index.trailer.size());
+        write_u64(out, index.uncompressed_size);
+        write_u64(out, index.checkpoints.size());
+        for (const auto& point : index.checkpoints) {
+            write_u64(out, point.compressed);
+            write_u64(out, point.uncompressed);
+            write_u64(out, point.bits);
+            write_u64(out, point.window.size());
+            out.write(reinterpret_cast<const char*>(point.window.data()), point.window.size());
+        }
+        if (!out) {
+            throw std::runtime_error("failed to write Gzip index file at '" + tmppath + "'");
+        }
+    }
+    if (std::rename(tmppath.c_str(), path.c_str()) != 0) {
+        std::remove(tmppath.c_str());
+        throw std::runtime_error("failed to rename Gzip index file to '" + path + "'");
+    }
+}
+
+inline GzipIndex load_gzip_index(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("failed to open Gzip index file at '" + path + "'");
+    }
+
+    char magic[sizeof(gzip_index_magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, gzip_index_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("unrecognized Gzip index file at '" + path + "'");
+    }
+
+    GzipIndex index;
+    index.compressed_size = read_u64(in);
+    if (!in.read(reinterpret_cast<char*>(index.trailer.data()), index.trailer.size())) {
+        throw std::runtime_error("unexpected end of the Gzip index file");
+    }
+    index.uncompressed_size = read_u64(in);
+
+    uint64_t num_points = read_u64(in);
+    for (uint64_t p = 0; p < num_points; ++p) {
+        GzipCheckpoint point;
+        point.compressed = read_u64(in);
+        point.uncompressed = read_u64(in);
+        uint64_t bits = read_u64(in);
+        uint64_t window_size = read_u64(in);
+
+        // Sanity checks so that a corrupted index cannot send us outside of the file or the output range.
+        if (bits > 7 || window_size > gzip_window_size || window_size > point.uncompressed) {
+            throw std::runtime_error("invalid checkpoint in the Gzip index file");
+        }
+        if (point.compressed > index.compressed_size || point.uncompressed > index.uncompressed_size) {
+            throw std::runtime_error("invalid checkpoint in the Gzip index file");
+        }
+        if (!index.checkpoints.empty()) {
+            const auto& previous = index.checkpoints.back();
+            if (point.compressed <= previous.compressed || point.uncompressed < previous.uncompressed) {
+                throw std::runtime_error("checkpoints should be sorted in the Gzip index file");
+            }
+        } else if (point.uncompressed != 0) {
+            throw std::runtime_error("first checkpoint should be at the start of the uncompressed data in the Gzip index file");
+        }
+
+        point.bits = bits;
+        point.window.resize(window_size);
+        if (!in.read(reinterpret_cast<char*>(point.window.data()), window_size)) {
+            throw std::runtime_error("unexpected end of the Gzip index file");
+        }
+        index.checkpoints.push_back(std::move(point));
+    }
+
+    return index;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,745 @@
+#ifndef GESEL_HYBRID_SET_HPP
+#define GESEL_HYBRID_SET_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <limits>
+#include <utility>
+
+#include "intersect.hpp"
+#include "flat_indices.hpp"
+
+/**
+ * @file hybrid_set.hpp
+ * @brief Sets of indices with adaptive array/bitmap containers.
+ */
+
+namespace gesel {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Each set is split into chunks of 2^16 consecutive values, as in Roaring bitmaps.
+ * A chunk with no more than 'hybrid_array_limit' values is stored as a sorted array of the lower 16 bits of each value,
+ * otherwise it is stored as a bitmap of 2^16 bits; the limit is chosen so that an array never uses more memory than a bitmap.
+ * The representation is fully determined by the cardinality, so each set has exactly one representation.
+ */
+constexpr uint32_t hybrid_array_limit = 4096;
+
+constexpr size_t hybrid_bitmap_words = 1024;
+
+inline int popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// 'x' should be non-zero.
+inline int count_trailing_zeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+struct HybridChunk {
+    uint32_t key; // i.e., the upper bits of each value in the chunk.
+    uint32_t cardinality;
+    uint64_t offset; // start of the chunk in the pool of arrays or bitmaps.
+
+    bool is_bitmap() const {
+        return cardinality > hybrid_array_limit;
+    }
+};
+
+inline bool bitmap_contains(const uint64_t* words, uint32_t low) {
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+inline void array_to_bitmap(const uint16_t* values, size_t n, uint64_t* words) {
+    std::fill_n(words, hybrid_bitmap_words, 0);
+    for (size_t i = 0; i < n; ++i) {
+        words[values[i] >> 6] |= static_cast<uint64_t>(1) << (values[i] & 63);
+    }
+}
+
+inline size_t bitmap_to_array(const uint64_t* words, uint16_t* output) {
+    size_t count = 0;
+    for (size_t w = 0; w < hybrid_bitmap_words; ++w) {
+        uint64_t x = words[w];
+        while (x) {
+            output[count] = static_cast<uint16_t>(w * 64 + count_trailing_zeros64(x));
+            ++count;
+            x &= x - 1;
+        }
+    }
+    return count;
+}
+
+/*
+ * Combines two bitmaps word by word with AND (if 'and_ = true') or OR, returning the number of set bits in the result.
+ * If 'store_ = false', the result is only counted and 'output' is not used.
+ */
+template<bool and_, bool store_>
+uint32_t combine_bitmaps_portable(const uint64_t* left, const uint64_t* right, uint64_t* output) {
+    uint32_t count = 0;
+    for (size_t w = 0; w < hybrid_bitmap_words; ++w) {
+        uint64_t x = (and_ ? left[w] & right[w] : left[w] | right[w]);
+        if constexpr(store_) {
+            output[w] = x;
+        }
+        count += popcount64(x);
+    }
+    return count;
+}
+
+#ifdef GESEL_X86_SIMD
+/*
+ * Same as above but compiled with the hardware popcount instruction, which is much faster than the generic fallback for __builtin_popcountll.
+ */
+template<bool and_, bool store_>
+__attribute__((target("popcnt")))
+uint32_t combine_bitmaps_popcnt(const uint64_t* left, const uint64_t* right, uint64_t* output) {
+    uint32_t count = 0;
+    for (size_t w = 0; w < hybrid_bitmap_words; ++w) {
+        uint64_t x = (and_ ? left[w] & right[w] : left[w] | right[w]);
+        if constexpr(store_) {
+            output[w] = x;
+        }
+        count += __builtin_popcountll(x);
+    }
+    return count;
+}
+#endif
+
+template<bool and_, bool store_>
+uint32_t combine_bitmaps(const uint64_t* left, const uint64_t* right, uint64_t* output) {
+#ifdef GESEL_X86_SIMD
+    if (simd_support().sse41) { // this already requires popcnt support.
+        return combine_bitmaps_popcnt<and_, store_>(left, right, output);
+    }
+#endif
+    return combine_bitmaps_portable<and_, store_>(left, right, output);
+}
+
+/*
+ * Scratch space for operations on individual chunks, reused across chunks to avoid repeated allocations.
+ */
+struct HybridWorkspace {
+    std::vector<uint16_t> values;
+    std::vector<uint64_t> words;
+};
+
+/*
+ * Chunks for one or more sets, where the arrays and bitmaps of all chunks are stored in two shared pools.
+ * Chunks for each set should be added in increasing order of their keys.
+ */
+struct HybridStorage {
+    std::vector<HybridChunk> chunks;
+    std::vector<uint16_t> arrays;
+    std::vector<uint64_t> bitmaps;
+
+    void add_array(uint32_t key, const uint16_t* values, size_t n) {
+        chunks.push_back(HybridChunk{ key, static_cast<uint32_t>(n), arrays.size() });
+        arrays.insert(arrays.end(), values, values + n);
+    }
+
+    void add_bitmap(uint32_t key, const uint64_t* words, uint32_t cardinality) {
+        chunks.push_back(HybridChunk{ key, cardinality, bitmaps.size() });
+        bitmaps.insert(bitmaps.end(), words, words + hybrid_bitmap_words);
+    }
+
+    // These choose the representation based on the cardinality, converting the input if necessary.
+    void add_from_array(uint32_t key, const uint16_t* values, size_t n, HybridWorkspace& work) {
+        if (n == 0) {
+            return;
+        }
+        if (n <= hybrid_array_limit) {
+            add_array(key, values, n);
+        } else {
+            work.words.resize(hybrid_bitmap_words);
+            array_to_bitmap(values, n, work.words.data());
+            add_bitmap(key, work.words.data(), n);
+        }
+    }
+
+    void add_from_bitmap(uint32_t key, const uint64_t* words, uint32_t cardinality, HybridWorkspace& work) {
+        if (cardinality == 0) {
+            return;
+        }
+        if (cardinality > hybrid_array_limit) {
+            add_bitmap(key, words, cardinality);
+        } else {
+            work.values.resize(hybrid_array_limit);
+            bitmap_to_array(words, work.values.data());
+            add_array(key, work.values.data(), cardinality);
+        }
+    }
+
+    template<typename Value_>
+    void add_sorted(const Value_* values, size_t n, HybridWorkspace& work) {
+        size_t i = 0;
+        while (i < n) {
+            uint64_t key = static_cast<uint64_t>(values[i]) >> 16;
+            if (key > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("values in a hybrid set should be less than 2^48");
+            }
+            work.values.clear();
+            for (; i < n && (static_cast<uint64_t>(values[i]) >> 16) == key; ++i) {
+                if (i && !(values[i - 1] < values[i])) {
+                    throw std::runtime_error("values in a hybrid set should be sorted and unique");
+                }
+                work.values.push_back(static_cast<uint16_t>(values[i] & 0xFFFF));
+            }
+            if (i < n && !(values[i - 1] < values[i])) {
+                throw std::runtime_error("values in a hybrid set should be sorted and unique");
+            }
+            add_from_array(key, work.values.data(), work.values.size(), work);
+        }
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Read-only view of a set of indices with adaptive array/bitmap containers.
+ *
+ * This is usually obtained from a `HybridSet` or `HybridIndices`, and is only valid while its source is alive.
+ */
+class HybridView {
+public:
+    /**
+     * @cond
+     */
+    HybridView() = default;
+
+    HybridView(const internal::HybridChunk* chunks, size_t num_chunks, const uint16_t* arrays, const uint64_t* bitmaps) :
+        my_chunks(chunks), my_num_chunks(num_chunks), my_arrays(arrays), my_bitmaps(bitmaps) {}
+
+    const internal::HybridChunk* chunks() const {
+        return my_chunks;
+    }
+
+    const uint16_t* array(size_t chunk) const {
+        return my_arrays + my_chunks[chunk].offset;
+    }
+
+    const uint64_t* bitmap(size_t chunk) const {
+        return my_bitmaps + my_chunks[chunk].offset;
+    }
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Number of chunks, i.e., runs of \f$2^{16}\f$ consecutive values containing at least one value in the set.
+     */
+    size_t num_chunks() const {
+        return my_num_chunks;
+    }
+
+    /**
+     * @return Number of chunks that are stored as bitmaps.
+     */
+    size_t num_bitmaps() const {
+        size_t count = 0;
+        for (size_t c = 0; c < my_num_chunks; ++c) {
+            count += my_chunks[c].is_bitmap();
+        }
+        return count;
+    }
+
+    /**
+     * @return Number of values in the set.
+     * This takes time proportional to the number of chunks.
+     */
+    size_t size() const {
+        size_t total = 0;
+        for (size_t c = 0; c < my_num_chunks; ++c) {
+            total += my_chunks[c].cardinality;
+        }
+        return total;
+    }
+
+    /**
+     * @return Whether the set is empty.
+     */
+    bool empty() const {
+        return my_num_chunks == 0;
+    }
+
+    /**
+     * @param value Value of interest.
+     * @return Whether the value is present in the set.
+     */
+    bool contains(uint64_t value) const {
+        uint64_t key = value >> 16;
+        auto end = my_chunks + my_num_chunks;
+        auto found = std::lower_bound(my_chunks, end, key, [](const internal::HybridChunk& chunk, uint64_t k) -> bool { return chunk.key < k; });
+        if (found == end || found->key != key) {
+            return false;
+        }
+        size_t c = found - my_chunks;
+        auto low = static_cast<uint16_t>(value & 0xFFFF);
+        if (found->is_bitmap()) {
+            return internal::bitmap_contains(bitmap(c), low);
+        }
+        auto arr = array(c);
+        return std::binary_search(arr, arr + found->cardinality, low);
+    }
+
+    /**
+     * @tparam Value_ Integer type of the output values.
+     * @param[out] output Vector in which to store the sorted values in the set.
+     */
+    template<typename Value_>
+    void to_vector(std::vector<Value_>& output) const {
+        output.clear();
+        output.reserve(size());
+        for (size_t c = 0; c < my_num_chunks; ++c) {
+            const auto& chunk = my_chunks[c];
+            uint64_t base = static_cast<uint64_t>(chunk.key) << 16;
+            if (chunk.is_bitmap()) {
+                auto words = bitmap(c);
+                for (size_t w = 0; w < internal::hybrid_bitmap_words; ++w) {
+                    uint64_t x = words[w];
+                    while (x) {
+                        output.push_back(base + w * 64 + internal::count_trailing_zeros64(x));
+                        x &= x - 1;
+                    }
+                }
+            } else {
+                auto arr = array(c);
+                for (uint32_t i = 0; i < chunk.cardinality; ++i) {
+                    output.push_back(base + arr[i]);
+                }
+            }
+        }
+    }
+
+    /**
+     * @tparam Value_ Integer type of the output values.
+     * @return Sorted values in the set.
+     */
+    template<typename Value_ = uint32_t>
+    std::vector<Value_> to_vector() const {
+        std::vector<Value_> output;
+        to_vector(output);
+        return output;
+    }
+
+private:
+    const internal::HybridChunk* my_chunks = NULL;
+    size_t my_num_chunks = 0;
+    const uint16_t* my_arrays = NULL;
+    const uint64_t* my_bitmaps = NULL;
+};
+
+/**
+ * @brief Set of indices with adaptive array/bitmap containers.
+ *
+ * The set is split into chunks of \f$2^{16}\f$ consecutive values, as in Roaring bitmaps.
+ * Each chunk is stored as a sorted array of 16-bit offsets if it contains no more than 4096 values, and as a bitmap otherwise.
+ * This is more compact than a sorted vector for dense sets (e.g., large gene sets or the sets containing housekeeping genes),
+ * and allows intersections and unions of dense chunks to be computed with word-wise bit operations.
+ * All values should be less than \f$2^{48}\f$.
+ */
+class HybridSet {
+public:
+    /**
+     * Create an empty set.
+     */
+    HybridSet() = default;
+
+    /**
+     * @tparam Value_ Integer type of the values.
+     * @param values Pointer to an array of sorted and unique values.
+     * @param n Number of values.
+     */
+    template<typename Value_>
+    HybridSet(const Value_* values, size_t n) {
+        internal::HybridWorkspace work;
+        my_storage.add_sorted(values, n, work);
+    }
+
+    /**
+     * @tparam Value_ Integer type of the values.
+     * @param values Sorted and unique values.
+     */
+    template<typename Value_>
+    HybridSet(const std::vector<Value_>& values) : HybridSet(values.data(), values.size()) {}
+
+    /**
+     * @cond
+     */
+    HybridSet(internal::HybridStorage storage) : my_storage(std::move(storage)) {}
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return View of this set.
+     */
+    HybridView view() const {
+        return HybridView(my_storage.chunks.data(), my_storage.chunks.size(), my_storage.arrays.data(), my_storage.bitmaps.data());
+    }
+
+    /**
+     * @return View of this set.
+     */
+    operator HybridView() const {
+        return view();
+    }
+
+    /**
+     * @return Number of values in the set.
+     */
+    size_t size() const {
+        return view().size();
+    }
+
+    /**
+     * @return Whether the set is empty.
+     */
+    bool empty() const {
+        return my_storage.chunks.empty();
+    }
+
+    /**
+     * @param value Value of interest.
+     * @return Whether the value is present in the set.
+     */
+    bool contains(uint64_t value) const {
+        return view().contains(value);
+    }
+
+    /**
+     * @tparam Value_ Integer type of the output values.
+     * @return Sorted values in the set.
+     */
+    template<typename Value_ = uint32_t>
+    std::vector<Value_> to_vector() const {
+        return view().to_vector<Value_>();
+    }
+
+private:
+    internal::HybridStorage my_storage;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Intersection of two sorted arrays of 16-bit values, galloping through the longer array if the lengths are sufficiently skewed.
+ * The kernels for 32-bit and 64-bit values are not applicable here, so the merge is always scalar.
+ */
+template<bool store_>
+size_t intersect_arrays16(const uint16_t* left, size_t left_size, const uint16_t* right, size_t right_size, uint16_t* output) {
+    if (left_size > right_size) {
+        std::swap(left, right);
+        std::swap(left_size, right_size);
+    }
+    if (left_size * galloping_ratio >= right_size) {
+        return intersect_scalar<store_>(left, left_size, right, right_size, output);
+    }
+
+    size_t count = 0;
+    const uint16_t* current = right;
+    const uint16_t* right_end = right + right_size;
+    for (size_t i = 0; i < left_size && current < right_end; ++i) {
+        auto target = left[i];
+        current = gallop(current, right_end, target);
+        if (current < right_end && *current == target) {
+            if constexpr(store_) {
+                output[count] = target;
+            }
+            ++count;
+            ++current;
+        }
+    }
+    return count;
+}
+
+/*
+ * Operations on a pair of chunks with the same key.
+ * If 'store_ = false', the intersection is only counted and nothing is added to 'output'.
+ */
+template<bool store_>
+size_t intersect_chunks(const HybridView& left, size_t l, const HybridView& right, size_t r, HybridStorage& output, HybridWorkspace& work) {
+    const auto& lchunk = left.chunks()[l];
+    const auto& rchunk = right.chunks()[r];
+    bool lbitmap = lchunk.is_bitmap(), rbitmap = rchunk.is_bitmap();
+
+    if (lbitmap && rbitmap) {
+        if constexpr(store_) {
+            work.words.resize(hybrid_bitmap_words);
+            auto count = combine_bitmaps<true, true>(left.bitmap(l), right.bitmap(r), work.words.data());
+            output.add_from_bitmap(lchunk.key, work.words.data(), count, work);
+            return count;
+        } else {
+            return combine_bitmaps<true, false>(left.bitmap(l), right.bitmap(r), static_cast<uint64_t*>(NULL));
+        }
+    }
+
+    if (lbitmap || rbitmap) {
+        const uint16_t* arr = (lbitmap ? right.array(r) : left.array(l));
+        size_t n = (lbitmap ? rchunk.cardinality : lchunk.cardinality);
+        const uint64_t* words = (lbitmap ? left.bitmap(l) : right.bitmap(r));
+        size_t count = 0;
+        if constexpr(store_) {
+            work.values.resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                work.values[count] = arr[i];
+                count += bitmap_contains(words, arr[i]);
+            }
+            output.add_from_array(lchunk.key, work.values.data(), count, work);
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                count += bitmap_contains(words, arr[i]);
+            }
+        }
+        return count;
+    }
+
+    if constexpr(store_) {
+        work.values.resize(std::min(lchunk.cardinality, rchunk.cardinality));
+        size_t count = intersect_arrays16<true>(left.array(l), lchunk.cardinality, right.array(r), rchunk.cardinality, work.values.data());
+        output.add_from_array(lchunk.key, work.values.data(), count, work);
+        return count;
+    } else {
+        return intersect_arrays16<false>(left.array(l), lchunk.cardinality, right.array(r), rchunk.cardinality, static_cast<uint16_t*>(NULL));
+    }
+}
+
+inline void unite_chunks(const HybridView& left, size_t l, const HybridView& right, size_t r, HybridStorage& output, HybridWorkspace& work) {
+    const auto& lchunk = left.chunks()[l];
+    const auto& rchunk = right.chunks()[r];
+    bool lbitmap = lchunk.is_bitmap(), rbitmap = rchunk.is_bitmap();
+
+    if (lbitmap && rbitmap) {
+        work.words.resize(hybrid_bitmap_words);
+        auto count = combine_bitmaps<false, true>(left.bitmap(l), right.bitmap(r), work.words.data());
+        output.add_bitmap(lchunk.key, work.words.data(), count);
+        return;
+    }
+
+    if (lbitmap || rbitmap) {
+        const uint16_t* arr = (lbitmap ? right.array(r) : left.array(l));
+        size_t n = (lbitmap ? rchunk.cardinality : lchunk.cardinality);
+        const uint64_t* words = (lbitmap ? left.bitmap(l) : right.bitmap(r));
+        uint32_t count = (lbitmap ? lchunk.cardinality : rchunk.cardinality);
+        work.words.assign(words, words + hybrid_bitmap_words);
+        for (size_t i = 0; i < n; ++i) {
+            auto& word = work.words[arr[i] >> 6];
+            uint64_t bit = static_cast<uint64_t>(1) << (arr[i] & 63);
+            count += !(word & bit);
+            word |= bit;
+        }
+        output.add_bitmap(lchunk.key, work.words.data(), count);
+        return;
+    }
+
+    // Using a separate buffer as add_from_array() may use 'work.words' for the conversion.
+    work.values.resize(static_cast<size_t>(lchunk.cardinality) + rchunk.cardinality);
+    size_t count = union_scalar(left.array(l), lchunk.cardinality, right.array(r), rchunk.cardinality, work.values.data());
+    output.add_from_array(lchunk.key, work.values.data(), count, work);
+}
+
+inline void copy_chunk(const HybridView& source, size_t c, HybridStorage& output) {
+    const auto& chunk = source.chunks()[c];
+    if (chunk.is_bitmap()) {
+        output.add_bitmap(chunk.key, source.bitmap(c), chunk.cardinality);
+    } else {
+        output.add_array(chunk.key, source.array(c), chunk.cardinality);
+    }
+}
+
+/*
+ * Walks through the chunks of both sets in order of their keys.
+ */
+template<bool store_>
+size_t intersect_hybrid(const HybridView& left, const HybridView& right, HybridStorage& output) {
+    HybridWorkspace work;
+    size_t l = 0, r = 0, count = 0;
+    const size_t lend = left.num_chunks(), rend = right.num_chunks();
+    while (l < lend && r < rend) {
+        auto lkey = left.chunks()[l].key, rkey = right.chunks()[r].key;
+        if (lkey < rkey) {
+            ++l;
+        } else if (rkey < lkey) {
+            ++r;
+        } else {
+            count += intersect_chunks<store_>(left, l, right, r, output, work);
+            ++l;
+            ++r;
+        }
+    }
+    return count;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @param left A hybrid set.
+ * @param right Another hybrid set.
+ * @return Intersection of the two sets.
+ */
+inline HybridSet hybrid_intersect(const HybridView& left, const HybridView& right) {
+    internal::HybridStorage output;
+    internal::intersect_hybrid<true>(left, right, output);
+    return HybridSet(std::move(output));
+}
+
+/**
+ * @param left A hybrid set.
+ * @param right Another hybrid set.
+ * @return Number of values in the intersection of the two sets.
+ * This is computed without storing the intersection, e.g., with population counts for pairs of bitmaps.
+ */
+inline size_t hybrid_intersection_size(const HybridView& left, const HybridView& right) {
+    internal::HybridStorage placeholder;
+    return internal::intersect_hybrid<false>(left, right, placeholder);
+}
+
+/**
+ * @param left A hybrid set.
+ * @param right Another hybrid set.
+ * @return Union of the two sets.
+ */
+inline HybridSet hybrid_union(const HybridView& left, const HybridView& right) {
+    internal::HybridStorage output;
+    internal::HybridWorkspace work;
+    size_t l = 0, r = 0;
+    const size_t lend = left.num_chunks(), rend = right.num_chunks();
+    while (l < lend || r < rend) {
+        if (r == rend || (l < lend && left.chunks()[l].key < right.chunks()[r].key)) {
+            internal::copy_chunk(left, l, output);
+            ++l;
+        } else if (l == lend || right.chunks()[r].key < left.chunks()[l].key) {
+            internal::copy_chunk(right, r, output);
+            ++r;
+        } else {
+            internal::unite_chunks(left, l, right, r, output, work);
+            ++l;
+            ++r;
+        }
+    }
+    return HybridSet(std::move(output));
+}
+
+/**
+ * @brief Collection of hybrid sets, e.g., for each row of a mapping between sets and genes.
+ *
+ * The chunks of all sets are stored in shared pools, avoiding a separate allocation for each set.
+ */
+class HybridIndices {
+public:
+    /**
+     * Create an empty collection.
+     */
+    HybridIndices() : my_row_offsets(1) {}
+
+    /**
+     * @tparam Value_ Integer type of the values.
+     * @param rows Sorted and unique values for each set.
+     */
+    template<typename Value_>
+    HybridIndices(const std::vector<std::vector<Value_> >& rows) : my_row_offsets(1) {
+        internal::HybridWorkspace work;
+        my_row_offsets.reserve(rows.size() + 1);
+        for (const auto& row : rows) {
+            my_storage.add_sorted(row.data(), row.size(), work);
+            my_row_offsets.push_back(my_storage.chunks.size());
+        }
+        shrink();
+    }
+
+    /**
+     * @cond
+     */
+    template<typename Index_>
+    HybridIndices(const internal::FlatIndices<Index_>& flat) : my_row_offsets(1) {
+        internal::HybridWorkspace work;
+        const size_t num_rows = flat.offsets.size() - 1;
+        my_row_offsets.reserve(num_rows + 1);
+        for (size_t i = 0; i < num_rows; ++i) {
+            auto start = flat.offsets[i];
+            my_storage.add_sorted(flat.values.data() + start, flat.offsets[i + 1] - start, work);
+            my_row_offsets.push_back(my_storage.chunks.size());
+        }
+        shrink();
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    void shrink() {
+        my_storage.chunks.shrink_to_fit();
+        my_storage.arrays.shrink_to_fit();
+        my_storage.bitmaps.shrink_to_fit();
+    }
+
+public:
+    /**
+     * @return Number of sets.
+     */
+    size_t num_rows() const {
+        return my_row_offsets.size() - 1;
+    }
+
+    /**
+     * @param i Index of the set.
+     * @return View of the set.
+     */
+    HybridView row(size_t i) const {
+        auto start = my_row_offsets[i];
+        return HybridView(my_storage.chunks.data() + start, my_row_offsets[i + 1] - start, my_storage.arrays.data(), my_storage.bitmaps.data());
+    }
+
+    /**
+     * @return Approximate number of bytes used to store all sets.
+     */
+    size_t memory_usage() const {
+        return my_storage.chunks.size() * sizeof(internal::HybridChunk)
+            + my_storage.arrays.size() * sizeof(uint16_t)
+            + my_storage.bitmaps.size() * sizeof(uint64_t)
+            + my_row_offsets.size() * sizeof(uint64_t);
+    }
+
+private:
+    internal::HybridStorage my_storage;
+    std::vector<uint64_t> my_row_offsets;
+};
+
+}
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef GESEL_INTERSECT_HPP
+#define GESEL_INTERSECT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "intersect_kernels.hpp"
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * Finds the first position in [start, end) with a value no less than 'target', by doubling the step size from 'start' before switching to a binary search.
+ * This is efficient when the target is expected to be close to 'start', as is the case when stepping through a much shorter sorted list.
+ */
+template<typename Value_>
+const Value_* gallop(const Value_* start, const Value_* end, Value_ target) {
+    size_t step = 1;
+    const Value_* lower = start;
+    const Value_* upper = start;
+    while (upper < end && *upper < target) {
+        lower = upper + 1;
+        if (static_cast<size_t>(end - upper) <= step) {
+            upper = end;
+            break;
+        }
+        upper += step;
+        step *= 2;
+    }
+    return std::lower_bound(lower, upper, target);
+}
+
+/*
+ * Intersection of two sorted and unique arrays, stored in 'output'.
+ * Each element of the shorter array is located in the longer array by galloping from the previous match,
+ * so the cost is proportional to the length of the shorter array multiplied by the log-gap between its consecutive elements.
+ */
+template<typename Value_>
+void intersect_galloping(const Value_* left, size_t left_size, const Value_* right, size_t right_size, std::vector<Value_>& output) {
+    output.clear();
+    if (left_size > right_size) {
+        std::swap(left, right);
+        std::swap(left_size, right_size);
+    }
+
+    const Value_* current = right;
+    const Value_* right_end = right + right_size;
+    for (size_t i = 0; i < left_size && current < right_end; ++i) {
+        auto target = left[i];
+        current = gallop(current, right_end, target);
+        if (current < right_end && *current == target) {
+            output.push_back(target);
+            ++current;
+        }
+    }
+}
+
+/*
+ * Galloping is faster than a linear merge once the longer array is this many times longer than the shorter array,
+ * as most of the longer array can be skipped; see benchmarks/src/intersect.cpp.
+ */
+constexpr size_t galloping_ratio = 16;
+
+/*
+ * Intersection of two sorted and unique arrays, stored in 'output'.
+ * This uses galloping for skewed lengths and the best available merge kernel otherwise.
+ */
+template<typename Value_>
+void intersect_pair(const Value_* left, size_t left_size, const Value_* right, size_t right_size, std::vector<Value_>& output) {
+    auto shorter = std::min(left_size, right_size), longer = std::max(left_size, right_size);
+    if (shorter * galloping_ratio < longer) {
+        intersect_galloping(left, left_size, right, right_size, output);
+        return;
+    }
+    output.resize(intersect_capacity(left_size, right_size));
+    output.resize(intersect_kernel<true>(left, left_size, right, right_size, output.data()));
+}
+
+/*
+ * Size of the intersection of two sorted and unique arrays, without storing the intersection itself.
+ */
+template<typename Value_>
+size_t intersect_count(const Value_* left, size_t left_size, const Value_* right, size_t right_size) {
+    if (left_size > right_size) {
+        std::swap(left, right);
+        std::swap(left_size, right_size);
+    }
+    if (left_size * galloping_ratio >= right_size) {
+        return intersect_kernel<false>(left, left_size, right, right_size, static_cast<Value_*>(NULL));
+    }
+
+    size_t count = 0;
+    const Value_* current = right;
+    const Value_* right_end = right + right_size;
+    for (size_t i = 0; i < left_size && current < right_end; ++i) {
+        auto target = left[i];
+        current = gallop(current, right_end, target);
+        if (current < right_end && *current == target) {
+            ++count;
+            ++current;
+        }
+    }
+    return count;
+}
+
+/*
+ * Union of two sorted and unique arrays, stored in 'output'.
+ */
+template<typename Value_>
+void union_pair(const Value_* left, size_t left_size, const Value_* right, size_t right_size, std::vector<Value_>& output) {
+    output.resize(union_capacity(left_size, right_size));
+    output.resize(union_kernel(left, left_size, right, right_size, output.data()));
+}
+
+/*
+ * Intersection of multiple sorted and unique arrays.
+ * Arrays are processed from smallest to largest so that the running intersection stays as short as possible.
+ * 'Range_' should have data() and size() methods, e.g., a std::vector or a Span.
+ */
+template<typename Value_, class Range_>
+std::vector<Value_> intersect_sorted(const std::vector<Range_>& ranges) {
+    std::vector<Value_> output;
+    if (ranges.empty()) {
+        return output;
+    }
+
+    std::vector<size_t> order(ranges.size());
+    for (size_t i = 0, end = ranges.size(); i < end; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t left, size_t right) -> bool { return ranges[left].size() < ranges[right].size(); });
+
+    const auto& first = ranges[order[0]];
+    output.assign(first.data(), first.data() + first.size());
+    std::vector<Value_> buffer;
+    for (size_t i = 1, end = order.size(); i < end && !output.empty(); ++i) {
+        const auto& next = ranges[order[i]];
+        intersect_pair(output.data(), output.size(), next.data(), next.size(), buffer);
+        output.swap(buffer);
+    }
+
+    return output;
+}
+
+/*
+ * Union of multiple sorted and unique arrays.
+ * 'Range_' should have data() and size() methods.
+ * Wildcards can expand to many arrays, so we concatenate and sort once rather than merging each array in turn.
+ */
+template<typename Value_, class Range_>
+std::vector<Value_> union_sorted(const std::vector<Range_>& ranges) {
+    std::vector<Value_> output;
+    if (ranges.size() == 1) {
+        output.assign(ranges[0].data(), ranges[0].data() + ranges[0].size());
+        return output;
+    }
+    if (ranges.size() == 2) {
+        union_pair(ranges[0].data(), ranges[0].size(), ranges[1].data(), ranges[1].size(), output);
+        return output;
+    }
+
+    size_t total = 0;
+    for (const auto& r : ranges) {
+        total += r.size();
+    }
+    output.reserve(total);
+    for (const auto& r : ranges) {
+        output.insert(output.end(), r.data(), r.data() + r.size());
+    }
+    std::sort(output.begin(), output.end());
+    output.erase(std::unique(output.begin(), output.end()), output.end());
+    return output;
+}
+
+/*
+ * Removes all elements of the sorted 'candidates' that are not present in any of the sorted 'components', i.e., intersection with the union of the components.
+ * This avoids materializing the union, which is useful when the candidates are few and the components are long.
+ * Each component has its own cursor that only moves forward, so each component is traversed at most once with galloping steps.
+ */
+template<typename Value_, class Range_>
+void intersect_with_any(std::vector<Value_>& candidates, const std::vector<Range_>& components) {
+    const size_t num_components = components.size();
+    std::vector<const Value_*> cursors(num_components);
+    for (size_t c = 0; c < num_components; ++c) {
+        cursors[c] = components[c].data();
+    }
+
+    size_t kept = 0;
+    for (auto x : candidates) {
+        for (size_t c = 0; c < num_components; ++c) {
+            const auto& comp = components[c];
+            auto end = comp.data() + comp.size();
+            auto& cur = cursors[c];
+            cur = gallop(cur, end, x);
+            if (cur < end && *cur == x) {
+                candidates[kept] = x;
+                ++kept;
+                break;
+            }
+        }
+    }
+    candidates.resize(kept);
+}
+
+/*
+ * Intersection across groups, where each group is represented by the union of its sorted and unique arrays (e.g., all tokens matching a wildcard).
+ * Groups are processed in increasing order of their total length, and the union is only materialized for the first group.
+ * For each subsequent group, we either search each of its arrays for the remaining candidates or materialize its union and intersect, whichever is expected to be cheaper.
+ */
+template<typename Value_, class Range_>
+std::vector<Value_> intersect_unions(const std::vector<std::vector<Range_> >& groups) {
+    std::vector<Value_> output;
+    const size_t num_groups = groups.size();
+    if (num_groups == 0) {
+        return output;
+    }
+
+    std::vector<size_t> totals(num_groups);
+    std::vector<size_t> order(num_groups);
+    for (size_t g = 0; g < num_groups; ++g) {
+        for (const auto& r : groups[g]) {
+            totals[g] += r.size();
+        }
+        order[g] = g;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t left, size_t right) -> bool { return totals[left] < totals[right]; });
+
+    output = union_sorted<Value_>(groups[order[0]]);
+    std::vector<Value_> buffer;
+    for (size_t i = 1; i < num_groups && !output.empty(); ++i) {
+        const auto& group = groups[order[i]];
+        if (group.size() == 1) {
+            const auto& only = group.front();
+            intersect_pair(output.data(), output.size(), only.data(), only.size(), buffer);
+            output.swap(buffer);
+        } else if (output.size() * group.size() <= totals[order[i]]) {
+            intersect_with_any(output, group);
+        } else {
+            auto merged = union_sorted<Value_>(group);
+            intersect_pair(output.data(), output.size(), merged.data(), merged.size(), buffer);
+            output.swap(buffer);
+        }
+    }
+
+    return output;
+}
+
+}
+
+}
+
+#endif
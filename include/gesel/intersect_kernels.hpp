@@ -0,0 +1,386 @@
+#ifndef GESEL_INTERSECT_KERNELS_HPP
+#define GESEL_INTERSECT_KERNELS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Vectorized kernels are only compiled for GCC-compatible compilers on x86,
+ * where we can use function-level target attributes to compile them without requiring any special flags for the rest of the library.
+ * The appropriate kernel is then chosen at run time based on the instruction sets supported by the CPU.
+ * Users can define GESEL_NO_SIMD to force the use of the scalar kernels.
+ */
+#if !defined(GESEL_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GESEL_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * All kernels accept sorted and unique arrays and return the number of values in the result.
+ * If 'store_ = true', the result is written to 'output', which should have space for at least 'intersect_capacity()' or 'union_capacity()' values;
+ * the vectorized kernels write whole vectors at a time, so the extra space is needed even if not all of it is used.
+ */
+inline size_t intersect_capacity(size_t left_size, size_t right_size) {
+    return (left_size < right_size ? left_size : right_size) + 4;
+}
+
+inline size_t union_capacity(size_t left_size, size_t right_size) {
+    return left_size + right_size + 4;
+}
+
+/*
+ * Scalar kernels, usable for any ordered type.
+ */
+template<bool store_, typename Value_>
+size_t intersect_scalar(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+    size_t i = 0, j = 0, count = 0;
+    while (i < left_size && j < right_size) {
+        auto l = left[i], r = right[j];
+        if (l < r) {
+            ++i;
+        } else {
+            if (!(r < l)) {
+                if constexpr(store_) {
+                    output[count] = l;
+                }
+                ++count;
+                ++i;
+            }
+            ++j;
+        }
+    }
+    return count;
+}
+
+/*
+ * Appends the union of the two arrays to 'output[count:]', skipping any value that is equal to 'output[count - 1]'.
+ * This allows the vectorized kernels to hand over to this function for the tail of the merge.
+ */
+template<typename Value_>
+size_t union_scalar_tail(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output, size_t count) {
+    size_t i = 0, j = 0;
+    auto push = [&](Value_ x) -> void {
+        if (count == 0 || output[count - 1] != x) {
+            output[count] = x;
+            ++count;
+        }
+    };
+    while (i < left_size && j < right_size) {
+        auto l = left[i], r = right[j];
+        if (l < r) {
+            push(l);
+            ++i;
+        } else if (r < l) {
+            push(r);
+            ++j;
+        } else {
+            push(l);
+            ++i;
+            ++j;
+        }
+    }
+    for (; i < left_size; ++i) {
+        push(left[i]);
+    }
+    for (; j < right_size; ++j) {
+        push(right[j]);
+    }
+    return count;
+}
+
+template<typename Value_>
+size_t union_scalar(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+    return union_scalar_tail(left, left_size, right, right_size, output, 0);
+}
+
+#ifdef GESEL_X86_SIMD
+
+struct SimdSupport {
+    bool sse41 = false;
+    bool avx2 = false;
+};
+
+inline const SimdSupport& simd_support() {
+    static const SimdSupport support = []() -> SimdSupport {
+        SimdSupport output;
+        __builtin_cpu_init();
+        bool popcnt = __builtin_cpu_supports("popcnt");
+        output.sse41 = popcnt && __builtin_cpu_supports("sse4.1");
+        output.avx2 = popcnt && __builtin_cpu_supports("avx2");
+        return output;
+    }();
+    return support;
+}
+
+/*
+ * Shuffle masks that pack the selected 32-bit lanes of a 128-bit vector to the front, for each of the 16 possible lane masks.
+ */
+struct PackTable32 {
+    PackTable32() {
+        for (int mask = 0; mask < 16; ++mask) {
+            int pos = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    for (int b = 0; b < 4; ++b) {
+                        bytes[mask][pos * 4 + b] = lane * 4 + b;
+                    }
+                    ++pos;
+                }
+            }
+            for (int b = pos * 4; b < 16; ++b) {
+                bytes[mask][b] = 0x80; // zeroes the remaining bytes.
+            }
+        }
+    }
+    alignas(16) uint8_t bytes[16][16];
+};
+
+/*
+ * Permutation indices that pack the selected 64-bit lanes of a 256-bit vector to the front, for each of the 16 possible lane masks.
+ */
+struct PackTable64 {
+    PackTable64() {
+        for (int mask = 0; mask < 16; ++mask) {
+            int pos = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                if (mask & (1 << lane)) {
+                    indices[mask][pos * 2] = lane * 2;
+                    indices[mask][pos * 2 + 1] = lane * 2 + 1;
+                    ++pos;
+                }
+            }
+            for (int i = pos * 2; i < 8; ++i) {
+                indices[mask][i] = 0;
+            }
+        }
+    }
+    alignas(32) int32_t indices[16][8];
+};
+
+inline const PackTable32& pack_table32() {
+    static const PackTable32 table;
+    return table;
+}
+
+inline const PackTable64& pack_table64() {
+    static const PackTable64 table;
+    return table;
+}
+
+/*
+ * Block-wise intersection of 32-bit values, comparing each block of 4 values from 'left' against all rotations of a block of 4 values from 'right'.
+ * The block with the smaller maximum is then discarded, as it cannot match anything in the remaining blocks of the other array.
+ */
+template<bool store_, typename Value_>
+__attribute__((target("sse4.1,popcnt")))
+size_t intersect_sse41(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+    static_assert(sizeof(Value_) == 4 && std::is_unsigned<Value_>::value);
+    const auto& table = pack_table32();
+    size_t i = 0, j = 0, count = 0;
+
+    while (i + 4 <= left_size && j + 4 <= right_size) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + j));
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))))
+        );
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(hits));
+        if constexpr(store_) {
+            __m128i packed = _mm_shuffle_epi8(va, _mm_load_si128(reinterpret_cast<const __m128i*>(table.bytes[mask])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + count), packed);
+        }
+        count += __builtin_popcount(mask);
+
+        auto amax = left[i + 3], bmax = right[j + 3];
+        if (amax <= bmax) {
+            i += 4;
+        }
+        if (bmax <= amax) {
+            j += 4;
+        }
+    }
+
+    if constexpr(store_) {
+        return count + intersect_scalar<true>(left + i, left_size - i, right + j, right_size - j, output + count);
+    } else {
+        return count + intersect_scalar<false>(left + i, left_size - i, right + j, right_size - j, output);
+    }
+}
+
+/*
+ * Same as above but for 64-bit values, using 256-bit vectors so that each block still contains 4 values.
+ */
+template<bool store_, typename Value_>
+__attribute__((target("avx2,popcnt")))
+size_t intersect_avx2(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+    static_assert(sizeof(Value_) == 8 && std::is_unsigned<Value_>::value);
+    const auto& table = pack_table64();
+    size_t i = 0, j = 0, count = 0;
+
+    while (i + 4 <= left_size && j + 4 <= right_size) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + j));
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi64(va, vb), _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm256_or_si256(_mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(1, 0, 3, 2))), _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(2, 1, 0, 3))))
+        );
+        int mask = _mm256_movemask_pd(_mm256_castsi256_pd(hits));
+        if constexpr(store_) {
+            __m256i packed = _mm256_permutevar8x32_epi32(va, _mm256_load_si256(reinterpret_cast<const __m256i*>(table.indices[mask])));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + count), packed);
+        }
+        count += __builtin_popcount(mask);
+
+        auto amax = left[i + 3], bmax = right[j + 3];
+        if (amax <= bmax) {
+            i += 4;
+        }
+        if (bmax <= amax) {
+            j += 4;
+        }
+    }
+
+    if constexpr(store_) {
+        return count + intersect_scalar<true>(left + i, left_size - i, right + j, right_size - j, output + count);
+    } else {
+        return count + intersect_scalar<false>(left + i, left_size - i, right + j, right_size - j, output);
+    }
+}
+
+/*
+ * Merges two sorted vectors of 4 values into the 4 smallest ('lower') and 4 largest ('upper') values, using a rotating min/max network.
+ */
+__attribute__((target("sse4.1,popcnt")))
+inline void merge_sse41(__m128i a, __m128i b, __m128i& lower, __m128i& upper) {
+    __m128i tmp = _mm_min_epu32(a, b);
+    upper = _mm_max_epu32(a, b);
+    tmp = _mm_alignr_epi8(tmp, tmp, 4);
+    lower = _mm_min_epu32(tmp, upper);
+    upper = _mm_max_epu32(tmp, upper);
+    tmp = _mm_alignr_epi8(lower, lower, 4);
+    lower = _mm_min_epu32(tmp, upper);
+    upper = _mm_max_epu32(tmp, upper);
+    tmp = _mm_alignr_epi8(lower, lower, 4);
+    lower = _mm_min_epu32(tmp, upper);
+    upper = _mm_max_epu32(tmp, upper);
+    lower = _mm_alignr_epi8(lower, lower, 4);
+}
+
+/*
+ * Stores the values in 'current' that are not equal to their predecessor, where the predecessor of the first value is the last value of 'previous'.
+ * If 'first = true', the first value is always stored.
+ */
+template<typename Value_>
+__attribute__((target("sse4.1,popcnt")))
+size_t store_unique_sse41(__m128i current, __m128i previous, bool first, const PackTable32& table, Value_* output) {
+    __m128i shifted = _mm_alignr_epi8(current, previous, 12); // i.e., [previous[3], current[0], current[1], current[2]].
+    int duplicated = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(current, shifted)));
+    if (first) {
+        duplicated &= ~1;
+    }
+    int keep = (~duplicated) & 15;
+    __m128i packed = _mm_shuffle_epi8(current, _mm_load_si128(reinterpret_cast<const __m128i*>(table.bytes[keep])));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), packed);
+    return __builtin_popcount(keep);
+}
+
+/*
+ * Union of 32-bit values by repeatedly merging the pending upper half with the next block from whichever array has the smaller head.
+ * Each merged lower half is stored after removing values that are equal to their predecessor, which handles values that are present in both arrays.
+ */
+template<typename Value_>
+__attribute__((target("sse4.1,popcnt")))
+size_t union_sse41(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+    static_assert(sizeof(Value_) == 4 && std::is_unsigned<Value_>::value);
+    if (left_size < 4 || right_size < 4) {
+        return union_scalar(left, left_size, right, right_size, output);
+    }
+
+    const auto& table = pack_table32();
+    size_t count = 0;
+    __m128i lower, upper;
+    merge_sse41(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(left)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(right)),
+        lower,
+        upper
+    );
+    count += store_unique_sse41(lower, lower, true, table, output + count);
+    __m128i previous = lower;
+
+    size_t i = 4, j = 4;
+    while (i + 4 <= left_size && j + 4 <= right_size) {
+        __m128i next;
+        if (left[i] < right[j]) {
+            next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+            i += 4;
+        } else {
+            next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + j));
+            j += 4;
+        }
+        merge_sse41(next, upper, lower, upper);
+        count += store_unique_sse41(lower, previous, false, table, output + count);
+        previous = lower;
+    }
+
+    // Merging the pending upper half with the leftovers of both arrays.
+    alignas(16) Value_ pending[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(pending), upper);
+    Value_ shorter[8];
+    const Value_* short_ptr = left + i;
+    size_t short_size = left_size - i;
+    const Value_* long_ptr = right + j;
+    size_t long_size = right_size - j;
+    if (short_size > long_size) {
+        std::swap(short_ptr, long_ptr);
+        std::swap(short_size, long_size);
+    }
+    size_t num_shorter = union_scalar(pending, 4, short_ptr, short_size, shorter); // short_size < 4, so this fits in 8.
+    return union_scalar_tail(shorter, num_shorter, long_ptr, long_size, output, count);
+}
+
+#endif
+
+/*
+ * Dispatchers that choose the best available kernel for the value type and CPU.
+ */
+template<bool store_, typename Value_>
+size_t intersect_kernel(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+#ifdef GESEL_X86_SIMD
+    if constexpr(std::is_unsigned<Value_>::value && sizeof(Value_) == 4) {
+        if (simd_support().sse41) {
+            return intersect_sse41<store_>(left, left_size, right, right_size, output);
+        }
+    } else if constexpr(std::is_unsigned<Value_>::value && sizeof(Value_) == 8) {
+        if (simd_support().avx2) {
+            return intersect_avx2<store_>(left, left_size, right, right_size, output);
+        }
+    }
+#endif
+    return intersect_scalar<store_>(left, left_size, right, right_size, output);
+}
+
+template<typename Value_>
+size_t union_kernel(const Value_* left, size_t left_size, const Value_* right, size_t right_size, Value_* output) {
+#ifdef GESEL_X86_SIMD
+    if constexpr(std::is_unsigned<Value_>::value && sizeof(Value_) == 4) {
+        if (simd_support().sse41) {
+            return union_sse41(left, left_size, right, right_size, output);
+        }
+    }
+#endif
+    return union_scalar(left, left_size, right, right_size, output);
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,387 @@
+#ifndef GESEL_LINE_CACHE_HPP
+#define GESEL_LINE_CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include "ranged_file.hpp"
+#include "fetch_ranges.hpp"
+
+/**
+ * @file line_cache.hpp
+ * @brief Cache the decoded indices of frequently requested lines.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Options for `LineCache`.
+ */
+struct LineCacheOptions {
+    /**
+     * Maximum number of bytes used by the cached entries.
+     * This is split evenly across the shards, so each shard evicts its least recently used entries once it exceeds its share.
+     */
+    uint64_t max_bytes = 64 * 1024 * 1024;
+
+    /**
+     * Number of shards, each with its own lock.
+     * More shards reduce contention between threads at the cost of a less accurate LRU ordering across the entire cache.
+     */
+    int num_shards = 16;
+};
+
+/**
+ * @brief Statistics for a `LineCache`.
+ */
+struct LineCacheStatistics {
+    /**
+     * Number of lookups that were found in the cache.
+     */
+    uint64_t hits = 0;
+
+    /**
+     * Number of lookups that were not found in the cache.
+     */
+    uint64_t misses = 0;
+
+    /**
+     * Number of entries that were evicted to stay within the byte budget.
+     */
+    uint64_t evictions = 0;
+
+    /**
+     * Number of entries currently in the cache.
+     */
+    uint64_t entries = 0;
+
+    /**
+     * Number of bytes currently used by the cached entries.
+     */
+    uint64_t bytes = 0;
+};
+
+/**
+ * @brief Thread-safe LRU cache of decoded lines.
+ *
+ * Each entry is keyed by a file identifier and a line index, and holds the decoded indices for that line, e.g., from `RangedFile::read_indices()`.
+ * Entries are distributed across multiple shards based on the hash of their key, where each shard is protected by its own lock and has its own byte budget.
+ * Entries are returned as shared pointers so that eviction does not invalidate indices that are still in use.
+ * The same cache can be shared by multiple files, see `CachedIndices`.
+ */
+class LineCache {
+public:
+    /**
+     * Shared pointer to the decoded indices for a line.
+     */
+    typedef std::shared_ptr<const std::vector<uint64_t> > Value;
+
+    /**
+     * @param options Further options.
+     */
+    LineCache(const LineCacheOptions& options = LineCacheOptions()) {
+        size_t num_shards = std::max(options.num_shards, 1);
+        my_shards.reserve(num_shards);
+        for (size_t s = 0; s < num_shards; ++s) {
+            my_shards.emplace_back(new Shard);
+        }
+        my_shard_budget = options.max_bytes / num_shards;
+    }
+
+public:
+    /**
+     * @return A new identifier for a file, to be used in `get()`.
+     * Identifiers are unique for the lifetime of this cache.
+     */
+    uint64_t register_file() {
+        return my_next_file.fetch_add(1);
+    }
+
+    /**
+     * Get the decoded indices for a line, loading them if they are not already in the cache.
+     * The loader is called without holding any locks, so concurrent misses for the same line may load it more than once;
+     * only the first result to be inserted is retained.
+     *
+     * @tparam Load_ Function that accepts no arguments and returns a `std::vector<uint64_t>`.
+     * @param file Identifier for the file, from `register_file()`.
+     * @param line Index of the line.
+     * @param load Function to load the decoded indices for this line.
+     * @return The decoded indices for this line.
+     */
+    template<class Load_>
+    Value get(uint64_t file, uint64_t line, Load_ load) {
+        Key key{ file, line };
+        auto& shard = choose_shard(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            auto found = lookup(shard, key);
+            if (found) {
+                return found;
+            }
+        }
+        return insert(shard, key, std::make_shared<const std::vector<uint64_t> >(load()));
+    }
+
+    /**
+     * Get the decoded indices for multiple lines, loading all missing lines in a single batch.
+     * This allows the loader to coalesce nearby lines into a single read, e.g., with `RangedFile::read_indices()` or `LineFetcher::fetch_indices()`.
+     *
+     * @tparam LoadBatch_ Function that accepts a `const std::vector<size_t>&` of line indices and returns a `std::vector<std::vector<uint64_t> >` containing the decoded indices for each line.
+     * @param file Identifier for the file, from `register_file()`.
+     * @param lines Indices of the lines.
+     * These need not be sorted or unique.
+     * @param load Function to load the decoded indices for the missing lines.
+     * This is not called if all lines are found in the cache.
+     * @return The decoded indices for each line in `lines`.
+     */
+    template<class LoadBatch_>
+    std::vector<Value> get(uint64_t file, const std::vector<size_t>& lines, LoadBatch_ load) {
+        const size_t num_lines = lines.size();
+        std::vector<Value> output(num_lines);
+        std::vector<size_t> missing, missing_lines;
+        std::unordered_map<size_t, size_t> first_missing;
+
+        for (size_t i = 0; i < num_lines; ++i) {
+            Key key{ file, lines[i] };
+            auto& shard = choose_shard(key);
+            std::lock_guard<std::mutex> lock(shard.lock);
+            output[i] = lookup(shard, key);
+            if (!output[i]) {
+                missing.push_back(i);
+                if (first_missing.emplace(lines[i], missing_lines.size()).second) {
+                    missing_lines.push_back(lines[i]);
+                }
+            }
+        }
+
+        if (missing_lines.empty()) {
+            return output;
+        }
+
+        auto loaded = load(missing_lines);
+        if (loaded.size() != missing_lines.size()) {
+            throw std::runtime_error("number of loaded lines is not equal to the number of requested lines");
+        }
+        std::vector<Value> inserted;
+        inserted.reserve(missing_lines.size());
+        for (size_t m = 0, end = missing_lines.size(); m < end; ++m) {
+            Key key{ file, missing_lines[m] };
+            inserted.push_back(insert(choose_shard(key), key, std::make_shared<const std::vector<uint64_t> >(std::move(loaded[m]))));
+        }
+        for (auto i : missing) {
+            output[i] = inserted[first_missing[lines[i]]];
+        }
+        return output;
+    }
+
+    /**
+     * Remove all entries from the cache.
+     * The hit, miss and eviction counters are not affected.
+     */
+    void clear() {
+        for (auto& shard : my_shards) {
+            std::lock_guard<std::mutex> lock(shard->lock);
+            shard->order.clear();
+            shard->entries.clear();
+            shard->bytes = 0;
+        }
+    }
+
+    /**
+     * @return Current statistics for the cache, summed across all shards.
+     */
+    LineCacheStatistics statistics() const {
+        LineCacheStatistics output;
+        for (const auto& shard : my_shards) {
+            std::lock_guard<std::mutex> lock(shard->lock);
+            output.hits += shard->hits;
+            output.misses += shard->misses;
+            output.evictions += shard->evictions;
+            output.entries += shard->entries.size();
+            output.bytes += shard->bytes;
+        }
+        return output;
+    }
+
+    /**
+     * @param value Decoded indices for a line.
+     * @return Number of bytes charged against the budget for this entry.
+     * This includes an estimate of the bookkeeping overhead for each entry.
+     */
+    static uint64_t entry_bytes(const std::vector<uint64_t>& value) {
+        constexpr uint64_t overhead = 128; // list node, hash map node, shared pointer control block and vector header.
+        return overhead + value.size() * sizeof(uint64_t);
+    }
+
+private:
+    struct Key {
+        uint64_t file;
+        uint64_t line;
+        bool operator==(const Key& other) const {
+            return file == other.file && line == other.line;
+        }
+    };
+
+    // Mixing both fields, as the identity hash for integers would send consecutive lines to consecutive shards and buckets.
+    static uint64_t mix(const Key& key) {
+        uint64_t x = key.line + 0x9e3779b97f4a7c15ull * (key.file + 1);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return mix(key);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        Value value;
+        uint64_t bytes;
+    };
+
+    // Most recently used entries are at the front of the list.
+    struct Shard {
+        mutable std::mutex lock;
+        std::list<Entry> order;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+        uint64_t bytes = 0;
+        uint64_t hits = 0, misses = 0, evictions = 0;
+    };
+
+    Shard& choose_shard(const Key& key) {
+        return *my_shards[(mix(key) >> 32) % my_shards.size()];
+    }
+
+    // Should be called while holding the shard's lock.
+    static Value lookup(Shard& shard, const Key& key) {
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            ++shard.misses;
+            return Value();
+        }
+        ++shard.hits;
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        return it->second->value;
+    }
+
+    Value insert(Shard& shard, const Key& key, Value value) {
+        auto bytes = entry_bytes(*value);
+        if (bytes > my_shard_budget) {
+            return value; // too large to cache without evicting everything else.
+        }
+
+        std::lock_guard<std::mutex> lock(shard.lock);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) {
+            return it->second->value; // another thread got here first.
+        }
+
+        shard.order.push_front(Entry{ key, value, bytes });
+        shard.entries.emplace(key, shard.order.begin());
+        shard.bytes += bytes;
+
+        while (shard.bytes > my_shard_budget) {
+            const auto& last = shard.order.back();
+            shard.bytes -= last.bytes;
+            shard.entries.erase(last.key);
+            shard.order.pop_back();
+            ++shard.evictions;
+        }
+
+        return value;
+    }
+
+private:
+    std::vector<std::unique_ptr<Shard> > my_shards;
+    uint64_t my_shard_budget;
+    std::atomic<uint64_t> my_next_file = 0;
+};
+
+/**
+ * @brief Cached random access to the decoded indices of a database file.
+ *
+ * This places a `LineCache` in front of a `RangedFile` or `LineFetcher`,
+ * so that repeated requests for the same lines (e.g., popular genes or sets) are served from memory.
+ * Multiple instances can share the same cache, in which case they share the same byte budget.
+ * All methods can be safely called from multiple threads.
+ */
+class CachedIndices {
+public:
+    /**
+     * Function that accepts a `const std::vector<size_t>&` of line indices and returns a `std::vector<std::vector<uint64_t> >` of decoded indices for each line.
+     */
+    typedef std::function<std::vector<std::vector<uint64_t> >(const std::vector<size_t>&)> Loader;
+
+    /**
+     * @param cache Cache to store the decoded indices.
+     * @param loader Function to load the decoded indices for lines that are not in the cache.
+     */
+    CachedIndices(std::shared_ptr<LineCache> cache, Loader loader) :
+        my_cache(std::move(cache)), my_loader(std::move(loader)), my_file(my_cache->register_file()) {}
+
+    /**
+     * @param cache Cache to store the decoded indices.
+     * @param file File containing delta-encoded indices, e.g., `gene2set.tsv` or `set2gene.tsv`.
+     */
+    CachedIndices(std::shared_ptr<LineCache> cache, std::shared_ptr<const RangedFile> file) :
+        CachedIndices(std::move(cache), [file](const std::vector<size_t>& lines) -> std::vector<std::vector<uint64_t> > { return file->read_indices(lines); }) {}
+
+    /**
+     * @param cache Cache to store the decoded indices.
+     * @param fetcher Fetcher for a remote file containing delta-encoded indices.
+     * @param options Options for fetching lines that are not in the cache.
+     */
+    CachedIndices(std::shared_ptr<LineCache> cache, std::shared_ptr<const LineFetcher> fetcher, const FetchLinesOptions& options = FetchLinesOptions()) :
+        CachedIndices(std::move(cache), [fetcher,options](const std::vector<size_t>& lines) -> std::vector<std::vector<uint64_t> > { return fetcher->fetch_indices(lines, options); }) {}
+
+public:
+    /**
+     * @param line Index of the line.
+     * @return The decoded indices for this line.
+     */
+    LineCache::Value get(size_t line) const {
+        return my_cache->get(my_file, line, [&]() -> std::vector<uint64_t> {
+            auto loaded = my_loader(std::vector<size_t>{ line });
+            return std::move(loaded.front());
+        });
+    }
+
+    /**
+     * @param lines Indices of the lines.
+     * These need not be sorted or unique.
+     * @return The decoded indices for each line in `lines`.
+     * Lines that are not in the cache are loaded in a single batch.
+     */
+    std::vector<LineCache::Value> get(const std::vector<size_t>& lines) const {
+        return my_cache->get(my_file, lines, my_loader);
+    }
+
+    /**
+     * @return The underlying cache.
+     */
+    const std::shared_ptr<LineCache>& cache() const {
+        return my_cache;
+    }
+
+private:
+    std::shared_ptr<LineCache> my_cache;
+    Loader my_loader;
+    uint64_t my_file;
+};
+
+}
+
+#endif
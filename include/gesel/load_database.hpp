@@ -0,0 +1,440 @@
+#ifndef GESEL_LOAD_DATABASE_HPP
+#define GESEL_LOAD_DATABASE_HPP
+
+#include "validate_database.hpp"
+#include "check_collection_details.hpp"
+#include "check_set_details.hpp"
+#include "flat_indices.hpp"
+#include "hybrid_set.hpp"
+#include "token_dictionary.hpp"
+#include "parallelize.hpp"
+#include "span.hpp"
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include <limits>
+#include <utility>
+
+/**
+ * @file load_database.hpp
+ * @brief Load database files into memory.
+ */
+
+namespace gesel {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Strings are concatenated into a single buffer to avoid the overhead of a separate allocation for each string.
+ */
+class StringColumn {
+public:
+    StringColumn() : my_offsets(1) {}
+
+    void push_back(std::string_view x) {
+        my_bytes.insert(my_bytes.end(), x.begin(), x.end());
+        my_offsets.push_back(my_bytes.size());
+    }
+
+    std::string_view operator[](size_t i) const {
+        return std::string_view(my_bytes.data() + my_offsets[i], my_offsets[i + 1] - my_offsets[i]);
+    }
+
+    void reserve(size_t n) {
+        my_offsets.reserve(n + 1);
+    }
+
+private:
+    std::string my_bytes;
+    std::vector<uint64_t> my_offsets;
+};
+
+template<typename Index_>
+struct DatabaseContents {
+    FlatIndices<Index_> set2gene, gene2set;
+    bool has_hybrid = false;
+    HybridIndices set2gene_hybrid, gene2set_hybrid;
+
+    StringColumn set_name, set_description;
+    std::vector<Index_> set_collection;
+
+    StringColumn collection_title, collection_description, collection_maintainer, collection_source;
+    std::vector<uint64_t> collection_species, collection_size, collection_start;
+};
+
+template<typename Index_>
+Span<Index_> flat_row(const FlatIndices<Index_>& flat, size_t i) {
+    auto start = flat.offsets[i];
+    return Span<Index_>(flat.values.data() + start, flat.offsets[i + 1] - start);
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief In-memory representation of a Gesel database.
+ *
+ * Mappings between sets and genes are stored in compressed sparse row form, while the collection and set details are stored as a struct of arrays.
+ * All accessors are constant-time.
+ * Instances should be created with `load_database()`.
+ *
+ * @tparam Index_ Integer type of the set and gene indices.
+ */
+template<typename Index_ = uint32_t>
+class Database {
+public:
+    /**
+     * @cond
+     */
+    Database(internal::DatabaseContents<Index_> contents) : my_contents(std::move(contents)) {}
+    /**
+     * @endcond
+     */
+
+public:
+    /**
+     * @return Number of genes.
+     */
+    size_t num_genes() const {
+        return my_contents.gene2set.offsets.size() - 1;
+    }
+
+    /**
+     * @return Number of sets.
+     */
+    size_t num_sets() const {
+        return my_contents.set2gene.offsets.size() - 1;
+    }
+
+    /**
+     * @return Number of collections.
+     */
+    size_t num_collections() const {
+        return my_contents.collection_start.size();
+    }
+
+public:
+    /**
+     * @param set Set index.
+     * @return Sorted indices of the genes in this set.
+     */
+    Span<Index_> genes_in_set(size_t set) const {
+        return internal::flat_row(my_contents.set2gene, set);
+    }
+
+    /**
+     * @param gene Gene index.
+     * @return Sorted indices of the sets containing this gene.
+     */
+    Span<Index_> sets_for_gene(size_t gene) const {
+        return internal::flat_row(my_contents.gene2set, gene);
+    }
+
+    /**
+     * @return Whether hybrid representations of the mappings are available, see `LoadDatabaseOptions::hybrid_mappings`.
+     */
+    bool has_hybrid_mappings() const {
+        return my_contents.has_hybrid;
+    }
+
+    /**
+     * This should only be called if `has_hybrid_mappings()` is true.
+     *
+     * @param set Set index.
+     * @return Indices of the genes in this set, as a hybrid set.
+     */
+    HybridView hybrid_genes_in_set(size_t set) const {
+        check_hybrid();
+        return my_contents.set2gene_hybrid.row(set);
+    }
+
+    /**
+     * This should only be called if `has_hybrid_mappings()` is true.
+     *
+     * @param gene Gene index.
+     * @return Indices of the sets containing this gene, as a hybrid set.
+     */
+    HybridView hybrid_sets_for_gene(size_t gene) const {
+        check_hybrid();
+        return my_contents.gene2set_hybrid.row(gene);
+    }
+
+private:
+    void check_hybrid() const {
+        if (!my_contents.has_hybrid) {
+            throw std::runtime_error("hybrid mappings were not loaded, see 'LoadDatabaseOptions::hybrid_mappings'");
+        }
+    }
+
+public:
+    /**
+     * @param set Set index.
+     * @return Name of the set.
+     */
+    std::string_view set_name(size_t set) const {
+        return my_contents.set_name[set];
+    }
+
+    /**
+     * @param set Set index.
+     * @return Description of the set.
+     */
+    std::string_view set_description(size_t set) const {
+        return my_contents.set_description[set];
+    }
+
+    /**
+     * @param set Set index.
+     * @return Number of genes in the set.
+     */
+    size_t set_size(size_t set) const {
+        return my_contents.set2gene.offsets[set + 1] - my_contents.set2gene.offsets[set];
+    }
+
+    /**
+     * @param set Set index.
+     * @return Index of the collection containing the set.
+     */
+    size_t set_collection(size_t set) const {
+        return my_contents.set_collection[set];
+    }
+
+    /**
+     * @param set Set index.
+     * @return Position of the set within its collection.
+     */
+    size_t set_position(size_t set) const {
+        return set - my_contents.collection_start[my_contents.set_collection[set]];
+    }
+
+public:
+    /**
+     * @param collection Collection index.
+     * @return Title of the collection.
+     */
+    std::string_view collection_title(size_t collection) const {
+        return my_contents.collection_title[collection];
+    }
+
+    /**
+     * @param collection Collection index.
+     * @return Description of the collection.
+     */
+    std::string_view collection_description(size_t collection) const {
+        return my_contents.collection_description[collection];
+    }
+
+    /**
+     * @param collection Collection index.
+     * @return NCBI taxonomy ID of the collection.
+     */
+    uint64_t collection_species(size_t collection) const {
+        return my_contents.collection_species[collection];
+    }
+
+    /**
+     * @param collection Collection index.
+     * @return Maintainer of the collection.
+     */
+    std::string_view collection_maintainer(size_t collection) const {
+        return my_contents.collection_maintainer[collection];
+    }
+
+    /**
+     * @param collection Collection index.
+     * @return Source of the collection.
+     */
+    std::string_view collection_source(size_t collection) const {
+        return my_contents.collection_source[collection];
+    }
+
+    /**
+     * @param collection Collection index.
+     * @return Number of sets in the collection.
+     */
+    size_t collection_size(size_t collection) const {
+        return my_contents.collection_size[collection];
+    }
+
+    /**
+     * @param collection Collection index.
+     * @return Set index of the first set in the collection.
+     */
+    size_t collection_start(size_t collection) const {
+        return my_contents.collection_start[collection];
+    }
+
+private:
+    internal::DatabaseContents<Index_> my_contents;
+};
+
+/**
+ * @brief Options for `load_database()`.
+ */
+struct LoadDatabaseOptions {
+    /**
+     * Whether to validate the database files while loading them.
+     * If true, this performs the same checks as `validate_database()` in the same pass through the files.
+     * Otherwise, only the uncompressed files are read and only basic formatting checks are performed.
+     */
+    bool validate = false;
+
+    /**
+     * Options for reading (and, if `validate = true`, validating) the files.
+     * `ValidateDatabaseOptions::fingerprint_mappings` is ignored as the reverse mapping is always materialized in memory.
+     */
+    ValidateDatabaseOptions read_options;
+
+    /**
+     * Whether to also store both mappings as `HybridIndices`, see `Database::hybrid_genes_in_set()` and `Database::hybrid_sets_for_gene()`.
+     * This enables fast intersections, unions and overlap counts for dense sets and frequently-used genes, at the cost of extra memory and loading time.
+     */
+    bool hybrid_mappings = false;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+template<bool validate_, typename Index_>
+void load_collections(const std::string& prefix, const SharedRanges& shared, DatabaseContents<Index_>& output, const ReaderOptions& read_opt) {
+    const auto& numbers = shared.collection_numbers;
+    size_t num_collections = numbers.size();
+    output.collection_title.reserve(num_collections);
+    output.collection_description.reserve(num_collections);
+    output.collection_maintainer.reserve(num_collections);
+    output.collection_source.reserve(num_collections);
+    output.collection_species.reserve(num_collections);
+
+    check_collection_details<validate_>(
+        prefix + "collections.tsv",
+        shared.collection_bytes,
+        numbers,
+        [&](uint64_t, std::string_view title, std::string_view description, uint64_t species, std::string_view maintainer, std::string_view source) -> void {
+            output.collection_title.push_back(title);
+            output.collection_description.push_back(description);
+            output.collection_species.push_back(species);
+            output.collection_maintainer.push_back(maintainer);
+            output.collection_source.push_back(source);
+        },
+        read_opt
+    );
+}
+
+template<bool validate_, typename Index_>
+void load_sets(const std::string& prefix, const SharedRanges& shared, DatabaseContents<Index_>& output, const ReaderOptions& read_opt) {
+    output.set_name.reserve(shared.total_sets);
+    output.set_description.reserve(shared.total_sets);
+    TokenCollector<Index_> collect_n, collect_d;
+
+    check_set_details<validate_>(
+        prefix + "sets.tsv",
+        shared.set_bytes,
+        shared.set_sizes,
+        [&](uint64_t line, std::string_view name, std::string_view description) -> void {
+            output.set_name.push_back(name);
+            output.set_description.push_back(description);
+            if constexpr(validate_) {
+                collect_n.add(line, name);
+                collect_d.add(line, description);
+            }
+        },
+        read_opt
+    );
+
+    if constexpr(validate_) {
+        check_token_files(prefix, shared.total_sets, collect_n, collect_d, read_opt);
+    }
+}
+
+template<bool validate_, typename Index_>
+void load_mappings(const std::string& prefix, uint64_t num_genes, const SharedRanges& shared, DatabaseContents<Index_>& output, const ReaderOptions& read_opt, bool hybrid) {
+    output.set2gene = load_set2gene<validate_, Index_>(prefix, num_genes, shared.total_sets, shared.set_sizes, read_opt);
+    output.gene2set = transpose_indices(output.set2gene, num_genes);
+    if constexpr(validate_) {
+        check_gene2set(prefix, num_genes, shared.total_sets, output.gene2set, read_opt);
+    }
+    if (hybrid) {
+        output.set2gene_hybrid = HybridIndices(output.set2gene);
+        output.gene2set_hybrid = HybridIndices(output.gene2set);
+        output.has_hybrid = true;
+    }
+}
+
+template<bool validate_, typename Index_>
+void load_database(const std::string& prefix, uint64_t num_genes, const SharedRanges& shared, DatabaseContents<Index_>& output, const LoadDatabaseOptions& options) {
+    auto read_opt = reader_options(options.read_options);
+    parallelize(options.read_options.num_threads, 3, [&](size_t stage) -> void {
+        if (stage == 0) {
+            load_collections<validate_>(prefix, shared, output, read_opt);
+        } else if (stage == 1) {
+            load_sets<validate_>(prefix, shared, output, read_opt);
+        } else {
+            load_mappings<validate_>(prefix, num_genes, shared, output, read_opt, options.hybrid_mappings);
+        }
+    });
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Load Gesel database files for a particular species into memory.
+ * The gene-to-set mapping is computed from `set2gene.tsv`, so `gene2set.tsv` is only read if `LoadDatabaseOptions::validate = true`.
+ *
+ * @tparam Index_ Integer type of the set and gene indices.
+ * This should be large enough to hold the number of genes, sets and collections.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param num_genes Total number of genes for this species.
+ * @param options Further options.
+ *
+ * @return The database in memory.
+ */
+template<typename Index_ = uint32_t>
+Database<Index_> load_database(const std::string& prefix, uint64_t num_genes, const LoadDatabaseOptions& options = LoadDatabaseOptions()) {
+    auto shared = internal::load_shared_ranges(prefix);
+
+    constexpr uint64_t limit = std::numeric_limits<Index_>::max();
+    if (num_genes > limit || shared.total_sets > limit || static_cast<uint64_t>(shared.collection_numbers.size()) > limit) {
+        throw std::runtime_error("number of genes, sets or collections does not fit in the index type");
+    }
+
+    internal::DatabaseContents<Index_> output;
+    const size_t num_collections = shared.collection_numbers.size();
+    output.collection_size = shared.collection_numbers;
+    output.collection_start.reserve(num_collections);
+    output.set_collection.reserve(shared.total_sets);
+    uint64_t start = 0;
+    for (size_t c = 0; c < num_collections; ++c) {
+        output.collection_start.push_back(start);
+        auto number = shared.collection_numbers[c];
+        output.set_collection.insert(output.set_collection.end(), number, c);
+        start += number;
+    }
+
+    if (options.validate) {
+        internal::load_database<true>(prefix, num_genes, shared, output, options);
+    } else {
+        internal::load_database<false>(prefix, num_genes, shared, output, options);
+    }
+
+    return Database<Index_>(std::move(output));
+}
+
+}
+
+#endif
@@ -28,9 +28,8 @@ inline void check_bytes(const std::vector<uint64_t>& bytes) {
     }
 }
 
-inline std::vector<uint64_t> load_ranges(const std::string& path) {
-    byteme::GzipFileReader reader(path.c_str(), {});
-    byteme::SerialBufferedReader<char, decltype(&reader)> pb(&reader, 65536);
+inline std::vector<uint64_t> load_ranges(byteme::Reader& reader, const std::string& path) {
+    byteme::SerialBufferedReader<char, byteme::Reader*> pb(&reader, 65536);
     std::vector<uint64_t> output;
 
     bool valid = pb.valid();
@@ -51,9 +50,13 @@ inline std::vector<uint64_t> load_ranges(const std::string& path) {
     return output;
 }
 
-inline std::pair<std::vector<uint64_t>, std::vector<uint64_t> > load_ranges_with_sizes(const std::string& path) {
+inline std::vector<uint64_t> load_ranges(const std::string& path) {
     byteme::GzipFileReader reader(path.c_str(), {});
-    byteme::SerialBufferedReader<char, decltype(&reader)> pb(&reader, 65536);
+    return load_ranges(reader, path);
+}
+
+inline std::pair<std::vector<uint64_t>, std::vector<uint64_t> > load_ranges_with_sizes(byteme::Reader& reader, const std::string& path) {
+    byteme::SerialBufferedReader<char, byteme::Reader*> pb(&reader, 65536);
     std::vector<uint64_t> output_byte, output_size;
 
     bool valid = pb.valid();
@@ -77,9 +80,13 @@ inline std::pair<std::vector<uint64_t>, std::vector<uint64_t> > load_ranges_with
     return std::make_pair(std::move(output_byte), std::move(output_size));
 }
 
-inline std::pair<std::vector<std::string>, std::vector<uint64_t> > load_named_ranges(const std::string& path) {
+inline std::pair<std::vector<uint64_t>, std::vector<uint64_t> > load_ranges_with_sizes(const std::string& path) {
     byteme::GzipFileReader reader(path.c_str(), {});
-    byteme::SerialBufferedReader<char, decltype(&reader)> pb(&reader, 65536);
+    return load_ranges_with_sizes(reader, path);
+}
+
+inline std::pair<std::vector<std::string>, std::vector<uint64_t> > load_named_ranges(byteme::Reader& reader, const std::string& path) {
+    byteme::SerialBufferedReader<char, byteme::Reader*> pb(&reader, 65536);
     std::vector<std::string> output_name; 
     std::vector<uint64_t> output_byte;
 
@@ -104,6 +111,11 @@ inline std::pair<std::vector<std::string>, std::vector<uint64_t> > load_named_ra
     return std::make_pair(std::move(output_name), std::move(output_byte));
 }
 
+inline std::pair<std::vector<std::string>, std::vector<uint64_t> > load_named_ranges(const std::string& path) {
+    byteme::GzipFileReader reader(path.c_str(), {});
+    return load_named_ranges(reader, path);
+}
+
 }
 
 }
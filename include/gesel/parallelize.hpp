@@ -0,0 +1,84 @@
+#ifndef GESEL_PARALLELIZE_HPP
+#define GESEL_PARALLELIZE_HPP
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * In the default implementation, tasks are claimed in increasing order, so a task could safely wait on the results of any earlier task.
+ * This is not guaranteed for a GESEL_CUSTOM_PARALLEL executor, so callers should not block on other tasks.
+ * If multiple tasks fail, we always rethrow the error from the earliest task, regardless of the timing of the threads.
+ *
+ * Users can define a GESEL_CUSTOM_PARALLEL function-like macro to use their own executor.
+ * This should accept the number of workers, the number of tasks and a function that accepts the task index;
+ * the function should be called exactly once for each task index in [0, num_tasks).
+ */
+template<class Function_>
+void parallelize(int num_workers, size_t num_tasks, Function_ fun) {
+    if (num_workers <= 1 || num_tasks <= 1) {
+        for (size_t t = 0; t < num_tasks; ++t) {
+            fun(t);
+        }
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(num_tasks);
+    auto run = [&](size_t t) -> void {
+        try {
+            fun(t);
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+#ifdef GESEL_CUSTOM_PARALLEL
+    GESEL_CUSTOM_PARALLEL(num_workers, num_tasks, run);
+#else
+    std::atomic<size_t> counter(0);
+    auto worker = [&]() -> void {
+        while (true) {
+            size_t t = counter.fetch_add(1);
+            if (t >= num_tasks) {
+                break;
+            }
+            run(t);
+        }
+    };
+
+    size_t num_threads = std::min(static_cast<size_t>(num_workers), num_tasks);
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    try {
+        for (size_t w = 1; w < num_threads; ++w) {
+            threads.emplace_back(worker);
+        }
+    } catch (...) {
+        // If we can't spin up more threads, we just make do with what we have.
+    }
+
+    worker();
+    for (auto& th : threads) {
+        th.join();
+    }
+#endif
+
+    for (const auto& err : errors) {
+        if (err) {
+            std::rethrow_exception(err);
+        }
+    }
+}
+
+}
+
+}
+
+#endif
@@ -5,9 +5,14 @@
 #include <limits>
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <stdexcept>
+#include <utility>
+#include <algorithm>
 
 #include "utils.hpp"
+#include "scan_bytes.hpp"
 
 namespace gesel {
 
@@ -15,9 +20,65 @@ namespace internal {
 
 enum class FieldType : char { LAST, MIDDLE, UNKNOWN }; 
 
+// Byte sources with chunk_pointer(), chunk_remaining() and skip() methods support multi-byte parsing of the current chunk.
+template<class ByteSource_, typename = int>
+struct has_chunk_access : std::false_type {};
+
+template<class ByteSource_>
+struct has_chunk_access<ByteSource_, decltype((void)std::declval<const ByteSource_&>().chunk_pointer(), 0)> : std::true_type {};
+
+/*
+ * Fast path for the common case where the entire field (and its delimiter) lies in the current chunk and is a valid integer.
+ * Anything else - including every error - is left to the byte-by-byte parser in parse_integer_field() so that the error messages are unchanged.
+ */
+template<FieldType type_, class ByteSource_>
+bool parse_integer_field_fast(ByteSource_& pb, bool& valid, uint64_t& number, bool& terminated) {
+    const char* ptr = pb.chunk_pointer();
+    constexpr size_t max_digits = 19; // any 19-digit number fits in a 64-bit integer.
+    size_t limit = std::min(pb.chunk_remaining(), max_digits + 1);
+    size_t ndigits = find_delimiter(ptr, limit);
+    if (ndigits == limit || ndigits == 0) {
+        return false;
+    }
+
+    char delim = ptr[ndigits];
+    if constexpr(type_ == FieldType::LAST) {
+        if (delim != '\n') {
+            return false;
+        }
+    } else if constexpr(type_ == FieldType::MIDDLE) {
+        if (delim != '\t') {
+            return false;
+        }
+    }
+
+    if (ndigits > 1 && ptr[0] == '0') {
+        return false;
+    }
+    if (!parse_digit_run(ptr, ndigits, number)) {
+        return false;
+    }
+
+    terminated = (delim == '\n');
+    valid = pb.skip(ndigits + 1);
+    return true;
+}
+
 template<FieldType type_, class ByteSource_>
 typename std::conditional<type_ == FieldType::UNKNOWN, std::pair<uint64_t, bool>, uint64_t>::type
 parse_integer_field(ByteSource_& pb, bool& valid, const std::string& path, uint64_t line) {
+    if constexpr(has_chunk_access<ByteSource_>::value) {
+        uint64_t number;
+        bool terminated;
+        if (parse_integer_field_fast<type_>(pb, valid, number, terminated)) {
+            if constexpr(type_ == FieldType::UNKNOWN) {
+                return std::make_pair(number, terminated);
+            } else {
+                return number;
+            }
+        }
+    }
+
     constexpr uint64_t threshold = std::numeric_limits<uint64_t>::max() / 10;
     constexpr uint64_t max_remainder = std::numeric_limits<uint64_t>::max() % 10;
 
@@ -49,7 +110,7 @@ parse_integer_field(ByteSource_& pb, bool& valid, const std::string& path, uint6
         }
 
         uint64_t delta = c - '0';
-        if (number == threshold && delta > max_remainder) {
+        if (number > threshold || (number == threshold && delta > max_remainder)) {
             throw std::runtime_error("integer overflow in '" + path + "' " + append_line_number(line));
         }
 
@@ -114,6 +175,162 @@ parse_string_field(ByteSource_& pb, bool& valid, const std::string& path, uint64
     }
 }
 
+
+/*
+ * Byte source for a single line, as extracted by read_line().
+ * The line is followed by its newline if it was terminated, so that parse_*_field() can be used on it with the usual error messages.
+ */
+class LineSource {
+public:
+    LineSource(const char* start, size_t length, bool terminated) : 
+        my_ptr(start), my_start(start), my_limit(start + length + terminated), my_length(length), my_terminated(terminated) {}
+
+    bool valid() const {
+        return my_ptr < my_limit;
+    }
+
+    char get() const {
+        return *my_ptr;
+    }
+
+    bool advance() {
+        ++my_ptr;
+        return my_ptr < my_limit;
+    }
+
+    unsigned long long position() const {
+        return my_ptr - my_start;
+    }
+
+    const char* chunk_pointer() const {
+        return my_ptr;
+    }
+
+    size_t chunk_remaining() const {
+        return my_limit - my_ptr;
+    }
+
+    bool skip(size_t n) {
+        my_ptr += n;
+        return my_ptr < my_limit;
+    }
+
+    // Number of bytes in the line, excluding the newline.
+    size_t length() const {
+        return my_length;
+    }
+
+    bool terminated() const {
+        return my_terminated;
+    }
+
+private:
+    const char* my_ptr;
+    const char* my_start;
+    const char* my_limit;
+    size_t my_length;
+    bool my_terminated;
+};
+
+/*
+ * Extracts the rest of the current line, leaving 'pb' on its terminating newline (or at the end of the stream, if there is no newline).
+ * If the line lies within the current chunk of 'pb', the returned source points directly into the reader's buffer; 
+ * otherwise, the line is copied into 'scratch'.
+ * Either way, the returned source is only valid until 'pb' is advanced past the newline, e.g., with finish_line().
+ */
+template<class ByteSource_>
+LineSource read_line(ByteSource_& pb, std::string& scratch) {
+    if constexpr(has_chunk_access<ByteSource_>::value) {
+        const char* ptr = pb.chunk_pointer();
+        size_t available = pb.chunk_remaining();
+        auto nl = static_cast<const char*>(std::memchr(ptr, '\n', available));
+        if (nl) {
+            size_t len = nl - ptr;
+            if (len) {
+                pb.skip(len); // this never triggers a refill as the newline is still in the current chunk.
+            }
+            return LineSource(ptr, len, true);
+        }
+
+        scratch.assign(ptr, available);
+        bool valid = pb.skip(available);
+        while (valid) {
+            ptr = pb.chunk_pointer();
+            available = pb.chunk_remaining();
+            nl = static_cast<const char*>(std::memchr(ptr, '\n', available));
+            if (nl) {
+                size_t len = nl - ptr;
+                scratch.append(ptr, len);
+                if (len) {
+                    pb.skip(len);
+                }
+                scratch += '\n';
+                return LineSource(scratch.data(), scratch.size() - 1, true);
+            }
+            scratch.append(ptr, available);
+            valid = pb.skip(available);
+        }
+
+    } else {
+        scratch.clear();
+        bool valid = pb.valid();
+        while (valid) {
+            char c = pb.get();
+            if (c == '\n') {
+                scratch += c;
+                return LineSource(scratch.data(), scratch.size() - 1, true);
+            }
+            scratch += c;
+            valid = pb.advance();
+        }
+    }
+
+    return LineSource(scratch.data(), scratch.size(), false);
+}
+
+template<class ByteSource_>
+bool finish_line(ByteSource_& pb, const LineSource& line) {
+    if (line.terminated()) {
+        return pb.advance();
+    } else {
+        return false;
+    }
+}
+
+/*
+ * Same as parse_string_field() but returns a view into the line, without any copying.
+ */
+template<FieldType type_>
+typename std::conditional<type_ == FieldType::UNKNOWN, std::pair<std::string_view, bool>, std::string_view>::type
+parse_string_view_field(LineSource& pb, bool& valid, const std::string& path, uint64_t line) {
+    const char* ptr = pb.chunk_pointer();
+    size_t available = pb.chunk_remaining();
+    size_t len = find_delimiter(ptr, available);
+
+    if (len == available) {
+        throw std::runtime_error("no terminating newline in '" + path + "' " + append_line_number(line));
+    }
+
+    char delim = ptr[len];
+    if constexpr(type_ == FieldType::LAST) {
+        if (delim != '\n') {
+            throw std::runtime_error("string containing a newline or tab in '" + path + "' " + append_line_number(line));
+        }
+    } else if constexpr(type_ == FieldType::MIDDLE) {
+        if (delim != '\t') {
+            throw std::runtime_error("string containing a newline or tab in '" + path + "' " + append_line_number(line));
+        }
+    }
+
+    valid = pb.skip(len + 1);
+    std::string_view value(ptr, len);
+    if constexpr(type_ == FieldType::UNKNOWN) {
+        return std::make_pair(value, delim == '\n');
+    } else {
+        return value;
+    }
+}
+
 }
 
 }
@@ -0,0 +1,473 @@
+#ifndef GESEL_RANGED_FILE_HPP
+#define GESEL_RANGED_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <utility>
+
+#include "load_ranges.hpp"
+#include "parse_field.hpp"
+#include "chunked_reader.hpp"
+
+#ifndef GESEL_HAS_MMAP
+#include <fstream>
+#include <mutex>
+#endif
+
+/**
+ * @file ranged_file.hpp
+ * @brief Random access to individual lines of the database files.
+ */
+
+namespace gesel {
+
+/**
+ * Format of the `*.ranges.gz` file accompanying each database file.
+ *
+ * - `BYTES`: each line contains the number of bytes, e.g., for `set2gene.tsv` or `gene2set.tsv`.
+ * - `BYTES_AND_NUMBER`: each line contains the number of bytes and another integer, e.g., the number of sets for `collections.tsv` or the set size for `sets.tsv`.
+ * - `NAME_AND_BYTES`: each line contains a name and the number of bytes, e.g., the token for `tokens-names.tsv` or `tokens-descriptions.tsv`.
+ */
+enum class RangesFormat : char { BYTES, BYTES_AND_NUMBER, NAME_AND_BYTES };
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Positional reads from a file, using pread() where available so that concurrent reads from multiple threads do not interfere.
+ */
+class PositionalFile {
+public:
+    PositionalFile(const std::string& path) : my_path(path) {
+#ifdef GESEL_HAS_MMAP
+        my_fd = ::open(path.c_str(), O_RDONLY);
+        if (my_fd < 0) {
+            throw std::runtime_error("failed to open file at '" + path + "'");
+        }
+        struct stat info;
+        if (fstat(my_fd, &info) != 0) {
+            ::close(my_fd);
+            throw std::runtime_error("failed to obtain the size of '" + path + "'");
+        }
+        my_size = info.st_size;
+#else
+        my_stream.reset(new std::ifstream(path, std::ios::binary));
+        if (!*my_stream) {
+            throw std::runtime_error("failed to open file at '" + path + "'");
+        }
+        my_stream->seekg(0, std::ios::end);
+        my_size = my_stream->tellg();
+        my_lock.reset(new std::mutex);
+#endif
+    }
+
+#ifdef GESEL_HAS_MMAP
+    ~PositionalFile() {
+        if (my_fd >= 0) {
+            ::close(my_fd);
+        }
+    }
+
+    PositionalFile(PositionalFile&& other) : my_path(std::move(other.my_path)), my_size(other.my_size), my_fd(other.my_fd) {
+        other.my_fd = -1;
+    }
+
+    PositionalFile& operator=(PositionalFile&& other) {
+        if (this != &other) {
+            if (my_fd >= 0) {
+                ::close(my_fd);
+            }
+            my_path = std::move(other.my_path);
+            my_size = other.my_size;
+            my_fd = other.my_fd;
+            other.my_fd = -1;
+        }
+        return *this;
+    }
+
+    PositionalFile(const PositionalFile&) = delete;
+    PositionalFile& operator=(const PositionalFile&) = delete;
+#endif
+
+public:
+    uint64_t size() const {
+        return my_size;
+    }
+
+    void read(uint64_t offset, size_t length, char* buffer) const {
+#ifdef GESEL_HAS_MMAP
+        while (length) {
+            auto n = ::pread(my_fd, buffer, length, offset);
+            if (n <= 0) {
+                throw std::runtime_error("failed to read bytes from '" + my_path + "'");
+            }
+            buffer += n;
+            offset += n;
+            length -= n;
+        }
+#else
+        std::lock_guard<std::mutex> lock(*my_lock);
+        my_stream->clear();
+        my_stream->seekg(offset);
+        if (!my_stream->read(buffer, length)) {
+            throw std::runtime_error("failed to read bytes from '" + my_path + "'");
+        }
+#endif
+    }
+
+private:
+    std::string my_path;
+    uint64_t my_size = 0;
+#ifdef GESEL_HAS_MMAP
+    int my_fd = -1;
+#else
+    std::unique_ptr<std::ifstream> my_stream;
+    std::unique_ptr<std::mutex> my_lock;
+#endif
+};
+
+/*
+ * Contents of a '*.ranges.gz' file, parsed according to its format.
+ * Only one of 'numbers' or 'names' is filled, depending on the format.
+ */
+struct LineRanges {
+    std::vector<uint64_t> bytes;
+    std::vector<uint64_t> numbers;
+    std::vector<std::string> names;
+};
+
+inline LineRanges load_line_ranges(byteme::Reader& reader, const std::string& path, RangesFormat format) {
+    LineRanges output;
+    if (format == RangesFormat::BYTES) {
+        output.bytes = load_ranges(reader, path);
+    } else if (format == RangesFormat::BYTES_AND_NUMBER) {
+        auto loaded = load_ranges_with_sizes(reader, path);
+        output.bytes = std::move(loaded.first);
+        output.numbers = std::move(loaded.second);
+    } else {
+        auto loaded = load_named_ranges(reader, path);
+        output.names = std::move(loaded.first);
+        output.bytes = std::move(loaded.second);
+    }
+    return output;
+}
+
+// Each line is followed by a newline, so the start of each line is the cumulative sum of the bytes plus one.
+inline std::vector<uint64_t> line_starts(const std::vector<uint64_t>& bytes) {
+    std::vector<uint64_t> starts;
+    starts.reserve(bytes.size() + 1);
+    uint64_t total = 0;
+    starts.push_back(total);
+    for (auto b : bytes) {
+        total += b + 1;
+        starts.push_back(total);
+    }
+    return starts;
+}
+
+inline size_t find_sorted_name(const std::vector<std::string>& names, std::string_view name) {
+    auto it = std::lower_bound(names.begin(), names.end(), name, [](const std::string& left, std::string_view right) -> bool { return left < right; });
+    if (it != names.end() && *it == name) {
+        return it - names.begin();
+    }
+    return names.size();
+}
+
+/*
+ * Decodes a line of delta-encoded indices into 'output'.
+ * 'ptr' should point to the start of the line, where 'ptr[length]' is the terminating newline.
+ * This uses the same parser as the validation functions, so malformed lines produce the same error messages.
+ */
+inline void decode_delta_line(const char* ptr, size_t length, std::vector<uint64_t>& output, const std::string& path, uint64_t line) {
+    output.clear();
+    if (length == 0) {
+        return;
+    }
+
+    LineSource source(ptr, length, true);
+    bool valid = true;
+    do {
+        auto status = parse_integer_field<FieldType::UNKNOWN>(source, valid, path, line);
+        output.push_back(status.first);
+        if (status.second) {
+            break;
+        }
+    } while (true);
+
+    for (size_t i = 1, end = output.size(); i < end; ++i) {
+        if (output[i] > std::numeric_limits<uint64_t>::max() - output[i - 1]) {
+            throw std::runtime_error("64-bit unsigned integer overflow for the cumulative sum in '" + path + "'" + append_line_number(line));
+        }
+        output[i] += output[i - 1];
+    }
+}
+
+/*
+ * Plans the reads for a batch of lines, given the cumulative byte offsets 'starts' of all lines in the file.
+ * Lines are sorted by their offsets and neighbouring lines are merged into a single request if the gap between them is no greater than 'max_gap'.
+ * Each request covers the lines at 'order[first]' to 'order[last - 1]', and spans the bytes from 'start' to 'end' (including the newline of the last line).
+ */
+struct LineRequest {
+    uint64_t start, end;
+    size_t first, last;
+};
+
+struct LinePlan {
+    std::vector<size_t> order;
+    std::vector<LineRequest> requests;
+};
+
+inline void check_line_index(size_t line, size_t num_lines) {
+    if (line >= num_lines) {
+        throw std::runtime_error("requested line " + std::to_string(line + 1) + " is out of range");
+    }
+}
+
+inline LinePlan plan_line_requests(const std::vector<uint64_t>& starts, const std::vector<size_t>& lines, uint64_t max_gap) {
+    const size_t num_lines = starts.size() - 1;
+    const size_t num_requested = lines.size();
+    LinePlan plan;
+    auto& order = plan.order;
+    order.resize(num_requested);
+    for (size_t i = 0; i < num_requested; ++i) {
+        check_line_index(lines[i], num_lines);
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t left, size_t right) -> bool { return lines[left] < lines[right]; });
+
+    size_t i = 0;
+    while (i < num_requested) {
+        size_t first = lines[order[i]];
+        size_t last = first;
+        size_t j = i + 1;
+        while (j < num_requested) {
+            size_t next = lines[order[j]];
+            if (next > last && starts[next] - starts[last + 1] > max_gap) {
+                break;
+            }
+            last = next;
+            ++j;
+        }
+        plan.requests.push_back(LineRequest{ starts[first], starts[last + 1], i, j });
+        i = j;
+    }
+
+    return plan;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Random access to lines of a database file.
+ *
+ * This uses the byte ranges in the accompanying `*.ranges.gz` file to read individual lines from the uncompressed database file,
+ * without loading the entire file into memory.
+ * Reads are performed with `pread()` where available, so all methods can be safely called from multiple threads.
+ */
+class RangedFile {
+public:
+    /**
+     * @param path Path to the uncompressed database file, e.g., `<PREFIX>gene2set.tsv`.
+     * The byte ranges are loaded from `<path>.ranges.gz`.
+     * @param format Format of the `*.ranges.gz` file.
+     */
+    RangedFile(std::string path, RangesFormat format = RangesFormat::BYTES) : my_path(std::move(path)), my_file(my_path) {
+        auto ranges_path = my_path + ".ranges.gz";
+        byteme::GzipFileReader reader(ranges_path.c_str(), {});
+        auto loaded = internal::load_line_ranges(reader, ranges_path, format);
+        my_numbers = std::move(loaded.numbers);
+        my_names = std::move(loaded.names);
+        initialize(loaded.bytes);
+    }
+
+    /**
+     * @param path Path to the uncompressed database file.
+     * @param bytes Number of bytes in each line of the file, excluding the newline.
+     */
+    RangedFile(std::string path, const std::vector<uint64_t>& bytes) : my_path(std::move(path)), my_file(my_path) {
+        internal::check_bytes(bytes);
+        initialize(bytes);
+    }
+
+private:
+    void initialize(const std::vector<uint64_t>& bytes) {
+        my_starts = internal::line_starts(bytes);
+        if (my_starts.back() != my_file.size()) {
+            throw std::runtime_error("size of '" + my_path + "' is not consistent with its '*.ranges.gz' file");
+        }
+    }
+
+public:
+    /**
+     * @return Number of lines in the file.
+     */
+    size_t num_lines() const {
+        return my_starts.size() - 1;
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @return Byte offset of the start of the line.
+     */
+    uint64_t line_start(size_t line) const {
+        internal::check_line_index(line, num_lines());
+        return my_starts[line];
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @return Number of bytes in the line, excluding the newline.
+     */
+    uint64_t line_length(size_t line) const {
+        internal::check_line_index(line, num_lines());
+        return my_starts[line + 1] - my_starts[line] - 1;
+    }
+
+    /**
+     * @return The second field of each line in the `*.ranges.gz` file, if `RangesFormat::BYTES_AND_NUMBER` was used; otherwise empty.
+     */
+    const std::vector<uint64_t>& numbers() const {
+        return my_numbers;
+    }
+
+    /**
+     * @return The first field of each line in the `*.ranges.gz` file, if `RangesFormat::NAME_AND_BYTES` was used; otherwise empty.
+     */
+    const std::vector<std::string>& names() const {
+        return my_names;
+    }
+
+    /**
+     * @param name Name of interest, e.g., a token.
+     * This assumes that the names are lexicographically sorted, as is the case for tokens.
+     * @return Index of the line with this name, or `num_lines()` if no such line exists.
+     */
+    size_t find_name(std::string_view name) const {
+        auto found = internal::find_sorted_name(my_names, name);
+        return (found == my_names.size() ? num_lines() : found);
+    }
+
+public:
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @param[out] output String in which to store the contents of the line, excluding the newline.
+     */
+    void read_line(size_t line, std::string& output) const {
+        auto len = line_length(line);
+        output.resize(len + 1);
+        my_file.read(my_starts[line], len + 1, output.data());
+        check_newline(output.data(), len, line);
+        output.pop_back();
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @return Contents of the line, excluding the newline.
+     */
+    std::string read_line(size_t line) const {
+        std::string output;
+        read_line(line, output);
+        return output;
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @param[out] output Vector in which to store the decoded indices, i.e., after reversing the delta encoding.
+     */
+    void read_indices(size_t line, std::vector<uint64_t>& output) const {
+        auto len = line_length(line);
+        std::vector<char> buffer(len + 1);
+        my_file.read(my_starts[line], len + 1, buffer.data());
+        check_newline(buffer.data(), len, line);
+        internal::decode_delta_line(buffer.data(), len, output, my_path, line);
+    }
+
+    /**
+     * @param line Index of the line.
+     * An error is thrown if this is not less than `num_lines()`.
+     * @return The decoded indices for this line.
+     */
+    std::vector<uint64_t> read_indices(size_t line) const {
+        std::vector<uint64_t> output;
+        read_indices(line, output);
+        return output;
+    }
+
+    /**
+     * Read multiple lines at once.
+     * Lines are sorted by their offsets and nearby lines are coalesced into a single read, to reduce the number of system calls.
+     *
+     * @tparam Function_ Function to be applied to each line.
+     * @param lines Indices of the lines to read.
+     * These need not be sorted or unique.
+     * @param fun Function that accepts `(i, contents)`, where `i` is the position of the line in `lines` and `contents` is a `std::string_view` of that line (excluding the newline).
+     * `contents` is only valid for the duration of the call.
+     * The order of calls is unspecified.
+     * @param max_gap Maximum number of unrequested bytes between two lines for them to be coalesced into a single read.
+     */
+    template<class Function_>
+    void read_lines(const std::vector<size_t>& lines, Function_ fun, uint64_t max_gap = 4096) const {
+        auto plan = internal::plan_line_requests(my_starts, lines, max_gap);
+        std::vector<char> buffer;
+        for (const auto& req : plan.requests) {
+            buffer.resize(req.end - req.start);
+            my_file.read(req.start, buffer.size(), buffer.data());
+            for (size_t i = req.first; i < req.last; ++i) {
+                auto o = plan.order[i];
+                size_t line = lines[o];
+                const char* ptr = buffer.data() + (my_starts[line] - req.start);
+                auto len = line_length(line);
+                check_newline(ptr, len, line);
+                fun(o, std::string_view(ptr, len));
+            }
+        }
+    }
+
+    /**
+     * @param lines Indices of the lines to read.
+     * These need not be sorted or unique.
+     * @return The decoded indices for each line in `lines`.
+     */
+    std::vector<std::vector<uint64_t> > read_indices(const std::vector<size_t>& lines) const {
+        std::vector<std::vector<uint64_t> > output(lines.size());
+        read_lines(lines, [&](size_t i, std::string_view contents) -> void {
+            internal::decode_delta_line(contents.data(), contents.size(), output[i], my_path, lines[i]);
+        });
+        return output;
+    }
+
+private:
+    void check_newline(const char* ptr, uint64_t len, size_t line) const {
+        if (ptr[len] != '\n') {
+            throw std::runtime_error("line in '" + my_path + "' is not consistent with its '*.ranges.gz' file" + internal::append_line_number(line));
+        }
+    }
+
+private:
+    std::string my_path;
+    internal::PositionalFile my_file;
+    std::vector<uint64_t> my_starts;
+    std::vector<uint64_t> my_numbers;
+    std::vector<std::string> my_names;
+};
+
+}
+
+#endif
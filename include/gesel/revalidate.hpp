@@ -0,0 +1,665 @@
+#ifndef GESEL_REVALIDATE_HPP
+#define GESEL_REVALIDATE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include <charconv>
+#include <cstdio>
+
+#include "validate_database.hpp"
+#include "validate_genes.hpp"
+
+/**
+ * @file revalidate.hpp
+ * @brief Revalidate files that have changed since a previous validation.
+ */
+
+namespace gesel {
+
+/**
+ * @brief State of a single file at the time of its last successful validation.
+ */
+struct ManifestFile {
+    /**
+     * Size of the file in bytes.
+     */
+    uint64_t size = 0;
+
+    /**
+     * Last modification time of the file, in ticks of the file system clock since its epoch.
+     */
+    int64_t mtime = 0;
+
+    /**
+     * 64-bit hash of the file contents.
+     */
+    uint64_t hash = 0;
+};
+
+/**
+ * @brief Manifest of previously validated files.
+ *
+ * This records the state of each file at its last successful validation, along with values derived from those files that are used in the cross-file checks.
+ * Instances are typically created with `load_manifest()` and updated by `revalidate_genes()` or `revalidate_database()`.
+ */
+struct ValidationManifest {
+    /**
+     * State of each validated file, keyed by its path.
+     */
+    std::map<std::string, ManifestFile> files;
+
+    /**
+     * Derived values from the validated files, e.g., the number of genes or fingerprints of the set-gene mappings.
+     * Each value is keyed by the path of the file that it was derived from, or by the prefix for values that are derived from multiple files.
+     */
+    std::map<std::string, std::vector<uint64_t> > values;
+};
+
+/**
+ * @brief Options for `revalidate_genes()` and `revalidate_database()`.
+ */
+struct RevalidateOptions {
+    /**
+     * Whether to hash the contents of every file to determine whether it has changed.
+     * If false, a file is assumed to be unchanged if its size and modification time are the same as those in the manifest,
+     * and only files with a different size or modification time are hashed.
+     */
+    bool verify_contents = false;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+constexpr char manifest_magic[] = "gesel-manifest";
+
+inline uint64_t rotate_left(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/*
+ * Hashes bytes in four independent lanes so that the multiplications can be pipelined, following the structure of xxHash64.
+ * Only used to detect changes to files between validations, so it does not need to be stable across platforms.
+ */
+class ContentHasher {
+public:
+    void add(const char* data, size_t n) {
+        my_total += n;
+        if (my_buffered) {
+            size_t take = std::min(n, sizeof(my_buffer) - my_buffered);
+            std::memcpy(my_buffer + my_buffered, data, take);
+            my_buffered += take;
+            data += take;
+            n -= take;
+            if (my_buffered < sizeof(my_buffer)) {
+                return;
+            }
+            consume(my_buffer);
+            my_buffered = 0;
+        }
+
+        while (n >= sizeof(my_buffer)) {
+            consume(data);
+            data += sizeof(my_buffer);
+            n -= sizeof(my_buffer);
+        }
+        std::memcpy(my_buffer, data, n);
+        my_buffered = n;
+    }
+
+    uint64_t finish() const {
+        uint64_t h = rotate_left(my_lanes[0], 1) + rotate_left(my_lanes[1], 7) + rotate_left(my_lanes[2], 12) + rotate_left(my_lanes[3], 18);
+        h = mix_index(h ^ my_total);
+        for (size_t i = 0; i < my_buffered; ++i) {
+            h = mix_index(h ^ static_cast<unsigned char>(my_buffer[i]));
+        }
+        return h;
+    }
+
+private:
+    static constexpr uint64_t prime1 = 0x9e3779b185ebca87ULL, prime2 = 0xc2b2ae3d27d4eb4fULL;
+
+    void consume(const char* block) {
+        for (int l = 0; l < 4; ++l) {
+            uint64_t word;
+            std::memcpy(&word, block + l * 8, 8);
+            my_lanes[l] = rotate_left(my_lanes[l] + word * prime2, 31) * prime1;
+        }
+    }
+
+    uint64_t my_lanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+    char my_buffer[32];
+    size_t my_buffered = 0;
+    uint64_t my_total = 0;
+};
+
+inline uint64_t hash_file(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("failed to open file at '" + path + "'");
+    }
+
+    ContentHasher hasher;
+    std::vector<char> buffer(1048576);
+    while (input) {
+        input.read(buffer.data(), buffer.size());
+        hasher.add(buffer.data(), input.gcount());
+    }
+    return hasher.finish();
+}
+
+inline uint64_t hash_string(std::string_view x) {
+    ContentHasher hasher;
+    hasher.add(x.data(), x.size());
+    return hasher.finish();
+}
+
+/*
+ * Checks whether a file has changed since it was recorded in the manifest, storing its current state in 'current'.
+ * Missing files are always reported as changed, so that the subsequent validation fails with the usual error.
+ */
+inline bool file_changed(const std::string& path, const ValidationManifest& manifest, const RevalidateOptions& options, ValidationManifest& current) {
+    std::error_code ec;
+    ManifestFile state;
+    state.size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return true;
+    }
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return true;
+    }
+    state.mtime = mtime.time_since_epoch().count();
+
+    auto it = manifest.files.find(path);
+    bool changed = true;
+    if (it != manifest.files.end() && it->second.size == state.size) {
+        if (!options.verify_contents && it->second.mtime == state.mtime) {
+            state.hash = it->second.hash;
+            changed = false;
+        } else {
+            state.hash = hash_file(path);
+            changed = (state.hash != it->second.hash);
+        }
+    } else {
+        state.hash = hash_file(path);
+    }
+
+    current.files[path] = state;
+    return changed;
+}
+
+/*
+ * If any file in the group has changed, all files in the group will be validated together.
+ * In that case, we hash any file that was assumed to be unchanged from its size and modification time,
+ * so that the manifest records the contents that were actually validated.
+ */
+inline bool any_file_changed(const std::string& path, const std::vector<std::string>& suffixes, const ValidationManifest& manifest, const RevalidateOptions& options, ValidationManifest& current) {
+    bool changed = false;
+    for (const auto& suffix : suffixes) {
+        changed = file_changed(path + suffix, manifest, options, current) || changed; // not short-circuiting, so that all states are recorded.
+    }
+    if (changed && !options.verify_contents) {
+        for (const auto& suffix : suffixes) {
+            auto it = current.files.find(path + suffix);
+            if (it == current.files.end()) {
+                continue;
+            }
+            auto previous = manifest.files.find(it->first);
+            if (previous != manifest.files.end() && previous->second.size == it->second.size && previous->second.mtime == it->second.mtime) {
+                it->second.hash = hash_file(it->first);
+            }
+        }
+    }
+    return changed;
+}
+
+inline const std::vector<uint64_t>* find_value(const ValidationManifest& manifest, const std::string& key) {
+    auto it = manifest.values.find(key);
+    if (it == manifest.values.end()) {
+        return NULL;
+    }
+    return &(it->second);
+}
+
+inline bool same_value(const ValidationManifest& manifest, const std::string& key, const std::vector<uint64_t>& value) {
+    auto found = find_value(manifest, key);
+    return found && *found == value;
+}
+
+inline void add_to_digest(IndexFingerprint& digest, uint64_t key, const IndexFingerprint& fp) {
+    key = mix_index(key ^ mix_index(fp.count));
+    ++digest.count;
+    digest.first += mix_index(key ^ fp.first);
+    digest.second += mix_index(key ^ fp.second ^ 0x5851f42d4c957f2dULL);
+}
+
+inline std::vector<uint64_t> digest_values(const IndexFingerprint& digest) {
+    return std::vector<uint64_t>{ digest.count, digest.first, digest.second };
+}
+
+/*
+ * Digest of the per-gene fingerprints from either mapping file; identical mappings yield identical digests.
+ */
+inline std::vector<uint64_t> digest_fingerprints(const std::vector<IndexFingerprint>& fingerprints) {
+    IndexFingerprint digest;
+    for (size_t g = 0, end = fingerprints.size(); g < end; ++g) {
+        add_to_digest(digest, g, fingerprints[g]);
+    }
+    return digest_values(digest);
+}
+
+template<typename Index_>
+std::vector<uint64_t> digest_tokens(const TokenDictionary<Index_>& dictionary) {
+    IndexFingerprint digest;
+    const auto& sets = dictionary.sets;
+    for (size_t t = 0, end = dictionary.tokens.size(); t < end; ++t) {
+        IndexFingerprint fp;
+        for (auto i = sets.offsets[t], iend = sets.offsets[t + 1]; i < iend; ++i) {
+            add_to_fingerprint(fp, sets.values[i]);
+        }
+        add_to_digest(digest, hash_string(dictionary.tokens[t]), fp);
+    }
+    return digest_values(digest);
+}
+
+inline std::vector<uint64_t> digest_set_sizes(const std::vector<uint64_t>& set_sizes) {
+    ContentHasher hasher;
+    hasher.add(reinterpret_cast<const char*>(set_sizes.data()), set_sizes.size() * sizeof(uint64_t));
+    return std::vector<uint64_t>{ static_cast<uint64_t>(set_sizes.size()), hasher.finish() };
+}
+
+/*
+ * Revalidates the set details and the token files.
+ * If the set details have changed but a token file has not, we compare a digest of the re-derived tokens to the digest recorded for the token file.
+ * If only a token file has changed, we still need to re-derive the tokens from the set details, but we can skip its Gzip-compressed twin.
+ */
+template<typename Index_>
+void revalidate_sets_and_tokens(
+    const std::string& prefix,
+    const SharedRanges& shared,
+    bool sets_changed,
+    const std::vector<bool>& tokens_changed,
+    const ValidationManifest& manifest,
+    ValidationManifest& current,
+    std::vector<std::string>& reread,
+    const ReaderOptions& read_opt)
+{
+    TokenCollector<Index_> collect_n, collect_d;
+    auto add = [&](uint64_t line, std::string_view name, std::string_view description) -> void {
+        collect_n.add(line, name);
+        collect_d.add(line, description);
+    };
+    auto sets_path = prefix + "sets.tsv";
+    if (sets_changed) {
+        check_set_details<true>(sets_path, shared.set_bytes, shared.set_sizes, add, read_opt);
+    } else {
+        check_set_details<false>(sets_path, shared.set_bytes, shared.set_sizes, add, read_opt);
+    }
+    reread.push_back("sets.tsv");
+
+    for (int tt = 0; tt < 2; ++tt) {
+        std::string type = (tt == 0 ? "names" : "descriptions");
+        auto dictionary = (tt == 0 ? collect_n : collect_d).finish();
+        auto digest = digest_tokens(dictionary);
+        auto key = prefix + "tokens-" + type + ".tsv";
+        if (tokens_changed[tt] || !same_value(manifest, key, digest)) {
+            check_token_file(prefix, type, shared.total_sets, dictionary, read_opt);
+            reread.push_back("tokens-" + type + ".tsv");
+        }
+        current.values[key] = std::move(digest);
+    }
+}
+
+inline void revalidate_sets_and_tokens(
+    const std::string& prefix,
+    const SharedRanges& shared,
+    bool sets_changed,
+    const std::vector<bool>& tokens_changed,
+    const ValidationManifest& manifest,
+    ValidationManifest& current,
+    std::vector<std::string>& reread,
+    const ReaderOptions& read_opt)
+{
+    if (shared.total_sets <= std::numeric_limits<uint32_t>::max()) {
+        revalidate_sets_and_tokens<uint32_t>(prefix, shared, sets_changed, tokens_changed, manifest, current, reread, read_opt);
+    } else {
+        revalidate_sets_and_tokens<uint64_t>(prefix, shared, sets_changed, tokens_changed, manifest, current, reread, read_opt);
+    }
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Load a manifest from file.
+ *
+ * @param path Path to the manifest file, as created by `save_manifest()`.
+ * @return The manifest.
+ * If `path` does not exist, an empty manifest is returned, which causes all files to be validated.
+ */
+inline ValidationManifest load_manifest(const std::string& path) {
+    ValidationManifest manifest;
+    if (!std::filesystem::exists(path)) {
+        return manifest;
+    }
+
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("failed to open manifest file at '" + path + "'");
+    }
+
+    std::string line;
+    uint64_t line_number = 0;
+    std::vector<std::string_view> fields;
+    auto fail = [&]() -> std::runtime_error {
+        return std::runtime_error("invalid manifest file at '" + path + "' " + internal::append_line_number(line_number));
+    };
+    auto parse = [&](std::string_view field, auto& value) -> void {
+        auto res = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (res.ec != std::errc() || res.ptr != field.data() + field.size()) {
+            throw fail();
+        }
+    };
+
+    while (std::getline(input, line)) {
+        fields.clear();
+        std::string_view remaining(line);
+        while (true) {
+            auto tab = remaining.find('\t');
+            fields.push_back(remaining.substr(0, tab));
+            if (tab == std::string_view::npos) {
+                break;
+            }
+            remaining.remove_prefix(tab + 1);
+        }
+
+        if (line_number == 0) {
+            if (fields.size() != 2 || fields[0] != internal::manifest_magic || fields[1] != "1") {
+                throw fail();
+            }
+        } else if (fields[0] == "file") {
+            if (fields.size() != 5) {
+                throw fail();
+            }
+            ManifestFile state;
+            parse(fields[2], state.size);
+            parse(fields[3], state.mtime);
+            parse(fields[4], state.hash);
+            manifest.files[std::string(fields[1])] = state;
+        } else if (fields[0] == "value") {
+            if (fields.size() < 2) {
+                throw fail();
+            }
+            auto& value = manifest.values[std::string(fields[1])];
+            value.resize(fields.size() - 2);
+            for (size_t f = 2, end = fields.size(); f < end; ++f) {
+                parse(fields[f], value[f - 2]);
+            }
+        } else {
+            throw fail();
+        }
+        ++line_number;
+    }
+
+    if (line_number == 0) {
+        throw fail();
+    }
+    return manifest;
+}
+
+/**
+ * Save a manifest to file.
+ * The manifest is written to a temporary file and then renamed, so that an interrupted save does not leave a partially written manifest.
+ *
+ * @param manifest The manifest, typically after a call to `revalidate_genes()` or `revalidate_database()`.
+ * @param path Path to the manifest file.
+ */
+inline void save_manifest(const ValidationManifest& manifest, const std::string& path) {
+    auto tmppath = path + ".tmp";
+    {
+        std::ofstream output(tmppath, std::ios::binary | std::ios::trunc);
+        if (!output) {
+            throw std::runtime_error("failed to open manifest file at '" + tmppath + "'");
+        }
+
+        auto check_key = [&](const std::string& key) -> void {
+            if (key.find_first_of("\t\n") != std::string::npos) {
+                throw std::runtime_error("paths in the manifest should not contain tabs or newlines");
+            }
+        };
+
+        output << internal::manifest_magic << "\t1\n";
+        for (const auto& entry : manifest.files) {
+            check_key(entry.first);
+            output << "file\t" << entry.first << "\t" << entry.second.size << "\t" << entry.second.mtime << "\t" << entry.second.hash << "\n";
+        }
+        for (const auto& entry : manifest.values) {
+            check_key(entry.first);
+            output << "value\t" << entry.first;
+            for (auto v : entry.second) {
+                output << "\t" << v;
+            }
+            output << "\n";
+        }
+
+        if (!output) {
+            throw std::runtime_error("failed to write manifest file at '" + tmppath + "'");
+        }
+    }
+
+    if (std::rename(tmppath.c_str(), path.c_str()) != 0) {
+        std::remove(tmppath.c_str());
+        throw std::runtime_error("failed to rename manifest file to '" + path + "'");
+    }
+}
+
+/**
+ * Revalidate Gesel gene mapping files for a particular species, skipping files that have not changed since the last successful validation.
+ * Each changed file is validated with the same checks as `validate_genes()`, and its number of genes is compared to the recorded numbers for the unchanged files.
+ *
+ * @param prefix Prefix for the Gesel gene mapping files, see `validate_genes()`.
+ * @param types Vector of gene name types, e.g., `"ensembl"`, `"symbol"`.
+ * This should contain at least one value.
+ * @param manifest Manifest from a previous validation, or an empty manifest.
+ * On success, this is updated with the state of the gene mapping files.
+ * On failure, this is left unchanged.
+ * @param options Further options.
+ *
+ * @return Number of genes.
+ */
+inline uint64_t revalidate_genes(const std::string& prefix, const std::vector<std::string>& types, ValidationManifest& manifest, const RevalidateOptions& options = RevalidateOptions()) {
+    if (types.empty()) {
+        throw std::runtime_error("at least one gene name type should be present");
+    }
+
+    ValidationManifest current;
+    uint64_t num_genes = 0;
+    for (size_t i = 0, end = types.size(); i < end; ++i) {
+        const auto& t = types[i];
+        auto path = prefix + t + ".tsv.gz";
+        uint64_t candidate;
+        auto cached = internal::find_value(manifest, path);
+        if (internal::file_changed(path, manifest, options, current) || !cached || cached->size() != 1) {
+            candidate = internal::check_genes(path);
+        } else {
+            candidate = cached->front();
+        }
+        current.values[path] = std::vector<uint64_t>{ candidate };
+
+        if (i == 0) {
+            num_genes = candidate;
+        } else if (candidate != num_genes) {
+            throw std::runtime_error("inconsistent number of genes between types (" + std::to_string(num_genes) + " for " + types.front() + ", " + std::to_string(candidate) + " for " + t + ")");
+        }
+    }
+
+    for (auto& entry : current.files) {
+        manifest.files[entry.first] = entry.second;
+    }
+    for (auto& entry : current.values) {
+        manifest.values[entry.first] = std::move(entry.second);
+    }
+    return num_genes;
+}
+
+/**
+ * Revalidate Gesel database files for a particular species, skipping files that have not changed since the last successful validation.
+ * This performs the same checks as `validate_database()` with `ValidateDatabaseOptions::fingerprint_mappings = true`,
+ * but uses values recorded in the manifest in place of those derived from unchanged files:
+ *
+ * - The collection details are only checked if any of the `collections.tsv` files have changed.
+ * - The set details are only fully checked if any of the `sets.tsv` files have changed.
+ *   If only the token files have changed, the tokens are derived from `sets.tsv` without checking its Gzip-compressed twin.
+ * - Each token file is only checked if it has changed, or if the tokens derived from `sets.tsv` differ from those recorded for the token file.
+ * - `set2gene.tsv` is only checked if its files have changed or if the number of genes, the total number of sets or the set sizes are different.
+ *   Similarly, `gene2set.tsv` is only checked if its files have changed or if the number of genes or total number of sets are different.
+ *   If only one of these files needs to be checked, its fingerprints are compared to those recorded for the other file.
+ *
+ * The `*.ranges.gz` files for the collections and sets are always loaded if any file has changed, as these are needed by the other checks.
+ * If no file has changed and the number of genes is the same, no files are read.
+ *
+ * @param prefix Prefix for the Gesel database files, see `validate_database()`.
+ * @param num_genes Total number of genes for this species.
+ * @param manifest Manifest from a previous validation, or an empty manifest.
+ * On success, this is updated with the state of the database files.
+ * On failure, this is left unchanged.
+ * @param options Further options for validation.
+ * `ValidateDatabaseOptions::fingerprint_mappings` is ignored.
+ * @param revalidate_options Further options for revalidation.
+ *
+ * @return Names of the files (without the prefix) that were read in full, excluding the `*.ranges.gz` files.
+ */
+inline std::vector<std::string> revalidate_database(
+    const std::string& prefix,
+    uint64_t num_genes,
+    ValidationManifest& manifest,
+    const ValidateDatabaseOptions& options,
+    const RevalidateOptions& revalidate_options = RevalidateOptions())
+{
+    ValidationManifest current;
+    const std::vector<std::string> all_suffixes{ "", ".gz", ".ranges.gz" };
+    bool collections_changed = internal::any_file_changed(prefix + "collections.tsv", all_suffixes, manifest, revalidate_options, current);
+    bool sets_changed = internal::any_file_changed(prefix + "sets.tsv", all_suffixes, manifest, revalidate_options, current);
+    std::vector<bool> tokens_changed(2);
+    tokens_changed[0] = internal::any_file_changed(prefix + "tokens-names.tsv", { "", ".ranges.gz" }, manifest, revalidate_options, current);
+    tokens_changed[1] = internal::any_file_changed(prefix + "tokens-descriptions.tsv", { "", ".ranges.gz" }, manifest, revalidate_options, current);
+    bool s2g_changed = internal::any_file_changed(prefix + "set2gene.tsv", all_suffixes, manifest, revalidate_options, current);
+    bool g2s_changed = internal::any_file_changed(prefix + "gene2set.tsv", all_suffixes, manifest, revalidate_options, current);
+
+    std::vector<std::string> reread;
+    std::vector<uint64_t> gene_value{ num_genes };
+    bool genes_changed = !internal::same_value(manifest, prefix + "num_genes", gene_value);
+    bool anything_changed = collections_changed || sets_changed || tokens_changed[0] || tokens_changed[1] || s2g_changed || g2s_changed || genes_changed;
+
+    if (anything_changed) {
+        auto shared = internal::load_shared_ranges(prefix);
+        const auto total_sets = shared.total_sets;
+        std::vector<uint64_t> total_value{ total_sets };
+        auto sizes_value = internal::digest_set_sizes(shared.set_sizes);
+        bool totals_changed = genes_changed || !internal::same_value(manifest, prefix + "total_sets", total_value);
+        bool check_s2g = s2g_changed || totals_changed || !internal::same_value(manifest, prefix + "set_sizes", sizes_value);
+        bool check_g2s = g2s_changed || totals_changed;
+        auto mapping_key = prefix + "mappings";
+        if (!internal::find_value(manifest, mapping_key)) {
+            check_s2g = true;
+            check_g2s = true;
+        }
+
+        auto names_key = prefix + "tokens-names.tsv", descriptions_key = prefix + "tokens-descriptions.tsv";
+        bool check_sets = sets_changed || tokens_changed[0] || tokens_changed[1] || !internal::find_value(manifest, names_key) || !internal::find_value(manifest, descriptions_key);
+
+        auto read_opt = internal::reader_options(options);
+        std::vector<std::string> stage_reread[4];
+        std::vector<internal::IndexFingerprint> s2g_fingerprints, g2s_fingerprints;
+
+        internal::parallelize(options.num_threads, 4, [&](size_t stage) -> void {
+            if (stage == 0) {
+                if (collections_changed) {
+                    internal::check_collection_details(prefix + "collections.tsv", shared.collection_bytes, shared.collection_numbers, read_opt);
+                    stage_reread[0].push_back("collections.tsv");
+                }
+            } else if (stage == 1) {
+                if (check_sets) {
+                    internal::revalidate_sets_and_tokens(prefix, shared, sets_changed, tokens_changed, manifest, current, stage_reread[1], read_opt);
+                }
+            } else if (stage == 2) {
+                if (check_s2g) {
+                    s2g_fingerprints = internal::fingerprint_set2gene(prefix, num_genes, total_sets, shared.set_sizes, read_opt);
+                    stage_reread[2].push_back("set2gene.tsv");
+                }
+            } else {
+                if (check_g2s) {
+                    g2s_fingerprints = internal::fingerprint_gene2set(prefix, num_genes, total_sets, read_opt);
+                    stage_reread[3].push_back("gene2set.tsv");
+                }
+            }
+        });
+
+        if (!check_sets) {
+            for (const auto& key : { names_key, descriptions_key }) {
+                current.values[key] = *internal::find_value(manifest, key);
+            }
+        }
+
+        // If only one of the mapping files was read, we compare its digest to the recorded digest of the other file.
+        // Upon any mismatch, we read the other file so that the inconsistent gene can be reported.
+        std::vector<uint64_t> mapping_digest;
+        if (check_s2g && check_g2s) {
+            internal::compare_fingerprints(s2g_fingerprints, g2s_fingerprints);
+            mapping_digest = internal::digest_fingerprints(s2g_fingerprints);
+        } else if (check_s2g || check_g2s) {
+            mapping_digest = internal::digest_fingerprints(check_s2g ? s2g_fingerprints : g2s_fingerprints);
+            if (!internal::same_value(manifest, mapping_key, mapping_digest)) {
+                if (check_s2g) {
+                    g2s_fingerprints = internal::fingerprint_gene2set(prefix, num_genes, total_sets, read_opt);
+                    stage_reread[3].push_back("gene2set.tsv");
+                } else {
+                    s2g_fingerprints = internal::fingerprint_set2gene(prefix, num_genes, total_sets, shared.set_sizes, read_opt);
+                    stage_reread[2].push_back("set2gene.tsv");
+                }
+                internal::compare_fingerprints(s2g_fingerprints, g2s_fingerprints);
+            }
+        } else {
+            mapping_digest = *internal::find_value(manifest, mapping_key);
+        }
+
+        for (auto& r : stage_reread) {
+            reread.insert(reread.end(), r.begin(), r.end());
+        }
+        current.values[mapping_key] = std::move(mapping_digest);
+        current.values[prefix + "total_sets"] = std::move(total_value);
+        current.values[prefix + "set_sizes"] = std::move(sizes_value);
+    }
+
+    // Only updating the manifest after all checks have passed.
+    // File states are always updated so that files with new modification times but the same contents are not hashed again next time;
+    // the derived values are only recomputed if anything changed.
+    for (auto& entry : current.files) {
+        manifest.files[entry.first] = entry.second;
+    }
+    if (anything_changed) {
+        current.values[prefix + "num_genes"] = std::move(gene_value);
+        for (auto& entry : current.values) {
+            manifest.values[entry.first] = std::move(entry.second);
+        }
+    }
+
+    return reread;
+}
+
+}
+
+#endif
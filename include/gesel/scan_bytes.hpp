@@ -0,0 +1,130 @@
+#ifndef GESEL_SCAN_BYTES_HPP
+#define GESEL_SCAN_BYTES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+/*
+ * Define GESEL_NO_SIMD to force the scalar fallbacks, e.g., for testing.
+ * The SIMD paths are only compiled in when the relevant instruction sets are enabled at compile time (e.g., with -msse2 or -mavx2).
+ */
+#if !defined(GESEL_NO_SIMD) && defined(__GNUC__)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GESEL_SCAN_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GESEL_SCAN_SSE2
+#endif
+#endif
+
+#if !defined(GESEL_NO_SIMD) && defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define GESEL_SCAN_SWAR
+#endif
+#endif
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * Returns the position of the first tab or newline in [ptr, ptr + n), or 'n' if there are none.
+ */
+inline size_t find_delimiter(const char* ptr, size_t n) {
+    size_t i = 0;
+
+#if defined(GESEL_SCAN_AVX2)
+    const __m256i tab32 = _mm256_set1_epi8('\t');
+    const __m256i newline32 = _mm256_set1_epi8('\n');
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + i));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, tab32), _mm256_cmpeq_epi8(block, newline32));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hits));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+#if defined(GESEL_SCAN_AVX2) || defined(GESEL_SCAN_SSE2)
+    const __m128i tab16 = _mm_set1_epi8('\t');
+    const __m128i newline16 = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(block, tab16), _mm_cmpeq_epi8(block, newline16));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hits));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        char c = ptr[i];
+        if (c == '\t' || c == '\n') {
+            return i;
+        }
+    }
+    return n;
+}
+
+#ifdef GESEL_SCAN_SWAR
+inline uint64_t load_eight_bytes(const char* ptr) {
+    uint64_t val;
+    std::memcpy(&val, ptr, 8);
+    return val;
+}
+
+inline bool is_eight_digits(uint64_t val) {
+    return !(((val + 0x4646464646464646ULL) | (val - 0x3030303030303030ULL)) & 0x8080808080808080ULL);
+}
+
+// Converts eight ASCII digits into their value with three multiplications, see https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/.
+inline uint64_t parse_eight_digits(uint64_t val) {
+    constexpr uint64_t mask = 0x000000FF000000FFULL;
+    constexpr uint64_t mul1 = 0x000F424000000064ULL; // 100 + (1000000 << 32)
+    constexpr uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+    val -= 0x3030303030303030ULL;
+    val = (val * 10) + (val >> 8);
+    val = (((val & mask) * mul1) + (((val >> 16) & mask) * mul2)) >> 32;
+    return val;
+}
+#endif
+
+/*
+ * Converts a run of 'n' bytes into an integer, returning false if any byte is not a digit.
+ * This should only be called with 'n' no greater than 19, so that the result is guaranteed to fit into a 64-bit integer.
+ */
+inline bool parse_digit_run(const char* ptr, size_t n, uint64_t& value) {
+    uint64_t number = 0;
+    size_t i = 0;
+
+#ifdef GESEL_SCAN_SWAR
+    for (; i + 8 <= n; i += 8) {
+        auto val = load_eight_bytes(ptr + i);
+        if (!is_eight_digits(val)) {
+            return false;
+        }
+        number = number * 100000000 + parse_eight_digits(val);
+    }
+#endif
+
+    for (; i < n; ++i) {
+        char c = ptr[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        number = number * 10 + (c - '0');
+    }
+
+    value = number;
+    return true;
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef GESEL_SEARCH_SETS_HPP
+#define GESEL_SEARCH_SETS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <limits>
+
+#include "ranged_file.hpp"
+#include "check_indices.hpp"
+#include "chunked_reader.hpp"
+#include "flat_indices.hpp"
+#include "token_dictionary.hpp"
+#include "intersect.hpp"
+#include "span.hpp"
+
+/**
+ * @file search_sets.hpp
+ * @brief Search for sets by the tokens in their names or descriptions.
+ */
+
+namespace gesel {
+
+/**
+ * Fields to search.
+ *
+ * - `NAMES`: tokens in the set names, from `tokens-names.tsv`.
+ * - `DESCRIPTIONS`: tokens in the set descriptions, from `tokens-descriptions.tsv`.
+ * - `BOTH`: tokens in either the names or descriptions.
+ */
+enum class SearchField : char { NAMES, DESCRIPTIONS, BOTH };
+
+/**
+ * @brief Options for the `TokenSearch` constructor.
+ */
+struct TokenSearchOptions {
+    /**
+     * Whether to load all of the sets for each token into memory.
+     * If false, only the tokens are loaded from the `*.ranges.gz` files, and the sets for each matching token are read from the `tokens-*.tsv` files at query time.
+     */
+    bool in_memory = false;
+};
+
+/**
+ * @brief Options for `TokenSearch::search()`.
+ */
+struct SearchOptions {
+    /**
+     * Fields to search.
+     */
+    SearchField field = SearchField::BOTH;
+
+    /**
+     * Whether a set must match all tokens in the query.
+     * If false, a set only needs to match any token.
+     */
+    bool match_all = true;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+/*
+ * Glob-style matching where '*' matches any number of characters and '?' matches exactly one character.
+ * On a mismatch, we backtrack to the most recent '*' and let it consume one more character; this is linear in most practical cases.
+ */
+inline bool wildcard_match(std::string_view pattern, std::string_view text) {
+    size_t p = 0, t = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            ++p;
+            ++t;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p;
+            ++p;
+            resume = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            ++resume;
+            t = resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+/*
+ * Sets for each token in a 'tokens-*.tsv' file, either held in memory or read on demand.
+ */
+class TokenPostings {
+public:
+    TokenPostings(const std::string& path, bool in_memory) : my_file(path, RangesFormat::NAME_AND_BYTES), my_in_memory(in_memory) {
+        if (!my_in_memory) {
+            return;
+        }
+
+        // Streaming through the file in order with a bounded buffer, so that only the decoded sets are held in memory.
+        const size_t num_tokens = my_file.num_lines();
+        std::vector<uint64_t> bytes(num_tokens);
+        for (size_t t = 0; t < num_tokens; ++t) {
+            bytes[t] = my_file.line_length(t);
+        }
+
+        ReaderOptions read_opt;
+        read_opt.memory_map_raw = false;
+        auto& offsets = my_loaded.offsets;
+        offsets.reserve(num_tokens + 1);
+        offsets.push_back(0);
+        check_indices<false>(path, std::numeric_limits<uint64_t>::max(), bytes, [&](uint64_t, const std::vector<uint64_t>& indices) -> void {
+            my_loaded.values.insert(my_loaded.values.end(), indices.begin(), indices.end());
+            offsets.push_back(my_loaded.values.size());
+        }, read_opt);
+    }
+
+public:
+    const std::vector<std::string>& tokens() const {
+        return my_file.names();
+    }
+
+    /*
+     * Appends the indices of all tokens matching 'pattern' to 'output'.
+     * As the tokens are sorted, only the tokens sharing the literal prefix before the first wildcard need to be checked.
+     */
+    void match(std::string_view pattern, std::vector<size_t>& output) const {
+        const auto& names = my_file.names();
+        auto wild = pattern.find_first_of("*?");
+        if (wild == std::string_view::npos) {
+            auto found = find_sorted_name(names, pattern);
+            if (found < names.size()) {
+                output.push_back(found);
+            }
+            return;
+        }
+
+        auto prefix = pattern.substr(0, wild);
+        auto it = std::lower_bound(names.begin(), names.end(), prefix, [](const std::string& left, std::string_view right) -> bool { return left < right; });
+        for (; it != names.end(); ++it) {
+            std::string_view current(*it);
+            if (current.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+            if (wildcard_match(pattern, current)) {
+                output.push_back(it - names.begin());
+            }
+        }
+    }
+
+    /*
+     * Views of the sets for each token in 'lines'.
+     * If the sets are not in memory, they are read from file in a single batch and stored in 'holder'.
+     */
+    std::vector<Span<uint64_t> > postings(const std::vector<size_t>& lines, std::vector<std::vector<uint64_t> >& holder) const {
+        std::vector<Span<uint64_t> > output;
+        output.reserve(lines.size());
+        if (my_in_memory) {
+            for (auto l : lines) {
+                auto start = my_loaded.offsets[l];
+                output.emplace_back(my_loaded.values.data() + start, my_loaded.offsets[l + 1] - start);
+            }
+        } else {
+            holder = my_file.read_indices(lines);
+            for (const auto& h : holder) {
+                output.emplace_back(h.data(), h.size());
+            }
+        }
+        return output;
+    }
+
+private:
+    RangedFile my_file;
+    bool my_in_memory;
+    FlatIndices<uint64_t> my_loaded;
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Search for sets by the tokens in their names or descriptions.
+ *
+ * Queries are split into tokens with the same rules used to create the `tokens-*.tsv` files, i.e., runs of alphanumeric characters or dashes after lower-casing.
+ * Each query token may contain `*` (matching any number of characters) or `?` (matching a single character) wildcards,
+ * which are expanded against the sorted tokens in the database.
+ * The sets for each query token are the union of the sets for all matching database tokens (across both fields, if `SearchField::BOTH` is used);
+ * the final result is either the intersection or the union of the sets for all query tokens.
+ * Intersections are computed with a galloping search, starting from the query token with the fewest sets;
+ * the postings for the other query tokens are only merged if this is cheaper than searching each of them for every candidate set.
+ *
+ * All methods are safe to call from multiple threads.
+ */
+class TokenSearch {
+public:
+    /**
+     * @param prefix Prefix for the Gesel database files, see `validate_database()`.
+     * @param options Further options.
+     */
+    TokenSearch(const std::string& prefix, const TokenSearchOptions& options = TokenSearchOptions()) :
+        my_names(prefix + "tokens-names.tsv", options.in_memory),
+        my_descriptions(prefix + "tokens-descriptions.tsv", options.in_memory)
+    {}
+
+public:
+    /**
+     * @param pattern A single query token, possibly containing wildcards.
+     * This should already be lower-cased.
+     * @param field Field to search.
+     * If `SearchField::BOTH` is used, matching tokens from both fields are reported.
+     * @return Sorted and unique database tokens that match `pattern`.
+     */
+    std::vector<std::string> expand(std::string_view pattern, SearchField field = SearchField::BOTH) const {
+        std::vector<std::string> output;
+        std::vector<size_t> matches;
+        for (auto current : fields(field)) {
+            matches.clear();
+            current->match(pattern, matches);
+            for (auto m : matches) {
+                output.push_back(current->tokens()[m]);
+            }
+        }
+        std::sort(output.begin(), output.end());
+        output.erase(std::unique(output.begin(), output.end()), output.end());
+        return output;
+    }
+
+    /**
+     * @param query Free-text query.
+     * @param options Further options.
+     * @return Sorted indices of the sets that match the query.
+     * This is empty if the query does not contain any tokens.
+     */
+    std::vector<uint64_t> search(std::string_view query, const SearchOptions& options = SearchOptions()) const {
+        std::vector<std::string> terms;
+        std::string scratch;
+        internal::for_each_token<true>(query, scratch, [&](std::string_view token) -> void {
+            terms.emplace_back(token);
+        });
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        const size_t num_terms = terms.size();
+
+        // Finding the matching tokens for each term in each field, so that all postings can be read in a single batch per field.
+        auto chosen = fields(options.field);
+        const size_t num_fields = chosen.size();
+        std::vector<std::vector<size_t> > lines(num_fields);
+        std::vector<std::vector<size_t> > term_bounds(num_fields, std::vector<size_t>(num_terms + 1));
+        for (size_t f = 0; f < num_fields; ++f) {
+            for (size_t t = 0; t < num_terms; ++t) {
+                chosen[f]->match(terms[t], lines[f]);
+                term_bounds[f][t + 1] = lines[f].size();
+            }
+        }
+
+        if (options.match_all) {
+            for (size_t t = 0; t < num_terms; ++t) {
+                bool found = false;
+                for (size_t f = 0; f < num_fields; ++f) {
+                    found = found || (term_bounds[f][t + 1] > term_bounds[f][t]);
+                }
+                if (!found) {
+                    return std::vector<uint64_t>(); // no need to read anything if a term has no matches.
+                }
+            }
+        }
+
+        std::vector<std::vector<std::vector<uint64_t> > > holders(num_fields);
+        std::vector<std::vector<Span<uint64_t> > > postings(num_fields);
+        for (size_t f = 0; f < num_fields; ++f) {
+            postings[f] = chosen[f]->postings(lines[f], holders[f]);
+        }
+
+        // Each term is represented by the postings of all of its matching tokens, which are only merged if necessary.
+        std::vector<std::vector<Span<uint64_t> > > per_term(num_terms);
+        for (size_t t = 0; t < num_terms; ++t) {
+            auto& current = per_term[t];
+            for (size_t f = 0; f < num_fields; ++f) {
+                const auto& bounds = term_bounds[f];
+                current.insert(current.end(), postings[f].begin() + bounds[t], postings[f].begin() + bounds[t + 1]);
+            }
+        }
+
+        if (options.match_all) {
+            return internal::intersect_unions<uint64_t>(per_term);
+        } else {
+            std::vector<Span<uint64_t> > everything;
+            for (const auto& current : per_term) {
+                everything.insert(everything.end(), current.begin(), current.end());
+            }
+            return internal::union_sorted<uint64_t>(everything);
+        }
+    }
+
+private:
+    std::vector<const internal::TokenPostings*> fields(SearchField field) const {
+        std::vector<const internal::TokenPostings*> output;
+        if (field != SearchField::DESCRIPTIONS) {
+            output.push_back(&my_names);
+        }
+        if (field != SearchField::NAMES) {
+            output.push_back(&my_descriptions);
+        }
+        return output;
+    }
+
+private:
+    internal::TokenPostings my_names, my_descriptions;
+};
+
+}
+
+#endif
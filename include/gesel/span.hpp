@@ -0,0 +1,80 @@
+#ifndef GESEL_SPAN_HPP
+#define GESEL_SPAN_HPP
+
+#include <cstddef>
+
+/**
+ * @file span.hpp
+ * @brief Read-only view of a contiguous array.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Read-only view of a contiguous array.
+ * @tparam Type_ Type of the array elements.
+ */
+template<typename Type_>
+class Span {
+public:
+    /**
+     * @cond
+     */
+    Span() = default;
+
+    Span(const Type_* data, size_t size) : my_data(data), my_size(size) {}
+    /**
+     * @endcond
+     */
+
+    /**
+     * @return Pointer to the start of the array.
+     */
+    const Type_* data() const {
+        return my_data;
+    }
+
+    /**
+     * @return Number of elements in the array.
+     */
+    size_t size() const {
+        return my_size;
+    }
+
+    /**
+     * @return Whether the array is empty.
+     */
+    bool empty() const {
+        return my_size == 0;
+    }
+
+    /**
+     * @param i Index of the element.
+     * @return Value of the element.
+     */
+    const Type_& operator[](size_t i) const {
+        return my_data[i];
+    }
+
+    /**
+     * @return Pointer to the start of the array.
+     */
+    const Type_* begin() const {
+        return my_data;
+    }
+
+    /**
+     * @return Pointer to the end of the array.
+     */
+    const Type_* end() const {
+        return my_data + my_size;
+    }
+
+private:
+    const Type_* my_data = NULL;
+    size_t my_size = 0;
+};
+
+}
+
+#endif
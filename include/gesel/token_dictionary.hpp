@@ -0,0 +1,202 @@
+#ifndef GESEL_TOKEN_DICTIONARY_HPP
+#define GESEL_TOKEN_DICTIONARY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cctype>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include "utils.hpp"
+#include "flat_indices.hpp"
+
+namespace gesel {
+
+namespace internal {
+
+/*
+ * Calls 'add(token)' for each token in 'text', where 'scratch' is used to hold the lower-cased token.
+ * A token is a run of lower-case alphabetical characters, digits or dashes after lower-casing.
+ * If 'wildcards_ = true', the '*' and '?' characters are also retained in the token, e.g., when tokenizing a search query.
+ */
+template<bool wildcards_ = false, class Add_>
+void for_each_token(std::string_view text, std::string& scratch, Add_ add) {
+    scratch.clear();
+    for (auto x : text) {
+        x = std::tolower(x);
+        if (invalid_token_character(x) && !(wildcards_ && (x == '*' || x == '?'))) {
+            if (scratch.size()) {
+                add(std::string_view(scratch));
+                scratch.clear();
+            }
+        } else {
+            scratch += x;
+        }
+    }
+    if (scratch.size()) {
+        add(std::string_view(scratch));
+        scratch.clear();
+    }
+}
+
+/*
+ * Append-only storage for strings, allocated in large blocks so that views into existing strings are never invalidated.
+ */
+class StringArena {
+public:
+    std::string_view store(std::string_view x) {
+        if (x.size() > my_remaining) {
+            size_t block_size = std::max(x.size(), static_cast<size_t>(65536));
+            my_blocks.emplace_back(new char[block_size]);
+            my_current = my_blocks.back().get();
+            my_remaining = block_size;
+        }
+        std::copy(x.begin(), x.end(), my_current);
+        std::string_view output(my_current, x.size());
+        my_current += x.size();
+        my_remaining -= x.size();
+        return output;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]> > my_blocks;
+    char* my_current = NULL;
+    size_t my_remaining = 0;
+};
+
+/*
+ * Sorted tokens with the sets that contain each token, stored in compressed sparse row form.
+ * The sets for 'tokens[i]' are stored in 'sets' from 'sets.offsets[i]' to 'sets.offsets[i + 1]', in increasing order.
+ */
+template<typename Index_>
+struct TokenDictionary {
+    StringArena arena;
+    std::vector<std::string_view> tokens;
+    FlatIndices<Index_> sets;
+};
+
+/*
+ * Collects the (token, set) pairs from each set's name or description.
+ * Each distinct token is interned once into an arena, so that each pair only costs a token ID and a set index.
+ * Sets should be added in increasing order of their indices.
+ */
+template<typename Index_>
+class TokenCollector {
+public:
+    void add(uint64_t set, std::string_view text) {
+        for_each_token(text, my_scratch, [&](std::string_view token) -> void {
+            size_t id;
+            auto it = my_ids.find(token);
+            if (it == my_ids.end()) {
+                id = my_last_set.size();
+                my_ids.emplace(my_dictionary.arena.store(token), id);
+                my_last_set.push_back(set);
+            } else {
+                id = it->second;
+                if (my_last_set[id] == set) { // same token occurring multiple times in the same set.
+                    return;
+                }
+                my_last_set[id] = set;
+            }
+            my_pair_ids.push_back(id);
+            my_pair_sets.push_back(set);
+        });
+    }
+
+    size_t size() const {
+        return my_last_set.size();
+    }
+
+    /*
+     * Sorts the interned tokens and groups the sets by token.
+     * As sets were added in increasing order, a stable counting sort by token keeps the sets sorted within each token.
+     */
+    TokenDictionary<Index_> finish() {
+        const size_t num_tokens = my_last_set.size();
+        auto& tokens = my_dictionary.tokens;
+        tokens.resize(num_tokens);
+        for (const auto& entry : my_ids) {
+            tokens[entry.second] = entry.first;
+        }
+        my_ids.clear();
+        my_last_set.clear();
+        my_last_set.shrink_to_fit();
+
+        std::vector<size_t> order(num_tokens);
+        for (size_t t = 0; t < num_tokens; ++t) {
+            order[t] = t;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t left, size_t right) -> bool { return tokens[left] < tokens[right]; });
+
+        std::vector<size_t> rank(num_tokens);
+        std::vector<std::string_view> sorted(num_tokens);
+        for (size_t r = 0; r < num_tokens; ++r) {
+            rank[order[r]] = r;
+            sorted[r] = tokens[order[r]];
+        }
+        tokens.swap(sorted);
+
+        auto& offsets = my_dictionary.sets.offsets;
+        offsets.resize(num_tokens + 1);
+        for (auto id : my_pair_ids) {
+            ++offsets[rank[id] + 1];
+        }
+        for (size_t t = 1; t <= num_tokens; ++t) {
+            offsets[t] += offsets[t - 1];
+        }
+
+        auto& values = my_dictionary.sets.values;
+        values.resize(my_pair_ids.size());
+        for (size_t p = 0, end = my_pair_ids.size(); p < end; ++p) {
+            auto& cursor = offsets[rank[my_pair_ids[p]]];
+            values[cursor] = my_pair_sets[p];
+            ++cursor;
+        }
+        for (size_t t = num_tokens; t > 0; --t) {
+            offsets[t] = offsets[t - 1];
+        }
+        offsets[0] = 0;
+
+        my_pair_ids.clear();
+        my_pair_ids.shrink_to_fit();
+        my_pair_sets.clear();
+        my_pair_sets.shrink_to_fit();
+        return std::move(my_dictionary);
+    }
+
+private:
+    TokenDictionary<Index_> my_dictionary;
+    std::unordered_map<std::string_view, size_t> my_ids;
+    std::vector<uint64_t> my_last_set;
+    std::vector<size_t> my_pair_ids;
+    std::vector<Index_> my_pair_sets;
+    std::string my_scratch;
+};
+
+/*
+ * Finds a token in the dictionary, returning the number of tokens if it is not present.
+ * Lines of the tokens file are sorted in the same order as the dictionary, so we check the expected position first before falling back to a binary search.
+ */
+template<typename Index_>
+size_t find_token(const TokenDictionary<Index_>& dictionary, size_t line, std::string_view token) {
+    const auto& tokens = dictionary.tokens;
+    if (line < tokens.size() && tokens[line] == token) {
+        return line;
+    }
+    auto it = std::lower_bound(tokens.begin(), tokens.end(), token);
+    if (it != tokens.end() && *it == token) {
+        return it - tokens.begin();
+    }
+    return tokens.size();
+}
+
+}
+
+}
+
+#endif
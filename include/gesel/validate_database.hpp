@@ -5,11 +5,19 @@
 #include "check_indices.hpp"
 #include "check_set_details.hpp"
 #include "load_ranges.hpp"
+#include "flat_indices.hpp"
+#include "fingerprint.hpp"
+#include "token_dictionary.hpp"
+#include "parallelize.hpp"
+#include "validation_report.hpp"
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <stdexcept> 
 #include <vector>
+#include <limits>
+#include <algorithm>
 #include <unordered_map>
 
 /**
@@ -24,28 +32,14 @@ namespace gesel {
  */
 namespace internal {
 
-inline void tokenize(uint64_t index, const std::string& text, std::unordered_map<std::string, std::vector<uint64_t> >& tokens_to_sets) {
+inline void tokenize(uint64_t index, std::string_view text, std::unordered_map<std::string, std::vector<uint64_t> >& tokens_to_sets) {
     std::string latest;
-    auto add = [&]() {
-        if (latest.size()) {
-            auto& vec = tokens_to_sets[latest];
-            if (vec.empty() || vec.back() != index) {
-                vec.push_back(index);
-            }
-            latest.clear();
-        }
-    };
-
-    for (auto x : text) {
-        x = std::tolower(x);
-        if (invalid_token_character(x)) {
-            add();
-        } else {
-            latest += x;
+    for_each_token(text, latest, [&](std::string_view token) -> void {
+        auto& vec = tokens_to_sets[std::string(token)];
+        if (vec.empty() || vec.back() != index) {
+            vec.push_back(index);
         }
-    }
-
-    add();
+    });
 }
 
 inline void check_tokens(const std::vector<std::string>& tokens, const std::string& path) {
@@ -67,126 +61,513 @@ inline void check_tokens(const std::vector<std::string>& tokens, const std::stri
     }
 }
 
+inline uint64_t count_total_sets(const std::vector<uint64_t>& numbers) {
+    uint64_t total_sets = 0;
+    constexpr uint64_t limit = std::numeric_limits<uint64_t>::max();
+    for (auto x : numbers) {
+        if (limit - total_sets < x) {
+            throw std::runtime_error("64-bit unsigned integer overflow for the sum of the number of sets in 'collections.tsv.ranges.gz'");
+        }
+        total_sets += x;
+    }
+    return total_sets;
 }
-/**
- * @endcond
- */
 
-/**
- * Validate Gesel database files for a particular species.
- * This checks all files for validity and consistency except for the gene mapping files (which are validated by `validate_genes()`).
- * Any invalid formatting or inconsistency between files will result in an error.
- *
- * @param prefix Prefix for the Gesel database files.
- * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
- * @param num_genes Total number of genes for this species.
+/*
+ * Checks 'tokens-<type>.tsv' and its ranges file against the dictionary of tokens collected from the set details.
+ * Returns the number of tokens, i.e., lines in the file.
  */
-inline void validate_database(const std::string& prefix, uint64_t num_genes) {
-    uint64_t total_sets = 0;
-    {
-        auto coll_info = internal::load_ranges_with_sizes(prefix + "collections.tsv.ranges.gz");
-        internal::check_collection_details(prefix + "collections.tsv", coll_info.first, coll_info.second);
-        constexpr uint64_t limit = std::numeric_limits<uint64_t>::max();
-        for (auto x : coll_info.second) {
-            if (limit - total_sets < x) {
-                throw std::runtime_error("64-bit unsigned integer overflow for the sum of the number of sets in 'collections.tsv.ranges.gz'");
-            }
-            total_sets += x;
-        }
+template<typename Index_>
+uint64_t check_token_file(const std::string& prefix, const std::string& type, uint64_t total_sets, const TokenDictionary<Index_>& dictionary, const ReaderOptions& read_opt) {
+    auto path = "tokens-" + type + ".tsv";
+    auto ranges_path = path + ".ranges.gz";
+    auto tok_info = load_named_ranges(prefix + ranges_path);
+    check_tokens(tok_info.first, ranges_path);
+    if (tok_info.first.size() != dictionary.tokens.size()) {
+        throw std::runtime_error("different number of tokens from " + type + " between '" + ranges_path + "' and 'sets.tsv'");
     }
 
-    std::vector<uint64_t> set_sizes;
-    {
-        auto set_info = internal::load_ranges_with_sizes(prefix + "sets.tsv.ranges.gz");
-        if (static_cast<uint64_t>(set_info.first.size()) != total_sets) {
-            throw std::runtime_error("total number of sets in 'sets.tsv' does not match with the reported number from 'collections.tsv.ranges.gz'");
-        }
-        set_sizes.swap(set_info.second);
+    // Both the ranges file and the dictionary are sorted, so each line should usually match the token at the same position.
+    check_indices<false>(
+        prefix + path,
+        total_sets,
+        tok_info.second,
+        [&](uint64_t line, const std::vector<uint64_t>& indices) {
+            const auto& tok = tok_info.first[line];
+            auto t = find_token(dictionary, line, tok);
+            if (t == dictionary.tokens.size()) {
+                throw std::runtime_error("token '" + tok + "' in '" + ranges_path + "' is not present in " + type + " in 'sets.tsv'");
+            }
+            if (!same_flat_indices(dictionary.sets, t, indices)) {
+                throw std::runtime_error("sets for token '" + tok + "' in '" + path + "' are inconsistent with " + type + " in 'sets.tsv'");
+            }
+        },
+        read_opt
+    );
+
+    return tok_info.first.size();
+}
+
+template<typename Index_>
+void check_token_files(const std::string& prefix, uint64_t total_sets, TokenCollector<Index_>& collect_n, TokenCollector<Index_>& collect_d, const ReaderOptions& read_opt) {
+    check_token_file(prefix, "names", total_sets, collect_n.finish(), read_opt);
+    check_token_file(prefix, "descriptions", total_sets, collect_d.finish(), read_opt);
+}
 
-        std::unordered_map<std::string, std::vector<uint64_t> > token_n, token_d;
-        internal::check_set_details(
+template<typename Index_>
+void validate_sets_and_tokens(const std::string& prefix, uint64_t total_sets, const std::vector<uint64_t>& set_ranges, const std::vector<uint64_t>& set_sizes, const ReaderOptions& read_opt, ValidationReport* report) {
+    TokenCollector<Index_> collect_n, collect_d;
+    record_stage(report, "sets", prefix + "sets.tsv", prefix + "sets.tsv.gz", [&]() -> uint64_t {
+        check_set_details(
             prefix + "sets.tsv",
-            set_info.first,
+            set_ranges,
             set_sizes,
-            [&](uint64_t line, const std::string& name, const std::string& description) {
-                internal::tokenize(line, name, token_n);
-                internal::tokenize(line, description, token_d);
-            }
+            [&](uint64_t line, std::string_view name, std::string_view description) {
+                collect_n.add(line, name);
+                collect_d.add(line, description);
+            },
+            read_opt
         );
+        return total_sets;
+    });
+
+    // Check for correct tokenization.
+    record_stage(report, "tokens-names", prefix + "tokens-names.tsv", "", [&]() -> uint64_t {
+        return check_token_file(prefix, "names", total_sets, collect_n.finish(), read_opt);
+    });
+    record_stage(report, "tokens-descriptions", prefix + "tokens-descriptions.tsv", "", [&]() -> uint64_t {
+        return check_token_file(prefix, "descriptions", total_sets, collect_d.finish(), read_opt);
+    });
+}
+
+inline void validate_sets_and_tokens(const std::string& prefix, uint64_t total_sets, const std::vector<uint64_t>& set_ranges, const std::vector<uint64_t>& set_sizes, const ReaderOptions& read_opt, ValidationReport* report = NULL) {
+    if (total_sets <= std::numeric_limits<uint32_t>::max()) {
+        validate_sets_and_tokens<uint32_t>(prefix, total_sets, set_ranges, set_sizes, read_opt, report);
+    } else {
+        validate_sets_and_tokens<uint64_t>(prefix, total_sets, set_ranges, set_sizes, read_opt, report);
+    }
+}
+
+inline std::vector<uint64_t> load_set2gene_ranges(const std::string& prefix, uint64_t total_sets) {
+    auto s2g_info = load_ranges(prefix + "set2gene.tsv.ranges.gz");
+    if (s2g_info.size() != static_cast<size_t>(total_sets)) {
+        throw std::runtime_error("number of lines in 'set2gene.tsv.ranges.gz' does not match the total number of sets");
+    }
+    return s2g_info;
+}
+
+inline std::vector<uint64_t> load_gene2set_ranges(const std::string& prefix, uint64_t num_genes) {
+    auto g2s_info = load_ranges(prefix + "gene2set.tsv.ranges.gz");
+    if (g2s_info.size() != static_cast<size_t>(num_genes)) {
+        throw std::runtime_error("number of lines in 'gene2set.tsv.ranges.gz' does not match the total number of genes");
+    }
+    return g2s_info;
+}
+
+inline void check_set_size(uint64_t line, const std::vector<uint64_t>& indices, const std::vector<uint64_t>& set_sizes) {
+    if (static_cast<uint64_t>(indices.size()) != set_sizes[line]) {
+        throw std::runtime_error("size of set " + std::to_string(line) + " from 'sets.tsv.ranges.gz' does not match with that in 'set2gene.tsv'");
+    }
+}
+
+inline std::runtime_error inconsistent_gene_error(uint64_t gene) {
+    return std::runtime_error("sets for gene " + std::to_string(gene) + " in 'gene2set.tsv' are inconsistent with 'set2gene.tsv'");
+}
+
+/*
+ * Loads 'set2gene.tsv' into a flat array, also checking it against its Gzipped version if 'has_gzip_ = true'.
+ */
+template<bool has_gzip_, typename Index_>
+FlatIndices<Index_> load_set2gene(const std::string& prefix, uint64_t num_genes, uint64_t total_sets, const std::vector<uint64_t>& set_sizes, const ReaderOptions& read_opt) {
+    auto s2g_info = load_set2gene_ranges(prefix, total_sets);
+
+    // Each index needs at least one digit and a delimiter, so we can cap the allocation for each set by the size of its line.
+    // This avoids allocating a huge array from a corrupted set size before the size check in the callback has a chance to fail.
+    FlatIndices<Index_> forward_map;
+    forward_map.offsets.resize(s2g_info.size() + 1);
+    for (size_t s = 0, end = s2g_info.size(); s < end; ++s) {
+        uint64_t max_size = s2g_info[s] / 2 + (s2g_info[s] % 2);
+        forward_map.offsets[s + 1] = forward_map.offsets[s] + std::min(set_sizes[s], max_size);
+    }
+    forward_map.values.resize(forward_map.offsets.back());
 
-        // Check for correct tokenization.
-        for (int tt = 0; tt < 2; ++tt) {
-            std::string type = (tt == 0 ? "names" : "descriptions");
-            const auto& tokens = (tt == 0 ? token_n : token_d);
-
-            auto path = "tokens-" + type + ".tsv";
-            auto ranges_path = path + ".ranges.gz";
-            auto tok_info = internal::load_named_ranges(prefix + ranges_path);
-            internal::check_tokens(tok_info.first, ranges_path);
-            if (tok_info.first.size() != tokens.size()) {
-                throw std::runtime_error("different number of tokens from " + type + " between '" + ranges_path + "' and 'sets.tsv'");
+    check_indices<has_gzip_>(
+        prefix + "set2gene.tsv",
+        num_genes,
+        s2g_info,
+        [&](uint64_t line, const std::vector<uint64_t>& indices) {
+            check_set_size(line, indices, set_sizes);
+            std::copy(indices.begin(), indices.end(), forward_map.values.begin() + forward_map.offsets[line]);
+        },
+        read_opt
+    );
+
+    return forward_map;
+}
+
+/*
+ * Checks that 'gene2set.tsv' is consistent with the reverse mapping from 'set2gene.tsv'.
+ */
+template<typename Index_>
+void check_gene2set(const std::string& prefix, uint64_t num_genes, uint64_t total_sets, const FlatIndices<Index_>& reverse_map, const ReaderOptions& read_opt) {
+    auto g2s_info = load_gene2set_ranges(prefix, num_genes);
+
+    check_indices<true>(
+        prefix + "gene2set.tsv",
+        total_sets,
+        g2s_info,
+        [&](uint64_t line, const std::vector<uint64_t>& indices) {
+            if (!same_flat_indices(reverse_map, line, indices)) {
+                throw inconsistent_gene_error(line);
             }
+        },
+        read_opt
+    );
+}
 
-            internal::check_indices<false>(
-                prefix + path,
-                total_sets,
-                tok_info.second,
-                [&](uint64_t line, const std::vector<uint64_t>& indices) {
-                    const auto& tok = tok_info.first[line];
-                    auto tIt = tokens.find(tok);
-                    if (tIt == tokens.end()) {
-                        throw std::runtime_error("token '" + tok + "' in '" + ranges_path + "' is not present in " + type + " in 'sets.tsv'");
-                    }
-                    if (!internal::same_vectors(tIt->second, indices)) {
-                        throw std::runtime_error("sets for token '" + tok + "' in '" + path + "' are inconsistent with " + type + " in 'sets.tsv'");
-                    }
-                }
-            );
-        }
+template<typename Index_>
+void validate_mappings(const std::string& prefix, uint64_t num_genes, uint64_t total_sets, const std::vector<uint64_t>& set_sizes, const ReaderOptions& read_opt, ValidationReport* report) {
+    // Check for correct mapping of sets to genes. The forward mapping is discarded before reading the reverse mapping to reduce memory usage.
+    FlatIndices<Index_> reverse_map;
+    record_stage(report, "set2gene", prefix + "set2gene.tsv", prefix + "set2gene.tsv.gz", [&]() -> uint64_t {
+        auto forward_map = load_set2gene<true, Index_>(prefix, num_genes, total_sets, set_sizes, read_opt);
+        reverse_map = transpose_indices(forward_map, num_genes);
+        return total_sets;
+    });
+
+    // And making sure that the reverse mapping is consistent.
+    record_stage(report, "gene2set", prefix + "gene2set.tsv", prefix + "gene2set.tsv.gz", [&]() -> uint64_t {
+        check_gene2set(prefix, num_genes, total_sets, reverse_map, read_opt);
+        return num_genes;
+    });
+}
+
+inline void validate_mappings(const std::string& prefix, uint64_t num_genes, uint64_t total_sets, const std::vector<uint64_t>& set_sizes, const ReaderOptions& read_opt, ValidationReport* report = NULL) {
+    // Gene and set indices are stored in the same type, so we can only use 32-bit storage if both fit.
+    constexpr uint64_t limit32 = std::numeric_limits<uint32_t>::max();
+    if (num_genes <= limit32 && total_sets <= limit32) {
+        validate_mappings<uint32_t>(prefix, num_genes, total_sets, set_sizes, read_opt, report);
+    } else {
+        validate_mappings<uint64_t>(prefix, num_genes, total_sets, set_sizes, read_opt, report);
     }
+}
 
-    // Check for correct mapping of sets to genes.
-    std::vector<std::vector<uint64_t> > reverse_map(num_genes);
-    {
-        auto s2g_info = internal::load_ranges(prefix + "set2gene.tsv.ranges.gz");
-        if (s2g_info.size() != static_cast<size_t>(total_sets)) {
-            throw std::runtime_error("number of lines in 'set2gene.tsv.ranges.gz' does not match the total number of sets");
-        }
+inline std::vector<IndexFingerprint> fingerprint_set2gene(const std::string& prefix, uint64_t num_genes, uint64_t total_sets, const std::vector<uint64_t>& set_sizes, const ReaderOptions& read_opt) {
+    auto s2g_info = load_set2gene_ranges(prefix, total_sets);
+    std::vector<IndexFingerprint> output(num_genes);
 
-        internal::check_indices<true>(
+    // Shards of the same file may add to the same gene's fingerprint, so we need atomics when the file is read by multiple threads.
+    if (read_opt.num_threads > 1) {
+        std::vector<AtomicFingerprint> shared(num_genes);
+        check_indices<true>(
             prefix + "set2gene.tsv",
             num_genes,
             s2g_info,
             [&](uint64_t line, const std::vector<uint64_t>& indices) {
-                if (static_cast<uint64_t>(indices.size()) != set_sizes[line]) {
-                    throw std::runtime_error("size of set " + std::to_string(line) + " from 'sets.tsv.ranges.gz' does not match with that in 'set2gene.tsv'");
-                }
+                check_set_size(line, indices, set_sizes);
                 for (auto i : indices) {
-                    reverse_map[i].push_back(line);
+                    add_to_fingerprint(shared[i], line);
                 }
-            }
+            },
+            read_opt
         );
+        for (uint64_t g = 0; g < num_genes; ++g) {
+            output[g] = load_fingerprint(shared[g]);
+        }
+        return output;
     }
 
-    // And making sure that the reverse mapping is consistent.
-    {
-        auto g2s_info = internal::load_ranges(prefix + "gene2set.tsv.ranges.gz");
-        if (g2s_info.size() != static_cast<size_t>(num_genes)) {
-            throw std::runtime_error("number of lines in 'gene2set.tsv.ranges.gz' does not match the total number of genes");
+    check_indices<true>(
+        prefix + "set2gene.tsv",
+        num_genes,
+        s2g_info,
+        [&](uint64_t line, const std::vector<uint64_t>& indices) {
+            check_set_size(line, indices, set_sizes);
+            for (auto i : indices) {
+                add_to_fingerprint(output[i], line);
+            }
+        },
+        read_opt
+    );
+    return output;
+}
+
+inline std::vector<IndexFingerprint> fingerprint_gene2set(const std::string& prefix, uint64_t num_genes, uint64_t total_sets, const ReaderOptions& read_opt) {
+    auto g2s_info = load_gene2set_ranges(prefix, num_genes);
+    std::vector<IndexFingerprint> output(num_genes);
+    check_indices<true>(
+        prefix + "gene2set.tsv",
+        total_sets,
+        g2s_info,
+        [&](uint64_t line, const std::vector<uint64_t>& indices) {
+            output[line] = compute_fingerprint(indices);
+        },
+        read_opt
+    );
+    return output;
+}
+
+inline void compare_fingerprints(const std::vector<IndexFingerprint>& from_set2gene, const std::vector<IndexFingerprint>& from_gene2set) {
+    for (size_t g = 0, end = from_set2gene.size(); g < end; ++g) {
+        if (!same_fingerprints(from_set2gene[g], from_gene2set[g])) {
+            throw inconsistent_gene_error(g);
         }
+    }
+}
 
-        internal::check_indices<true>(
-            prefix + "gene2set.tsv",
-            total_sets,
-            g2s_info,
-            [&](uint64_t line, const std::vector<uint64_t>& indices) {
-                if (!internal::same_vectors(reverse_map[line], indices)) {
-                    throw std::runtime_error("sets for gene " + std::to_string(line) + " in 'gene2set.tsv' are inconsistent with 'set2gene.tsv'");
-                }
-            }
-        );
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Options for `validate_database()`.
+ */
+struct ValidateDatabaseOptions {
+    /**
+     * Number of threads to use.
+     * If greater than 1, the collection details, the set details and their tokens, and the mappings between sets and genes are validated concurrently.
+     * Only the values that are shared between these stages (i.e., the total number of sets and the set sizes) are loaded before the threads are started,
+     * so an error in `collections.tsv.ranges.gz` or `sets.tsv.ranges.gz` is reported before any error in the other files.
+     * If multiple stages fail, the error from the earliest stage (in the order listed above) is always reported.
+     * With a single thread, `collections.tsv` is fully checked before `sets.tsv.ranges.gz` is loaded.
+     *
+     * Users can define a `GESEL_CUSTOM_PARALLEL` function-like macro to run the stages on their own executor.
+     * This should accept the number of threads, the number of tasks and a function that accepts a task index,
+     * and should call the function once for each task index in \f$[0, N)\f$ where \f$N\f$ is the number of tasks.
+     * The stages do not wait on each other, so the tasks can be started in any order.
+     */
+    int num_threads = 1;
+
+    /**
+     * Whether to decompress each Gzip-compressed file on a separate producer thread.
+     * This allows parsing of each file to proceed while the next chunks are being inflated.
+     */
+    bool background_gzip = false;
+
+    /**
+     * Whether to read each uncompressed file on a separate producer thread.
+     */
+    bool background_raw = false;
+
+    /**
+     * Whether to memory-map each uncompressed file rather than reading it in chunks.
+     * This avoids the copies and system calls associated with buffered reads; if true, `background_raw` is ignored.
+     * Files that cannot be memory-mapped are read in chunks as usual.
+     * Only supported on POSIX systems, and enabled by default on Linux.
+     */
+    bool memory_map_raw = internal::memory_map_by_default;
+
+    /**
+     * Size of each buffer used for reading, in bytes.
+     */
+    size_t buffer_size = 65536;
+
+    /**
+     * Number of buffers in the ring that is filled by each producer thread.
+     * Only used if `background_gzip` or `background_raw` is true.
+     */
+    size_t num_buffers = 4;
+
+    /**
+     * Whether to check the consistency of `set2gene.tsv` and `gene2set.tsv` by comparing order-independent fingerprints for each gene.
+     * This avoids materializing the reverse mapping so that memory usage is proportional to the number of genes rather than the number of set-gene memberships.
+     * Any mismatch in the fingerprints is conclusive, while a collision between the fingerprints of inconsistent lines is vanishingly unlikely.
+     * The two files can then be read concurrently when `num_threads` is greater than 1,
+     * though any inconsistency will only be reported after both files have been completely read.
+     */
+    bool fingerprint_mappings = false;
+
+    /**
+     * Number of threads used to validate each of the index files, i.e., `set2gene.tsv`, `gene2set.tsv` and the token files.
+     * If greater than 1, each uncompressed file is split into line-aligned shards using the offsets from its `*.ranges.gz` file,
+     * and the shards are validated concurrently while the Gzip-compressed version is compared against the uncompressed bytes.
+     * This requires memory mapping and is ignored for files that cannot be memory-mapped.
+     * Upon any failure, the file is validated again in serial so that the first error is always reported.
+     *
+     * This is applied separately within each stage, so the total number of threads may be up to the product of `num_threads` and this value.
+     */
+    int num_index_threads = 1;
+
+    /**
+     * Whether to use checkpoint indices to decompress the Gzip-compressed index files in parallel when `num_index_threads` is greater than 1.
+     * Each index is stored in a `*.gz.zran` sidecar file next to its Gzip-compressed file, and is ignored if it does not match the size and trailing bytes of that file.
+     * If no matching sidecar is available, the index is built during the usual serial decompression.
+     */
+    bool gzip_index = false;
+
+    /**
+     * Whether to save each newly built checkpoint index to its sidecar file for use in subsequent validations.
+     * Only used if `gzip_index = true`.
+     * Failures to write the sidecar (e.g., because the directory is read-only) are ignored.
+     */
+    bool save_gzip_index = false;
+
+    /**
+     * Approximate number of uncompressed bytes between checkpoints in each newly built index.
+     * Smaller values allow more parallelism at the cost of larger sidecar files, as each checkpoint stores 32 kB of decompression state.
+     */
+    uint64_t gzip_index_spacing = 1048576;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline ReaderOptions reader_options(const ValidateDatabaseOptions& options) {
+    ReaderOptions read_opt;
+    read_opt.buffer_size = options.buffer_size;
+    read_opt.background_gzip = options.background_gzip;
+    read_opt.background_raw = options.background_raw;
+    read_opt.num_buffers = options.num_buffers;
+    read_opt.memory_map_raw = options.memory_map_raw;
+    read_opt.num_threads = options.num_index_threads;
+    read_opt.gzip_index = options.gzip_index;
+    read_opt.save_gzip_index = options.save_gzip_index;
+    read_opt.gzip_index_spacing = options.gzip_index_spacing;
+    return read_opt;
+}
+
+// Only the ranges files are needed to obtain the values that are shared between stages;
+// these are small enough that we just load them before splitting into threads.
+struct SharedRanges {
+    std::vector<uint64_t> collection_bytes, collection_numbers;
+    uint64_t total_sets;
+    std::vector<uint64_t> set_bytes, set_sizes;
+};
+
+inline void load_collection_ranges(const std::string& prefix, SharedRanges& output) {
+    auto coll_info = load_ranges_with_sizes(prefix + "collections.tsv.ranges.gz");
+    output.collection_bytes = std::move(coll_info.first);
+    output.collection_numbers = std::move(coll_info.second);
+    output.total_sets = count_total_sets(output.collection_numbers);
+}
+
+inline void load_set_ranges(const std::string& prefix, SharedRanges& output) {
+    auto set_info = load_ranges_with_sizes(prefix + "sets.tsv.ranges.gz");
+    if (static_cast<uint64_t>(set_info.first.size()) != output.total_sets) {
+        throw std::runtime_error("total number of sets in 'sets.tsv' does not match with the reported number from 'collections.tsv.ranges.gz'");
+    }
+    output.set_bytes = std::move(set_info.first);
+    output.set_sizes = std::move(set_info.second);
+}
+
+inline SharedRanges load_shared_ranges(const std::string& prefix) {
+    SharedRanges output;
+    load_collection_ranges(prefix, output);
+    load_set_ranges(prefix, output);
+    return output;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline void validate_database(const std::string& prefix, uint64_t num_genes, const ValidateDatabaseOptions& options, ValidationReport* report) {
+    SharedRanges shared;
+    load_collection_ranges(prefix, shared);
+    const auto total_sets = shared.total_sets;
+    const auto& set_sizes = shared.set_sizes;
+    auto read_opt = reader_options(options);
+
+    std::vector<IndexFingerprint> s2g_fingerprints, g2s_fingerprints;
+    size_t num_stages = (options.fingerprint_mappings ? 4 : 3);
+    auto split = split_report(report, num_stages);
+
+    // Stages do not depend on each other's results, so they can be run in any order.
+    auto run_stage = [&](size_t stage) -> void {
+        auto stage_report = split_report_at(split, stage);
+        if (stage == 0) {
+            record_stage(stage_report, "collections", prefix + "collections.tsv", prefix + "collections.tsv.gz", [&]() -> uint64_t {
+                check_collection_details(prefix + "collections.tsv", shared.collection_bytes, shared.collection_numbers, read_opt);
+                return shared.collection_numbers.size();
+            });
+        } else if (stage == 1) {
+            validate_sets_and_tokens(prefix, total_sets, shared.set_bytes, set_sizes, read_opt, stage_report);
+        } else if (!options.fingerprint_mappings) {
+            validate_mappings(prefix, num_genes, total_sets, set_sizes, read_opt, stage_report);
+        } else if (stage == 2) {
+            record_stage(stage_report, "set2gene", prefix + "set2gene.tsv", prefix + "set2gene.tsv.gz", [&]() -> uint64_t {
+                s2g_fingerprints = fingerprint_set2gene(prefix, num_genes, total_sets, set_sizes, read_opt);
+                return total_sets;
+            });
+        } else {
+            record_stage(stage_report, "gene2set", prefix + "gene2set.tsv", prefix + "gene2set.tsv.gz", [&]() -> uint64_t {
+                g2s_fingerprints = fingerprint_gene2set(prefix, num_genes, total_sets, read_opt);
+                return num_genes;
+            });
+        }
+    };
+
+    if (options.num_threads <= 1) {
+        // Fully checking 'collections.tsv' before loading the set ranges, so that the first error is the same as in a serial run of each check.
+        run_stage(0);
+        load_set_ranges(prefix, shared);
+        for (size_t stage = 1; stage < num_stages; ++stage) {
+            run_stage(stage);
+        }
+    } else {
+        load_set_ranges(prefix, shared);
+        parallelize(options.num_threads, num_stages, run_stage);
     }
-} 
+
+    if (options.fingerprint_mappings) {
+        compare_fingerprints(s2g_fingerprints, g2s_fingerprints);
+    }
+    merge_report(report, split);
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Validate Gesel database files for a particular species.
+ * This checks all files for validity and consistency except for the gene mapping files (which are validated by `validate_genes()`).
+ * Any invalid formatting or inconsistency between files will result in an error.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param num_genes Total number of genes for this species.
+ * @param options Further options.
+ */
+inline void validate_database(const std::string& prefix, uint64_t num_genes, const ValidateDatabaseOptions& options) {
+    internal::validate_database(prefix, num_genes, options, NULL);
+}
+
+/**
+ * Overload of `validate_database()` that also records the time, bytes, lines and allocations for each stage.
+ * Stages are appended to `report` in the order `collections`, `sets`, `tokens-names`, `tokens-descriptions`, `set2gene` and `gene2set`.
+ * Nothing is appended if validation fails.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param num_genes Total number of genes for this species.
+ * @param options Further options.
+ * @param[out] report Report in which to store the per-stage measurements.
+ */
+inline void validate_database(const std::string& prefix, uint64_t num_genes, const ValidateDatabaseOptions& options, ValidationReport& report) {
+    internal::validate_database(prefix, num_genes, options, &report);
+}
+
+/**
+ * Overload of `validate_database()` with default options.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param num_genes Total number of genes for this species.
+ */
+inline void validate_database(const std::string& prefix, uint64_t num_genes) {
+    validate_database(prefix, num_genes, ValidateDatabaseOptions());
+}
 
 }
 
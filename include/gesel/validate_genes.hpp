@@ -2,6 +2,7 @@
 #define GESEL_VALIDATE_GENES_HPP
 
 #include "check_genes.hpp"
+#include "validation_report.hpp"
 
 #include <cstdint>
 #include <string>
@@ -17,21 +18,29 @@
 namespace gesel {
 
 /**
- * Validate Gesel gene mapping files for a particular species.
- * Any invalid formatting or inconsistency between files will result in an error.
- *
- * @param prefix Prefix for the Gesel gene mapping files.
- * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
- * @param types Vector of gene name types, e.g., `"ensembl"`, `"symbol"`.
- * This should contain at least one value.
- *
- * @return Number of genes.
+ * @cond
  */
-inline uint64_t validate_genes(const std::string& prefix, const std::vector<std::string>& types) {
+namespace internal {
+
+/*
+ * Calls 'on_name(type, gene, name)' for each name of each type, where 'type' is the index of the type in 'types'.
+ * If 'report' is not NULL, the measurements for each type are appended to it, but only if all types are valid.
+ */
+template<class OnName_>
+uint64_t validate_genes(const std::string& prefix, const std::vector<std::string>& types, OnName_ on_name, ValidationReport* report = NULL) {
     bool first = true;
     uint64_t num_genes = 0;
-    for (auto t : types) {
-        auto candidate = internal::check_genes(prefix + t + ".tsv.gz");
+    auto split = split_report(report, 1);
+    auto local = split_report_at(split, 0);
+
+    for (size_t i = 0, end = types.size(); i < end; ++i) {
+        const auto& t = types[i];
+        auto path = prefix + t + ".tsv.gz";
+        uint64_t candidate = 0, inflated = 0;
+        record_stage(local, "genes-" + t, "", path, [&]() -> uint64_t {
+            candidate = check_genes(path, [&](uint64_t gene, const std::string& name) -> void { on_name(i, gene, name); }, &inflated);
+            return candidate;
+        }, &inflated);
         if (first) {
             num_genes = candidate;
             first = false;
@@ -44,19 +53,12 @@ inline uint64_t validate_genes(const std::string& prefix, const std::vector<std:
         throw std::runtime_error("at least one gene name type should be present");
     }
 
+    merge_report(report, split);
+
     return num_genes;
 }
 
-/**
- * Overload for `validate_genes()`.
- * This will scan the directory for all files starting with `prefix` and ending with `".tsv.gz"`.
- *
- * @param prefix Prefix for the Gesel gene files.
- * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
- *
- * @return Number of genes.
- */
-inline uint64_t validate_genes(const std::string& prefix) {
+inline std::vector<std::string> list_gene_types(const std::string& prefix) {
     std::vector<std::string> types;
 
     std::filesystem::path path(prefix);
@@ -78,7 +80,57 @@ inline uint64_t validate_genes(const std::string& prefix) {
         types.push_back(name.substr(raw_prefix.size(), ext_loc - raw_prefix.size()));
     }
 
-    return validate_genes(prefix, types);
+    return types;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Validate Gesel gene mapping files for a particular species.
+ * Any invalid formatting or inconsistency between files will result in an error.
+ *
+ * @param prefix Prefix for the Gesel gene mapping files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param types Vector of gene name types, e.g., `"ensembl"`, `"symbol"`.
+ * This should contain at least one value.
+ *
+ * @return Number of genes.
+ */
+inline uint64_t validate_genes(const std::string& prefix, const std::vector<std::string>& types) {
+    return internal::validate_genes(prefix, types, [](size_t, uint64_t, const std::string&) -> void {});
+}
+
+/**
+ * Overload for `validate_genes()`.
+ * This will scan the directory for all files starting with `prefix` and ending with `".tsv.gz"`.
+ *
+ * @param prefix Prefix for the Gesel gene files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ *
+ * @return Number of genes.
+ */
+inline uint64_t validate_genes(const std::string& prefix) {
+    return validate_genes(prefix, internal::list_gene_types(prefix));
+}
+
+/**
+ * Overload of `validate_genes()` that also records the time, bytes and lines for each type, as stages named `genes-<TYPE>`.
+ * Stages are appended to `report` in the order of `types`.
+ * Nothing is appended if validation fails.
+ *
+ * @param prefix Prefix for the Gesel gene mapping files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * @param types Vector of gene name types, e.g., `"ensembl"`, `"symbol"`.
+ * This should contain at least one value.
+ * @param[out] report Report in which to store the per-type measurements.
+ *
+ * @return Number of genes.
+ */
+inline uint64_t validate_genes(const std::string& prefix, const std::vector<std::string>& types, ValidationReport& report) {
+    return internal::validate_genes(prefix, types, [](size_t, uint64_t, const std::string&) -> void {}, &report);
 }
 
 }
@@ -0,0 +1,247 @@
+#ifndef GESEL_VALIDATION_REPORT_HPP
+#define GESEL_VALIDATION_REPORT_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+#include <functional>
+#include <filesystem>
+#include <system_error>
+
+/**
+ * @file validation_report.hpp
+ * @brief Per-stage measurements from validation.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Measurements for a single stage of validation.
+ */
+struct StageReport {
+    /**
+     * Name of the stage.
+     * For `validate_database()`, this is one of `collections`, `sets`, `tokens-names`, `tokens-descriptions`, `set2gene` and `gene2set`.
+     * For `validate_genes()`, this is `genes-<TYPE>` for each gene name type.
+     */
+    std::string name;
+
+    /**
+     * Wall-clock time spent in the stage, in seconds.
+     */
+    double wall_seconds = 0;
+
+    /**
+     * CPU time spent by the thread running the stage, in seconds.
+     * This does not include any time spent in helper threads, e.g., for `ValidateDatabaseOptions::background_gzip` or `ValidateDatabaseOptions::num_index_threads`.
+     * If per-thread CPU time is not available, this is the CPU time for the whole process, which includes any concurrently running stages.
+     */
+    double cpu_seconds = 0;
+
+    /**
+     * On-disk size of the uncompressed file read by the stage, in bytes.
+     * This is zero if the stage only reads a Gzip-compressed file.
+     * The small `*.ranges.gz` files are not included.
+     */
+    uint64_t raw_file_bytes = 0;
+
+    /**
+     * On-disk size of the Gzip-compressed file read by the stage, in bytes.
+     * This is zero if the stage only reads an uncompressed file.
+     */
+    uint64_t gzip_file_bytes = 0;
+
+    /**
+     * Number of bytes obtained by decompressing the Gzip-compressed file, e.g., to compute the inflation throughput.
+     * For stages that compare the Gzip-compressed file to its uncompressed copy, this is equal to `raw_file_bytes` as the contents must be identical.
+     * For stages that only read a Gzip-compressed file (i.e., `genes-<TYPE>`), this is counted as the file is decompressed.
+     * This is zero if the stage only reads an uncompressed file.
+     */
+    uint64_t inflated_bytes = 0;
+
+    /**
+     * Number of lines in the file(s) read by the stage.
+     */
+    uint64_t lines = 0;
+
+    /**
+     * Number of allocations performed during the stage, as reported by `ValidationReport::allocation_counter`.
+     * This is zero if no counter is supplied.
+     */
+    uint64_t allocations = 0;
+};
+
+/**
+ * @brief Per-stage report from `validate_database()` and `validate_genes()`.
+ *
+ * Stages are appended to `stages` in a fixed order regardless of the number of threads,
+ * so a single report can accumulate the results of `validate_genes()` and `validate_database()` for the same species.
+ * Recording is skipped entirely when no report is supplied to the validation functions.
+ */
+struct ValidationReport {
+    /**
+     * Measurements for each stage, in order of completion of each call to the validation functions.
+     */
+    std::vector<StageReport> stages;
+
+    /**
+     * Optional function that returns the total number of allocations performed by the process so far,
+     * e.g., from a counter that is incremented by a user-supplied replacement of the global `operator new`.
+     * The difference between the values before and after each stage is reported in `StageReport::allocations`.
+     * This counts allocations from all threads, so stages should be run serially (i.e., `ValidateDatabaseOptions::num_threads = 1`) for accurate per-stage counts.
+     */
+    std::function<uint64_t()> allocation_counter;
+
+    /**
+     * @return JSON representation of the report, as an object containing a `stages` array.
+     * Each stage is represented as an object with the same properties as `StageReport`.
+     * If no `allocation_counter` is supplied, the `allocations` properties are set to `null`.
+     */
+    std::string to_json() const;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline double cpu_seconds() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+#endif
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+inline uint64_t file_size_or_zero(const std::string& path) {
+    if (path.empty()) {
+        return 0;
+    }
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    return (ec ? 0 : static_cast<uint64_t>(size));
+}
+
+/*
+ * Runs 'fun' as a named stage, which should return the number of lines that it read.
+ * If 'report' is NULL, 'fun' is called without any measurement; otherwise, the measurements for the stage are appended to 'report->stages'.
+ * 'raw_path' and 'gzip_path' are the uncompressed and Gzip-compressed files read by the stage, either of which may be empty.
+ * If only 'gzip_path' is supplied, 'inflated' should point to the number of decompressed bytes, which is read after 'fun' returns;
+ * if both are supplied, the Gzip-compressed file is assumed to be decompressed in full to compare it to the uncompressed file.
+ */
+template<class Function_>
+void record_stage(ValidationReport* report, std::string name, const std::string& raw_path, const std::string& gzip_path, Function_ fun, const uint64_t* inflated = NULL) {
+    if (report == NULL) {
+        fun();
+        return;
+    }
+
+    StageReport stage;
+    stage.name = std::move(name);
+    uint64_t alloc_start = (report->allocation_counter ? report->allocation_counter() : 0);
+    double cpu_start = cpu_seconds();
+    auto wall_start = std::chrono::steady_clock::now();
+
+    stage.lines = fun();
+
+    stage.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    stage.cpu_seconds = cpu_seconds() - cpu_start;
+    if (report->allocation_counter) {
+        stage.allocations = report->allocation_counter() - alloc_start;
+    }
+    stage.raw_file_bytes = file_size_or_zero(raw_path);
+    stage.gzip_file_bytes = file_size_or_zero(gzip_path);
+    if (inflated) {
+        stage.inflated_bytes = *inflated;
+    } else if (!gzip_path.empty()) {
+        stage.inflated_bytes = stage.raw_file_bytes;
+    }
+    report->stages.push_back(std::move(stage));
+}
+
+/*
+ * Each concurrent stage records into its own report, which are then appended to the main report in a fixed order.
+ */
+inline std::vector<ValidationReport> split_report(const ValidationReport* report, size_t num_stages) {
+    std::vector<ValidationReport> output;
+    if (report) {
+        output.resize(num_stages);
+        for (auto& x : output) {
+            x.allocation_counter = report->allocation_counter;
+        }
+    }
+    return output;
+}
+
+inline ValidationReport* split_report_at(std::vector<ValidationReport>& split, size_t stage) {
+    return (split.empty() ? NULL : &(split[stage]));
+}
+
+inline void merge_report(ValidationReport* report, std::vector<ValidationReport>& split) {
+    if (report) {
+        for (auto& x : split) {
+            for (auto& stage : x.stages) {
+                report->stages.push_back(std::move(stage));
+            }
+        }
+    }
+}
+
+inline void append_json_string(std::string& output, const std::string& value) {
+    output += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            output += '\\';
+            output += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+            output += buffer;
+        } else {
+            output += c;
+        }
+    }
+    output += '"';
+}
+
+inline void append_json_double(std::string& output, double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    output += buffer;
+}
+
+}
+/**
+ * @endcond
+ */
+
+inline std::string ValidationReport::to_json() const {
+    std::string output = "{\"stages\":[";
+    for (size_t s = 0, end = stages.size(); s < end; ++s) {
+        const auto& stage = stages[s];
+        output += (s ? ",{" : "{");
+        output += "\"name\":";
+        internal::append_json_string(output, stage.name);
+        output += ",\"wall_seconds\":";
+        internal::append_json_double(output, stage.wall_seconds);
+        output += ",\"cpu_seconds\":";
+        internal::append_json_double(output, stage.cpu_seconds);
+        output += ",\"raw_file_bytes\":" + std::to_string(stage.raw_file_bytes);
+        output += ",\"gzip_file_bytes\":" + std::to_string(stage.gzip_file_bytes);
+        output += ",\"inflated_bytes\":" + std::to_string(stage.inflated_bytes);
+        output += ",\"lines\":" + std::to_string(stage.lines);
+        output += ",\"allocations\":" + (allocation_counter ? std::to_string(stage.allocations) : std::string("null"));
+        output += "}";
+    }
+    output += "]}";
+    return output;
+}
+
+}
+
+#endif
@@ -0,0 +1,572 @@
+#ifndef GESEL_WRITE_DATABASE_HPP
+#define GESEL_WRITE_DATABASE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+#include <charconv>
+
+#include "zlib.h"
+
+#include "flat_indices.hpp"
+#include "token_dictionary.hpp"
+#include "parallelize.hpp"
+
+/**
+ * @file write_database.hpp
+ * @brief Write Gesel database and gene files.
+ */
+
+namespace gesel {
+
+/**
+ * @brief Details of a single set.
+ */
+struct SetDetails {
+    /**
+     * Name of the set.
+     * This should not contain any tabs or newlines.
+     */
+    std::string name;
+
+    /**
+     * Description of the set.
+     * This should not contain any tabs or newlines.
+     */
+    std::string description;
+
+    /**
+     * Indices of the genes in the set.
+     * These should be unique but need not be sorted.
+     */
+    std::vector<uint64_t> genes;
+};
+
+/**
+ * @brief Details of a single collection and its sets.
+ */
+struct CollectionDetails {
+    /**
+     * Title of the collection.
+     * This should not contain any tabs or newlines, as should all other strings in this class.
+     */
+    std::string title;
+
+    /**
+     * Description of the collection.
+     */
+    std::string description;
+
+    /**
+     * NCBI taxonomy ID of the species of the collection.
+     */
+    uint64_t species = 0;
+
+    /**
+     * Identity of the maintainer of the collection.
+     */
+    std::string maintainer;
+
+    /**
+     * Source of the collection, usually a URL.
+     */
+    std::string source;
+
+    /**
+     * Sets in the collection.
+     * Sets are numbered consecutively across all collections, in the order in which the collections are supplied.
+     */
+    std::vector<SetDetails> sets;
+};
+
+/**
+ * @brief Names of each gene for a particular type.
+ */
+struct GeneNames {
+    /**
+     * Type of the gene names, e.g., `symbol`, `ensembl`.
+     * This is used to name the `<TYPE>.tsv.gz` file.
+     */
+    std::string type;
+
+    /**
+     * Names for each gene.
+     * Each inner vector may be empty but should not contain empty or duplicated names, or names with tabs or newlines.
+     */
+    std::vector<std::vector<std::string> > names;
+};
+
+/**
+ * @brief Options for `write_database()` and `write_genes()`.
+ */
+struct WriteDatabaseOptions {
+    /**
+     * Number of threads to use for Gzip compression.
+     */
+    int num_threads = 1;
+
+    /**
+     * Number of uncompressed bytes in each block.
+     * Each block is compressed on a separate thread into its own Gzip member, and the members are concatenated in order, as done by **pigz**.
+     * Smaller blocks allow more parallelism for small files at the cost of a slightly worse compression ratio.
+     * Up to `num_threads` blocks are held in memory for each file.
+     */
+    size_t block_size = 1048576;
+
+    /**
+     * Compression level for Gzip, from 1 to 9.
+     */
+    int compression_level = 6;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+class DeflateStream {
+public:
+    DeflateStream(int level) {
+        std::memset(&my_strm, 0, sizeof(z_stream));
+        if (deflateInit2(&my_strm, level, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY) != Z_OK) { // 31 = 15-bit window with a Gzip header.
+            throw std::runtime_error("failed to initialize the Gzip compression stream");
+        }
+    }
+
+    ~DeflateStream() {
+        deflateEnd(&my_strm);
+    }
+
+    DeflateStream(const DeflateStream&) = delete;
+    DeflateStream& operator=(const DeflateStream&) = delete;
+
+public:
+    z_stream& get() {
+        return my_strm;
+    }
+
+private:
+    z_stream my_strm;
+};
+
+/*
+ * Compresses 'data' into a single self-contained Gzip member in 'output'.
+ * 'n' should fit in the 32-bit 'avail_in', which is guaranteed by the block size limit in ParallelGzipWriter.
+ */
+inline void compress_gzip_member(const char* data, size_t n, int level, std::string& output) {
+    DeflateStream stream(level);
+    auto& strm = stream.get();
+    output.resize(deflateBound(&strm, n));
+    strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    strm.avail_in = n;
+    strm.next_out = reinterpret_cast<Bytef*>(output.data());
+    strm.avail_out = output.size();
+    if (deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+        throw std::runtime_error("failed to compress a block with Gzip");
+    }
+    output.resize(strm.total_out);
+}
+
+template<class Stream_>
+void check_stream(const Stream_& stream, const std::string& path) {
+    if (!stream) {
+        throw std::runtime_error("failed to write to '" + path + "'");
+    }
+}
+
+class TextFileWriter {
+public:
+    TextFileWriter(const std::string& path) : my_path(path), my_output(path, std::ios::binary | std::ios::trunc) {
+        check_stream(my_output, my_path);
+    }
+
+    void write(std::string_view x) {
+        my_output.write(x.data(), x.size());
+    }
+
+    void finish() {
+        my_output.close();
+        check_stream(my_output, my_path);
+    }
+
+private:
+    std::string my_path;
+    std::ofstream my_output;
+};
+
+/*
+ * Accumulates text until there are enough bytes for one block per thread, and then compresses all blocks in parallel.
+ * Each block becomes a separate Gzip member, which is transparently handled by all Gzip readers that support concatenated members (i.e., all of them in this library).
+ */
+class ParallelGzipWriter {
+public:
+    ParallelGzipWriter(const std::string& path, const WriteDatabaseOptions& options) :
+        my_path(path),
+        my_output(path, std::ios::binary | std::ios::trunc),
+        my_level(options.compression_level),
+        my_num_threads(std::max(options.num_threads, 1)),
+        my_block_size(std::min(std::max(options.block_size, static_cast<size_t>(1)), static_cast<size_t>(1) << 30))
+    {
+        check_stream(my_output, my_path);
+        my_batch_size = my_block_size * static_cast<size_t>(my_num_threads);
+    }
+
+    void write(std::string_view x) {
+        if (my_pending.empty() && x.size() >= my_batch_size) {
+            // Skipping the copy into the pending buffer for large writes.
+            size_t num_blocks = x.size() / my_block_size;
+            compress(x.data(), x.size(), num_blocks);
+            x.remove_prefix(num_blocks * my_block_size);
+        }
+        my_pending.append(x);
+        if (my_pending.size() >= my_batch_size) {
+            flush(false);
+        }
+    }
+
+    void finish() {
+        flush(true);
+        my_output.close();
+        check_stream(my_output, my_path);
+    }
+
+private:
+    void compress(const char* data, size_t size, size_t num_blocks) {
+        my_compressed.resize(std::max(my_compressed.size(), std::min(num_blocks, static_cast<size_t>(my_num_threads))));
+        for (size_t first = 0; first < num_blocks; first += my_num_threads) {
+            size_t last = std::min(num_blocks, first + my_num_threads);
+            parallelize(my_num_threads, last - first, [&](size_t b) -> void {
+                size_t start = (first + b) * my_block_size;
+                size_t length = std::min(my_block_size, size - start);
+                compress_gzip_member(data + start, length, my_level, my_compressed[b]);
+            });
+
+            for (size_t b = 0, end = last - first; b < end; ++b) {
+                const auto& current = my_compressed[b];
+                my_output.write(current.data(), current.size());
+            }
+            check_stream(my_output, my_path);
+        }
+        my_started = my_started || num_blocks > 0;
+    }
+
+    void flush(bool last) {
+        size_t num_blocks = my_pending.size() / my_block_size;
+        if (last && (my_pending.size() % my_block_size || (num_blocks == 0 && !my_started))) {
+            ++num_blocks; // an empty file still needs one (empty) member to be a valid Gzip file.
+        }
+        compress(my_pending.data(), my_pending.size(), num_blocks);
+        my_pending.erase(0, std::min(my_pending.size(), num_blocks * my_block_size));
+    }
+
+private:
+    std::string my_path;
+    std::ofstream my_output;
+    int my_level;
+    int my_num_threads;
+    size_t my_block_size, my_batch_size;
+    bool my_started = false;
+
+    std::string my_pending;
+    std::vector<std::string> my_compressed;
+};
+
+/*
+ * Writes a file in all of its flavors, i.e., the uncompressed file, its Gzip-compressed twin and its '*.ranges.gz' file.
+ * 'line' is written to both the uncompressed file and its twin, while 'extra' is only appended to the line in the twin.
+ * 'name' (if not empty) and 'number' (if not empty) are written to the ranges file along with the number of bytes in 'line'.
+ */
+class DatabaseFileWriter {
+public:
+    DatabaseFileWriter(const std::string& path, const WriteDatabaseOptions& options) :
+        my_raw(path),
+        my_gzip(path + ".gz", options),
+        my_ranges(path + ".ranges.gz", options)
+    {}
+
+    void add(std::string_view line, std::string_view extra, std::string_view name, std::string_view number) {
+        my_raw.write(line);
+        my_raw.write("\n");
+        my_gzip.write(line);
+        my_gzip.write(extra);
+        my_gzip.write("\n");
+
+        if (!name.empty()) {
+            my_ranges.write(name);
+            my_ranges.write("\t");
+        }
+        char buffer[32];
+        auto res = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<uint64_t>(line.size()));
+        my_ranges.write(std::string_view(buffer, res.ptr - buffer));
+        if (!number.empty()) {
+            my_ranges.write("\t");
+            my_ranges.write(number);
+        }
+        my_ranges.write("\n");
+    }
+
+    void finish() {
+        my_raw.finish();
+        my_gzip.finish();
+        my_ranges.finish();
+    }
+
+private:
+    TextFileWriter my_raw;
+    ParallelGzipWriter my_gzip, my_ranges;
+};
+
+inline void append_integer(std::string& output, uint64_t value) {
+    char buffer[32];
+    auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, res.ptr - buffer);
+}
+
+template<typename Index_>
+void delta_encode(const Index_* values, size_t n, std::string& output) {
+    output.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (i) {
+            output += '\t';
+            append_integer(output, values[i] - values[i - 1]);
+        } else {
+            append_integer(output, values[i]);
+        }
+    }
+}
+
+template<typename Index_>
+void write_indices(const std::string& path, const FlatIndices<Index_>& indices, const WriteDatabaseOptions& options) {
+    DatabaseFileWriter writer(path, options);
+    std::string line;
+    for (size_t l = 0, end = indices.offsets.size() - 1; l < end; ++l) {
+        auto start = indices.offsets[l];
+        delta_encode(indices.values.data() + start, indices.offsets[l + 1] - start, line);
+        writer.add(line, "", "", "");
+    }
+    writer.finish();
+}
+
+inline void check_text_field(const std::string& value, const char* field, const std::string& where) {
+    if (value.find_first_of("\t\n") != std::string::npos) {
+        throw std::runtime_error(std::string(field) + " for " + where + " should not contain tabs or newlines");
+    }
+}
+
+inline void check_collections(const std::vector<CollectionDetails>& collections, uint64_t num_genes) {
+    uint64_t set_index = 0;
+    for (size_t c = 0, cend = collections.size(); c < cend; ++c) {
+        const auto& coll = collections[c];
+        auto where = "collection " + std::to_string(c);
+        check_text_field(coll.title, "title", where);
+        check_text_field(coll.description, "description", where);
+        check_text_field(coll.maintainer, "maintainer", where);
+        check_text_field(coll.source, "source", where);
+
+        for (const auto& set : coll.sets) {
+            auto swhere = "set " + std::to_string(set_index);
+            check_text_field(set.name, "name", swhere);
+            check_text_field(set.description, "description", swhere);
+            for (auto g : set.genes) {
+                if (g >= num_genes) {
+                    throw std::runtime_error("out-of-range gene index for " + swhere);
+                }
+            }
+            ++set_index;
+        }
+    }
+}
+
+// Sorting the genes in each set, which also lets us check for duplicates before any files are written.
+template<typename Index_>
+FlatIndices<Index_> sorted_set2gene(const std::vector<CollectionDetails>& collections) {
+    FlatIndices<Index_> set2gene;
+    set2gene.offsets.push_back(0);
+    for (const auto& coll : collections) {
+        for (const auto& set : coll.sets) {
+            auto start = set2gene.values.size();
+            set2gene.values.insert(set2gene.values.end(), set.genes.begin(), set.genes.end());
+            auto first = set2gene.values.begin() + start;
+            std::sort(first, set2gene.values.end());
+            if (std::adjacent_find(first, set2gene.values.end()) != set2gene.values.end()) {
+                throw std::runtime_error("duplicate gene indices in set " + std::to_string(set2gene.offsets.size() - 1));
+            }
+            set2gene.offsets.push_back(set2gene.values.size());
+        }
+    }
+    return set2gene;
+}
+
+template<typename Index_>
+void write_database(const std::string& prefix, const std::vector<CollectionDetails>& collections, uint64_t num_genes, const WriteDatabaseOptions& options) {
+    auto set2gene = sorted_set2gene<Index_>(collections);
+    std::string line, number;
+
+    {
+        DatabaseFileWriter writer(prefix + "collections.tsv", options);
+        for (const auto& coll : collections) {
+            line.clear();
+            for (const auto& field : { &coll.title, &coll.description }) {
+                line += *field;
+                line += '\t';
+            }
+            append_integer(line, coll.species);
+            for (const auto& field : { &coll.maintainer, &coll.source }) {
+                line += '\t';
+                line += *field;
+            }
+            number.clear();
+            append_integer(number, coll.sets.size());
+            writer.add(line, "\t" + number, "", number);
+        }
+        writer.finish();
+    }
+
+    // Collecting tokens in the same pass as writing the set details.
+    TokenCollector<Index_> collect_n, collect_d;
+    {
+        DatabaseFileWriter writer(prefix + "sets.tsv", options);
+        uint64_t set_index = 0;
+        for (const auto& coll : collections) {
+            for (const auto& set : coll.sets) {
+                line = set.name;
+                line += '\t';
+                line += set.description;
+                number.clear();
+                append_integer(number, set.genes.size());
+                writer.add(line, "\t" + number, "", number);
+
+                collect_n.add(set_index, set.name);
+                collect_d.add(set_index, set.description);
+
+                ++set_index;
+            }
+        }
+        writer.finish();
+    }
+
+    for (int tt = 0; tt < 2; ++tt) {
+        auto dictionary = (tt == 0 ? collect_n : collect_d).finish();
+        DatabaseFileWriter writer(prefix + (tt == 0 ? "tokens-names.tsv" : "tokens-descriptions.tsv"), options);
+        const auto& sets = dictionary.sets;
+        for (size_t t = 0, end = dictionary.tokens.size(); t < end; ++t) {
+            auto start = sets.offsets[t];
+            delta_encode(sets.values.data() + start, sets.offsets[t + 1] - start, line);
+            writer.add(line, "", dictionary.tokens[t], "");
+        }
+        writer.finish();
+    }
+
+    write_indices(prefix + "set2gene.tsv", set2gene, options);
+    auto gene2set = transpose_indices(set2gene, num_genes);
+    set2gene.offsets.clear();
+    set2gene.offsets.shrink_to_fit();
+    set2gene.values.clear();
+    set2gene.values.shrink_to_fit();
+    write_indices(prefix + "gene2set.tsv", gene2set, options);
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * Write Gesel database files for a particular species, i.e., all files that are checked by `validate_database()`.
+ * This includes the uncompressed files, their Gzip-compressed twins and the `*.ranges.gz` files for the collections, sets, tokens and set-gene mappings.
+ * The tokens are generated from the names and descriptions of the sets, and the mapping from genes to sets is obtained by transposing the mapping from sets to genes.
+ * All inputs are checked for validity so that the output will pass `validate_database()`.
+ *
+ * @param prefix Prefix for the Gesel database files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * The directory should already exist.
+ * @param collections Details for each collection and its sets.
+ * @param num_genes Total number of genes for this species, e.g., from `write_genes()`.
+ * @param options Further options.
+ */
+inline void write_database(const std::string& prefix, const std::vector<CollectionDetails>& collections, uint64_t num_genes, const WriteDatabaseOptions& options) {
+    internal::check_collections(collections, num_genes);
+
+    uint64_t total_sets = 0;
+    for (const auto& coll : collections) {
+        total_sets += coll.sets.size();
+    }
+    if (total_sets <= std::numeric_limits<uint32_t>::max() && num_genes <= std::numeric_limits<uint32_t>::max()) {
+        internal::write_database<uint32_t>(prefix, collections, num_genes, options);
+    } else {
+        internal::write_database<uint64_t>(prefix, collections, num_genes, options);
+    }
+}
+
+/**
+ * Write the gene mapping files for a particular species, i.e., the `<TYPE>.tsv.gz` files that are checked by `validate_genes()`.
+ * All inputs are checked for validity before any files are written.
+ * These files should be written to a different directory from the database files if `validate_genes()` is to find the types automatically,
+ * as the Gzip-compressed database files would otherwise be mistaken for gene mapping files.
+ *
+ * @param prefix Prefix for the gene mapping files.
+ * This should be of the form `<DIRECTORY>/<SPECIES>_`, where `<SPECIES>` is an NCBI taxonomy ID.
+ * The directory should already exist.
+ * @param genes Names of each gene for each type.
+ * There should be at least one type, and all types should have the same number of genes.
+ * @param options Further options.
+ *
+ * @return Total number of genes for this species.
+ */
+inline uint64_t write_genes(const std::string& prefix, const std::vector<GeneNames>& genes, const WriteDatabaseOptions& options) {
+    if (genes.empty()) {
+        throw std::runtime_error("at least one gene name type should be present");
+    }
+    const uint64_t num_genes = genes.front().names.size();
+
+    std::unordered_set<std::string_view> current;
+    for (const auto& entry : genes) {
+        if (static_cast<uint64_t>(entry.names.size()) != num_genes) {
+            throw std::runtime_error("inconsistent number of genes between types (" + std::to_string(num_genes) + " for " + genes.front().type + ", " + std::to_string(entry.names.size()) + " for " + entry.type + ")");
+        }
+        for (size_t g = 0; g < num_genes; ++g) {
+            current.clear();
+            auto where = "gene " + std::to_string(g) + " of type '" + entry.type + "'";
+            for (const auto& name : entry.names[g]) {
+                if (name.empty()) {
+                    throw std::runtime_error("empty name for " + where);
+                }
+                internal::check_text_field(name, "name", where);
+                if (!current.insert(name).second) {
+                    throw std::runtime_error("duplicated names for " + where);
+                }
+            }
+        }
+    }
+
+    std::string line;
+    for (const auto& entry : genes) {
+        internal::ParallelGzipWriter writer(prefix + entry.type + ".tsv.gz", options);
+        for (const auto& names : entry.names) {
+            line.clear();
+            for (const auto& name : names) {
+                if (!line.empty()) {
+                    line += '\t';
+                }
+                line += name;
+            }
+            line += '\n';
+            writer.write(line);
+        }
+        writer.finish();
+    }
+
+    return num_genes;
+}
+
+}
+
+#endif
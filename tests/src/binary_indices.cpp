@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "gesel/binary_indices.hpp"
+#include "gesel/validate_database.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+static std::vector<uint64_t> decode(const std::string& encoded) {
+    std::vector<uint64_t> output;
+    gesel::internal::decode_binary_line(reinterpret_cast<const unsigned char*>(encoded.data()), encoded.size(), output, "foo", 0);
+    return output;
+}
+
+static std::string encode(const std::vector<uint64_t>& values) {
+    std::string output;
+    gesel::internal::encode_binary_line(values.data(), values.size(), output);
+    return output;
+}
+
+TEST(BinaryIndices, Varint) {
+    for (uint64_t x : { static_cast<uint64_t>(0), static_cast<uint64_t>(1), static_cast<uint64_t>(127), static_cast<uint64_t>(128), static_cast<uint64_t>(300), std::numeric_limits<uint64_t>::max() }) {
+        std::string encoded;
+        gesel::internal::append_varint(encoded, x);
+        auto ptr = reinterpret_cast<const unsigned char*>(encoded.data());
+        uint64_t value;
+        EXPECT_EQ(gesel::internal::read_varint(ptr, ptr + encoded.size(), value), ptr + encoded.size());
+        EXPECT_EQ(value, x);
+        EXPECT_EQ(gesel::internal::read_varint(ptr, ptr + encoded.size() - 1, value), nullptr);
+    }
+
+    std::string overflow(9, static_cast<char>(255));
+    overflow += '\2';
+    auto ptr = reinterpret_cast<const unsigned char*>(overflow.data());
+    uint64_t value;
+    EXPECT_EQ(gesel::internal::read_varint(ptr, ptr + overflow.size(), value), nullptr);
+}
+
+TEST(BinaryIndices, Encoding) {
+    EXPECT_EQ(encode({}), "");
+    EXPECT_TRUE(decode("").empty());
+
+    // Checking the layout explicitly: count, control byte, then the little-endian deltas.
+    auto encoded = encode({ 5, 300, 70000, 20000000 });
+    std::string expected{ '\4', static_cast<char>(0 | (1 << 2) | (2 << 4) | (3 << 6)), '\5', static_cast<char>(295 & 255), static_cast<char>(295 >> 8) };
+    for (uint32_t delta : { 70000 - 300, 20000000 - 70000 }) {
+        for (int b = 0, len = gesel::internal::streamvbyte_length(delta); b < len; ++b) {
+            expected += static_cast<char>((delta >> (8 * b)) & 255);
+        }
+    }
+    EXPECT_EQ(encoded, expected);
+    EXPECT_EQ(decode(encoded), std::vector<uint64_t>({ 5, 300, 70000, 20000000 }));
+
+    // Padding bits in the last control byte are zero.
+    encoded = encode({ 0, 1, 2, 3, 4 });
+    EXPECT_EQ(encoded.size(), 1 + 2 + 5);
+    EXPECT_EQ(encoded[2], '\0');
+
+    std::vector<uint64_t> largest{ 0, std::numeric_limits<uint32_t>::max() };
+    EXPECT_EQ(decode(encode(largest)), largest);
+}
+
+TEST(BinaryIndices, RoundTrip) {
+    std::mt19937_64 rng(42);
+    for (size_t n : { 1, 3, 4, 5, 15, 16, 17, 100, 1001 }) {
+        for (uint64_t max_delta : { 2, 200, 60000, 10000000 }) {
+            std::vector<uint64_t> values;
+            uint64_t current = rng() % max_delta;
+            for (size_t i = 0; i < n; ++i) {
+                values.push_back(current);
+                current += 1 + rng() % max_delta;
+            }
+            if (values.back() > std::numeric_limits<uint32_t>::max()) {
+                continue;
+            }
+
+            auto encoded = encode(values);
+            EXPECT_EQ(decode(encoded), values);
+
+            // Comparing the scalar and vectorized decoders directly, as the dispatcher only uses the latter if it is supported.
+            auto ptr = reinterpret_cast<const unsigned char*>(encoded.data());
+            auto end = ptr + encoded.size();
+            uint64_t count;
+            auto control = gesel::internal::read_varint(ptr, end, count);
+            ASSERT_EQ(count, n);
+            auto data = control + (n + 3) / 4;
+
+            std::vector<uint64_t> scalar(n);
+            EXPECT_EQ(gesel::internal::decode_streamvbyte_scalar(control, data, end, n, 0, scalar.data()), end);
+            EXPECT_EQ(scalar, values);
+
+#ifdef GESEL_X86_SIMD
+            if (gesel::internal::simd_support().sse41) {
+                std::vector<uint64_t> vectorized(n);
+                EXPECT_EQ(gesel::internal::decode_streamvbyte_sse41(control, data, end, n, 0, vectorized.data()), end);
+                EXPECT_EQ(vectorized, values);
+
+                // Truncated data is reported in the same way.
+                EXPECT_EQ(gesel::internal::decode_streamvbyte_sse41(control, data, end - 1, n, 0, vectorized.data()), nullptr);
+            }
+#endif
+        }
+    }
+}
+
+TEST(BinaryIndices, DecodeFailures) {
+    std::vector<uint64_t> output;
+    auto decode_error = [&](const std::string& encoded, const std::string& msg) -> void {
+        expect_error([&]() { decode(encoded); }, msg);
+    };
+
+    decode_error(std::string(1, static_cast<char>(128)), "invalid number of indices");
+    decode_error(std::string{ '\3', '\0', '\1', '\1' }, "too small");
+    decode_error(std::string{ '\2', static_cast<char>(4), '\1', '\1' }, "too small"); // second delta needs 2 bytes.
+    decode_error(std::string{ '\1', '\0', '\1', '\1' }, "greater than");
+    decode_error(std::string{ static_cast<char>(255), static_cast<char>(255), static_cast<char>(255), '\1', '\0' }, "too small");
+}
+
+TEST(BinaryIndices, CheckFailures) {
+    std::vector<uint64_t> indices;
+    auto check = [&](const std::string& encoded, uint64_t limit) -> void {
+        auto extra = [](uint64_t, const std::vector<uint64_t>&) -> void {};
+        gesel::internal::check_binary_line(reinterpret_cast<const unsigned char*>(encoded.data()), encoded.size(), limit, indices, "foo", 0, extra);
+    };
+
+    check(encode({ 1, 5, 9 }), 10);
+    expect_error([&]() { check(encode({ 1, 5, 9 }), 9); }, "out-of-range");
+    expect_error([&]() { check(encode({ 10 }), 10); }, "out-of-range");
+    expect_error([&]() { check(std::string{ '\2', '\0', '\1', '\0' }, 10); }, "duplicate");
+
+    // Cumulative sum that overflows 32 bits.
+    std::string wrapped{ '\2', static_cast<char>(3 << 2), '\1', static_cast<char>(255), static_cast<char>(255), static_cast<char>(255), static_cast<char>(255) };
+    expect_error([&]() { check(wrapped, 100); }, "out-of-range");
+
+    // Non-canonical encodings.
+    expect_error([&]() { check(std::string{ '\1', '\1', '\5', '\0' }, 10); }, "non-canonical");
+    expect_error([&]() { check(std::string{ '\1', static_cast<char>(4), '\5' }, 10); }, "non-canonical");
+    expect_error([&]() { check(std::string{ static_cast<char>(129), '\0', '\0', '\5' }, 10); }, "non-canonical");
+}
+
+class TestBinaryIndices : public MockDatabaseTest {};
+
+TEST_F(TestBinaryIndices, Database) {
+    auto path = temp_file_path("binary");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+    gesel::convert_database_to_binary(prefix, max_genes, gesel::WriteDatabaseOptions());
+
+    for (const auto& name : { "set2gene", "gene2set", "tokens-names", "tokens-descriptions" }) {
+        EXPECT_TRUE(std::filesystem::exists(prefix + name + ".bin"));
+        EXPECT_TRUE(std::filesystem::exists(prefix + name + ".bin.ranges.gz"));
+    }
+
+    gesel::ValidateBinaryOptions opt;
+    gesel::validate_binary_database(prefix, max_genes, opt);
+    opt.num_threads = 2;
+    opt.num_index_threads = 3;
+    gesel::validate_binary_database(prefix, max_genes, opt);
+    opt.compare_text = false;
+    opt.memory_map_raw = false;
+    opt.buffer_size = 7;
+    gesel::validate_binary_database(prefix, max_genes, opt);
+
+    // Same indices as the text files when fetched by byte ranges.
+    auto src = std::make_shared<gesel::FileFetcher>(path + "/");
+    gesel::FetchLinesOptions fopt;
+    fopt.max_gap = 5;
+    {
+        gesel::LineFetcher text(src, "9606_gene2set.tsv");
+        gesel::BinaryIndexFetcher binary(src, "9606_gene2set.bin");
+        EXPECT_EQ(binary.num_lines(), text.num_lines());
+        std::vector<size_t> requested{ 19, 0, 5, 6, 6, 12, 1 };
+        EXPECT_EQ(binary.fetch_indices(requested, fopt), text.fetch_indices(requested, fopt));
+        EXPECT_LE(binary.num_requests(requested, fopt), text.num_requests(requested, fopt));
+    }
+    {
+        gesel::LineFetcher text(src, "9606_tokens-names.tsv", gesel::RangesFormat::NAME_AND_BYTES);
+        gesel::BinaryIndexFetcher binary(src, "9606_tokens-names.bin", gesel::RangesFormat::NAME_AND_BYTES);
+        EXPECT_EQ(binary.names(), text.names());
+        auto found = binary.find_name(text.names().front());
+        EXPECT_EQ(found, 0);
+        EXPECT_EQ(binary.find_name("__missing__"), binary.num_lines());
+        expect_error([&]() { binary.line_length(binary.num_lines()); }, "out of range");
+        expect_error([&]() { text.line_length(text.num_lines()); }, "out of range");
+        std::vector<size_t> requested{ found, binary.num_lines() - 1 };
+        EXPECT_EQ(binary.fetch_indices(requested, fopt), text.fetch_indices(requested, fopt));
+    }
+}
+
+TEST_F(TestBinaryIndices, Failures) {
+    auto path = temp_file_path("binary");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+    gesel::convert_database_to_binary(prefix, max_genes, gesel::WriteDatabaseOptions());
+    gesel::ValidateBinaryOptions opt;
+
+    auto copy_path = path + "/copy";
+    std::filesystem::copy_file(prefix + "set2gene.bin", copy_path);
+    auto restore = [&]() -> void {
+        std::filesystem::copy_file(copy_path, prefix + "set2gene.bin", std::filesystem::copy_options::overwrite_existing);
+    };
+
+    expect_error([&]() { gesel::validate_binary_database(prefix, max_genes + 1, opt); }, "total number of genes");
+
+    // Extra trailing byte.
+    {
+        std::ofstream output(prefix + "set2gene.bin", std::ios::binary | std::ios::app);
+        output << '\1';
+    }
+    expect_error([&]() { gesel::validate_binary_database(prefix, max_genes, opt); }, "greater than that expected");
+    opt.num_index_threads = 2; // same error as the parallel failure is repeated in serial.
+    expect_error([&]() { gesel::validate_binary_database(prefix, max_genes, opt); }, "greater than that expected");
+    opt.num_index_threads = 1;
+    restore();
+
+    // Truncated file.
+    std::filesystem::resize_file(prefix + "set2gene.bin", std::filesystem::file_size(copy_path) - 1);
+    expect_error([&]() { gesel::validate_binary_database(prefix, max_genes, opt); }, "less than that expected");
+    restore();
+
+    // Valid binary file with different indices from the text file.
+    gesel::validate_binary_database(prefix, max_genes, opt);
+    {
+        std::string contents;
+        std::vector<uint64_t> bytes;
+        for (uint64_t s = 0; s < 7; ++s) {
+            auto before = contents.size();
+            gesel::internal::encode_binary_line(std::vector<uint64_t>{ s }.data(), 1, contents);
+            bytes.push_back(contents.size() - before);
+        }
+        quick_text_write(prefix + "set2gene.bin", contents);
+        std::string ranges;
+        for (auto b : bytes) {
+            ranges += std::to_string(b) + "\n";
+        }
+        quick_gzip_write(prefix + "set2gene.bin.ranges.gz", ranges);
+    }
+    expect_error([&]() { gesel::validate_binary_database(prefix, max_genes, opt); }, "different indices");
+    opt.compare_text = false;
+    gesel::validate_binary_database(prefix, max_genes, opt);
+    opt.compare_text = true;
+
+    // Wrong number of lines.
+    quick_gzip_write(prefix + "set2gene.bin.ranges.gz", "1\n");
+    expect_error([&]() { gesel::validate_binary_database(prefix, max_genes, opt); }, "total number of sets");
+
+    // Indices that do not fit into 32 bits.
+    expect_error([&]() { gesel::convert_database_to_binary(prefix, static_cast<uint64_t>(1) << 33, gesel::WriteDatabaseOptions()); }, "32-bit");
+}
@@ -8,12 +8,13 @@
 class TestCheckIndices : public ::testing::Test {
 protected:
     template<bool has_gzip_>
-    static void check_indices(const std::string& path, uint64_t limit, const std::vector<uint64_t>& ranges) {
+    static void check_indices(const std::string& path, uint64_t limit, const std::vector<uint64_t>& ranges, const gesel::internal::ReaderOptions& opt = gesel::internal::ReaderOptions()) {
         gesel::internal::check_indices<has_gzip_>(
             path,
             limit,
             ranges,
-            [&](uint64_t, const std::vector<uint64_t>&) {}
+            [&](uint64_t, const std::vector<uint64_t>&) {},
+            opt
         );
     }
 };
@@ -50,6 +51,16 @@ TEST_F(TestCheckIndices, Success) {
 
     ranges = std::vector<uint64_t>{ 8, 1, 12, 6, 0 };
     check_indices<true>(path, 2000, ranges);
+
+    // Works with background reads, with and without memory-mapping of the raw file.
+    gesel::internal::ReaderOptions opt;
+    opt.buffer_size = 5;
+    opt.background_gzip = true;
+    opt.background_raw = true;
+    for (bool mmap : { false, true }) {
+        opt.memory_map_raw = mmap;
+        gesel::internal::check_indices<true>(path, 2000, ranges, [&](uint64_t, const std::vector<uint64_t>&) {}, opt);
+    }
 }
 
 TEST_F(TestCheckIndices, RawFailure) {
@@ -113,3 +124,121 @@ TEST_F(TestCheckIndices, GzipFailure) {
     quick_gzip_write(path + ".gz", "0\n2\t3\n3\n");
     expect_error([&]() { check_indices<true>(path, 10, std::vector<uint64_t>{ 1, 3, 1 }); }, "different indices");
 }
+
+TEST_F(TestCheckIndices, Sharded) {
+    auto path = temp_file_path("check_indices");
+
+    std::string payload = "0\t123\t45\n6\n780\t1\t234\t45\n\n67\t890\n\n5\t5\n";
+    quick_text_write(path, payload);
+    quick_gzip_write(path + ".gz", payload);
+    std::vector<uint64_t> ranges{ 8, 1, 12, 0, 6, 0, 3 };
+
+    for (int nthreads : std::vector<int>{ 2, 3, 10 }) {
+        gesel::internal::ReaderOptions opt;
+        opt.memory_map_raw = true;
+        opt.num_threads = nthreads;
+
+        std::vector<std::vector<uint64_t> > collected(ranges.size());
+        std::vector<std::vector<uint64_t> > expected {
+            { 0, 123, 168 },
+            { 6 },
+            { 780, 781, 1015, 1060 },
+            {},
+            { 67, 957 },
+            {},
+            { 5, 10 }
+        };
+        gesel::internal::check_indices<true>(
+            path,
+            2000,
+            ranges,
+            [&](uint64_t line, const std::vector<uint64_t>& indices) {
+                collected[line] = indices; // each line is only visited by one thread.
+            },
+            opt
+        );
+        EXPECT_EQ(collected, expected);
+
+        // Same errors are reported as in the serial case.
+        expect_error([&]() { check_indices<true>(path, 1000, ranges, opt); }, "out-of-range index in '" + path + "' (line 3)");
+        expect_error([&]() { check_indices<true>(path, 2000, std::vector<uint64_t>{ 8, 1, 12, 0, 6, 0 }, opt); }, "exceeds");
+        expect_error([&]() { check_indices<true>(path, 2000, std::vector<uint64_t>{ 8, 1, 12, 0, 6, 0, 3, 0 }, opt); }, "less than");
+        expect_error([&]() { check_indices<true>(path, 2000, std::vector<uint64_t>{ 8, 1, 11, 1, 6, 0, 3 }, opt); }, "bytes per line");
+
+        quick_gzip_write(path + ".gz", "0\t123\t45\n6\n780\t1\t234\t45\n\n67\t891\n\n5\t5\n");
+        expect_error([&]() { check_indices<true>(path, 2000, ranges, opt); }, "different indices between '" + path + "' and its Gzipped version (line 5)");
+        quick_gzip_write(path + ".gz", "0\t123\t45\n6\n780\t1\t234\t45\n\n67\t890\n");
+        expect_error([&]() { check_indices<true>(path, 2000, ranges, opt); }, "early termination");
+
+        // Trailing bytes in the Gzipped version are ignored, as in the serial case.
+        quick_gzip_write(path + ".gz", payload + "1\n");
+        check_indices<true>(path, 2000, ranges);
+        check_indices<true>(path, 2000, ranges, opt);
+        quick_gzip_write(path + ".gz", payload);
+    }
+}
+
+TEST_F(TestCheckIndices, GzipIndex) {
+    auto path = temp_file_path("check_indices");
+    auto gzpath = path + ".gz";
+    auto idxpath = gzpath + ".zran";
+
+    std::mt19937_64 rng(99);
+    std::string payload;
+    std::vector<uint64_t> ranges;
+    for (int l = 0; l < 20000; ++l) {
+        std::string line = std::to_string(rng() % 1000);
+        for (int i = 0, end = rng() % 5; i < end; ++i) {
+            line += "\t" + std::to_string(rng() % 1000 + 1);
+        }
+        payload += line + "\n";
+        ranges.push_back(line.size());
+    }
+    quick_text_write(path, payload);
+    quick_gzip_write(gzpath, payload);
+
+    gesel::internal::ReaderOptions opt;
+    opt.memory_map_raw = true;
+    opt.num_threads = 3;
+    opt.gzip_index = true;
+    opt.gzip_index_spacing = 10000;
+
+    // No sidecar is saved unless requested.
+    check_indices<true>(path, 1000000, ranges, opt);
+    EXPECT_FALSE(std::filesystem::exists(idxpath));
+
+    opt.save_gzip_index = true;
+    check_indices<true>(path, 1000000, ranges, opt);
+    ASSERT_TRUE(std::filesystem::exists(idxpath));
+    EXPECT_GT(gesel::internal::load_gzip_index(idxpath).checkpoints.size(), 1);
+
+    // Now using the saved sidecar.
+    check_indices<true>(path, 1000000, ranges, opt);
+
+    // Mismatches are still detected with the sidecar, and the same error is reported as in the serial case.
+    auto altered = payload;
+    altered[altered.size() - 2] = (altered[altered.size() - 2] == '1' ? '2' : '1');
+    quick_gzip_write(gzpath, altered);
+    opt.save_gzip_index = false;
+    expect_error([&]() { check_indices<true>(path, 1000000, ranges, opt); }, "different indices");
+
+    auto sidecar = gesel::internal::load_gzip_index(idxpath);
+    quick_gzip_write(gzpath, payload);
+    check_indices<true>(path, 1000000, ranges, opt);
+
+    quick_gzip_write(gzpath, altered);
+    auto gzmapped = gesel::internal::MappedFile::open(gzpath);
+    auto rebuilt = gesel::internal::build_gzip_index(*gzmapped, 10000, [](const unsigned char*, size_t) {});
+    gesel::internal::save_gzip_index(rebuilt, idxpath);
+    expect_error([&]() { check_indices<true>(path, 1000000, ranges, opt); }, "different indices");
+
+    quick_gzip_write(gzpath, payload.substr(0, payload.find('\n', payload.size() / 2) + 1));
+    expect_error([&]() { check_indices<true>(path, 1000000, ranges, opt); }, "early termination");
+
+    // Stale or corrupted sidecars are ignored.
+    quick_gzip_write(gzpath, payload);
+    gesel::internal::save_gzip_index(rebuilt, idxpath);
+    check_indices<true>(path, 1000000, ranges, opt);
+    quick_text_write(idxpath, "foobar");
+    check_indices<true>(path, 1000000, ranges, opt);
+}
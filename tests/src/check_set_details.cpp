@@ -8,7 +8,7 @@
 class TestCheckSetDetails : public ::testing::Test {
 protected:
     static void check_set_details(const std::string& path, const std::vector<uint64_t>& ranges, const std::vector<uint64_t>& sizes) {
-        gesel::internal::check_set_details(path, ranges, sizes, [&](uint64_t, const std::string&, const std::string&) {});
+        gesel::internal::check_set_details(path, ranges, sizes, [&](uint64_t, std::string_view, std::string_view) {});
     }
 };
 
@@ -23,6 +23,25 @@ TEST_F(TestCheckSetDetails, Success) {
     std::vector<uint64_t> ranges { static_cast<uint64_t>(payload1.size()), static_cast<uint64_t>(payload2.size()) };
     std::vector<uint64_t> sizes { 51, 82 };
     check_set_details(path, ranges, sizes);
+
+    // Fields are correctly reported when lines are split across buffers.
+    for (size_t buffer_size : std::vector<size_t>{ 1, 5, 50, 65536 }) {
+        gesel::internal::ReaderOptions opt;
+        opt.buffer_size = buffer_size;
+        std::vector<std::string> collected;
+        gesel::internal::check_set_details(
+            path,
+            ranges,
+            sizes,
+            [&](uint64_t, std::string_view n, std::string_view d) {
+                collected.emplace_back(n);
+                collected.emplace_back(d);
+            },
+            opt
+        );
+        std::vector<std::string> expected { "aaron's set", "this is aaron's set", "another set", "yet another set" };
+        EXPECT_EQ(collected, expected);
+    }
 }
 
 TEST_F(TestCheckSetDetails, Failure) {
@@ -70,8 +89,8 @@ TEST_F(TestCheckSetDetails, Failure) {
             path,
             std::vector<uint64_t>{ r1, r2 },
             std::vector<uint64_t>{ 51, 82 },
-            [&](uint64_t, const std::string& n, const std::string& d) {
-                throw std::runtime_error(n + "\n" + d);
+            [&](uint64_t, std::string_view n, std::string_view d) {
+                throw std::runtime_error(std::string(n) + "\n" + std::string(d));
             }
         );
     }, "aaron");
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <string>
+#include <memory>
+
+#include "gesel/chunked_reader.hpp"
+
+#include "utils.h"
+
+class TestChunkedReader : public ::testing::TestWithParam<std::tuple<bool, int> > {
+protected:
+    static std::string consume(gesel::internal::ChunkedReader& reader) {
+        std::string output;
+        bool valid = reader.valid();
+        while (valid) {
+            EXPECT_EQ(reader.position(), output.size());
+            output += reader.get();
+            valid = reader.advance();
+        }
+        EXPECT_EQ(reader.position(), output.size());
+        return output;
+    }
+};
+
+TEST_P(TestChunkedReader, Basic) {
+    auto param = GetParam();
+    gesel::internal::ReaderOptions opt;
+    opt.buffer_size = std::get<1>(param);
+    opt.background_raw = std::get<0>(param);
+    opt.background_gzip = std::get<0>(param);
+    opt.num_buffers = 2;
+    opt.memory_map_raw = false;
+
+    std::string payload = "Lorem ipsum dolor sit amet, consectetur adipiscing elit,\nsed do eiusmod tempor incididunt ut labore et dolore magna aliqua.\n";
+    auto path = temp_file_path("chunked_reader");
+    quick_text_write(path, payload);
+    quick_gzip_write(path + ".gz", payload);
+
+    {
+        auto reader = gesel::internal::open_raw_reader(path, opt);
+        EXPECT_EQ(consume(reader), payload);
+        EXPECT_FALSE(reader.advance()); // no-op once we're at the end.
+    }
+
+    {
+        auto reader = gesel::internal::open_gzip_reader(path + ".gz", opt);
+        EXPECT_EQ(consume(reader), payload);
+    }
+
+    // Destruction works correctly even if we don't consume everything.
+    {
+        auto reader = gesel::internal::open_gzip_reader(path + ".gz", opt);
+        EXPECT_EQ(reader.get(), 'L');
+        reader.advance();
+        EXPECT_EQ(reader.get(), 'o');
+    }
+
+    // Behaves correctly for empty files.
+    quick_text_write(path, "");
+    {
+        auto reader = gesel::internal::open_raw_reader(path, opt);
+        EXPECT_FALSE(reader.valid());
+        EXPECT_EQ(reader.position(), 0);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ChunkedReader,
+    TestChunkedReader,
+    ::testing::Combine(
+        ::testing::Values(false, true), // whether to read in the background.
+        ::testing::Values(1, 7, 100, 65536) // buffer size.
+    )
+);
+
+TEST(ChunkedReader, MemoryMapped) {
+    std::string payload = "Lorem ipsum dolor sit amet, consectetur adipiscing elit,\nsed do eiusmod tempor incididunt ut labore et dolore magna aliqua.\n";
+    auto path = temp_file_path("chunked_reader");
+    quick_text_write(path, payload);
+
+    gesel::internal::ReaderOptions opt;
+    opt.memory_map_raw = true;
+    {
+        auto reader = gesel::internal::open_raw_reader(path, opt);
+        EXPECT_EQ(reader.chunk_remaining(), payload.size()); // we should be using the mapping on Unix-like systems.
+
+        std::string output;
+        bool valid = reader.valid();
+        while (valid) {
+            output += reader.get();
+            valid = reader.advance();
+        }
+        EXPECT_EQ(output, payload);
+        EXPECT_EQ(reader.position(), payload.size());
+        EXPECT_FALSE(reader.advance());
+        EXPECT_EQ(reader.position(), payload.size());
+    }
+
+    // Works with a subset of the file.
+    {
+        auto mapped = gesel::internal::MappedFile::open(path);
+        gesel::internal::ChunkedReader reader(mapped, 6, 5);
+        EXPECT_EQ(reader.get(), 'i');
+        EXPECT_TRUE(reader.skip(4));
+        EXPECT_EQ(reader.get(), 'm');
+        EXPECT_EQ(reader.position(), 4);
+        EXPECT_FALSE(reader.advance());
+        EXPECT_EQ(reader.position(), 5);
+    }
+
+    quick_text_write(path, "");
+    {
+        auto reader = gesel::internal::open_raw_reader(path, opt);
+        EXPECT_FALSE(reader.valid());
+        EXPECT_EQ(reader.position(), 0);
+    }
+
+    expect_error([&]() { gesel::internal::open_raw_reader(path + "_missing", opt); }, "failed to open");
+}
+
+class FailingReader final : public byteme::Reader {
+public:
+    std::size_t read(unsigned char* buffer, std::size_t n) {
+        if (my_calls == 2) {
+            throw std::runtime_error("oops, failed to read");
+        }
+        ++my_calls;
+        std::fill_n(buffer, n, 'x');
+        return n;
+    }
+private:
+    int my_calls = 0;
+};
+
+TEST(ChunkedReader, Error) {
+    for (int background = 0; background < 2; ++background) {
+        expect_error([&]() {
+            gesel::internal::ChunkedReader reader(std::unique_ptr<byteme::Reader>(new FailingReader), 10, background, 2);
+            while (reader.advance()) {}
+        }, "oops");
+    }
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <cmath>
+
+#include "gesel/enrich.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+class TestEnrich : public MockDatabaseTest {
+protected:
+    // Reference p-value from a direct sum of binomial coefficients.
+    static double reference_p_value(uint64_t overlap, uint64_t set_size, uint64_t num_drawn, uint64_t universe) {
+        auto choose = [](uint64_t n, uint64_t k) -> long double {
+            long double output = 1;
+            for (uint64_t i = 0; i < k; ++i) {
+                output = output * (n - i) / (i + 1);
+            }
+            return output;
+        };
+        long double total = 0;
+        for (uint64_t x = overlap; x <= std::min(set_size, num_drawn); ++x) {
+            if (num_drawn - x <= universe - set_size) {
+                total += choose(set_size, x) * choose(universe - set_size, num_drawn - x);
+            }
+        }
+        return total / choose(universe, num_drawn);
+    }
+
+    static void compare_results(const std::vector<gesel::EnrichResult>& left, const std::vector<gesel::EnrichResult>& right) {
+        ASSERT_EQ(left.size(), right.size());
+        for (size_t i = 0; i < left.size(); ++i) {
+            EXPECT_EQ(left[i].set, right[i].set);
+            EXPECT_EQ(left[i].overlap, right[i].overlap);
+            EXPECT_EQ(left[i].size, right[i].size);
+            EXPECT_EQ(left[i].p_value, right[i].p_value);
+        }
+    }
+};
+
+TEST_F(TestEnrich, HypergeometricTail) {
+    auto lfact = gesel::internal::log_factorials(1000);
+    EXPECT_EQ(lfact[0], 0);
+    EXPECT_EQ(lfact[1], 0);
+    EXPECT_NEAR(lfact[10], std::log(3628800.0), 1e-10);
+
+    for (uint64_t universe : { 20, 100, 1000 }) {
+        for (uint64_t set_size : { 1, 5, 17 }) {
+            for (uint64_t drawn : { 1, 3, 10, 20 }) {
+                for (uint64_t overlap = 1; overlap <= std::min(set_size, drawn); ++overlap) {
+                    if (drawn - overlap > universe - set_size) {
+                        continue;
+                    }
+                    auto observed = gesel::internal::hypergeometric_upper_tail(overlap, set_size, drawn, universe, lfact);
+                    auto expected = reference_p_value(overlap, set_size, drawn, universe);
+                    EXPECT_NEAR(observed, expected, 1e-10 * std::max(1.0, expected));
+                    EXPECT_LT(std::abs(observed - expected) / expected, 1e-8);
+                }
+            }
+        }
+    }
+
+    EXPECT_EQ(gesel::internal::hypergeometric_upper_tail(0, 5, 3, 20, lfact), 1);
+
+    // Tiny p-values are still accurate.
+    auto tiny = gesel::internal::hypergeometric_upper_tail(100, 100, 100, 1000, lfact);
+    EXPECT_GT(tiny, 0);
+    EXPECT_NEAR(std::log(tiny), -(lfact[1000] - lfact[100] - lfact[900]), 1e-8);
+
+    // Tiny overlaps in a large universe, where the probability of the observed overlap underflows but the tail is close to 1.
+    // The tolerance reflects the rounding error in the log-factorials of large numbers.
+    auto big_lfact = gesel::internal::log_factorials(100000);
+    for (uint64_t overlap : { 1, 2, 10, 100 }) {
+        auto observed = gesel::internal::hypergeometric_upper_tail(overlap, 20000, 20000, 100000, big_lfact);
+        EXPECT_TRUE(std::isfinite(observed));
+        EXPECT_NEAR(observed, 1, 1e-7);
+    }
+
+    // Sweeping across the mode (4000) gives a finite, decreasing tail.
+    double last = 1;
+    for (uint64_t overlap = 3000; overlap <= 5000; overlap += 50) {
+        auto observed = gesel::internal::hypergeometric_upper_tail(overlap, 20000, 20000, 100000, big_lfact);
+        EXPECT_TRUE(std::isfinite(observed));
+        EXPECT_LE(observed, last);
+        last = observed;
+    }
+    EXPECT_LT(last, 1e-10);
+
+    // Overlaps below the mode in a small universe are still accurate.
+    for (uint64_t overlap = 1; overlap <= 10; ++overlap) {
+        auto observed = gesel::internal::hypergeometric_upper_tail(overlap, 40, 50, 100, lfact);
+        auto expected = reference_p_value(overlap, 40, 50, 100);
+        EXPECT_LT(std::abs(observed - expected) / expected, 1e-8);
+    }
+}
+
+TEST_F(TestEnrich, Database) {
+    auto path = temp_file_path("enrich");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+    auto db = gesel::load_database(prefix, max_genes);
+
+    std::vector<uint32_t> query{ 2, 3, 9, 13, 13, 0 };
+    auto results = gesel::enrich(db, query, max_genes);
+
+    // Set 2 contains {2, 3, 7, 9, 13} so has the largest overlap.
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(results[0].set, 2);
+    EXPECT_EQ(results[0].overlap, 4);
+    EXPECT_EQ(results[0].size, 5);
+    EXPECT_NEAR(results[0].p_value, reference_p_value(4, 5, 5, max_genes), 1e-12);
+
+    // Checking the overlaps and p-values for each set by brute force.
+    std::vector<uint32_t> unique_query{ 0, 2, 3, 9, 13 };
+    size_t touched = 0;
+    for (size_t s = 0; s < db.num_sets(); ++s) {
+        uint64_t overlap = 0;
+        for (auto g : db.genes_in_set(s)) {
+            overlap += std::count(unique_query.begin(), unique_query.end(), g);
+        }
+        auto it = std::find_if(results.begin(), results.end(), [&](const gesel::EnrichResult& r) -> bool { return r.set == s; });
+        if (overlap == 0) {
+            EXPECT_TRUE(it == results.end());
+            continue;
+        }
+        ++touched;
+        ASSERT_TRUE(it != results.end());
+        EXPECT_EQ(it->overlap, overlap);
+        EXPECT_NEAR(it->p_value, reference_p_value(overlap, db.set_size(s), unique_query.size(), max_genes), 1e-12);
+    }
+    EXPECT_EQ(touched, results.size());
+
+    for (size_t i = 1; i < results.size(); ++i) {
+        EXPECT_LE(results[i - 1].p_value, results[i].p_value);
+    }
+
+    // Same results from the files.
+    std::vector<uint64_t> query64(query.begin(), query.end());
+    compare_results(gesel::enrich(prefix, query64, max_genes), results);
+
+    // Same results with multiple threads.
+    gesel::EnrichOptions opt;
+    opt.num_threads = 3;
+    compare_results(gesel::enrich(db, query, max_genes, opt), results);
+    compare_results(gesel::enrich(prefix, query64, max_genes, opt), results);
+
+    // Top-k results.
+    opt.top_k = 2;
+    auto top = gesel::enrich(db, query, max_genes, opt);
+    ASSERT_EQ(top.size(), 2);
+    compare_results(top, std::vector<gesel::EnrichResult>(results.begin(), results.begin() + 2));
+
+    // Larger universe gives smaller p-values.
+    auto bigger = gesel::enrich(db, query, 1000);
+    EXPECT_LT(bigger[0].p_value, results[0].p_value);
+
+    // Same results with hybrid mappings, for both sparse queries and dense queries that are intersected with each set.
+    gesel::LoadDatabaseOptions lopt;
+    lopt.hybrid_mappings = true;
+    auto hdb = gesel::load_database(prefix, max_genes, lopt);
+    ASSERT_TRUE(hdb.has_hybrid_mappings());
+    compare_results(gesel::enrich(hdb, query, max_genes), results);
+
+    std::vector<uint32_t> dense;
+    for (uint32_t g = 0; g < max_genes; g += 2) {
+        dense.push_back(g);
+    }
+    uint64_t dense_hits = 0;
+    for (auto g : dense) {
+        dense_hits += db.sets_for_gene(g).size();
+    }
+    ASSERT_GE(dense_hits, db.num_sets()); // ensure that the hybrid path is used.
+    auto dense_results = gesel::enrich(db, dense, max_genes);
+    compare_results(gesel::enrich(hdb, dense, max_genes), dense_results);
+    gesel::EnrichOptions hopt;
+    hopt.num_threads = 3;
+    compare_results(gesel::enrich(hdb, dense, max_genes, hopt), dense_results);
+
+    // Empty queries.
+    EXPECT_TRUE(gesel::enrich(db, std::vector<uint32_t>(), max_genes).empty());
+}
+
+TEST_F(TestEnrich, Failures) {
+    auto path = temp_file_path("enrich");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+    auto db = gesel::load_database(prefix, max_genes);
+
+    expect_error([&]() { gesel::enrich(db, std::vector<uint32_t>{ 20 }, 100); }, "out of range");
+    expect_error([&]() { gesel::enrich(db, std::vector<uint32_t>{ 10 }, 10); }, "less than the universe");
+    expect_error([&]() { gesel::enrich(db, std::vector<uint32_t>{ 0, 3, 5 }, 6); }, "set size");
+    expect_error([&]() { gesel::enrich(prefix, std::vector<uint64_t>{ 20 }, 100); }, "out of range");
+}
@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+
+#include "gesel/fetch_ranges.hpp"
+#include "utils.h"
+#include "mock_database.h"
+#include "http_server.h"
+
+class TestFetchRanges : public MockDatabaseTest {
+protected:
+    static void compare_to_ranged(const gesel::RangedFile& ranged, const gesel::LineFetcher& fetcher, const std::vector<size_t>& requested) {
+        for (uint64_t gap : { 0, 5, 1000000 }) {
+            for (int threads : { 1, 3 }) {
+                gesel::FetchLinesOptions opt;
+                opt.max_gap = gap;
+                opt.num_threads = threads;
+                auto lines = fetcher.fetch_lines(requested, opt);
+                auto indices = fetcher.fetch_indices(requested, opt);
+                ASSERT_EQ(lines.size(), requested.size());
+                ASSERT_EQ(indices.size(), requested.size());
+                for (size_t i = 0; i < requested.size(); ++i) {
+                    EXPECT_EQ(lines[i], ranged.read_line(requested[i]));
+                    EXPECT_EQ(indices[i], ranged.read_indices(requested[i]));
+                }
+            }
+        }
+    }
+
+    static void check_fetcher(const std::string& dir, std::shared_ptr<const gesel::RangeFetcher> src) {
+        gesel::RangedFile g2s_ref(dir + "/9606_gene2set.tsv");
+        gesel::LineFetcher g2s(src, "9606_gene2set.tsv");
+        EXPECT_EQ(g2s.num_lines(), max_genes);
+        for (size_t g = 0; g < g2s.num_lines(); ++g) {
+            EXPECT_EQ(g2s.line_length(g), g2s_ref.line_length(g));
+        }
+        compare_to_ranged(g2s_ref, g2s, std::vector<size_t>{ 13, 0, 19, 13, 15, 2, 1 });
+
+        std::vector<size_t> all;
+        for (size_t g = 0; g < g2s.num_lines(); ++g) {
+            all.push_back(g);
+        }
+        compare_to_ranged(g2s_ref, g2s, all);
+
+        gesel::RangedFile sets_ref(dir + "/9606_sets.tsv", gesel::RangesFormat::BYTES_AND_NUMBER);
+        gesel::LineFetcher sets(src, "9606_sets.tsv", gesel::RangesFormat::BYTES_AND_NUMBER);
+        EXPECT_EQ(sets.numbers(), sets_ref.numbers());
+        auto first = sets.fetch_lines(std::vector<size_t>{ 0, 6 }, gesel::FetchLinesOptions());
+        EXPECT_EQ(first[0], "Akira's set\tthis is akira's set");
+        EXPECT_EQ(first[1], sets_ref.read_line(6));
+
+        gesel::LineFetcher tokens(src, "9606_tokens-names.tsv", gesel::RangesFormat::NAME_AND_BYTES);
+        auto t = tokens.find_name("athena");
+        ASSERT_LT(t, tokens.num_lines());
+        auto found = tokens.fetch_indices(std::vector<size_t>{ t }, gesel::FetchLinesOptions());
+        EXPECT_EQ(found[0], std::vector<uint64_t>{ 2 });
+        EXPECT_EQ(tokens.find_name("zzz"), tokens.num_lines());
+    }
+};
+
+TEST_F(TestFetchRanges, Plan) {
+    // Lines of lengths 1, 2, 3, ... so that the gaps are easy to compute.
+    std::vector<uint64_t> bytes;
+    for (uint64_t i = 1; i <= 10; ++i) {
+        bytes.push_back(i);
+    }
+    auto starts = gesel::internal::line_starts(bytes);
+
+    std::vector<size_t> lines{ 5, 1, 2, 5, 9 };
+    auto plan = gesel::internal::plan_line_requests(starts, lines, 0);
+    ASSERT_EQ(plan.requests.size(), 3);
+    EXPECT_EQ(plan.requests[0].start, starts[1]);
+    EXPECT_EQ(plan.requests[0].end, starts[3]);
+    EXPECT_EQ(plan.requests[1].start, starts[5]);
+    EXPECT_EQ(plan.requests[1].end, starts[6]);
+    EXPECT_EQ(plan.requests[1].last - plan.requests[1].first, 2); // duplicates share a request.
+    EXPECT_EQ(plan.requests[2].start, starts[9]);
+    EXPECT_EQ(plan.requests[2].end, starts[10]);
+
+    // The gap between lines 2 and 5 is the 5 + 6 bytes of lines 3 and 4, including the newlines.
+    plan = gesel::internal::plan_line_requests(starts, lines, 10);
+    EXPECT_EQ(plan.requests.size(), 3);
+    plan = gesel::internal::plan_line_requests(starts, lines, 11);
+    EXPECT_EQ(plan.requests.size(), 2);
+    plan = gesel::internal::plan_line_requests(starts, lines, 1000);
+    ASSERT_EQ(plan.requests.size(), 1);
+    EXPECT_EQ(plan.requests[0].start, starts[1]);
+    EXPECT_EQ(plan.requests[0].end, starts[10]);
+
+    plan = gesel::internal::plan_line_requests(starts, std::vector<size_t>(), 1000);
+    EXPECT_TRUE(plan.requests.empty());
+    expect_error([&]() { gesel::internal::plan_line_requests(starts, std::vector<size_t>{ 10 }, 0); }, "out of range");
+}
+
+TEST_F(TestFetchRanges, File) {
+    auto path = temp_file_path("fetch");
+    mock_database(path, "9606_");
+    check_fetcher(path, std::make_shared<gesel::FileFetcher>(path + "/"));
+}
+
+TEST_F(TestFetchRanges, Http) {
+    auto path = temp_file_path("fetch");
+    mock_database(path, "9606_");
+
+    {
+        LocalHttpServer server(path);
+        check_fetcher(path, std::make_shared<gesel::HttpFetcher>(server.url()));
+    }
+
+    // Falling back to the full file if the server ignores ranges.
+    {
+        LocalHttpServer server(path, false);
+        check_fetcher(path, std::make_shared<gesel::HttpFetcher>(server.url()));
+    }
+
+    {
+        LocalHttpServer server(path, true, true);
+        check_fetcher(path, std::make_shared<gesel::HttpFetcher>(server.url()));
+    }
+}
+
+TEST_F(TestFetchRanges, Coalescing) {
+    auto path = temp_file_path("fetch");
+    mock_database(path, "9606_");
+
+    LocalHttpServer server(path);
+    auto src = std::make_shared<gesel::HttpFetcher>(server.url());
+    gesel::LineFetcher g2s(src, "9606_gene2set.tsv");
+    EXPECT_EQ(server.num_requests(), 1); // for the ranges file.
+
+    std::vector<size_t> requested{ 0, 1, 2, 10, 19 };
+    gesel::FetchLinesOptions opt;
+    opt.max_gap = 0;
+    auto expected = g2s.fetch_lines(requested, opt);
+    EXPECT_EQ(g2s.num_requests(requested, opt), 3);
+    EXPECT_EQ(server.num_requests(), 4);
+
+    opt.max_gap = 1000000;
+    EXPECT_EQ(g2s.fetch_lines(requested, opt), expected);
+    EXPECT_EQ(g2s.num_requests(requested, opt), 1);
+    EXPECT_EQ(server.num_requests(), 5);
+}
+
+TEST_F(TestFetchRanges, Failures) {
+    auto path = temp_file_path("fetch");
+    mock_database(path, "9606_");
+
+    auto fsrc = std::make_shared<gesel::FileFetcher>(path + "/");
+    expect_error([&]() { gesel::LineFetcher(fsrc, "9606_missing.tsv"); }, "failed to open");
+
+    // Ranges that extend past the end of the file.
+    std::vector<uint64_t> bytes(max_genes, 100);
+    gesel::LineFetcher bad(fsrc, "9606_gene2set.tsv", bytes);
+    expect_error([&]() { bad.fetch_lines(std::vector<size_t>{ 10 }, gesel::FetchLinesOptions()); }, "outside");
+
+    // Ranges that are not aligned to the lines.
+    gesel::LineFetcher g2s(fsrc, "9606_gene2set.tsv");
+    bytes.clear();
+    for (size_t g = 0; g < g2s.num_lines(); ++g) {
+        bytes.push_back(g2s.line_length(g));
+    }
+    ASSERT_NE(bytes[0], bytes[1]);
+    std::swap(bytes[0], bytes[1]);
+    gesel::LineFetcher misaligned(fsrc, "9606_gene2set.tsv", bytes);
+    expect_error([&]() { misaligned.fetch_lines(std::vector<size_t>{ 0 }, gesel::FetchLinesOptions()); }, "not consistent");
+
+    LocalHttpServer server(path);
+    auto hsrc = std::make_shared<gesel::HttpFetcher>(server.url());
+    expect_error([&]() { gesel::LineFetcher(hsrc, "9606_missing.tsv"); }, "status 404");
+    gesel::LineFetcher hbad(hsrc, "9606_gene2set.tsv", std::vector<uint64_t>(max_genes, 100));
+    expect_error([&]() { hbad.fetch_lines(std::vector<size_t>{ 10 }, gesel::FetchLinesOptions()); }, "outside");
+
+    // Ranges that differ from the request are rejected, even if they have the same length.
+    {
+        LocalHttpServer shifted(path, true, false, 1);
+        auto ssrc = std::make_shared<gesel::HttpFetcher>(shifted.url());
+        std::string buffer(5, '\0');
+        expect_error([&]() { ssrc->fetch("9606_gene2set.tsv", 0, 5, buffer.data()); }, "does not match the requested range");
+    }
+
+    // Unresponsive servers are abandoned after the timeout.
+    {
+        StalledHttpServer stalled;
+        gesel::HttpFetcherOptions hopt;
+        hopt.timeout = 0.2;
+        gesel::HttpFetcher slow(stalled.url(), hopt);
+        auto start = std::chrono::steady_clock::now();
+        expect_error([&]() { slow.fetch_all("9606_gene2set.tsv"); }, "timed out fetching '" + stalled.url() + "9606_gene2set.tsv'");
+        EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 10);
+    }
+
+    expect_error([&]() { gesel::HttpFetcher("https://foo.com/"); }, "http://");
+    expect_error([&]() { gesel::HttpFetcher("http://:80/"); }, "host");
+
+    // Parsing of malformed responses.
+    expect_error([&]() { gesel::internal::parse_http_response("foobar", "url"); }, "malformed");
+    expect_error([&]() { gesel::internal::parse_http_response("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nfoo", "url"); }, "truncated");
+    expect_error([&]() { gesel::internal::parse_http_response("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10\r\nfoo", "url"); }, "truncated");
+    auto res = gesel::internal::parse_http_response("HTTP/1.1 206 Partial Content\r\ncontent-length:  3 \r\n\r\nfoobar", "url");
+    EXPECT_EQ(res.status, 206);
+    EXPECT_EQ(res.body, "foo");
+    EXPECT_FALSE(res.has_range);
+
+    res = gesel::internal::parse_http_response("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 10-12/100\r\nContent-Length: 3\r\n\r\nfoo", "url");
+    EXPECT_TRUE(res.has_range);
+    EXPECT_EQ(res.range_first, 10);
+    EXPECT_EQ(res.range_last, 12);
+}
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "gesel/fingerprint.hpp"
+
+TEST(Fingerprint, OrderIndependent) {
+    auto ref = gesel::internal::compute_fingerprint(std::vector<uint64_t>{ 1, 5, 10, 100 });
+    EXPECT_EQ(ref.count, 4);
+
+    gesel::internal::IndexFingerprint alt;
+    gesel::internal::add_to_fingerprint(alt, 100);
+    gesel::internal::add_to_fingerprint(alt, 5);
+    gesel::internal::add_to_fingerprint(alt, 1);
+    gesel::internal::add_to_fingerprint(alt, 10);
+    EXPECT_TRUE(gesel::internal::same_fingerprints(ref, alt));
+}
+
+TEST(Fingerprint, Different) {
+    auto ref = gesel::internal::compute_fingerprint(std::vector<uint64_t>{ 1, 5, 10, 100 });
+    EXPECT_FALSE(gesel::internal::same_fingerprints(ref, gesel::internal::compute_fingerprint(std::vector<uint64_t>{ 1, 5, 10 })));
+    EXPECT_FALSE(gesel::internal::same_fingerprints(ref, gesel::internal::compute_fingerprint(std::vector<uint64_t>{ 1, 5, 10, 101 })));
+    EXPECT_FALSE(gesel::internal::same_fingerprints(ref, gesel::internal::compute_fingerprint(std::vector<uint64_t>{ 0, 6, 10, 100 })));
+
+    // Empty sets are consistent with each other.
+    EXPECT_TRUE(gesel::internal::same_fingerprints(gesel::internal::IndexFingerprint(), gesel::internal::compute_fingerprint(std::vector<uint64_t>{})));
+}
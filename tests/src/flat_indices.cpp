@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "gesel/flat_indices.hpp"
+
+TEST(FlatIndices, Transpose) {
+    gesel::internal::FlatIndices<uint32_t> forward;
+    forward.offsets = std::vector<uint64_t>{ 0, 3, 3, 5, 9 };
+    forward.values = std::vector<uint32_t>{ 1, 2, 4, /* empty */ 0, 4, 0, 1, 2, 4 };
+
+    auto reverse = gesel::internal::transpose_indices(forward, 6);
+    std::vector<uint64_t> expected_offsets{ 0, 2, 4, 6, 6, 9, 9 };
+    EXPECT_EQ(reverse.offsets, expected_offsets);
+    std::vector<uint32_t> expected_values{ 2, 3, 0, 3, 0, 3, 0, 2, 3 };
+    EXPECT_EQ(reverse.values, expected_values);
+
+    // Transposing again recovers the original.
+    auto again = gesel::internal::transpose_indices(reverse, 4);
+    EXPECT_EQ(again.offsets, forward.offsets);
+    EXPECT_EQ(again.values, forward.values);
+}
+
+TEST(FlatIndices, Empty) {
+    gesel::internal::FlatIndices<uint64_t> forward;
+    forward.offsets.resize(1);
+    auto reverse = gesel::internal::transpose_indices(forward, 3);
+    EXPECT_EQ(reverse.offsets, std::vector<uint64_t>(4));
+    EXPECT_TRUE(reverse.values.empty());
+}
+
+TEST(FlatIndices, Same) {
+    gesel::internal::FlatIndices<uint32_t> flat;
+    flat.offsets = std::vector<uint64_t>{ 0, 3, 3, 5 };
+    flat.values = std::vector<uint32_t>{ 1, 2, 4, 0, 4 };
+
+    EXPECT_TRUE(gesel::internal::same_flat_indices(flat, 0, std::vector<uint64_t>{ 1, 2, 4 }));
+    EXPECT_TRUE(gesel::internal::same_flat_indices(flat, 1, std::vector<uint64_t>{}));
+    EXPECT_TRUE(gesel::internal::same_flat_indices(flat, 2, std::vector<uint64_t>{ 0, 4 }));
+    EXPECT_FALSE(gesel::internal::same_flat_indices(flat, 0, std::vector<uint64_t>{ 1, 2, 5 }));
+    EXPECT_FALSE(gesel::internal::same_flat_indices(flat, 2, std::vector<uint64_t>{ 0 }));
+}
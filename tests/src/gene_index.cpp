@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <random>
+
+#include "gesel/gene_index.hpp"
+#include "utils.h"
+
+class TestGeneIndex : public ::testing::Test {
+protected:
+    static std::string create_directory() {
+        auto path = temp_file_path("gene_index");
+        if (std::filesystem::exists(path)) {
+            std::filesystem::remove_all(path);
+        }
+        std::filesystem::create_directory(path);
+        return path;
+    }
+
+    static std::string mock_genes() {
+        auto path = create_directory();
+        quick_gzip_write(path + "/9606_symbol.tsv.gz", "Alpha\nbravo\tCharlie\nALPHA\talpha\n\ngolf\tBravo\nindia\n");
+        quick_gzip_write(path + "/9606_ensembl.tsv.gz", "ENSG0001\nENSG0002\nENSG0003\nENSG0004\tENSG0005\nENSG0006\nalpha\n");
+        return path + "/9606_";
+    }
+
+    static std::vector<uint64_t> to_vector(gesel::Span<uint64_t> span) {
+        return std::vector<uint64_t>(span.begin(), span.end());
+    }
+};
+
+TEST_F(TestGeneIndex, Exact) {
+    auto prefix = mock_genes();
+    gesel::GeneIndex index(prefix, { "symbol", "ensembl" });
+    EXPECT_EQ(index.num_genes(), 6);
+    EXPECT_EQ(index.types(), std::vector<std::string>({ "symbol", "ensembl" }));
+    EXPECT_EQ(index.type_index("ensembl"), 1);
+    expect_error([&]() { index.type_index("entrez"); }, "unknown gene name type");
+
+    gesel::GeneLookupOptions sym_opt;
+    sym_opt.type = "symbol";
+    EXPECT_EQ(to_vector(index.find("Alpha", sym_opt)), std::vector<uint64_t>{ 0 });
+    EXPECT_EQ(to_vector(index.find("alpha", sym_opt)), std::vector<uint64_t>{ 2 });
+    EXPECT_EQ(to_vector(index.find("ALPHA", sym_opt)), std::vector<uint64_t>{ 2 });
+    EXPECT_EQ(to_vector(index.find("Charlie", sym_opt)), std::vector<uint64_t>{ 1 });
+    EXPECT_TRUE(index.find("charlie", sym_opt).empty());
+    EXPECT_TRUE(index.find("ENSG0001", sym_opt).empty());
+    gesel::GeneLookupOptions ens_opt;
+    ens_opt.type = "ensembl";
+    EXPECT_EQ(to_vector(index.find("ENSG0005", ens_opt)), std::vector<uint64_t>{ 3 });
+
+    // Searching across types.
+    EXPECT_EQ(to_vector(index.find("alpha")), std::vector<uint64_t>({ 2, 5 }));
+    EXPECT_EQ(to_vector(index.find("ENSG0001")), std::vector<uint64_t>{ 0 });
+    EXPECT_TRUE(index.find("foxtrot").empty());
+    EXPECT_TRUE(index.find("").empty());
+    EXPECT_EQ(to_vector(index.find("alpha", ens_opt)), std::vector<uint64_t>{ 5 });
+
+    gesel::GeneLookupOptions bad_opt;
+    bad_opt.type = "entrez";
+    expect_error([&]() { index.find("alpha", bad_opt); }, "unknown gene name type");
+}
+
+TEST_F(TestGeneIndex, CaseInsensitive) {
+    auto prefix = mock_genes();
+    gesel::GeneIndex index(prefix, { "symbol", "ensembl" });
+
+    gesel::GeneLookupOptions opt;
+    opt.case_insensitive = true;
+    EXPECT_EQ(to_vector(index.find("ALPHA", opt)), std::vector<uint64_t>({ 0, 2, 5 }));
+    EXPECT_EQ(to_vector(index.find("ensg0003", opt)), std::vector<uint64_t>{ 2 });
+
+    opt.type = "symbol";
+    EXPECT_EQ(to_vector(index.find("aLpHa", opt)), std::vector<uint64_t>({ 0, 2 }));
+    EXPECT_EQ(to_vector(index.find("BRAVO", opt)), std::vector<uint64_t>({ 1, 4 }));
+    opt.type = "ensembl";
+    EXPECT_EQ(to_vector(index.find("ensg0003", opt)), std::vector<uint64_t>{ 2 });
+
+    gesel::GeneIndexOptions iopt;
+    iopt.case_insensitive = false;
+    gesel::GeneIndex sensitive(prefix, iopt);
+    EXPECT_EQ(sensitive.types().size(), 2);
+    EXPECT_EQ(to_vector(sensitive.find("alpha")), std::vector<uint64_t>({ 2, 5 }));
+    expect_error([&]() { sensitive.find("alpha", opt); }, "case-insensitive");
+}
+
+TEST_F(TestGeneIndex, Complete) {
+    auto prefix = mock_genes();
+    gesel::GeneIndex index(prefix, { "symbol", "ensembl" });
+
+    EXPECT_EQ(index.complete("ENSG000", 3), std::vector<std::string>({ "ENSG0001", "ENSG0002", "ENSG0003" }));
+    EXPECT_EQ(index.complete("ENSG000", 100).size(), 6);
+    EXPECT_EQ(index.complete("al", 10), std::vector<std::string>({ "alpha" })); // not duplicated across types.
+    EXPECT_TRUE(index.complete("zz", 10).empty());
+    EXPECT_EQ(index.complete("", 2), std::vector<std::string>({ "ALPHA", "Alpha" }));
+
+    gesel::GeneLookupOptions opt;
+    opt.case_insensitive = true;
+    EXPECT_EQ(index.complete("AL", 10, opt), std::vector<std::string>({ "ALPHA", "Alpha", "alpha" }));
+    EXPECT_EQ(index.complete("b", 10, opt), std::vector<std::string>({ "Bravo", "bravo" }));
+    EXPECT_EQ(index.complete("", 2, opt), std::vector<std::string>({ "ALPHA", "Alpha" }));
+    EXPECT_EQ(index.complete("ensg", 2, opt), std::vector<std::string>({ "ENSG0001", "ENSG0002" }));
+
+    opt.type = "ensembl";
+    EXPECT_EQ(index.complete("AL", 10, opt), std::vector<std::string>({ "alpha" }));
+}
+
+TEST_F(TestGeneIndex, Resolve) {
+    // Larger example to check that the hash table grows correctly.
+    auto path = create_directory();
+    std::mt19937_64 rng(10);
+    std::string symbols, ids;
+    std::vector<std::vector<std::string> > names;
+    const size_t num_genes = 2000;
+    for (size_t g = 0; g < num_genes; ++g) {
+        std::vector<std::string> current;
+        for (size_t i = 0, n = rng() % 3; i < n; ++i) {
+            current.push_back("Gene" + std::to_string(rng() % 1000) + "_" + std::to_string(i));
+        }
+        for (size_t i = 0; i < current.size(); ++i) {
+            symbols += (i ? "\t" : "") + current[i];
+        }
+        symbols += "\n";
+        ids += "ID" + std::to_string(g) + "\n";
+        names.push_back(current);
+    }
+    quick_gzip_write(path + "/10090_symbol.tsv.gz", symbols);
+    quick_gzip_write(path + "/10090_entrez.tsv.gz", ids);
+
+    gesel::GeneIndex index(path + "/10090_");
+    EXPECT_EQ(index.num_genes(), num_genes);
+
+    // Brute-force reference.
+    std::vector<std::string> queries;
+    std::vector<std::vector<uint64_t> > expected;
+    for (size_t q = 0; q < 500; ++q) {
+        std::string query = (q % 5 == 0 ? "ID" + std::to_string(rng() % (num_genes + 100)) : "Gene" + std::to_string(rng() % 1000) + "_" + std::to_string(rng() % 3));
+        std::vector<uint64_t> genes;
+        for (size_t g = 0; g < num_genes; ++g) {
+            if (std::find(names[g].begin(), names[g].end(), query) != names[g].end() || query == "ID" + std::to_string(g)) {
+                genes.push_back(g);
+            }
+        }
+        queries.push_back(query);
+        expected.push_back(genes);
+    }
+
+    auto resolved = index.resolve(queries);
+    ASSERT_EQ(resolved.size(), queries.size());
+    for (size_t q = 0; q < queries.size(); ++q) {
+        EXPECT_EQ(to_vector(resolved[q]), expected[q]);
+        EXPECT_EQ(to_vector(index.find(queries[q])), expected[q]);
+    }
+
+    gesel::GeneLookupOptions opt;
+    opt.case_insensitive = true;
+    for (auto& q : queries) {
+        for (auto& x : q) {
+            x = std::toupper(x);
+        }
+    }
+    auto upper = index.resolve(queries, opt);
+    for (size_t q = 0; q < queries.size(); ++q) {
+        EXPECT_EQ(to_vector(upper[q]), expected[q]);
+    }
+
+    EXPECT_EQ(index.resolve(std::vector<std::string>()).size(), 0);
+}
+
+TEST_F(TestGeneIndex, Failures) {
+    auto path = create_directory();
+    expect_error([&]() { gesel::GeneIndex index(path + "/9606_"); }, "at least one");
+
+    quick_gzip_write(path + "/9606_symbol.tsv.gz", "alpha\nbravo\tbravo\n");
+    expect_error([&]() { gesel::GeneIndex index(path + "/9606_"); }, "duplicated");
+
+    quick_gzip_write(path + "/9606_symbol.tsv.gz", "alpha\nbravo\n");
+    quick_gzip_write(path + "/9606_ensembl.tsv.gz", "alpha\n");
+    expect_error([&]() { gesel::GeneIndex index(path + "/9606_"); }, "inconsistent");
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "gesel/gzip_index.hpp"
+
+#include "utils.h"
+
+#include <fstream>
+#include <iterator>
+
+class TestGzipIndex : public ::testing::Test {
+protected:
+    static std::string mock_contents(size_t num_lines, int seed) {
+        std::mt19937_64 rng(seed);
+        std::string output;
+        for (size_t l = 0; l < num_lines; ++l) {
+            size_t nfields = rng() % 10;
+            for (size_t f = 0; f < nfields; ++f) {
+                if (f) {
+                    output += '\t';
+                }
+                output += std::to_string(rng() % 100000);
+            }
+            output += '\n';
+        }
+        return output;
+    }
+
+    static std::string slurp(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // Concatenating multiple Gzip members, as done by pigz.
+    static void multi_gzip_write(const std::string& path, const std::vector<std::string>& members, const std::string& trailing = "") {
+        std::string combined;
+        for (const auto& m : members) {
+            auto tmp = temp_file_path("gzip_index_member");
+            quick_gzip_write(tmp, m);
+            combined += slurp(tmp);
+        }
+        combined += trailing;
+        quick_text_write(path, combined);
+    }
+
+    static std::string inflate_span(const gesel::internal::MappedFile& gz, const gesel::internal::GzipIndex& index, size_t span) {
+        const auto& points = index.checkpoints;
+        uint64_t end = (span + 1 < points.size() ? points[span + 1].uncompressed : index.uncompressed_size);
+        std::string output;
+        auto produced = gesel::internal::inflate_from_checkpoint(gz, points[span], end - points[span].uncompressed, [&](const unsigned char* ptr, size_t n) {
+            output.insert(output.end(), ptr, ptr + n);
+        });
+        EXPECT_EQ(produced, output.size());
+        return output;
+    }
+
+    static void check_index(const std::string& path, const std::string& expected, uint64_t spacing) {
+        auto gz = gesel::internal::MappedFile::open(path);
+        ASSERT_TRUE(gz);
+
+        std::string full;
+        auto index = gesel::internal::build_gzip_index(*gz, spacing, [&](const unsigned char* ptr, size_t n) {
+            full.insert(full.end(), ptr, ptr + n);
+        });
+        EXPECT_EQ(full, expected);
+        EXPECT_EQ(index.uncompressed_size, expected.size());
+        ASSERT_FALSE(index.checkpoints.empty());
+        EXPECT_EQ(index.checkpoints.front().uncompressed, 0);
+
+        std::string reconstructed;
+        for (size_t s = 0, end = index.checkpoints.size(); s < end; ++s) {
+            auto span = inflate_span(*gz, index, s);
+            EXPECT_EQ(span, expected.substr(index.checkpoints[s].uncompressed, span.size()));
+            reconstructed += span;
+        }
+        EXPECT_EQ(reconstructed, expected);
+
+        // Reading past the end of a span runs to the end of the file.
+        const auto& last = index.checkpoints.back();
+        std::string tail;
+        auto produced = gesel::internal::inflate_from_checkpoint(*gz, index.checkpoints.front(), expected.size() + 100, [&](const unsigned char* ptr, size_t n) {
+            tail.insert(tail.end(), ptr, ptr + n);
+        });
+        EXPECT_EQ(produced, expected.size());
+        EXPECT_EQ(tail, expected);
+        EXPECT_LE(last.window.size(), gesel::internal::gzip_window_size);
+    }
+};
+
+TEST_F(TestGzipIndex, SingleMember) {
+    auto path = temp_file_path("gzip_index");
+    auto contents = mock_contents(100000, 42);
+    quick_gzip_write(path, contents);
+
+    check_index(path, contents, 1);
+    check_index(path, contents, 100000);
+    check_index(path, contents, 1000000000);
+
+    auto gz = gesel::internal::MappedFile::open(path);
+    auto index = gesel::internal::build_gzip_index(*gz, 1, [](const unsigned char*, size_t) {});
+    EXPECT_GT(index.checkpoints.size(), 1);
+}
+
+TEST_F(TestGzipIndex, MultipleMembers) {
+    auto path = temp_file_path("gzip_index");
+    std::vector<std::string> members { mock_contents(20000, 1), "", mock_contents(50000, 2), mock_contents(10, 3) };
+    std::string combined;
+    for (const auto& m : members) {
+        combined += m;
+    }
+
+    multi_gzip_write(path, members);
+    check_index(path, combined, 1);
+    check_index(path, combined, 50000);
+
+    // Trailing garbage is ignored.
+    multi_gzip_write(path, members, "foobar");
+    check_index(path, combined, 1);
+}
+
+TEST_F(TestGzipIndex, Failures) {
+    auto path = temp_file_path("gzip_index");
+    quick_text_write(path, "this is not a gzip file");
+    auto gz = gesel::internal::MappedFile::open(path);
+    expect_error([&]() { gesel::internal::build_gzip_index(*gz, 1, [](const unsigned char*, size_t) {}); }, "failed to decompress");
+
+    auto contents = mock_contents(1000, 42);
+    quick_gzip_write(path, contents);
+    auto full = slurp(path);
+    quick_text_write(path, full.substr(0, full.size() / 2));
+    gz = gesel::internal::MappedFile::open(path);
+    expect_error([&]() { gesel::internal::build_gzip_index(*gz, 1, [](const unsigned char*, size_t) {}); }, "unexpected end");
+}
+
+TEST_F(TestGzipIndex, Sidecar) {
+    auto path = temp_file_path("gzip_index");
+    auto contents = mock_contents(100000, 42);
+    quick_gzip_write(path, contents);
+
+    auto gz = gesel::internal::MappedFile::open(path);
+    auto index = gesel::internal::build_gzip_index(*gz, 100000, [](const unsigned char*, size_t) {});
+    EXPECT_TRUE(gesel::internal::gzip_index_matches(index, *gz));
+
+    auto idxpath = path + ".zran";
+    gesel::internal::save_gzip_index(index, idxpath);
+    auto reloaded = gesel::internal::load_gzip_index(idxpath);
+    EXPECT_TRUE(gesel::internal::gzip_index_matches(reloaded, *gz));
+    EXPECT_EQ(reloaded.uncompressed_size, index.uncompressed_size);
+    ASSERT_EQ(reloaded.checkpoints.size(), index.checkpoints.size());
+    for (size_t s = 0, end = index.checkpoints.size(); s < end; ++s) {
+        const auto& left = reloaded.checkpoints[s];
+        const auto& right = index.checkpoints[s];
+        EXPECT_EQ(left.compressed, right.compressed);
+        EXPECT_EQ(left.uncompressed, right.uncompressed);
+        EXPECT_EQ(left.bits, right.bits);
+        EXPECT_EQ(left.window, right.window);
+        EXPECT_EQ(inflate_span(*gz, reloaded, s), inflate_span(*gz, index, s));
+    }
+
+    // Detecting stale indices.
+    quick_gzip_write(path, mock_contents(100000, 43));
+    auto gz2 = gesel::internal::MappedFile::open(path);
+    EXPECT_FALSE(gesel::internal::gzip_index_matches(reloaded, *gz2));
+
+    // Detecting corrupted indices.
+    auto raw = slurp(idxpath);
+    quick_text_write(idxpath, raw.substr(0, raw.size() - 1));
+    expect_error([&]() { gesel::internal::load_gzip_index(idxpath); }, "unexpected end");
+    quick_text_write(idxpath, "FOOBAR");
+    expect_error([&]() { gesel::internal::load_gzip_index(idxpath); }, "unrecognized");
+    expect_error([&]() { gesel::internal::load_gzip_index(idxpath + ".missing"); }, "failed to open");
+}
@@ -0,0 +1,241 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <string>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <cstdio>
+#include <algorithm>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+/*
+ * Minimal static file server on the loopback interface, standing in for the web server that hosts the database files.
+ * This supports single byte ranges in the 'Range' header, and can be configured to ignore ranges or use chunked transfer encoding to mimic less capable servers.
+ * A non-zero 'range_shift' mimics a misbehaving proxy by returning a range of the same length that starts 'range_shift' bytes later, where possible.
+ * Connections are handled one at a time, with concurrent clients waiting in the listen queue.
+ */
+class LocalHttpServer {
+public:
+    LocalHttpServer(std::string directory, bool honor_ranges = true, bool chunked = false, uint64_t range_shift = 0) :
+        my_directory(std::move(directory)), my_honor_ranges(honor_ranges), my_chunked(chunked), my_range_shift(range_shift)
+    {
+        my_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (my_listener < 0) {
+            throw std::runtime_error("failed to create a socket");
+        }
+        int yes = 1;
+        setsockopt(my_listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0; // any free port.
+        if (::bind(my_listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(my_listener, 64) != 0) {
+            ::close(my_listener);
+            throw std::runtime_error("failed to listen on the loopback interface");
+        }
+
+        socklen_t len = sizeof(addr);
+        getsockname(my_listener, reinterpret_cast<sockaddr*>(&addr), &len);
+        my_port = ntohs(addr.sin_port);
+
+        my_thread = std::thread([this]() { serve(); });
+    }
+
+    ~LocalHttpServer() {
+        my_stopping = true;
+
+        // Waking up the accept() call with a dummy connection.
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(my_port);
+        ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::close(fd);
+
+        my_thread.join();
+        ::close(my_listener);
+    }
+
+    LocalHttpServer(const LocalHttpServer&) = delete;
+    LocalHttpServer& operator=(const LocalHttpServer&) = delete;
+
+public:
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(my_port) + "/";
+    }
+
+    size_t num_requests() const {
+        return my_requests;
+    }
+
+private:
+    void serve() {
+        while (true) {
+            int client = ::accept(my_listener, NULL, NULL);
+            if (my_stopping) {
+                if (client >= 0) {
+                    ::close(client);
+                }
+                break;
+            }
+            if (client < 0) {
+                continue;
+            }
+            handle(client);
+            ::close(client);
+        }
+    }
+
+    static void send_all(int fd, const std::string& message) {
+        size_t sent = 0;
+        while (sent < message.size()) {
+            auto n = ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += n;
+        }
+    }
+
+    static void respond(int fd, const std::string& status, const std::string& body, const std::string& extra = "", bool chunked = false) {
+        std::string message = "HTTP/1.1 " + status + "\r\n" + extra + "Connection: close\r\n";
+        if (chunked) {
+            message += "Transfer-Encoding: chunked\r\n\r\n";
+            for (size_t pos = 0; pos < body.size(); pos += 1000) {
+                auto piece = body.substr(pos, 1000);
+                char size[32];
+                std::snprintf(size, sizeof(size), "%zx", piece.size());
+                message += std::string(size) + "\r\n" + piece + "\r\n";
+            }
+            message += "0\r\n\r\n";
+        } else {
+            message += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        }
+        send_all(fd, message);
+    }
+
+    void handle(int fd) {
+        std::string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            auto n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            request.append(buffer, n);
+        }
+        ++my_requests;
+
+        auto first_space = request.find(' ');
+        auto second_space = request.find(' ', first_space + 1);
+        if (request.compare(0, first_space, "GET") != 0 || second_space == std::string::npos) {
+            respond(fd, "405 Method Not Allowed", "");
+            return;
+        }
+        auto target = request.substr(first_space + 1, second_space - first_space - 1);
+        if (target.empty() || target[0] != '/' || target.find("..") != std::string::npos) {
+            respond(fd, "404 Not Found", "");
+            return;
+        }
+
+        std::ifstream in(my_directory + target, std::ios::binary);
+        if (!in) {
+            respond(fd, "404 Not Found", "");
+            return;
+        }
+        std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        auto range_pos = request.find("\r\nRange: bytes=");
+        if (!my_honor_ranges || range_pos == std::string::npos) {
+            respond(fd, "200 OK", contents, "", my_chunked);
+            return;
+        }
+
+        unsigned long long start = 0, end = 0;
+        if (std::sscanf(request.c_str() + range_pos, "\r\nRange: bytes=%llu-%llu", &start, &end) != 2 || start > end || start >= contents.size()) {
+            respond(fd, "416 Range Not Satisfiable", "", "Content-Range: bytes */" + std::to_string(contents.size()) + "\r\n");
+            return;
+        }
+        end = std::min<unsigned long long>(end, contents.size() - 1);
+        if (my_range_shift && end + my_range_shift < contents.size()) {
+            start += my_range_shift;
+            end += my_range_shift;
+        }
+        respond(
+            fd,
+            "206 Partial Content",
+            contents.substr(start, end - start + 1),
+            "Content-Range: bytes " + std::to_string(start) + "-" + std::to_string(end) + "/" + std::to_string(contents.size()) + "\r\n",
+            my_chunked
+        );
+    }
+
+private:
+    std::string my_directory;
+    bool my_honor_ranges, my_chunked;
+    uint64_t my_range_shift;
+    int my_listener = -1;
+    int my_port = 0;
+    std::atomic<bool> my_stopping = false;
+    std::atomic<size_t> my_requests = 0;
+    std::thread my_thread;
+};
+
+/*
+ * Server that accepts connections into its listen queue but never reads or responds, to mimic an unresponsive host.
+ */
+class StalledHttpServer {
+public:
+    StalledHttpServer() {
+        my_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (my_listener < 0) {
+            throw std::runtime_error("failed to create a socket");
+        }
+
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (::bind(my_listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(my_listener, 64) != 0) {
+            ::close(my_listener);
+            throw std::runtime_error("failed to listen on the loopback interface");
+        }
+
+        socklen_t len = sizeof(addr);
+        getsockname(my_listener, reinterpret_cast<sockaddr*>(&addr), &len);
+        my_port = ntohs(addr.sin_port);
+    }
+
+    ~StalledHttpServer() {
+        ::close(my_listener);
+    }
+
+    StalledHttpServer(const StalledHttpServer&) = delete;
+    StalledHttpServer& operator=(const StalledHttpServer&) = delete;
+
+public:
+    std::string url() const {
+        return "http://127.0.0.1:" + std::to_string(my_port) + "/";
+    }
+
+private:
+    int my_listener = -1;
+    int my_port = 0;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+
+#include "gesel/hybrid_set.hpp"
+
+class TestHybridSet : public ::testing::Test {
+protected:
+    // Values are drawn from a few regions of varying density, so that some chunks are arrays and others are bitmaps.
+    static std::vector<uint32_t> random_sorted(std::mt19937_64& rng, const std::vector<std::pair<uint32_t, double> >& regions) {
+        std::vector<uint32_t> output;
+        std::uniform_real_distribution<double> unif;
+        for (const auto& reg : regions) {
+            uint32_t start = reg.first << 16;
+            for (uint32_t i = 0; i < 65536; ++i) {
+                if (unif(rng) < reg.second) {
+                    output.push_back(start + i);
+                }
+            }
+        }
+        return output;
+    }
+
+    static std::vector<std::vector<uint32_t> > mock_sets() {
+        std::mt19937_64 rng(42);
+        std::vector<std::vector<uint32_t> > output;
+        for (double density : { 0.0, 0.0001, 0.01, 0.05, 0.07, 0.2, 0.9, 1.0 }) {
+            output.push_back(random_sorted(rng, { { 0, density } }));
+            output.push_back(random_sorted(rng, { { 0, density }, { 1, 0.5 }, { 3, 0.001 } }));
+            output.push_back(random_sorted(rng, { { 1, 0.01 }, { 2, density }, { 100, density } }));
+        }
+        return output;
+    }
+};
+
+TEST_F(TestHybridSet, Basic) {
+    gesel::HybridSet empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.size(), 0);
+    EXPECT_FALSE(empty.contains(0));
+
+    std::vector<uint64_t> values { 1, 5, 100, 65535, 65536, 1000000, 123456789012 };
+    gesel::HybridSet set(values);
+    EXPECT_EQ(set.size(), values.size());
+    EXPECT_EQ(set.view().num_chunks(), 4);
+    EXPECT_EQ(set.view().num_bitmaps(), 0);
+    EXPECT_EQ(set.to_vector<uint64_t>(), values);
+    for (auto v : values) {
+        EXPECT_TRUE(set.contains(v));
+        EXPECT_EQ(set.contains(v + 1), std::binary_search(values.begin(), values.end(), v + 1));
+    }
+
+    std::vector<uint32_t> unsorted { 1, 3, 2 };
+    EXPECT_ANY_THROW(gesel::HybridSet{ unsorted });
+    std::vector<uint32_t> duplicated { 1, 2, 2 };
+    EXPECT_ANY_THROW(gesel::HybridSet{ duplicated });
+    std::vector<uint32_t> across { 65537, 65536 };
+    EXPECT_ANY_THROW(gesel::HybridSet{ across });
+    std::vector<uint64_t> too_large { static_cast<uint64_t>(1) << 48 };
+    EXPECT_ANY_THROW(gesel::HybridSet{ too_large });
+}
+
+TEST_F(TestHybridSet, Representation) {
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < 4096; ++i) {
+        values.push_back(i * 16);
+    }
+    gesel::HybridSet at_limit(values);
+    EXPECT_EQ(at_limit.view().num_bitmaps(), 0);
+    EXPECT_EQ(at_limit.to_vector(), values);
+
+    values.push_back(65535);
+    gesel::HybridSet over_limit(values);
+    EXPECT_EQ(over_limit.view().num_bitmaps(), 1);
+    EXPECT_EQ(over_limit.to_vector(), values);
+    EXPECT_TRUE(over_limit.contains(65535));
+    EXPECT_FALSE(over_limit.contains(65534));
+
+    // Intersection of two bitmaps is converted back to an array if it is small enough.
+    std::vector<uint32_t> evens, odds_plus;
+    for (uint32_t i = 0; i < 65536; i += 2) {
+        evens.push_back(i);
+    }
+    for (uint32_t i = 1; i < 65536; i += 2) {
+        odds_plus.push_back(i);
+        if (i % 64 == 1) {
+            odds_plus.push_back(i + 1);
+        }
+    }
+    std::sort(odds_plus.begin(), odds_plus.end());
+    auto combined = gesel::hybrid_intersect(gesel::HybridSet(evens), gesel::HybridSet(odds_plus));
+    EXPECT_EQ(combined.view().num_bitmaps(), 0);
+    EXPECT_EQ(combined.size(), 1024);
+
+    // Union of two arrays is converted to a bitmap if it is large enough.
+    std::vector<uint32_t> first(evens.begin(), evens.begin() + 3000), second(odds_plus.begin(), odds_plus.begin() + 3000);
+    auto merged = gesel::hybrid_union(gesel::HybridSet(first), gesel::HybridSet(second));
+    EXPECT_EQ(merged.view().num_bitmaps(), 1);
+    std::vector<uint32_t> expected;
+    std::set_union(first.begin(), first.end(), second.begin(), second.end(), std::back_inserter(expected));
+    EXPECT_EQ(merged.to_vector(), expected);
+}
+
+TEST_F(TestHybridSet, Operations) {
+    auto sets = mock_sets();
+    std::vector<gesel::HybridSet> hybrids;
+    for (const auto& s : sets) {
+        hybrids.emplace_back(s);
+        EXPECT_EQ(hybrids.back().to_vector(), s);
+        EXPECT_EQ(hybrids.back().size(), s.size());
+    }
+
+    for (size_t i = 0; i < sets.size(); ++i) {
+        for (size_t j = 0; j < sets.size(); ++j) {
+            const auto& left = sets[i];
+            const auto& right = sets[j];
+
+            std::vector<uint32_t> expected;
+            std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(expected));
+            auto intersection = gesel::hybrid_intersect(hybrids[i], hybrids[j]);
+            EXPECT_EQ(intersection.to_vector(), expected);
+            EXPECT_EQ(gesel::hybrid_intersection_size(hybrids[i], hybrids[j]), expected.size());
+
+            // Checking that the representation is canonical, i.e., the same as building the set from scratch.
+            gesel::HybridSet reference(expected);
+            EXPECT_EQ(intersection.view().num_bitmaps(), reference.view().num_bitmaps());
+
+            expected.clear();
+            std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(expected));
+            auto united = gesel::hybrid_union(hybrids[i], hybrids[j]);
+            EXPECT_EQ(united.to_vector(), expected);
+            EXPECT_EQ(united.view().num_bitmaps(), gesel::HybridSet(expected).view().num_bitmaps());
+        }
+    }
+}
+
+TEST_F(TestHybridSet, Galloping) {
+    std::vector<uint32_t> dense, sparse;
+    for (uint32_t i = 0; i < 4000; ++i) {
+        dense.push_back(i * 3);
+    }
+    for (uint32_t i = 0; i < 20; ++i) {
+        sparse.push_back(i * 500 + 1);
+    }
+    std::vector<uint32_t> expected;
+    std::set_intersection(dense.begin(), dense.end(), sparse.begin(), sparse.end(), std::back_inserter(expected));
+    EXPECT_FALSE(expected.empty());
+
+    gesel::HybridSet hdense(dense), hsparse(sparse);
+    EXPECT_EQ(gesel::hybrid_intersect(hdense, hsparse).to_vector(), expected);
+    EXPECT_EQ(gesel::hybrid_intersect(hsparse, hdense).to_vector(), expected);
+    EXPECT_EQ(gesel::hybrid_intersection_size(hsparse, hdense), expected.size());
+}
+
+TEST_F(TestHybridSet, Indices) {
+    auto sets = mock_sets();
+    gesel::HybridIndices indices(sets);
+    EXPECT_EQ(indices.num_rows(), sets.size());
+    for (size_t i = 0; i < sets.size(); ++i) {
+        EXPECT_EQ(indices.row(i).to_vector(), sets[i]);
+    }
+    EXPECT_GT(indices.memory_usage(), 0);
+
+    gesel::internal::FlatIndices<uint32_t> flat;
+    flat.offsets.push_back(0);
+    for (const auto& s : sets) {
+        flat.values.insert(flat.values.end(), s.begin(), s.end());
+        flat.offsets.push_back(flat.values.size());
+    }
+    gesel::HybridIndices from_flat(flat);
+    EXPECT_EQ(from_flat.num_rows(), sets.size());
+    for (size_t i = 0; i < sets.size(); ++i) {
+        EXPECT_EQ(from_flat.row(i).to_vector(), sets[i]);
+        EXPECT_EQ(gesel::hybrid_intersection_size(from_flat.row(i), indices.row(sets.size() - i - 1)), gesel::hybrid_intersect(indices.row(i), indices.row(sets.size() - i - 1)).size());
+    }
+
+    gesel::HybridIndices empty;
+    EXPECT_EQ(empty.num_rows(), 0);
+}
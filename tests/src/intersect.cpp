@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "gesel/intersect.hpp"
+
+template<typename Value_>
+class TestIntersectKernels : public ::testing::Test {
+protected:
+    static std::vector<Value_> random_sorted(std::mt19937_64& rng, size_t n, uint64_t max) {
+        std::vector<Value_> output;
+        for (size_t i = 0; i < n; ++i) {
+            output.push_back(rng() % max);
+        }
+        std::sort(output.begin(), output.end());
+        output.erase(std::unique(output.begin(), output.end()), output.end());
+        return output;
+    }
+
+    typedef size_t (*Kernel)(const Value_*, size_t, const Value_*, size_t, Value_*);
+
+    static void check_intersect(Kernel stored, Kernel counted, const std::vector<Value_>& left, const std::vector<Value_>& right) {
+        std::vector<Value_> expected;
+        std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(expected));
+
+        std::vector<Value_> observed(gesel::internal::intersect_capacity(left.size(), right.size()));
+        observed.resize(stored(left.data(), left.size(), right.data(), right.size(), observed.data()));
+        EXPECT_EQ(observed, expected);
+        EXPECT_EQ(counted(left.data(), left.size(), right.data(), right.size(), NULL), expected.size());
+    }
+
+    static void check_union(Kernel fun, const std::vector<Value_>& left, const std::vector<Value_>& right) {
+        std::vector<Value_> expected;
+        std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(expected));
+        std::vector<Value_> observed(gesel::internal::union_capacity(left.size(), right.size()));
+        observed.resize(fun(left.data(), left.size(), right.data(), right.size(), observed.data()));
+        EXPECT_EQ(observed, expected);
+    }
+
+    // Runs 'fun' on a variety of pairs, covering short tails, disjoint and identical arrays, and the extremes of the value type.
+    template<class Function_>
+    static void for_each_pair(Function_ fun) {
+        std::mt19937_64 rng(Value_(1234));
+        for (size_t left_size : { 0, 1, 3, 4, 5, 8, 17, 100, 1000 }) {
+            for (size_t right_size : { 0, 2, 4, 7, 16, 33, 500, 2000 }) {
+                for (uint64_t max : { 50, 2000, 100000 }) {
+                    auto left = random_sorted(rng, left_size, max);
+                    auto right = random_sorted(rng, right_size, max);
+                    fun(left, right);
+                    fun(right, left);
+                    fun(left, left);
+                }
+            }
+        }
+
+        constexpr Value_ top = std::numeric_limits<Value_>::max();
+        std::vector<Value_> extremes{ 0, 1, top - 4, top - 3, top - 2, top - 1, top };
+        std::vector<Value_> low{ 0, 1, 2, 3, 4, 5, 6, 7 };
+        fun(extremes, low);
+        fun(low, extremes);
+        fun(extremes, extremes);
+
+        std::vector<Value_> evens, odds;
+        for (Value_ i = 0; i < 100; ++i) {
+            (i % 2 ? odds : evens).push_back(i);
+        }
+        fun(evens, odds);
+    }
+};
+
+typedef ::testing::Types<uint32_t, uint64_t> IntersectKernelTypes;
+TYPED_TEST_SUITE(TestIntersectKernels, IntersectKernelTypes);
+
+TYPED_TEST(TestIntersectKernels, Scalar) {
+    this->for_each_pair([&](const std::vector<TypeParam>& left, const std::vector<TypeParam>& right) -> void {
+        this->check_intersect(gesel::internal::intersect_scalar<true, TypeParam>, gesel::internal::intersect_scalar<false, TypeParam>, left, right);
+        this->check_union(gesel::internal::union_scalar<TypeParam>, left, right);
+    });
+}
+
+TYPED_TEST(TestIntersectKernels, Dispatch) {
+    this->for_each_pair([&](const std::vector<TypeParam>& left, const std::vector<TypeParam>& right) -> void {
+        this->check_intersect(gesel::internal::intersect_kernel<true, TypeParam>, gesel::internal::intersect_kernel<false, TypeParam>, left, right);
+        this->check_union(gesel::internal::union_kernel<TypeParam>, left, right);
+
+        std::vector<TypeParam> expected;
+        std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(expected));
+        std::vector<TypeParam> observed;
+        gesel::internal::intersect_pair(left.data(), left.size(), right.data(), right.size(), observed);
+        EXPECT_EQ(observed, expected);
+        EXPECT_EQ(gesel::internal::intersect_count(left.data(), left.size(), right.data(), right.size()), expected.size());
+
+        std::vector<TypeParam> combined;
+        std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(combined));
+        gesel::internal::union_pair(left.data(), left.size(), right.data(), right.size(), observed);
+        EXPECT_EQ(observed, combined);
+    });
+}
+
+#ifdef GESEL_X86_SIMD
+TYPED_TEST(TestIntersectKernels, Simd) {
+    const auto& support = gesel::internal::simd_support();
+    if constexpr(sizeof(TypeParam) == 4) {
+        if (!support.sse41) {
+            GTEST_SKIP() << "SSE4.1 is not supported";
+        }
+        this->for_each_pair([&](const std::vector<TypeParam>& left, const std::vector<TypeParam>& right) -> void {
+            this->check_intersect(gesel::internal::intersect_sse41<true, TypeParam>, gesel::internal::intersect_sse41<false, TypeParam>, left, right);
+            this->check_union(gesel::internal::union_sse41<TypeParam>, left, right);
+        });
+    } else {
+        if (!support.avx2) {
+            GTEST_SKIP() << "AVX2 is not supported";
+        }
+        this->for_each_pair([&](const std::vector<TypeParam>& left, const std::vector<TypeParam>& right) -> void {
+            this->check_intersect(gesel::internal::intersect_avx2<true, TypeParam>, gesel::internal::intersect_avx2<false, TypeParam>, left, right);
+        });
+    }
+}
+#endif
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <memory>
+
+#include "gesel/line_cache.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+class TestLineCache : public MockDatabaseTest {};
+
+TEST_F(TestLineCache, Basic) {
+    gesel::LineCache cache;
+    auto file = cache.register_file();
+    EXPECT_NE(cache.register_file(), file);
+
+    int loads = 0;
+    auto loader = [&]() -> std::vector<uint64_t> {
+        ++loads;
+        return std::vector<uint64_t>{ 1, 2, 3 };
+    };
+
+    auto first = cache.get(file, 5, loader);
+    EXPECT_EQ(*first, std::vector<uint64_t>({ 1, 2, 3 }));
+    auto second = cache.get(file, 5, loader);
+    EXPECT_EQ(first, second); // same pointer.
+    EXPECT_EQ(loads, 1);
+
+    // Same line in a different file is a different entry.
+    cache.get(file + 1, 5, loader);
+    EXPECT_EQ(loads, 2);
+
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.evictions, 0);
+    EXPECT_EQ(stats.entries, 2);
+    EXPECT_EQ(stats.bytes, 2 * gesel::LineCache::entry_bytes(*first));
+
+    cache.clear();
+    stats = cache.statistics();
+    EXPECT_EQ(stats.entries, 0);
+    EXPECT_EQ(stats.bytes, 0);
+    EXPECT_EQ(stats.hits, 1);
+    cache.get(file, 5, loader);
+    EXPECT_EQ(loads, 3);
+}
+
+TEST_F(TestLineCache, Eviction) {
+    gesel::LineCacheOptions opt;
+    opt.num_shards = 1;
+    std::vector<uint64_t> payload(10);
+    auto per_entry = gesel::LineCache::entry_bytes(payload);
+    opt.max_bytes = per_entry * 3;
+    gesel::LineCache cache(opt);
+
+    int loads = 0;
+    auto loader = [&]() -> std::vector<uint64_t> {
+        ++loads;
+        return payload;
+    };
+
+    cache.get(0, 0, loader);
+    cache.get(0, 1, loader);
+    cache.get(0, 2, loader);
+    cache.get(0, 0, loader); // refreshes line 0, so line 1 is now the least recently used.
+    cache.get(0, 3, loader);
+    EXPECT_EQ(loads, 4);
+
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.entries, 3);
+    EXPECT_EQ(stats.bytes, per_entry * 3);
+
+    cache.get(0, 0, loader);
+    cache.get(0, 2, loader);
+    cache.get(0, 3, loader);
+    EXPECT_EQ(loads, 4);
+    cache.get(0, 1, loader);
+    EXPECT_EQ(loads, 5);
+
+    // Evicted entries remain valid for existing holders.
+    auto held = cache.get(0, 100, loader);
+    for (size_t i = 200; i < 210; ++i) {
+        cache.get(0, i, loader);
+    }
+    EXPECT_EQ(*held, payload);
+
+    // Entries that exceed the budget are returned but not cached.
+    auto big = cache.get(0, 1000, []() -> std::vector<uint64_t> { return std::vector<uint64_t>(1000); });
+    EXPECT_EQ(big->size(), 1000);
+    EXPECT_LE(cache.statistics().bytes, per_entry * 3);
+}
+
+TEST_F(TestLineCache, Batch) {
+    gesel::LineCache cache;
+    std::vector<std::vector<size_t> > requests;
+    auto loader = [&](const std::vector<size_t>& lines) -> std::vector<std::vector<uint64_t> > {
+        requests.push_back(lines);
+        std::vector<std::vector<uint64_t> > output;
+        for (auto l : lines) {
+            output.push_back(std::vector<uint64_t>{ l, l * 2 });
+        }
+        return output;
+    };
+
+    auto out = cache.get(0, std::vector<size_t>{ 5, 2, 5, 8 }, loader);
+    ASSERT_EQ(requests.size(), 1);
+    EXPECT_EQ(requests[0], std::vector<size_t>({ 5, 2, 8 })); // duplicates are only loaded once.
+    ASSERT_EQ(out.size(), 4);
+    EXPECT_EQ(*out[0], std::vector<uint64_t>({ 5, 10 }));
+    EXPECT_EQ(out[0], out[2]);
+    EXPECT_EQ(*out[3], std::vector<uint64_t>({ 8, 16 }));
+
+    out = cache.get(0, std::vector<size_t>{ 8, 1, 2 }, loader);
+    ASSERT_EQ(requests.size(), 2);
+    EXPECT_EQ(requests[1], std::vector<size_t>{ 1 });
+    EXPECT_EQ(*out[1], std::vector<uint64_t>({ 1, 2 }));
+
+    cache.get(0, std::vector<size_t>{ 1, 2, 5, 8 }, loader);
+    EXPECT_EQ(requests.size(), 2); // no loading at all.
+
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.misses, 5);
+    EXPECT_EQ(stats.hits, 6);
+
+    expect_error([&]() {
+        cache.get(0, std::vector<size_t>{ 100 }, [](const std::vector<size_t>&) -> std::vector<std::vector<uint64_t> > { return {}; });
+    }, "number of loaded lines");
+}
+
+TEST_F(TestLineCache, RangedFile) {
+    auto path = temp_file_path("line_cache");
+    mock_database(path, "9606_");
+
+    auto cache = std::make_shared<gesel::LineCache>();
+    auto g2s = std::make_shared<const gesel::RangedFile>(path + "/9606_gene2set.tsv");
+    auto s2g = std::make_shared<const gesel::RangedFile>(path + "/9606_set2gene.tsv");
+    gesel::CachedIndices cached_g2s(cache, g2s), cached_s2g(cache, s2g);
+
+    for (size_t g = 0; g < g2s->num_lines(); ++g) {
+        EXPECT_EQ(*cached_g2s.get(g), g2s->read_indices(g));
+    }
+    for (size_t s = 0; s < s2g->num_lines(); ++s) {
+        EXPECT_EQ(*cached_s2g.get(s), s2g->read_indices(s));
+    }
+    auto stats = cache->statistics();
+    EXPECT_EQ(stats.misses, max_genes + 7);
+    EXPECT_EQ(stats.hits, 0);
+
+    std::vector<size_t> requested{ 13, 0, 19, 13, 15, 2, 1 };
+    auto batch = cached_g2s.get(requested);
+    for (size_t i = 0; i < requested.size(); ++i) {
+        EXPECT_EQ(*batch[i], g2s->read_indices(requested[i]));
+    }
+    EXPECT_EQ(cache->statistics().hits, requested.size());
+
+    // Concurrent access from multiple threads, with a small budget to force evictions.
+    gesel::LineCacheOptions opt;
+    opt.max_bytes = 2000;
+    opt.num_shards = 4;
+    auto small = std::make_shared<gesel::LineCache>(opt);
+    gesel::CachedIndices cached_small(small, g2s);
+
+    std::vector<std::thread> workers;
+    std::vector<int> okay(4);
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&,t]() {
+            bool all_same = true;
+            for (int rep = 0; rep < 20; ++rep) {
+                for (size_t g = 0; g < g2s->num_lines(); ++g) {
+                    size_t gene = (g * (t + 1) + rep) % g2s->num_lines();
+                    all_same = all_same && (*cached_small.get(gene) == g2s->read_indices(gene));
+                }
+            }
+            okay[t] = all_same;
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    EXPECT_EQ(okay, std::vector<int>(4, 1));
+
+    stats = small->statistics();
+    EXPECT_EQ(stats.hits + stats.misses, 4 * 20 * max_genes);
+    EXPECT_GT(stats.evictions, 0);
+    EXPECT_LE(stats.bytes, opt.max_bytes);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+
+#include "gesel/load_database.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+class TestLoadDatabase : public MockDatabaseTest {
+protected:
+    template<typename Index_>
+    static void check_contents(const gesel::Database<Index_>& db) {
+        EXPECT_EQ(db.num_genes(), max_genes);
+        EXPECT_EQ(db.num_sets(), 7);
+        EXPECT_EQ(db.num_collections(), 2);
+
+        EXPECT_EQ(db.collection_title(0), "aaron's collection");
+        EXPECT_EQ(db.collection_description(1), "someone else's collection");
+        EXPECT_EQ(db.collection_species(0), 12345);
+        EXPECT_EQ(db.collection_maintainer(1), "Someone else");
+        EXPECT_EQ(db.collection_source(0), "https://aaron.net");
+        EXPECT_EQ(db.collection_size(0), 3);
+        EXPECT_EQ(db.collection_size(1), 4);
+        EXPECT_EQ(db.collection_start(0), 0);
+        EXPECT_EQ(db.collection_start(1), 3);
+
+        EXPECT_EQ(db.set_name(0), "Akira's set");
+        EXPECT_EQ(db.set_description(5), "I-I should also mention aika, b-baka");
+        EXPECT_EQ(db.set_collection(2), 0);
+        EXPECT_EQ(db.set_collection(3), 1);
+        EXPECT_EQ(db.set_position(2), 2);
+        EXPECT_EQ(db.set_position(6), 3);
+        EXPECT_EQ(db.set_size(3), 7);
+
+        auto genes = db.genes_in_set(3);
+        std::vector<Index_> expected_genes{ 0, 5, 7, 10, 11, 12, 17 };
+        EXPECT_EQ(std::vector<Index_>(genes.begin(), genes.end()), expected_genes);
+        EXPECT_TRUE(db.genes_in_set(0).size() == 1 && db.genes_in_set(0)[0] == 0);
+
+        auto sets = db.sets_for_gene(13);
+        std::vector<Index_> expected_sets{ 2, 5 };
+        EXPECT_EQ(std::vector<Index_>(sets.begin(), sets.end()), expected_sets);
+        EXPECT_TRUE(db.sets_for_gene(15).empty());
+
+        // Consistency between the two mappings.
+        for (size_t s = 0; s < db.num_sets(); ++s) {
+            for (auto g : db.genes_in_set(s)) {
+                auto sets = db.sets_for_gene(g);
+                EXPECT_TRUE(std::find(sets.begin(), sets.end(), s) != sets.end());
+            }
+        }
+    }
+};
+
+TEST_F(TestLoadDatabase, Basic) {
+    auto path = temp_file_path("loading");
+    mock_database(path, "9606_");
+
+    auto db = gesel::load_database(path + "/9606_", max_genes);
+    check_contents(db);
+
+    gesel::LoadDatabaseOptions opt;
+    opt.validate = true;
+    check_contents(gesel::load_database(path + "/9606_", max_genes, opt));
+
+    opt.read_options.num_threads = 3;
+    opt.read_options.buffer_size = 7;
+    check_contents(gesel::load_database<uint64_t>(path + "/9606_", max_genes, opt));
+}
+
+TEST_F(TestLoadDatabase, Validation) {
+    auto path = temp_file_path("loading");
+    mock_database(path, "9606_");
+
+    // Inconsistent Gzipped files are only detected with validation.
+    quick_gzip_write(path + "/9606_sets.tsv.gz", "foo\tbar\t1\n");
+    gesel::load_database(path + "/9606_", max_genes);
+    gesel::LoadDatabaseOptions opt;
+    opt.validate = true;
+    expect_error([&]() { gesel::load_database(path + "/9606_", max_genes, opt); }, "different name");
+
+    mock_database(path, "9606_");
+    std::vector<std::vector<int> > map_from(max_genes);
+    save_indices(path + "/9606_gene2set.tsv", map_from);
+    gesel::load_database(path + "/9606_", max_genes);
+    expect_error([&]() { gesel::load_database(path + "/9606_", max_genes, opt); }, "sets for gene 0");
+
+    mock_database(path, "9606_");
+    quick_gzip_write(path + "/9606_tokens-names.tsv.ranges.gz", "a\t1\nb\t2\n");
+    gesel::load_database(path + "/9606_", max_genes);
+    expect_error([&]() { gesel::load_database(path + "/9606_", max_genes, opt); }, "different number of tokens");
+
+    // Basic formatting errors are always detected.
+    mock_database(path, "9606_");
+    quick_text_write(path + "/9606_set2gene.tsv", "foo\n");
+    expect_error([&]() { gesel::load_database(path + "/9606_", max_genes); }, "set2gene");
+
+    // Index type is checked.
+    mock_database(path, "9606_");
+    expect_error([&]() { gesel::load_database<uint8_t>(path + "/9606_", 1000); }, "does not fit");
+}
+
+TEST_F(TestLoadDatabase, HybridMappings) {
+    auto path = temp_file_path("loading");
+    mock_database(path, "9606_");
+
+    auto db = gesel::load_database(path + "/9606_", max_genes);
+    EXPECT_FALSE(db.has_hybrid_mappings());
+    EXPECT_ANY_THROW(db.hybrid_genes_in_set(0));
+
+    gesel::LoadDatabaseOptions opt;
+    opt.hybrid_mappings = true;
+    db = gesel::load_database(path + "/9606_", max_genes, opt);
+    EXPECT_TRUE(db.has_hybrid_mappings());
+    check_contents(db);
+
+    for (size_t s = 0; s < db.num_sets(); ++s) {
+        auto genes = db.genes_in_set(s);
+        EXPECT_EQ(db.hybrid_genes_in_set(s).to_vector(), std::vector<uint32_t>(genes.begin(), genes.end()));
+    }
+    for (size_t g = 0; g < db.num_genes(); ++g) {
+        auto sets = db.sets_for_gene(g);
+        EXPECT_EQ(db.hybrid_sets_for_gene(g).to_vector(), std::vector<uint32_t>(sets.begin(), sets.end()));
+    }
+}
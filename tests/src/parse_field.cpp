@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <memory>
+
+#include "gesel/parse_field.hpp"
+#include "gesel/chunked_reader.hpp"
+
+#include "utils.h"
+
+TEST(ScanBytes, FindDelimiter) {
+    for (size_t n = 0; n < 100; ++n) {
+        std::string x(n, 'a');
+        EXPECT_EQ(gesel::internal::find_delimiter(x.c_str(), n), n);
+        for (size_t i = 0; i < n; ++i) {
+            std::string y = x;
+            y[i] = (i % 2 ? '\t' : '\n');
+            if (i + 1 < n) {
+                y[n - 1] = '\t'; // only the first delimiter should be reported.
+            }
+            EXPECT_EQ(gesel::internal::find_delimiter(y.c_str(), n), i);
+        }
+    }
+}
+
+TEST(ScanBytes, ParseDigitRun) {
+    uint64_t value = 0;
+    std::string digits = "1234567890123456789";
+    for (size_t n = 0; n <= digits.size(); ++n) {
+        EXPECT_TRUE(gesel::internal::parse_digit_run(digits.c_str(), n, value));
+        EXPECT_EQ(value, n ? std::stoull(digits.substr(0, n)) : 0);
+    }
+
+    for (size_t i = 0; i < digits.size(); ++i) {
+        auto copy = digits;
+        copy[i] = (i % 2 ? '/' : ':'); // just outside the range of digits.
+        EXPECT_FALSE(gesel::internal::parse_digit_run(copy.c_str(), copy.size(), value));
+    }
+}
+
+class TestParseIntegerField : public ::testing::TestWithParam<int> {
+protected:
+    // Parses all fields with the byte-by-byte parser and the chunk-aware parser, returning the results or the error message.
+    template<class ByteSource_>
+    static std::vector<std::string> parse_all(ByteSource_& pb) {
+        std::vector<std::string> output;
+        bool valid = pb.valid();
+        try {
+            while (valid) {
+                auto res = gesel::internal::parse_integer_field<gesel::internal::FieldType::UNKNOWN>(pb, valid, "foo", 0);
+                output.push_back(std::to_string(res.first) + (res.second ? "\n" : "\t"));
+            }
+        } catch (std::exception& e) {
+            output.push_back(e.what());
+        }
+        return output;
+    }
+
+    static void compare(const std::string& payload, size_t buffer_size) {
+        auto ptr = reinterpret_cast<const unsigned char*>(payload.c_str());
+
+        byteme::RawBufferReader ref_reader(ptr, payload.size());
+        byteme::SerialBufferedReader<char, byteme::RawBufferReader*> ref_pb(&ref_reader, buffer_size);
+        static_assert(!gesel::internal::has_chunk_access<decltype(ref_pb)>::value);
+        auto expected = parse_all(ref_pb);
+
+        gesel::internal::ChunkedReader pb(std::unique_ptr<byteme::Reader>(new byteme::RawBufferReader(ptr, payload.size())), buffer_size, false, 1);
+        static_assert(gesel::internal::has_chunk_access<decltype(pb)>::value);
+        auto observed = parse_all(pb);
+        EXPECT_EQ(expected, observed) << "mismatch for payload '" << payload << "'";
+    }
+};
+
+TEST_P(TestParseIntegerField, Consistent) {
+    size_t buffer_size = GetParam();
+    std::vector<std::string> payloads {
+        "0\t123\t45\n6\n780\t1\t234\t45\n67\t890\n",
+        "1234567890123456789\t12345678901234567890\n",
+        "18446744073709551615\n",
+        "18446744073709551616\n",
+        "99999999999999999999\n",
+        "184467440737095516150\n",
+        "00\t1\n",
+        "01\n",
+        "10\t\t1\n",
+        "12a34\n",
+        "12345678a\n",
+        "1234\n5678",
+        "1234\r\n"
+    };
+    for (const auto& p : payloads) {
+        compare(p, buffer_size);
+    }
+
+    std::mt19937_64 rng(buffer_size);
+    const char choices[] = "0123456789\t\n";
+    for (int i = 0; i < 200; ++i) {
+        std::string payload;
+        size_t len = rng() % 100;
+        for (size_t j = 0; j < len; ++j) {
+            // Mostly digits, so that we get some long numbers.
+            payload += choices[rng() % (rng() % 4 ? 10 : 12)];
+        }
+        payload += '\n';
+        compare(payload, buffer_size);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ParseIntegerField,
+    TestParseIntegerField,
+    ::testing::Values(1, 3, 8, 13, 64, 65536) // buffer size
+);
+
+TEST(ParseIntegerField, Overflow) {
+    auto path = temp_file_path("parse_field");
+    quick_text_write(path, "99999999999999999999\n");
+    byteme::RawFileReader reader(path.c_str(), {});
+    byteme::SerialBufferedReader<char, byteme::RawFileReader*> pb(&reader, 10);
+    bool valid = pb.valid();
+    expect_error([&]() { gesel::internal::parse_integer_field<gesel::internal::FieldType::LAST>(pb, valid, path, 0); }, "integer overflow");
+}
+
+class TestReadLine : public ::testing::TestWithParam<int> {};
+
+TEST_P(TestReadLine, Basic) {
+    size_t buffer_size = GetParam();
+    std::string payload = "alpha\tbravo\t123\n\ncharlie\tdelta echo\t45\nfoxtrot";
+    auto ptr = reinterpret_cast<const unsigned char*>(payload.c_str());
+    gesel::internal::ChunkedReader pb(std::unique_ptr<byteme::Reader>(new byteme::RawBufferReader(ptr, payload.size())), buffer_size, false, 1);
+    std::string scratch;
+
+    auto first = gesel::internal::read_line(pb, scratch);
+    EXPECT_TRUE(first.terminated());
+    EXPECT_EQ(first.length(), 15);
+    EXPECT_EQ(pb.get(), '\n');
+    EXPECT_EQ(pb.position(), 15);
+
+    bool valid = true;
+    EXPECT_EQ(gesel::internal::parse_string_view_field<gesel::internal::FieldType::MIDDLE>(first, valid, "foo", 0), "alpha");
+    auto res = gesel::internal::parse_string_view_field<gesel::internal::FieldType::UNKNOWN>(first, valid, "foo", 0);
+    EXPECT_EQ(res.first, "bravo");
+    EXPECT_FALSE(res.second);
+    EXPECT_EQ(gesel::internal::parse_integer_field<gesel::internal::FieldType::LAST>(first, valid, "foo", 0), 123);
+    EXPECT_FALSE(valid);
+    EXPECT_TRUE(gesel::internal::finish_line(pb, first));
+
+    auto second = gesel::internal::read_line(pb, scratch);
+    EXPECT_TRUE(second.terminated());
+    EXPECT_EQ(second.length(), 0);
+    EXPECT_TRUE(gesel::internal::finish_line(pb, second));
+
+    auto third = gesel::internal::read_line(pb, scratch);
+    EXPECT_TRUE(third.terminated());
+    EXPECT_EQ(gesel::internal::parse_string_view_field<gesel::internal::FieldType::MIDDLE>(third, valid, "foo", 2), "charlie");
+    EXPECT_EQ(gesel::internal::parse_string_view_field<gesel::internal::FieldType::MIDDLE>(third, valid, "foo", 2), "delta echo");
+    expect_error([&]() { gesel::internal::parse_string_view_field<gesel::internal::FieldType::MIDDLE>(third, valid, "foo", 2); }, "newline or tab");
+    EXPECT_TRUE(gesel::internal::finish_line(pb, third));
+
+    auto fourth = gesel::internal::read_line(pb, scratch);
+    EXPECT_FALSE(fourth.terminated());
+    EXPECT_EQ(fourth.length(), 7);
+    expect_error([&]() { gesel::internal::parse_string_view_field<gesel::internal::FieldType::LAST>(fourth, valid, "foo", 3); }, "no terminating newline");
+    EXPECT_FALSE(gesel::internal::finish_line(pb, fourth));
+}
+
+TEST(ReadLine, Errors) {
+    std::string payload = "alpha\tbravo\n";
+    gesel::internal::LineSource line(payload.c_str(), payload.size() - 1, true);
+    bool valid = true;
+    expect_error([&]() { gesel::internal::parse_string_view_field<gesel::internal::FieldType::LAST>(line, valid, "foo", 0); }, "newline or tab");
+
+    std::string payload2 = "alpha\n";
+    gesel::internal::LineSource line2(payload2.c_str(), payload2.size() - 1, true);
+    expect_error([&]() { gesel::internal::parse_string_view_field<gesel::internal::FieldType::MIDDLE>(line2, valid, "foo", 0); }, "newline or tab");
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ReadLine,
+    TestReadLine,
+    ::testing::Values(1, 4, 16, 65536) // buffer size
+);
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <thread>
+
+#include "gesel/ranged_file.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+class TestRangedFile : public MockDatabaseTest {};
+
+TEST_F(TestRangedFile, Indices) {
+    auto path = temp_file_path("ranged");
+    mock_database(path, "9606_");
+
+    gesel::RangedFile s2g(path + "/9606_set2gene.tsv");
+    EXPECT_EQ(s2g.num_lines(), 7);
+    EXPECT_EQ(s2g.line_start(0), 0);
+    EXPECT_EQ(s2g.line_length(0), 1);
+    EXPECT_EQ(s2g.line_start(1), 2);
+    EXPECT_EQ(s2g.read_line(1), "1\t2\t1");
+
+    std::vector<uint64_t> expected{ 0, 5, 7, 10, 11, 12, 17 };
+    EXPECT_EQ(s2g.read_indices(3), expected);
+
+    gesel::RangedFile g2s(path + "/9606_gene2set.tsv");
+    EXPECT_EQ(g2s.num_lines(), max_genes);
+    EXPECT_TRUE(g2s.read_indices(15).empty());
+    expected = std::vector<uint64_t>{ 2, 5 };
+    EXPECT_EQ(g2s.read_indices(13), expected);
+
+    // Batched reads give the same results, in the requested order.
+    std::vector<size_t> requested{ 13, 0, 19, 13, 15, 2, 1 };
+    auto batch = g2s.read_indices(requested);
+    ASSERT_EQ(batch.size(), requested.size());
+    for (size_t i = 0; i < requested.size(); ++i) {
+        EXPECT_EQ(batch[i], g2s.read_indices(requested[i]));
+    }
+
+    // Same results without any coalescing.
+    std::vector<std::string> contents(requested.size());
+    g2s.read_lines(requested, [&](size_t i, std::string_view x) { contents[i] = std::string(x); }, 0);
+    for (size_t i = 0; i < requested.size(); ++i) {
+        EXPECT_EQ(contents[i], g2s.read_line(requested[i]));
+    }
+
+    // Concurrent reads are safe.
+    std::vector<std::vector<uint64_t> > reference;
+    for (size_t g = 0; g < g2s.num_lines(); ++g) {
+        reference.push_back(g2s.read_indices(g));
+    }
+    std::vector<std::thread> workers;
+    std::vector<int> okay(4);
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&,t]() {
+            bool all_same = true;
+            for (int rep = 0; rep < 10; ++rep) {
+                for (size_t g = 0; g < g2s.num_lines(); ++g) {
+                    all_same = all_same && (g2s.read_indices(g) == reference[g]);
+                }
+            }
+            okay[t] = all_same;
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    EXPECT_EQ(okay, std::vector<int>(4, 1));
+}
+
+TEST_F(TestRangedFile, Details) {
+    auto path = temp_file_path("ranged");
+    mock_database(path, "9606_");
+
+    gesel::RangedFile sets(path + "/9606_sets.tsv", gesel::RangesFormat::BYTES_AND_NUMBER);
+    EXPECT_EQ(sets.num_lines(), 7);
+    EXPECT_EQ(sets.read_line(0), "Akira's set\tthis is akira's set");
+    std::vector<uint64_t> expected_sizes{ 1, 3, 5, 7, 6, 4, 2 };
+    EXPECT_EQ(sets.numbers(), expected_sizes);
+    EXPECT_TRUE(sets.names().empty());
+
+    gesel::RangedFile tokens(path + "/9606_tokens-names.tsv", gesel::RangesFormat::NAME_AND_BYTES);
+    auto t = tokens.find_name("athena");
+    ASSERT_LT(t, tokens.num_lines());
+    std::vector<uint64_t> expected{ 2 };
+    EXPECT_EQ(tokens.read_indices(t), expected);
+    t = tokens.find_name("set");
+    ASSERT_LT(t, tokens.num_lines());
+    EXPECT_EQ(tokens.read_indices(t).size(), 7);
+    EXPECT_EQ(tokens.find_name("zzz"), tokens.num_lines());
+    EXPECT_EQ(tokens.find_name("a"), tokens.num_lines());
+
+    // Passing the result of a failed search to the single-line accessors is an error.
+    auto missing = tokens.find_name("zzz");
+    expect_error([&]() { tokens.read_line(missing); }, "out of range");
+    expect_error([&]() { tokens.read_indices(missing); }, "out of range");
+    expect_error([&]() { tokens.line_start(missing); }, "out of range");
+    expect_error([&]() { tokens.line_length(missing); }, "out of range");
+}
+
+TEST_F(TestRangedFile, Failures) {
+    auto path = temp_file_path("ranged");
+    quick_text_write(path, "1\t2\n3\tfoo\n\n");
+
+    expect_error([&]() { gesel::RangedFile(path, std::vector<uint64_t>{ 3, 5 }); }, "not consistent");
+    expect_error([&]() { gesel::RangedFile(path + ".missing", std::vector<uint64_t>{ 3, 5, 0 }); }, "failed to open");
+
+    gesel::RangedFile ranged(path, std::vector<uint64_t>{ 3, 5, 0 });
+    std::vector<uint64_t> expected{ 1, 3 };
+    EXPECT_EQ(ranged.read_indices(0), expected);
+    EXPECT_TRUE(ranged.read_indices(2).empty());
+    expect_error([&]() { ranged.read_indices(1); }, "non-digit");
+
+    gesel::RangedFile misaligned(path, std::vector<uint64_t>{ 2, 6, 0 });
+    expect_error([&]() { misaligned.read_line(0); }, "not consistent");
+
+    quick_text_write(path, "18446744073709551615\t1\n");
+    gesel::RangedFile overflow(path, std::vector<uint64_t>{ 22 });
+    expect_error([&]() { overflow.read_indices(0); }, "overflow");
+}
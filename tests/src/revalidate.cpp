@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <chrono>
+
+#include "gesel/revalidate.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+TEST(ContentHasher, Chunking) {
+    std::string contents;
+    for (int i = 0; i < 1000; ++i) {
+        contents += std::to_string(i * i);
+    }
+    auto expected = gesel::internal::hash_string(contents);
+
+    // Same hash regardless of how the contents are split.
+    for (size_t step : { 1, 7, 32, 33, 500 }) {
+        gesel::internal::ContentHasher hasher;
+        for (size_t i = 0; i < contents.size(); i += step) {
+            hasher.add(contents.data() + i, std::min(step, contents.size() - i));
+        }
+        EXPECT_EQ(hasher.finish(), expected);
+    }
+
+    EXPECT_NE(gesel::internal::hash_string(contents.substr(1)), expected);
+    EXPECT_NE(gesel::internal::hash_string("aaa"), gesel::internal::hash_string("aab"));
+    EXPECT_NE(gesel::internal::hash_string(""), gesel::internal::hash_string(std::string(1, '\0')));
+}
+
+class TestRevalidate : public MockDatabaseTest {
+protected:
+    // Pushing the modification time forward, so that changes are detected even if the file system has coarse timestamps.
+    static void bump_mtime(const std::string& path) {
+        auto mtime = std::filesystem::last_write_time(path);
+        std::filesystem::last_write_time(path, mtime + std::chrono::seconds(10));
+    }
+
+    static void save_set_details(const std::string& dir, const std::vector<std::pair<std::string, std::string> >& payloads) {
+        std::vector<uint64_t> sizes{ 1, 3, 5, 7, 6, 4, 2 };
+        auto path = dir + "/9606_sets.tsv";
+        save_sets(path, payloads, sizes);
+        for (const auto& suffix : { "", ".gz", ".ranges.gz" }) {
+            bump_mtime(path + suffix);
+        }
+    }
+
+    static std::vector<std::pair<std::string, std::string> > default_set_details() {
+        return {
+            { "Akira's set", "this is akira's set" },
+            { "Alicia's set", "but this is alicia's set" },
+            { "Athena's set", "can't forget about athena, of course" },
+            { "Ai's set", "and there's also ai" },
+            { "Alice's set", "and alice" },
+            { "Aika's set", "I-I should also mention aika, b-baka" },
+            { "Akari's set", "But the best girl is still akari" }
+        };
+    }
+};
+
+TEST_F(TestRevalidate, Database) {
+    auto path = temp_file_path("revalidation");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+
+    gesel::ValidationManifest manifest;
+    gesel::ValidateDatabaseOptions vopt;
+    auto reread = gesel::revalidate_database(prefix, max_genes, manifest, vopt);
+    EXPECT_EQ(reread, std::vector<std::string>({ "collections.tsv", "sets.tsv", "tokens-names.tsv", "tokens-descriptions.tsv", "set2gene.tsv", "gene2set.tsv" }));
+    EXPECT_EQ(manifest.files.size(), 16);
+
+    // Nothing is read if nothing has changed.
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt).empty());
+
+    // Round-tripping through the manifest file.
+    auto mpath = path + "/manifest.tsv";
+    gesel::save_manifest(manifest, mpath);
+    auto reloaded = gesel::load_manifest(mpath);
+    EXPECT_EQ(reloaded.values, manifest.values);
+    EXPECT_EQ(reloaded.files.size(), manifest.files.size());
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, reloaded, vopt).empty());
+
+    // Touching a file without changing its contents only requires a hash.
+    bump_mtime(prefix + "gene2set.tsv");
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt).empty());
+    EXPECT_EQ(manifest.files[prefix + "gene2set.tsv"].mtime, std::filesystem::last_write_time(prefix + "gene2set.tsv").time_since_epoch().count()); // refreshed so it won't be hashed again.
+
+    // Changing the collection details only requires the collections to be checked.
+    {
+        std::vector<std::string> payloads {
+            "aaron's collection\tthis is aaron's modified collection\t12345\tAaron Lun\thttps://aaron.net",
+            "yet another collection\tsomeone else's collection\t9999\tSomeone else\thttps://someone.else.com"
+        };
+        save_collections(prefix + "collections.tsv", payloads, { 3, 4 });
+        EXPECT_EQ(gesel::revalidate_database(prefix, max_genes, manifest, vopt), std::vector<std::string>{ "collections.tsv" });
+        EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt).empty());
+    }
+
+    // Changing the set details without changing their tokens doesn't require the tokens files to be read.
+    {
+        auto payloads = default_set_details();
+        payloads[0].second = "THIS IS AKIRA'S SET!!!";
+        save_set_details(path, payloads);
+        EXPECT_EQ(gesel::revalidate_database(prefix, max_genes, manifest, vopt), std::vector<std::string>{ "sets.tsv" });
+    }
+
+    // Changing the tokens in the set details is detected, even if the token files have not changed.
+    {
+        auto payloads = default_set_details();
+        payloads[0].second = "this is akira's sets";
+        save_set_details(path, payloads);
+        auto copy = manifest;
+        expect_error([&]() { gesel::revalidate_database(prefix, max_genes, manifest, vopt); }, "tokens-descriptions");
+        EXPECT_EQ(copy.values, manifest.values); // manifest is unchanged on failure.
+
+        save_set_details(path, default_set_details());
+        EXPECT_EQ(gesel::revalidate_database(prefix, max_genes, manifest, vopt), std::vector<std::string>{ "sets.tsv" });
+    }
+
+    // A change in the number of genes requires the mappings to be checked.
+    expect_error([&]() { gesel::revalidate_database(prefix, max_genes + 1, manifest, vopt); }, "gene2set.tsv.ranges.gz");
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt).empty());
+}
+
+TEST_F(TestRevalidate, Mappings) {
+    auto path = temp_file_path("revalidation");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+
+    gesel::ValidationManifest manifest;
+    gesel::ValidateDatabaseOptions vopt;
+    vopt.num_threads = 3;
+    gesel::revalidate_database(prefix, max_genes, manifest, vopt);
+
+    std::vector<std::vector<int> > map_from(max_genes);
+    map_from[0] = { 0, 3 };
+    map_from[1] = { 1 };
+    map_from[2] = { 2, 5 };
+    map_from[3] = { 1, 2 };
+    map_from[4] = { 1 };
+    map_from[5] = { 3 };
+    map_from[6] = { 6 };
+    map_from[7] = { 2, 3 };
+    map_from[8] = { 4, 5 };
+    map_from[9] = { 2, 5 };
+    map_from[10] = { 3, 4 };
+    map_from[11] = { 3 };
+    map_from[12] = { 3 };
+    map_from[13] = { 2, 5 };
+    map_from[14] = { 4 };
+    map_from[16] = { 6 };
+    map_from[17] = { 3, 4 };
+    map_from[18] = { 4 };
+    map_from[19] = { 4 };
+
+    // Rewriting the same contents is not a change.
+    save_indices(prefix + "gene2set.tsv", map_from);
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt).empty());
+
+    // Inconsistent changes to one mapping file are detected by comparing its fingerprints to those recorded for the other file.
+    std::swap(map_from[18], map_from[19]);
+    map_from[15] = { 4 };
+    map_from[19].clear();
+    save_indices(prefix + "gene2set.tsv", map_from);
+    auto copy = manifest;
+    expect_error([&]() { gesel::revalidate_database(prefix, max_genes, manifest, vopt); }, "gene 15");
+    EXPECT_EQ(copy.values, manifest.values);
+    expect_error([&]() { gesel::revalidate_database(prefix, max_genes, manifest, vopt); }, "gene 15"); // still fails on the next attempt.
+
+    // Consistent changes to both files are fine.
+    std::vector<std::vector<int> > map_to = {
+        { 0 },
+        { 1, 3, 4 },
+        { 2, 3, 7, 9, 13 },
+        { 0, 5, 7, 10, 11, 12, 17 },
+        { 8, 10, 14, 15, 17, 18 },
+        { 2, 8, 9, 13 },
+        { 6, 16 }
+    };
+    save_indices(prefix + "set2gene.tsv", map_to);
+    EXPECT_EQ(gesel::revalidate_database(prefix, max_genes, manifest, vopt), std::vector<std::string>({ "set2gene.tsv", "gene2set.tsv" }));
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt).empty());
+}
+
+TEST_F(TestRevalidate, VerifyContents) {
+    auto path = temp_file_path("revalidation");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+
+    gesel::ValidationManifest manifest;
+    gesel::ValidateDatabaseOptions vopt;
+    gesel::revalidate_database(prefix, max_genes, manifest, vopt);
+
+    // Replacing the contents while preserving the size and modification time.
+    auto cpath = prefix + "collections.tsv";
+    auto mtime = std::filesystem::last_write_time(cpath);
+    {
+        std::vector<std::string> payloads {
+            "aaron's collection\tthis is aaron's collection\t12345\tAaron Lun\thttps://aaron.org",
+            "yet another collection\tsomeone else's collection\t9999\tSomeone else\thttps://someone.else.com"
+        };
+        save_collections(cpath, payloads, { 3, 4 });
+    }
+    std::filesystem::last_write_time(cpath, mtime);
+
+    gesel::RevalidateOptions ropt;
+    EXPECT_EQ(gesel::revalidate_database(prefix, max_genes, manifest, vopt, ropt), std::vector<std::string>{ "collections.tsv" }); // detected from the Gzipped twin.
+    quick_text_write(cpath, "aaron's collection\tthis is aaron's collection\t12345\tAaron Lun\thttps://aaron.net\nyet another collection\tsomeone else's collection\t9999\tSomeone else\thttps://someone.else.com\n");
+    std::filesystem::last_write_time(cpath, mtime);
+    EXPECT_TRUE(gesel::revalidate_database(prefix, max_genes, manifest, vopt, ropt).empty());
+
+    ropt.verify_contents = true;
+    expect_error([&]() { gesel::revalidate_database(prefix, max_genes, manifest, vopt, ropt); }, "different source");
+}
+
+TEST_F(TestRevalidate, Genes) {
+    auto path = temp_file_path("revalidation");
+    std::filesystem::create_directory(path);
+    auto prefix = path + "/9606_";
+    quick_gzip_write(prefix + "symbol.tsv.gz", "alpha\nbravo\tcharlie\ndelta\n");
+    quick_gzip_write(prefix + "ensembl.tsv.gz", "ALPHA\n\nDELTA\n");
+
+    gesel::ValidationManifest manifest;
+    std::vector<std::string> types{ "symbol", "ensembl" };
+    EXPECT_EQ(gesel::revalidate_genes(prefix, types, manifest), 3);
+    EXPECT_EQ(manifest.files.size(), 2);
+    EXPECT_EQ(gesel::revalidate_genes(prefix, types, manifest), 3);
+
+    quick_gzip_write(prefix + "ensembl.tsv.gz", "ALPHA\n\nDELTA\nECHO\n");
+    auto copy = manifest;
+    expect_error([&]() { gesel::revalidate_genes(prefix, types, manifest); }, "inconsistent number of genes");
+    EXPECT_EQ(copy.values, manifest.values);
+
+    quick_gzip_write(prefix + "symbol.tsv.gz", "alpha\nbravo\tcharlie\ndelta\techo\techo\nfoxtrot\n");
+    expect_error([&]() { gesel::revalidate_genes(prefix, types, manifest); }, "duplicated");
+
+    quick_gzip_write(prefix + "symbol.tsv.gz", "alpha\nbravo\tcharlie\ndelta\techo\nfoxtrot\n");
+    EXPECT_EQ(gesel::revalidate_genes(prefix, types, manifest), 4);
+
+    expect_error([&]() { gesel::revalidate_genes(prefix, {}, manifest); }, "at least one");
+}
+
+TEST(Manifest, Failures) {
+    auto path = temp_file_path("manifest");
+    EXPECT_TRUE(gesel::load_manifest(path).files.empty());
+
+    quick_text_write(path, "");
+    expect_error([&]() { gesel::load_manifest(path); }, "invalid manifest");
+    quick_text_write(path, "gesel-manifest\t2\n");
+    expect_error([&]() { gesel::load_manifest(path); }, "invalid manifest");
+    quick_text_write(path, "gesel-manifest\t1\nfile\tfoo\t1\t2\n");
+    expect_error([&]() { gesel::load_manifest(path); }, "invalid manifest");
+    quick_text_write(path, "gesel-manifest\t1\nfile\tfoo\t1\t-2\tx\n");
+    expect_error([&]() { gesel::load_manifest(path); }, "invalid manifest");
+    quick_text_write(path, "gesel-manifest\t1\nwhee\n");
+    expect_error([&]() { gesel::load_manifest(path); }, "invalid manifest");
+
+    quick_text_write(path, "gesel-manifest\t1\nfile\tfoo\t1\t-2\t3\nvalue\tbar\nvalue\tbaz\t1\t2\n");
+    auto loaded = gesel::load_manifest(path);
+    EXPECT_EQ(loaded.files["foo"].mtime, -2);
+    EXPECT_EQ(loaded.files["foo"].hash, 3);
+    EXPECT_TRUE(loaded.values["bar"].empty());
+    EXPECT_EQ(loaded.values["baz"], std::vector<uint64_t>({ 1, 2 }));
+
+    loaded.files["foo\tbar"] = gesel::ManifestFile();
+    expect_error([&]() { gesel::save_manifest(loaded, path); }, "tabs or newlines");
+}
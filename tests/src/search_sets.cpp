@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <random>
+
+#include "gesel/search_sets.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+TEST(WildcardMatch, Basic) {
+    EXPECT_TRUE(gesel::internal::wildcard_match("akira", "akira"));
+    EXPECT_FALSE(gesel::internal::wildcard_match("akira", "akiras"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("ak*", "akira"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("ak*", "ak"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("*ra", "akira"));
+    EXPECT_FALSE(gesel::internal::wildcard_match("*ra", "akiras"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("a*i*a", "akira"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("a?i?a", "akira"));
+    EXPECT_FALSE(gesel::internal::wildcard_match("a?i?a", "akiraa"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("*", ""));
+    EXPECT_FALSE(gesel::internal::wildcard_match("?", ""));
+    EXPECT_TRUE(gesel::internal::wildcard_match("**a**", "banana"));
+    EXPECT_TRUE(gesel::internal::wildcard_match("*an?", "banana"));
+    EXPECT_FALSE(gesel::internal::wildcard_match("*an", "banana"));
+}
+
+TEST(Intersect, Galloping) {
+    std::mt19937_64 rng(42);
+    for (size_t left_size : { 0, 1, 10, 100 }) {
+        for (size_t right_size : { 0, 5, 1000 }) {
+            std::vector<uint64_t> left, right;
+            for (size_t i = 0; i < left_size; ++i) {
+                left.push_back(rng() % 2000);
+            }
+            for (size_t i = 0; i < right_size; ++i) {
+                right.push_back(rng() % 2000);
+            }
+            for (auto vec : { &left, &right }) {
+                std::sort(vec->begin(), vec->end());
+                vec->erase(std::unique(vec->begin(), vec->end()), vec->end());
+            }
+
+            std::vector<uint64_t> expected;
+            std::set_intersection(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(expected));
+            std::vector<uint64_t> observed;
+            gesel::internal::intersect_galloping(left.data(), left.size(), right.data(), right.size(), observed);
+            EXPECT_EQ(observed, expected);
+            gesel::internal::intersect_galloping(right.data(), right.size(), left.data(), left.size(), observed);
+            EXPECT_EQ(observed, expected);
+
+            std::vector<std::vector<uint64_t> > both{ left, right };
+            EXPECT_EQ(gesel::internal::intersect_sorted<uint64_t>(both), expected);
+
+            std::vector<uint64_t> combined;
+            std::set_union(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(combined));
+            EXPECT_EQ(gesel::internal::union_sorted<uint64_t>(both), combined);
+        }
+    }
+
+    EXPECT_TRUE(gesel::internal::intersect_sorted<uint64_t>(std::vector<std::vector<uint64_t> >()).empty());
+    EXPECT_TRUE(gesel::internal::union_sorted<uint64_t>(std::vector<std::vector<uint64_t> >()).empty());
+}
+
+class TestTokenSearch : public MockDatabaseTest, public ::testing::WithParamInterface<bool> {
+protected:
+    static std::vector<std::pair<std::string, std::string> > set_details(const std::string& prefix) {
+        gesel::RangedFile sets(prefix + "sets.tsv", gesel::RangesFormat::BYTES_AND_NUMBER);
+        std::vector<std::pair<std::string, std::string> > output;
+        for (size_t s = 0; s < sets.num_lines(); ++s) {
+            auto line = sets.read_line(s);
+            auto tab = line.find('\t');
+            output.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+        }
+        return output;
+    }
+
+    // Brute-force search by tokenizing every set and checking each token against each query term.
+    static std::vector<uint64_t> reference_search(const std::vector<std::pair<std::string, std::string> >& details, const std::string& query, const gesel::SearchOptions& options) {
+        std::vector<std::string> terms;
+        std::string scratch;
+        gesel::internal::for_each_token<true>(query, scratch, [&](std::string_view t) { terms.emplace_back(t); });
+
+        std::vector<uint64_t> output;
+        if (terms.empty()) {
+            return output;
+        }
+        for (size_t s = 0; s < details.size(); ++s) {
+            std::vector<std::string> tokens;
+            if (options.field != gesel::SearchField::DESCRIPTIONS) {
+                gesel::internal::for_each_token(details[s].first, scratch, [&](std::string_view t) { tokens.emplace_back(t); });
+            }
+            if (options.field != gesel::SearchField::NAMES) {
+                gesel::internal::for_each_token(details[s].second, scratch, [&](std::string_view t) { tokens.emplace_back(t); });
+            }
+
+            size_t matched = 0;
+            for (const auto& term : terms) {
+                bool found = false;
+                for (const auto& tok : tokens) {
+                    found = found || gesel::internal::wildcard_match(term, tok);
+                }
+                matched += found;
+            }
+            if (options.match_all ? matched == terms.size() : matched > 0) {
+                output.push_back(s);
+            }
+        }
+        return output;
+    }
+};
+
+TEST_P(TestTokenSearch, Search) {
+    auto path = temp_file_path("search");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+    auto details = set_details(prefix);
+
+    gesel::TokenSearchOptions sopt;
+    sopt.in_memory = GetParam();
+    gesel::TokenSearch searcher(prefix, sopt);
+
+    std::vector<std::string> queries {
+        "akira",
+        "AKIRA",
+        "Athena's set",
+        "set",
+        "this set",
+        "this-is",
+        "b-baka",
+        "a*",
+        "a?",
+        "al*",
+        "*ka",
+        "a?i*a set",
+        "*",
+        "akira athena",
+        "also a*",
+        "nothing",
+        "set nothing",
+        "",
+        "   !!! ",
+    };
+
+    for (const auto& q : queries) {
+        for (auto field : { gesel::SearchField::NAMES, gesel::SearchField::DESCRIPTIONS, gesel::SearchField::BOTH }) {
+            for (bool all : { true, false }) {
+                gesel::SearchOptions opt;
+                opt.field = field;
+                opt.match_all = all;
+                EXPECT_EQ(searcher.search(q, opt), reference_search(details, q, opt)) << "query: '" << q << "'";
+            }
+        }
+    }
+
+    // Sanity checks on a few specific searches.
+    EXPECT_EQ(searcher.search("akira"), std::vector<uint64_t>{ 0 });
+    EXPECT_EQ(searcher.search("set").size(), 7);
+    EXPECT_EQ(searcher.search("akira athena"), std::vector<uint64_t>());
+    gesel::SearchOptions any;
+    any.match_all = false;
+    EXPECT_EQ(searcher.search("akira athena", any), std::vector<uint64_t>({ 0, 2 }));
+}
+
+TEST_P(TestTokenSearch, Expand) {
+    auto path = temp_file_path("search");
+    mock_database(path, "9606_");
+    gesel::TokenSearchOptions sopt;
+    sopt.in_memory = GetParam();
+    gesel::TokenSearch searcher(path + "/9606_", sopt);
+
+    EXPECT_EQ(searcher.expand("akira"), std::vector<std::string>{ "akira" });
+    EXPECT_EQ(searcher.expand("ali*", gesel::SearchField::NAMES), std::vector<std::string>({ "alice", "alicia" }));
+    EXPECT_EQ(searcher.expand("a?", gesel::SearchField::DESCRIPTIONS), std::vector<std::string>{ "ai" });
+    EXPECT_EQ(searcher.expand("a?"), std::vector<std::string>{ "ai" });
+    EXPECT_TRUE(searcher.expand("zzz*").empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    TokenSearch,
+    TestTokenSearch,
+    ::testing::Values(false, true)
+);
+
+TEST(Intersect, Unions) {
+    std::mt19937_64 rng(100);
+    auto random_sorted = [&](size_t n, uint64_t max) -> std::vector<uint64_t> {
+        std::vector<uint64_t> output;
+        for (size_t i = 0; i < n; ++i) {
+            output.push_back(rng() % max);
+        }
+        std::sort(output.begin(), output.end());
+        output.erase(std::unique(output.begin(), output.end()), output.end());
+        return output;
+    };
+
+    // Mixing small and large groups to exercise both the searching and merging paths.
+    for (size_t rep = 0; rep < 20; ++rep) {
+        std::vector<std::vector<std::vector<uint64_t> > > groups;
+        for (size_t g = 0, ngroups = 1 + rng() % 4; g < ngroups; ++g) {
+            std::vector<std::vector<uint64_t> > group;
+            for (size_t c = 0, ncomp = 1 + rng() % 5; c < ncomp; ++c) {
+                group.push_back(random_sorted(rng() % 2 ? 5 : 500, 1000));
+            }
+            groups.push_back(std::move(group));
+        }
+
+        std::vector<std::vector<uint64_t> > merged;
+        for (const auto& group : groups) {
+            merged.push_back(gesel::internal::union_sorted<uint64_t>(group));
+        }
+        EXPECT_EQ(gesel::internal::intersect_unions<uint64_t>(groups), gesel::internal::intersect_sorted<uint64_t>(merged));
+
+        auto candidates = merged[0];
+        auto expected = candidates;
+        if (groups.size() > 1) {
+            gesel::internal::intersect_with_any(candidates, groups[1]);
+            std::vector<uint64_t> tmp;
+            std::set_intersection(expected.begin(), expected.end(), merged[1].begin(), merged[1].end(), std::back_inserter(tmp));
+            EXPECT_EQ(candidates, tmp);
+        }
+    }
+}
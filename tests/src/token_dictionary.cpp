@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "gesel/token_dictionary.hpp"
+#include "gesel/validate_database.hpp"
+
+TEST(TokenDictionary, ForEachToken) {
+    std::string scratch;
+    std::vector<std::string> collected;
+    gesel::internal::for_each_token("Aaron's  12345.4567890 is-AWESOME!", scratch, [&](std::string_view tok) { collected.emplace_back(tok); });
+    std::vector<std::string> expected { "aaron", "s", "12345", "4567890", "is-awesome" };
+    EXPECT_EQ(collected, expected);
+
+    collected.clear();
+    gesel::internal::for_each_token("  ...  ", scratch, [&](std::string_view tok) { collected.emplace_back(tok); });
+    EXPECT_TRUE(collected.empty());
+}
+
+TEST(TokenDictionary, Arena) {
+    gesel::internal::StringArena arena;
+    std::vector<std::string_view> stored;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 20000; ++i) {
+        expected.push_back(std::to_string(i * 7919));
+        stored.push_back(arena.store(expected.back()));
+    }
+    expected.push_back(std::string(100000, 'x')); // larger than a block.
+    stored.push_back(arena.store(expected.back()));
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(stored[i], expected[i]);
+    }
+}
+
+TEST(TokenDictionary, Collector) {
+    std::vector<std::string> texts {
+        "aaron is awesome",
+        "Aaron and   Aaron",
+        "",
+        "foo bar",
+        "12345.4567890 is aaron"
+    };
+
+    std::unordered_map<std::string, std::vector<uint64_t> > reference;
+    gesel::internal::TokenCollector<uint32_t> collector;
+    for (size_t s = 0; s < texts.size(); ++s) {
+        gesel::internal::tokenize(s, texts[s], reference);
+        collector.add(s, texts[s]);
+    }
+    EXPECT_EQ(collector.size(), reference.size());
+
+    auto dict = collector.finish();
+    ASSERT_EQ(dict.tokens.size(), reference.size());
+    EXPECT_TRUE(std::is_sorted(dict.tokens.begin(), dict.tokens.end()));
+    for (size_t t = 0; t < dict.tokens.size(); ++t) {
+        auto it = reference.find(std::string(dict.tokens[t]));
+        ASSERT_TRUE(it != reference.end());
+        EXPECT_TRUE(gesel::internal::same_flat_indices(dict.sets, t, it->second));
+    }
+
+    // Tokens are found at the expected position or by binary search.
+    for (size_t t = 0; t < dict.tokens.size(); ++t) {
+        std::string tok(dict.tokens[t]);
+        EXPECT_EQ(gesel::internal::find_token(dict, t, tok), t);
+        EXPECT_EQ(gesel::internal::find_token(dict, 0, tok), t);
+        EXPECT_EQ(gesel::internal::find_token(dict, 1000, tok), t);
+    }
+    EXPECT_EQ(gesel::internal::find_token(dict, 0, "zzz"), dict.tokens.size());
+    EXPECT_EQ(gesel::internal::find_token(dict, 0, "aaro"), dict.tokens.size());
+
+    // Works with an empty dictionary.
+    gesel::internal::TokenCollector<uint64_t> empty;
+    auto edict = empty.finish();
+    EXPECT_TRUE(edict.tokens.empty());
+    EXPECT_EQ(edict.sets.offsets.size(), 1);
+    EXPECT_EQ(gesel::internal::find_token(edict, 0, "aaron"), 0);
+}
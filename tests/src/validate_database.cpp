@@ -9,6 +9,7 @@
 
 #include "gesel/validate_database.hpp"
 #include "utils.h"
+#include "mock_database.h"
 
 TEST(Tokenization, Generator) {
     std::unordered_map<std::string, std::vector<uint64_t> > tokens_to_sets;
@@ -39,157 +40,7 @@ TEST(Tokenization, Checker) {
     expect_error([&]() { gesel::internal::check_tokens(std::vector<std::string>{ "" }, "foobar.tsv"); }, "empty");
 }
 
-class TestValidateDatabase : public ::testing::Test {
-protected:
-    static constexpr int max_genes = 20;
-
-    template<typename Type_>
-    static std::string delta_encode(const std::vector<Type_>& values) {
-        std::string output;
-        for (size_t j = 0, jend = values.size(); j < jend; ++j) {
-            if (j != 0) {
-                output += "\t";
-                output += std::to_string(values[j] - values[j - 1]);
-            } else {
-                output += std::to_string(values[j]);
-            }
-        }
-        return output;
-    }
-
-    static void save_collections(const std::string& path, const std::vector<std::string>& payloads, const std::vector<uint64_t>& sizes) {
-        byteme::RawFileWriter rwriter(path.c_str(), {});
-        auto gzpath = path + ".gz";
-        byteme::GzipFileWriter gwriter(gzpath.c_str(), {});
-        auto rangepath = path + ".ranges.gz";
-        byteme::GzipFileWriter rrwriter(rangepath.c_str(), {});
-
-        for (std::size_t i = 0, end = sizes.size(); i < end; ++i) {
-            const auto& current = payloads[i];
-            quick_write(rwriter, current + "\n");
-            auto as_str = std::to_string(sizes[i]);
-            quick_write(gwriter, current + "\t" + as_str + "\n");
-            quick_write(rrwriter, std::to_string(current.size()) + "\t" + as_str + "\n");
-        }
-    }
-
-    static void save_sets(const std::string& path, const std::vector<std::pair<std::string, std::string> >& payloads, const std::vector<uint64_t>& sizes) {
-        byteme::RawFileWriter rwriter(path.c_str(), {});
-        auto gzpath = path + ".gz";
-        byteme::GzipFileWriter gwriter(gzpath.c_str(), {});
-        auto rangepath = path + ".ranges.gz";
-        byteme::GzipFileWriter rrwriter(rangepath.c_str(), {});
-
-        for (std::size_t i = 0, end = sizes.size(); i < end; ++i) {
-            const auto& current = payloads[i];
-            auto combined = current.first + "\t" + current.second;
-            quick_write(rwriter, combined + "\n");
-            auto as_str = std::to_string(sizes[i]);
-            quick_write(gwriter, combined + "\t" + as_str + "\n");
-            quick_write(rrwriter, std::to_string(combined.size()) + "\t" + as_str + "\n");
-        }
-    }
-
-    static void save_indices(const std::string& path, const std::vector<std::vector<int > >& mapping) {
-        byteme::RawFileWriter rwriter(path.c_str(), {});
-        auto gzpath = path + ".gz";
-        byteme::GzipFileWriter gwriter(gzpath.c_str(), {});
-        auto rangepath = path + ".ranges.gz";
-        byteme::GzipFileWriter rrwriter(rangepath.c_str(), {});
-
-        for (const auto& x : mapping) {
-            auto as_str = delta_encode(x);
-            quick_write(rwriter, as_str + "\n");
-            quick_write(gwriter, as_str + "\n");
-            quick_write(rrwriter, std::to_string(as_str.size()) + "\n");
-        }
-    }
-
-    static void mock_database(const std::string& dir, const std::string& prefix) {
-        if (std::filesystem::exists(dir)) {
-            std::filesystem::remove_all(dir);
-        }
-        std::filesystem::create_directory(dir);
-
-        // Saving the collection.
-        {
-            std::vector<std::string> payloads {
-                "aaron's collection\tthis is aaron's collection\t12345\tAaron Lun\thttps://aaron.net",
-                "yet another collection\tsomeone else's collection\t9999\tSomeone else\thttps://someone.else.com"
-            };
-            std::vector<uint64_t> sizes { 3, 4 };
-            auto path = dir + "/" + prefix + "collections.tsv";
-            save_collections(path, payloads, sizes);
-        }
-
-        // Saving the sets and the token information.
-        {
-            std::vector<std::pair<std::string, std::string> > payloads = {
-                { "Akira's set", "this is akira's set" },
-                { "Alicia's set", "but this is alicia's set" },
-                { "Athena's set", "can't forget about athena, of course" },
-                { "Ai's set", "and there's also ai" },
-                { "Alice's set", "and alice" },
-                { "Aika's set", "I-I should also mention aika, b-baka" }, // throw in some dashes for the tsundere
-                { "Akari's set", "But the best girl is still akari" }
-            };
-            std::vector<uint64_t> sizes{ 1, 3, 5, 7, 6, 4, 2 };
-            auto path = dir + "/" + prefix + "sets.tsv";
-            save_sets(path, payloads, sizes);
-
-            std::unordered_map<std::string, std::vector<uint64_t> > token_n, token_d;
-            for (size_t i = 0, end = payloads.size(); i < end; ++i) {
-                const auto& p = payloads[i];
-                gesel::internal::tokenize(i, p.first, token_n);
-                gesel::internal::tokenize(i, p.second, token_d);
-            }
-
-            auto deposit_token_text = [&](const std::string& path, const std::unordered_map<std::string, std::vector<uint64_t> >& tokens_to_sets) {
-                std::vector<std::string> all_tokens;
-                all_tokens.reserve(tokens_to_sets.size());
-                for (const auto& pp : tokens_to_sets) {
-                    all_tokens.push_back(pp.first);
-                }
-                std::sort(all_tokens.begin(), all_tokens.end());
-
-                byteme::RawFileWriter rwriter(path.c_str(), {});
-                auto rangepath = path + ".ranges.gz";
-                byteme::GzipFileWriter rrwriter(rangepath.c_str(), {});
-
-                for (const auto& tok : all_tokens) {
-                    auto encoded = delta_encode(tokens_to_sets.find(tok)->second);
-                    quick_write(rwriter, encoded + "\n");
-                    quick_write(rrwriter, tok + "\t" + std::to_string(encoded.size()) + "\n");
-                }
-            };
-
-            deposit_token_text(dir + "/" + prefix + "tokens-names.tsv", token_n);
-            deposit_token_text(dir + "/" + prefix + "tokens-descriptions.tsv", token_d);
-        }
-
-        // Saving the set->gene mappings, and vice versa.
-        {
-            std::vector<std::vector<int> > map_to = {
-                { 0 },
-                { 1, 3, 4 },
-                { 2, 3, 7, 9, 13 },
-                { 0, 5, 7, 10, 11, 12, 17 },
-                { 8, 10, 14, 17, 18, 19 },
-                { 2, 8, 9, 13 },
-                { 6, 16 }
-            };
-            save_indices(dir + "/" + prefix + "set2gene.tsv", map_to);
-
-            std::vector<std::vector<int> > map_from(max_genes);
-            for (size_t s = 0, end = map_to.size(); s < end; ++ s) {
-                for (auto i : map_to[s]) {
-                    map_from[i].push_back(s);
-                }
-            }
-            save_indices(dir + "/" + prefix + "gene2set.tsv", map_from);
-        }
-    }
-};
+class TestValidateDatabase : public MockDatabaseTest {};
 
 TEST_F(TestValidateDatabase, Basic) {
     auto path = temp_file_path("validation");
@@ -210,6 +61,15 @@ TEST_F(TestValidateDatabase, CollectionFailures) {
         std::vector<uint64_t> sizes { 3, 4 };
         save_collections(path + "/9606_collections.tsv", payloads, sizes);
         expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes); }, "non-digit");
+
+        // With a single thread, the collections are fully checked before the set ranges are loaded;
+        // with multiple threads, the set ranges are loaded first as they are shared between stages.
+        quick_gzip_write(path + "/9606_sets.tsv.ranges.gz", "5\t5\n6\t6\n");
+        expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes); }, "non-digit");
+        gesel::ValidateDatabaseOptions opt;
+        opt.num_threads = 3;
+        expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "total number of sets");
+        mock_database(path, "9606_");
     }
 
     // Checking for overflow.
@@ -335,3 +195,95 @@ TEST_F(TestValidateDatabase, SetToGeneFailures) {
         expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes); }, "inconsistent");
     }
 }
+
+TEST_F(TestValidateDatabase, Parallel) {
+    auto path = temp_file_path("validation");
+    mock_database(path, "9606_");
+
+    gesel::ValidateDatabaseOptions opt;
+    opt.num_threads = 3;
+    gesel::validate_database(path + "/9606_", max_genes, opt);
+
+    opt.background_gzip = true;
+    opt.background_raw = true;
+    opt.buffer_size = 10;
+    for (bool mmap : { true, false }) {
+        opt.memory_map_raw = mmap; // ending with buffered raw reads for the checks below.
+        gesel::validate_database(path + "/9606_", max_genes, opt);
+    }
+
+    // Errors in multiple stages should be reported deterministically.
+    std::vector<std::string> payloads {
+        "aaron's\tcollection\tthis is aaron's collection\t12345\tAaron Lun\thttps://aaron.net",
+        "yet another collection\tsomeone else's collection\t9999\tSomeone else\thttps://someone.else.com"
+    };
+    save_collections(path + "/9606_collections.tsv", payloads, std::vector<uint64_t>{ 3, 4 });
+    quick_gzip_write(path + "/9606_gene2set.tsv.ranges.gz", "1\n");
+
+    for (int i = 0; i < 10; ++i) {
+        expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "non-digit");
+    }
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes); }, "non-digit");
+
+    // Errors in the later stages are still reported.
+    mock_database(path, "9606_");
+    quick_gzip_write(path + "/9606_gene2set.tsv.ranges.gz", "1\n");
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "number of lines in 'gene2set");
+}
+
+TEST_F(TestValidateDatabase, Fingerprint) {
+    auto path = temp_file_path("validation");
+    mock_database(path, "9606_");
+
+    gesel::ValidateDatabaseOptions opt;
+    opt.fingerprint_mappings = true;
+    gesel::validate_database(path + "/9606_", max_genes, opt);
+    opt.num_threads = 4;
+    gesel::validate_database(path + "/9606_", max_genes, opt);
+
+    std::vector<std::vector<int> > map_to = {
+        { 0 },
+        { 1, 3, 4 },
+        { 2, 3, 7, 9, 13 },
+        { 0, 5, 7, 10, 11, 12, 18 },
+        { 8, 10, 14, 17, 18, 19 },
+        { 2, 8, 9, 13 },
+        { 6, 16 }
+    };
+    save_indices(path + "/9606_set2gene.tsv", map_to);
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "sets for gene 17");
+    opt.num_threads = 1;
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "sets for gene 17");
+
+    mock_database(path, "9606_");
+    quick_gzip_write(path + "/9606_gene2set.tsv.ranges.gz", "1\n");
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "number of lines in 'gene2set");
+}
+
+TEST_F(TestValidateDatabase, ShardedIndices) {
+    auto path = temp_file_path("validation");
+    mock_database(path, "9606_");
+
+    gesel::ValidateDatabaseOptions opt;
+    opt.memory_map_raw = true;
+    opt.num_index_threads = 3;
+    gesel::validate_database(path + "/9606_", max_genes, opt);
+    opt.fingerprint_mappings = true;
+    gesel::validate_database(path + "/9606_", max_genes, opt);
+    opt.num_threads = 2;
+    gesel::validate_database(path + "/9606_", max_genes, opt);
+
+    std::vector<std::vector<int> > map_to = {
+        { 0 },
+        { 1, 3, 4 },
+        { 2, 3, 7, 9, 13 },
+        { 0, 5, 7, 10, 11, 12, 18 },
+        { 8, 10, 14, 17, 18, 19 },
+        { 2, 8, 9, 13 },
+        { 6, 16 }
+    };
+    save_indices(path + "/9606_set2gene.tsv", map_to);
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "sets for gene 17");
+    opt.fingerprint_mappings = false;
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, opt); }, "sets for gene 17");
+}
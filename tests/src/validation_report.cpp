@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <filesystem>
+
+#include "gesel/validate_database.hpp"
+#include "gesel/validate_genes.hpp"
+#include "utils.h"
+#include "mock_database.h"
+
+class TestValidationReport : public MockDatabaseTest {
+protected:
+    static std::vector<std::string> stage_names(const gesel::ValidationReport& report) {
+        std::vector<std::string> output;
+        for (const auto& stage : report.stages) {
+            output.push_back(stage.name);
+        }
+        return output;
+    }
+
+    static const std::vector<std::string>& expected_names() {
+        static const std::vector<std::string> names{ "collections", "sets", "tokens-names", "tokens-descriptions", "set2gene", "gene2set" };
+        return names;
+    }
+};
+
+TEST_F(TestValidationReport, Database) {
+    auto path = temp_file_path("report");
+    mock_database(path, "9606_");
+    auto prefix = path + "/9606_";
+
+    gesel::ValidationReport report;
+    gesel::validate_database(prefix, max_genes, gesel::ValidateDatabaseOptions(), report);
+    EXPECT_EQ(stage_names(report), expected_names());
+
+    const auto& stages = report.stages;
+    EXPECT_EQ(stages[0].lines, 2);
+    EXPECT_EQ(stages[1].lines, 7);
+    EXPECT_GT(stages[2].lines, 0);
+    EXPECT_GT(stages[3].lines, 0);
+    EXPECT_EQ(stages[4].lines, 7);
+    EXPECT_EQ(stages[5].lines, max_genes);
+
+    EXPECT_EQ(stages[0].raw_file_bytes, std::filesystem::file_size(prefix + "collections.tsv"));
+    EXPECT_EQ(stages[0].gzip_file_bytes, std::filesystem::file_size(prefix + "collections.tsv.gz"));
+    EXPECT_EQ(stages[0].inflated_bytes, stages[0].raw_file_bytes);
+    EXPECT_EQ(stages[2].raw_file_bytes, std::filesystem::file_size(prefix + "tokens-names.tsv"));
+    EXPECT_EQ(stages[2].gzip_file_bytes, 0);
+    EXPECT_EQ(stages[2].inflated_bytes, 0);
+    EXPECT_EQ(stages[5].raw_file_bytes, std::filesystem::file_size(prefix + "gene2set.tsv"));
+    EXPECT_EQ(stages[5].gzip_file_bytes, std::filesystem::file_size(prefix + "gene2set.tsv.gz"));
+    EXPECT_EQ(stages[5].inflated_bytes, stages[5].raw_file_bytes);
+
+    for (const auto& stage : stages) {
+        EXPECT_GE(stage.wall_seconds, 0);
+        EXPECT_GE(stage.cpu_seconds, 0);
+        EXPECT_EQ(stage.allocations, 0);
+    }
+
+    // Same order regardless of the number of threads or the method for checking the mappings.
+    gesel::ValidateDatabaseOptions opt;
+    opt.num_threads = 3;
+    gesel::ValidationReport parallel;
+    gesel::validate_database(prefix, max_genes, opt, parallel);
+    EXPECT_EQ(stage_names(parallel), expected_names());
+
+    opt.fingerprint_mappings = true;
+    gesel::ValidationReport fingerprinted;
+    gesel::validate_database(prefix, max_genes, opt, fingerprinted);
+    EXPECT_EQ(stage_names(fingerprinted), expected_names());
+    EXPECT_EQ(fingerprinted.stages[4].lines, 7);
+    EXPECT_EQ(fingerprinted.stages[5].lines, max_genes);
+}
+
+TEST_F(TestValidationReport, Allocations) {
+    auto path = temp_file_path("report");
+    mock_database(path, "9606_");
+
+    // Mock counter that advances by 10 on every call, so each stage should report 10 allocations.
+    uint64_t counter = 0;
+    gesel::ValidationReport report;
+    report.allocation_counter = [&]() -> uint64_t {
+        counter += 10;
+        return counter;
+    };
+
+    gesel::validate_database(path + "/9606_", max_genes, gesel::ValidateDatabaseOptions(), report);
+    EXPECT_EQ(report.stages.size(), 6);
+    for (const auto& stage : report.stages) {
+        EXPECT_EQ(stage.allocations, 10);
+    }
+
+    auto json = report.to_json();
+    EXPECT_THAT(json, ::testing::HasSubstr("\"allocations\":10"));
+    EXPECT_THAT(json, ::testing::Not(::testing::HasSubstr("null")));
+}
+
+TEST_F(TestValidationReport, Failure) {
+    auto path = temp_file_path("report");
+    mock_database(path, "9606_");
+    quick_gzip_write(path + "/9606_gene2set.tsv.ranges.gz", "1\n");
+
+    gesel::ValidationReport report;
+    expect_error([&]() { gesel::validate_database(path + "/9606_", max_genes, gesel::ValidateDatabaseOptions(), report); }, "gene2set");
+    EXPECT_TRUE(report.stages.empty());
+}
+
+TEST(ValidationReport, Genes) {
+    auto path = temp_file_path("report");
+    if (std::filesystem::exists(path)) {
+        std::filesystem::remove_all(path);
+    }
+    std::filesystem::create_directory(path);
+
+    quick_gzip_write(path + "/9606_symbol.tsv.gz", "alpha\nbravo\tcharlie\ndelta\n");
+    quick_gzip_write(path + "/9606_ensembl.tsv.gz", "ALPHA\nBRAVO\n\n");
+
+    gesel::ValidationReport report;
+    EXPECT_EQ(gesel::validate_genes(path + "/9606_", std::vector<std::string>{ "symbol", "ensembl" }, report), 3);
+    ASSERT_EQ(report.stages.size(), 2);
+    EXPECT_EQ(report.stages[0].name, "genes-symbol");
+    EXPECT_EQ(report.stages[1].name, "genes-ensembl");
+    for (const auto& stage : report.stages) {
+        EXPECT_EQ(stage.lines, 3);
+        EXPECT_EQ(stage.raw_file_bytes, 0);
+    }
+    EXPECT_EQ(report.stages[0].gzip_file_bytes, std::filesystem::file_size(path + "/9606_symbol.tsv.gz"));
+
+    // Decompressed bytes are counted for the Gzip-only stages.
+    EXPECT_EQ(report.stages[0].inflated_bytes, std::string("alpha\nbravo\tcharlie\ndelta\n").size());
+    EXPECT_EQ(report.stages[1].inflated_bytes, std::string("ALPHA\nBRAVO\n\n").size());
+
+    // Nothing is appended if a later type is invalid or the number of genes is inconsistent, even if the earlier types are valid.
+    quick_gzip_write(path + "/9606_entrez.tsv.gz", "1\n2\n");
+    gesel::ValidationReport failed;
+    expect_error([&]() { gesel::validate_genes(path + "/9606_", std::vector<std::string>{ "symbol", "entrez" }, failed); }, "inconsistent");
+    EXPECT_TRUE(failed.stages.empty());
+
+    quick_gzip_write(path + "/9606_entrez.tsv.gz", "1\t1\n2\n3\n");
+    expect_error([&]() { gesel::validate_genes(path + "/9606_", std::vector<std::string>{ "symbol", "entrez" }, failed); }, "duplicate");
+    EXPECT_TRUE(failed.stages.empty());
+}
+
+TEST(ValidationReport, Json) {
+    gesel::ValidationReport report;
+    EXPECT_EQ(report.to_json(), "{\"stages\":[]}");
+
+    gesel::StageReport stage;
+    stage.name = "weird \"name\"\\\n";
+    stage.wall_seconds = 1.5;
+    stage.cpu_seconds = 0.25;
+    stage.raw_file_bytes = 100;
+    stage.gzip_file_bytes = 20;
+    stage.inflated_bytes = 100;
+    stage.lines = 5;
+    report.stages.push_back(stage);
+    report.stages.push_back(stage);
+    report.stages.back().name = "other";
+
+    EXPECT_EQ(
+        report.to_json(),
+        "{\"stages\":["
+            "{\"name\":\"weird \\\"name\\\"\\\\\\u000a\",\"wall_seconds\":1.5,\"cpu_seconds\":0.25,\"raw_file_bytes\":100,\"gzip_file_bytes\":20,\"inflated_bytes\":100,\"lines\":5,\"allocations\":null},"
+            "{\"name\":\"other\",\"wall_seconds\":1.5,\"cpu_seconds\":0.25,\"raw_file_bytes\":100,\"gzip_file_bytes\":20,\"inflated_bytes\":100,\"lines\":5,\"allocations\":null}"
+        "]}"
+    );
+}
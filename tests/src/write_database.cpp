@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <vector>
+#include <string>
+#include <random>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <tuple>
+
+#include "gesel/write_database.hpp"
+#include "gesel/validate_database.hpp"
+#include "gesel/validate_genes.hpp"
+#include "gesel/load_database.hpp"
+#include "gesel/fetch_ranges.hpp"
+#include "utils.h"
+
+class TestWriteDatabase : public ::testing::TestWithParam<std::tuple<int, size_t> > {
+protected:
+    static std::string fresh_directory() {
+        auto path = temp_file_path("writer");
+        std::filesystem::create_directory(path);
+        return path;
+    }
+
+    static std::vector<gesel::CollectionDetails> mock_collections(uint64_t num_genes, size_t num_collections, std::mt19937_64& rng) {
+        std::vector<std::string> words { "akira", "alicia", "Athena's", "ai", "alice", "aika", "b-baka", "AKARI", "set", "of", "genes", "123" };
+        auto random_text = [&]() -> std::string {
+            std::string output;
+            for (size_t w = 0, nwords = rng() % 6; w < nwords; ++w) {
+                if (w) {
+                    output += (rng() % 2 ? " " : ", ");
+                }
+                output += words[rng() % words.size()];
+            }
+            return output;
+        };
+
+        std::vector<gesel::CollectionDetails> output(num_collections);
+        for (size_t c = 0; c < num_collections; ++c) {
+            auto& coll = output[c];
+            coll.title = random_text();
+            coll.description = random_text();
+            coll.species = 9606;
+            coll.maintainer = "Aaron Lun";
+            coll.source = "https://aaron.net/" + std::to_string(c);
+            coll.sets.resize(rng() % 50);
+            for (auto& set : coll.sets) {
+                set.name = random_text();
+                set.description = random_text();
+                for (uint64_t g = 0; g < num_genes; ++g) {
+                    if (rng() % 5 == 0) {
+                        set.genes.push_back(g);
+                    }
+                }
+                std::shuffle(set.genes.begin(), set.genes.end(), rng); // unsorted inputs are allowed.
+            }
+        }
+        return output;
+    }
+
+    static std::vector<gesel::GeneNames> mock_genes(uint64_t num_genes) {
+        std::vector<gesel::GeneNames> output(2);
+        output[0].type = "symbol";
+        output[1].type = "ensembl";
+        for (uint64_t g = 0; g < num_genes; ++g) {
+            output[0].names.push_back({ "GENE" + std::to_string(g), "ALIAS" + std::to_string(g % 7) });
+            output[1].names.push_back(g % 3 ? std::vector<std::string>{ "ENSG" + std::to_string(g) } : std::vector<std::string>{});
+        }
+        return output;
+    }
+};
+
+TEST_P(TestWriteDatabase, RoundTrip) {
+    auto param = GetParam();
+    gesel::WriteDatabaseOptions opt;
+    opt.num_threads = std::get<0>(param);
+    opt.block_size = std::get<1>(param);
+
+    std::mt19937_64 rng(opt.num_threads * 100 + opt.block_size);
+    constexpr uint64_t num_genes = 200;
+    auto collections = mock_collections(num_genes, 5, rng);
+    auto genes = mock_genes(num_genes);
+
+    auto dir = fresh_directory();
+    std::filesystem::create_directory(dir + "/genes");
+    auto gene_prefix = dir + "/genes/9606_";
+    EXPECT_EQ(gesel::write_genes(gene_prefix, genes, opt), num_genes);
+    EXPECT_EQ(gesel::validate_genes(gene_prefix), num_genes);
+
+    auto prefix = dir + "/9606_";
+    gesel::write_database(prefix, collections, num_genes, opt);
+    gesel::validate_database(prefix, num_genes);
+
+    gesel::ValidateDatabaseOptions vopt;
+    vopt.fingerprint_mappings = true;
+    vopt.num_index_threads = 3;
+    vopt.gzip_index = true;
+    vopt.gzip_index_spacing = 100;
+    gesel::validate_database(prefix, num_genes, vopt);
+
+    auto db = gesel::load_database(prefix, num_genes);
+    EXPECT_EQ(db.num_collections(), collections.size());
+    size_t s = 0;
+    for (size_t c = 0; c < collections.size(); ++c) {
+        EXPECT_EQ(db.collection_title(c), collections[c].title);
+        EXPECT_EQ(db.collection_species(c), 9606);
+        for (const auto& set : collections[c].sets) {
+            EXPECT_EQ(db.set_name(s), set.name);
+            auto expected = set.genes;
+            std::sort(expected.begin(), expected.end());
+            auto observed = db.genes_in_set(s);
+            EXPECT_EQ(std::vector<uint64_t>(observed.begin(), observed.end()), expected);
+            ++s;
+        }
+    }
+    EXPECT_EQ(db.num_sets(), s);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    WriteDatabase,
+    TestWriteDatabase,
+    ::testing::Combine(
+        ::testing::Values(1, 3), // number of threads
+        ::testing::Values(50, 1048576) // block size
+    )
+);
+
+TEST(WriteDatabase, MultipleMembers) {
+    auto path = temp_file_path("writer");
+    gesel::WriteDatabaseOptions opt;
+    opt.num_threads = 2;
+    opt.block_size = 10;
+
+    std::string contents;
+    {
+        gesel::internal::ParallelGzipWriter writer(path, opt);
+        for (int i = 0; i < 100; ++i) {
+            auto line = std::to_string(i) + "\n";
+            writer.write(line);
+            contents += line;
+        }
+        writer.finish();
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::string compressed((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    auto observed = gesel::internal::inflate_gzip_buffer(compressed, path);
+    EXPECT_EQ(std::string(observed.begin(), observed.end()), contents);
+
+    // Each block should be its own Gzip member, each of which starts with the magic bytes.
+    size_t num_members = 0;
+    for (size_t i = 0; i + 3 < compressed.size(); ++i) {
+        num_members += (compressed.compare(i, 3, "\x1f\x8b\x08") == 0);
+    }
+    EXPECT_GE(num_members, contents.size() / opt.block_size);
+
+    // Empty files are still valid.
+    {
+        gesel::internal::ParallelGzipWriter writer(path, opt);
+        writer.finish();
+    }
+    std::ifstream in2(path, std::ios::binary);
+    std::string empty((std::istreambuf_iterator<char>(in2)), std::istreambuf_iterator<char>());
+    EXPECT_FALSE(empty.empty());
+    EXPECT_TRUE(gesel::internal::inflate_gzip_buffer(empty, path).empty());
+}
+
+TEST(WriteDatabase, Empty) {
+    auto dir = temp_file_path("writer");
+    std::filesystem::create_directory(dir);
+    auto prefix = dir + "/9606_";
+
+    std::vector<gesel::CollectionDetails> collections(1);
+    collections[0].title = "empty";
+    gesel::write_database(prefix, collections, 10, gesel::WriteDatabaseOptions());
+    gesel::validate_database(prefix, 10);
+
+    gesel::write_database(prefix, std::vector<gesel::CollectionDetails>(), 0, gesel::WriteDatabaseOptions());
+    gesel::validate_database(prefix, 0);
+}
+
+TEST(WriteDatabase, Failures) {
+    auto dir = temp_file_path("writer");
+    std::filesystem::create_directory(dir);
+    auto prefix = dir + "/9606_";
+    gesel::WriteDatabaseOptions opt;
+
+    std::vector<gesel::CollectionDetails> collections(1);
+    collections[0].title = "foo\tbar";
+    expect_error([&]() { gesel::write_database(prefix, collections, 10, opt); }, "title for collection 0");
+
+    collections[0].title = "foo";
+    collections[0].sets.resize(2);
+    collections[0].sets[1].description = "foo\nbar";
+    expect_error([&]() { gesel::write_database(prefix, collections, 10, opt); }, "description for set 1");
+
+    collections[0].sets[1].description = "bar";
+    collections[0].sets[1].genes = { 1, 5, 10 };
+    expect_error([&]() { gesel::write_database(prefix, collections, 10, opt); }, "out-of-range gene index for set 1");
+
+    collections[0].sets[1].genes = { 5, 1, 5 };
+    expect_error([&]() { gesel::write_database(prefix, collections, 10, opt); }, "duplicate gene indices in set 1");
+    EXPECT_FALSE(std::filesystem::exists(prefix + "collections.tsv"));
+
+    std::vector<gesel::GeneNames> genes;
+    expect_error([&]() { gesel::write_genes(prefix, genes, opt); }, "at least one");
+
+    genes.resize(2);
+    genes[0].type = "symbol";
+    genes[0].names = { { "A" }, { "B" } };
+    genes[1].type = "ensembl";
+    genes[1].names = { { "A" } };
+    expect_error([&]() { gesel::write_genes(prefix, genes, opt); }, "inconsistent number of genes");
+
+    genes[1].names.push_back({ "" });
+    expect_error([&]() { gesel::write_genes(prefix, genes, opt); }, "empty name for gene 1 of type 'ensembl'");
+
+    genes[1].names.back() = { "B", "C", "B" };
+    expect_error([&]() { gesel::write_genes(prefix, genes, opt); }, "duplicated names");
+
+    genes[1].names.back() = { "B\tC" };
+    expect_error([&]() { gesel::write_genes(prefix, genes, opt); }, "tabs or newlines");
+}